@@ -15,6 +15,7 @@
  */
 
 #include <math.h>
+#include <stdlib.h>
 
 //#define LOG_NDEBUG 0
 #define LOG_TAG "A2dpAudioInterface"
@@ -30,7 +31,20 @@
 namespace android_audio_legacy {
 
 static const char *sA2dpWakeLock = "A2dpOutputStream";
-#define MAX_WRITE_RETRIES  5
+
+// a2dp_write() returns 0 while the link is congested: back off between
+// attempts, doubling from kMinBackoffUs up to kMaxBackoffUs
+static const useconds_t kMinBackoffUs = 1000;
+static const useconds_t kMaxBackoffUs = 8000;
+// chunks handed to a2dp_write() carry about this much link time, in whole SBC blocks
+static const uint32_t kChunkMs = 20;
+static const size_t kSbcBlockSize = 512;
+// default time the a2dp stream stays started after standby, see keepWarm_l()
+static const uint32_t kWarmStandbyMs = 3000;
+static const char *kKeyWarmStandbyMs = "a2dp_warm_standby_ms";
+
+// sampling rates the SBC encoder supports
+static const uint32_t kSampleRates[] = { 16000, 32000, 44100, 48000 };
 
 // ----------------------------------------------------------------------------
 
@@ -45,7 +59,8 @@ static const char *sA2dpWakeLock = "A2dpOutputStream";
 //}
 
 A2dpAudioInterface::A2dpAudioInterface(AudioHardwareInterface* hw) :
-    mOutput(0), mHardwareInterface(hw), mBluetoothEnabled(true), mSuspended(false)
+    AudioHardwareExtension(this), mOutput(0), mHardwareInterface(hw), mBluetoothEnabled(true), mSuspended(false),
+    mThreadPolicy(new AudioThreadPolicy())
 {
 }
 
@@ -79,7 +94,7 @@ AudioStreamOut* A2dpAudioInterface::openOutputStream(
     }
 
     // create new output stream
-    A2dpAudioStreamOut* out = new A2dpAudioStreamOut();
+    A2dpAudioStreamOut* out = new A2dpAudioStreamOut(mThreadPolicy);
     if ((err = out->set(devices, format, channels, sampleRate)) == NO_ERROR) {
         mOutput = out;
         mOutput->setBluetoothEnabled(mBluetoothEnabled);
@@ -133,32 +148,56 @@ status_t A2dpAudioInterface::getMicMute(bool* state)
 
 status_t A2dpAudioInterface::setParameters(const String8& keyValuePairs)
 {
-    AudioParameter param = AudioParameter(keyValuePairs);
-    String8 value;
-    String8 key;
+    AudioParameterList param;
+    ALOGV("setParameters() %s", keyValuePairs.string());
+
+    status_t status = param.parse(keyValuePairs.string());
+    if (status != NO_ERROR) {
+        return status;
+    }
+    return setParameterList(param);
+}
+
+status_t A2dpAudioInterface::setParameterList(const AudioParameterList& param)
+{
+    const char *value;
+    size_t consumed = 0;
     status_t status = NO_ERROR;
 
-    ALOGV("setParameters() %s", keyValuePairs.string());
+    // the writer thread follows this module's policy, the wrapped hardware
+    // gets the same keys below for its own threads
+    status = mThreadPolicy->setParameters(param);
 
-    key = "bluetooth_enabled";
-    if (param.get(key, value) == NO_ERROR) {
-        mBluetoothEnabled = (value == "true");
+    if (param.get(AudioParameterList::KEY_BLUETOOTH_ENABLED, &value) == NO_ERROR) {
+        mBluetoothEnabled = (strcmp(value, "true") == 0);
         if (mOutput) {
             mOutput->setBluetoothEnabled(mBluetoothEnabled);
         }
-        param.remove(key);
+        consumed++;
     }
-    key = String8("A2dpSuspended");
-    if (param.get(key, value) == NO_ERROR) {
-        mSuspended = (value == "true");
+    if (param.get(AudioParameterList::KEY_A2DP_SUSPENDED, &value) == NO_ERROR) {
+        mSuspended = (strcmp(value, "true") == 0);
         if (mOutput) {
             mOutput->setSuspended(mSuspended);
         }
-        param.remove(key);
+        consumed++;
     }
 
-    if (param.size()) {
-        status_t hwStatus = mHardwareInterface->setParameters(param.toString());
+    if (param.size() > consumed) {
+        status_t hwStatus;
+        if (consumed == 0) {
+            hwStatus = android_audio_legacy::setParameterList(mHardwareInterface, param);
+        } else {
+            AudioParameterList hwParam;
+            for (size_t i = 0; i < param.size(); i++) {
+                int id = param.idAt(i);
+                if (id != AudioParameterList::KEY_BLUETOOTH_ENABLED &&
+                        id != AudioParameterList::KEY_A2DP_SUSPENDED) {
+                    hwParam.add(param.keyAt(i), param.valueAt(i));
+                }
+            }
+            hwStatus = android_audio_legacy::setParameterList(mHardwareInterface, hwParam);
+        }
         if (status == NO_ERROR) {
             status = hwStatus;
         }
@@ -217,20 +256,27 @@ status_t A2dpAudioInterface::setMasterVolume(float v)
 
 status_t A2dpAudioInterface::dump(int fd, const Vector<String16>& args)
 {
+    mThreadPolicy->dump(fd);
     return mHardwareInterface->dumpState(fd, args);
 }
 
 // ----------------------------------------------------------------------------
 
-A2dpAudioInterface::A2dpAudioStreamOut::A2dpAudioStreamOut() :
-    mFd(-1), mStandby(true), mStartCount(0), mRetryCount(0), mData(NULL),
+A2dpAudioInterface::A2dpAudioStreamOut::A2dpAudioStreamOut(
+        const sp<AudioThreadPolicy>& threadPolicy) :
+    AudioStreamOutExtension(this), mFd(-1), mStandby(true), mStartCount(0), mRetryCount(0),
     // assume BT enabled to start, this is safe because its only the
     // enabled->disabled transition we are worried about
-    mBluetoothEnabled(true), mDevice(0), mClosing(false), mSuspended(false)
+    mBluetoothEnabled(true), mDevice(0), mClosing(false), mSuspended(false),
+    mLastWriteTime(0), mBufferDurationUs(0),
+    mSampleRate(44100), mChannels(AudioSystem::CHANNEL_OUT_STEREO),
+    mData(NULL), mSendBuffer(NULL), mThreadPolicy(threadPolicy), mWriteStatus(NO_ERROR),
+    mBytesDropped(0), mBytesSent(0), mBuffersSent(0), mEncodeNs(0), mSendNs(0), mMaxSendNs(0),
+    mSendDrops(0), mChunkSize(0), mLinkRate(0), mSessionStart(0), mSessionBytes(0),
+    mWarmStandbyMs(kWarmStandbyMs), mWarmUntil(0), mStreamStarted(false), mWarmResumes(0)
 {
     // use any address by default
     strcpy(mA2dpAddress, "00:00:00:00:00:00");
-    init();
 }
 
 status_t A2dpAudioInterface::A2dpAudioStreamOut::set(
@@ -247,10 +293,19 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::set(
     if (lChannels == 0) lChannels = channels();
     if (lRate == 0) lRate = sampleRate();
 
+    bool rateSupported = false;
+    for (size_t i = 0; i < sizeof(kSampleRates) / sizeof(kSampleRates[0]); i++) {
+        if (lRate == kSampleRates[i]) {
+            rateSupported = true;
+            break;
+        }
+    }
+
     // check values
     if ((lFormat != format()) ||
-            (lChannels != channels()) ||
-            (lRate != sampleRate())){
+            (lChannels != AudioSystem::CHANNEL_OUT_STEREO &&
+             lChannels != AudioSystem::CHANNEL_OUT_MONO) ||
+            !rateSupported) {
         if (pFormat) *pFormat = format();
         if (pChannels) *pChannels = channels();
         if (pRate) *pRate = sampleRate();
@@ -262,24 +317,57 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::set(
     if (pRate) *pRate = lRate;
 
     mDevice = device;
+    mSampleRate = lRate;
+    mChannels = lChannels;
     mBufferDurationUs = ((bufferSize() * 1000 )/ frameSize() / sampleRate()) * 1000;
-    return NO_ERROR;
+    mChunkSize = bufferSize();
+
+    // room for the buffer being sent and the one queued behind it
+    status_t status = mRing.init(2 * bufferSize());
+    if (status != NO_ERROR) {
+        return status;
+    }
+    mSendBuffer = (uint8_t *)malloc(bufferSize());
+    if (mSendBuffer == NULL) {
+        return NO_MEMORY;
+    }
+    mThread = new WriteThread(this, mThreadPolicy);
+    status = mThread->run("A2dpWriteThread", ANDROID_PRIORITY_AUDIO);
+    if (status != NO_ERROR) {
+        ALOGE("A2dpAudioStreamOut::set() could not start writer thread: %d", status);
+        mThread.clear();
+    }
+    return status;
 }
 
 A2dpAudioInterface::A2dpAudioStreamOut::~A2dpAudioStreamOut()
 {
     ALOGV("A2dpAudioStreamOut destructor");
+    stopThread();
     close();
     ALOGV("A2dpAudioStreamOut destructor returning from close()");
+    free(mSendBuffer);
+}
+
+void A2dpAudioInterface::A2dpAudioStreamOut::stopThread()
+{
+    if (mThread == 0) {
+        return;
+    }
+    mThread->requestExit();
+    {
+        AudioPiMutex::Autolock lock(mThreadLock);
+        mDataCond.signal();
+    }
+    mThread->requestExitAndWait();
+    mThread.clear();
 }
 
 ssize_t A2dpAudioInterface::A2dpAudioStreamOut::write(const void* buffer, size_t bytes)
 {
     status_t status = -1;
     {
-        Mutex::Autolock lock(mLock);
-
-        size_t remaining = bytes;
+        AudioPiMutex::Autolock lock(mLock);
 
         if (!mBluetoothEnabled || mClosing || mSuspended) {
             ALOGV("A2dpAudioStreamOut::write(), but bluetooth disabled \
@@ -292,25 +380,19 @@ ssize_t A2dpAudioInterface::A2dpAudioStreamOut::write(const void* buffer, size_t
             acquire_wake_lock (PARTIAL_WAKE_LOCK, sA2dpWakeLock);
             mStandby = false;
             mLastWriteTime = systemTime();
+            // cancel the pending stop of a warm stream
+            AudioPiMutex::Autolock dataLock(mDataLock);
+            if (mWarmUntil.exchange(0) != 0 && mStreamStarted) {
+                mWarmResumes++;
+            }
         }
 
-        status = init();
+        // report a failure of the writer thread on the next write
+        status = mWriteStatus.exchange(NO_ERROR);
         if (status < 0)
             goto Error;
 
-        int retries = MAX_WRITE_RETRIES;
-        while (remaining > 0 && retries) {
-            status = a2dp_write(mData, buffer, remaining);
-            if (status < 0) {
-                ALOGE("a2dp_write failed err: %d\n", status);
-                goto Error;
-            }
-            if (status == 0) {
-                retries--;
-            }
-            remaining -= status;
-            buffer = (char *)buffer + status;
-        }
+        queue(buffer, bytes);
 
         // if A2DP sink runs abnormally fast, sleep a little so that audioflinger mixer thread
         // does no spin and starve other threads.
@@ -334,10 +416,191 @@ Error:
     return status;
 }
 
-status_t A2dpAudioInterface::A2dpAudioStreamOut::init()
+// called with mLock held: hand the buffer to the writer thread, waiting at most
+// one buffer duration for it to make room
+void A2dpAudioInterface::A2dpAudioStreamOut::queue(const void* buffer, size_t bytes)
+{
+    const size_t limit = bufferSize();
+
+    while (bytes > 0) {
+        size_t chunk = bytes < limit ? bytes : limit;
+        bool full;
+        {
+            AudioPiMutex::Autolock lock(mThreadLock);
+            nsecs_t deadline = systemTime() + us2ns(mBufferDurationUs);
+            while ((full = mRing.availableToRead() + chunk > limit)) {
+                nsecs_t now = systemTime();
+                if (now >= deadline) {
+                    break;
+                }
+                mSpaceCond.waitRelative(mThreadLock, deadline - now);
+            }
+        }
+        if (full) {
+            ALOGW("A2dpAudioStreamOut::write() writer thread late, dropping %zu bytes", chunk);
+            mBytesDropped += chunk;
+        } else {
+            mRing.write(buffer, chunk);
+            AudioPiMutex::Autolock lock(mThreadLock);
+            mDataCond.signal();
+        }
+        bytes -= chunk;
+        buffer = (const char *)buffer + chunk;
+    }
+}
+
+bool A2dpAudioInterface::A2dpAudioStreamOut::processWrite()
+{
+    {
+        AudioPiMutex::Autolock lock(mThreadLock);
+        if (mRing.availableToRead() == 0) {
+            // stopThread() signals under mThreadLock after requestExit()
+            if (mThread->exiting()) {
+                return true;
+            }
+            nsecs_t warmUntil = mWarmUntil.load();
+            if (warmUntil == 0) {
+                mDataCond.wait(mThreadLock);
+                return true;
+            }
+            nsecs_t now = systemTime();
+            if (now < warmUntil) {
+                mDataCond.waitRelative(mThreadLock, warmUntil - now);
+                return true;
+            }
+        }
+    }
+
+    AudioPiMutex::Autolock lock(mDataLock);
+    nsecs_t warmUntil = mWarmUntil.load();
+    if (warmUntil != 0 && systemTime() >= warmUntil) {
+        // idle for the whole warm period: really stop now. write() clears
+        // mWarmUntil under mDataLock, so this cannot race with a resume
+        ALOGV("A2dpAudioStreamOut warm standby expired");
+        stop_l(true);
+        return true;
+    }
+
+    // standby_l() may have flushed the ring in the meantime
+    size_t bytes = mRing.read(mSendBuffer, bufferSize());
+    {
+        AudioPiMutex::Autolock threadLock(mThreadLock);
+        mSpaceCond.signal();
+    }
+    if (bytes == 0) {
+        return true;
+    }
+
+    status_t status = init_l();
+    if (status == NO_ERROR) {
+        mStreamStarted = true;
+        status = send_l(mSendBuffer, bytes);
+    }
+    if (status < 0) {
+        mWriteStatus.store(status);
+    }
+    return true;
+}
+
+// called with mDataLock held: send one buffer, giving up on what the link could
+// not take within one buffer duration
+status_t A2dpAudioInterface::A2dpAudioStreamOut::send_l(const void* buffer, size_t bytes)
+{
+    nsecs_t start = systemTime();
+    nsecs_t startCpu = systemTime(SYSTEM_TIME_THREAD);
+    nsecs_t deadline = start + us2ns(mBufferDurationUs);
+    nsecs_t writeNs = 0;
+    useconds_t backoffUs = kMinBackoffUs;
+    status_t status = NO_ERROR;
+    size_t remaining = bytes;
+
+    if (mSessionStart == 0) {
+        mSessionStart = start;
+    }
+
+    while (remaining > 0) {
+        size_t chunk = remaining < mChunkSize ? remaining : mChunkSize;
+        nsecs_t writeStart = systemTime();
+        int written = a2dp_write(mData, buffer, chunk);
+        nsecs_t now = systemTime();
+        if (written < 0) {
+            ALOGE("a2dp_write failed err: %d\n", written);
+            status = written;
+            break;
+        }
+        if (written == 0) {
+            if (now >= deadline) {
+                break;
+            }
+            // the link is congested, wait for it instead of spinning
+            useconds_t leftUs = (useconds_t)ns2us(deadline - now);
+            usleep(backoffUs < leftUs ? backoffUs : leftUs);
+            if (backoffUs < kMaxBackoffUs) {
+                backoffUs *= 2;
+            }
+            continue;
+        }
+        backoffUs = kMinBackoffUs;
+        writeNs += now - writeStart;
+        remaining -= written;
+        buffer = (const char *)buffer + written;
+    }
+
+    if (remaining > 0 && status == NO_ERROR) {
+        ALOGW("A2dpAudioStreamOut link congested, dropping %zu of %zu bytes", remaining, bytes);
+        mBytesDropped += remaining;
+        mSendDrops++;
+    }
+
+    // a2dp_write() encodes on this thread, so its CPU time is the SBC encode cost
+    nsecs_t sendNs = systemTime() - start;
+    mEncodeNs += systemTime(SYSTEM_TIME_THREAD) - startCpu;
+    mSendNs += sendNs;
+    if (sendNs > mMaxSendNs) {
+        mMaxSendNs = sendNs;
+    }
+    mBytesSent += bytes - remaining;
+    mBuffersSent++;
+    mSessionBytes += bytes - remaining;
+    updateLinkRate_l(bytes - remaining, writeNs);
+    return status;
+}
+
+// called with mDataLock held: follow the rate at which a2dp_write() accepts data
+// and size the chunks so that a congested link is retried in small steps
+void A2dpAudioInterface::A2dpAudioStreamOut::updateLinkRate_l(size_t bytes, nsecs_t ns)
+{
+    if (bytes == 0 || ns <= 0) {
+        return;
+    }
+    uint64_t rate = (uint64_t)bytes * 1000000000LL / ns;
+    if (rate > UINT32_MAX) {
+        rate = UINT32_MAX;
+    }
+    // first order low pass, 1/8 weight to the new measurement
+    if (mLinkRate == 0) {
+        mLinkRate = (uint32_t)rate;
+    } else {
+        mLinkRate = (uint32_t)(((uint64_t)mLinkRate * 7 + rate) / 8);
+    }
+
+    size_t chunk = ((uint64_t)mLinkRate * kChunkMs / 1000) / kSbcBlockSize * kSbcBlockSize;
+    if (chunk < kSbcBlockSize) {
+        chunk = kSbcBlockSize;
+    } else if (chunk > bufferSize()) {
+        chunk = bufferSize();
+    }
+    if (chunk != mChunkSize) {
+        ALOGV("A2dpAudioStreamOut link %u bytes/s, chunk %zu bytes", mLinkRate, chunk);
+        mChunkSize = chunk;
+    }
+}
+
+// called with mDataLock held
+status_t A2dpAudioInterface::A2dpAudioStreamOut::init_l()
 {
     if (!mData) {
-        status_t status = a2dp_init(44100, 2, &mData);
+        status_t status = a2dp_init(mSampleRate, AudioSystem::popCount(mChannels), &mData);
         if (status < 0) {
             ALOGE("a2dp_init failed err: %d\n", status);
             mData = NULL;
@@ -351,7 +614,7 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::init()
 
 status_t A2dpAudioInterface::A2dpAudioStreamOut::standby()
 {
-    Mutex::Autolock lock(mLock);
+    AudioPiMutex::Autolock lock(mLock);
     return standby_l();
 }
 
@@ -359,56 +622,121 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::standby_l()
 {
     int result = NO_ERROR;
 
+    AudioPiMutex::Autolock lock(mDataLock);
     if (!mStandby) {
-        ALOGV_IF(mClosing || !mBluetoothEnabled, "Standby skip stop: closing %d enabled %d",
-                mClosing, mBluetoothEnabled);
-        if (!mClosing && mBluetoothEnabled) {
-            result = a2dp_stop(mData);
+        // drop what the writer thread has not sent yet
+        mRing.skip(mRing.availableToRead());
+        mSessionStart = 0;
+        mSessionBytes = 0;
+        if (mStreamStarted && keepWarm_l()) {
+            // the wake lock is kept until stop_l() ends the warm period
+            ALOGV("A2dpAudioStreamOut warm standby for %u ms", mWarmStandbyMs);
+            mWarmUntil.store(systemTime() + ms2ns(mWarmStandbyMs));
+            AudioPiMutex::Autolock threadLock(mThreadLock);
+            mDataCond.signal();
+        } else {
+            release_wake_lock(sA2dpWakeLock);
         }
-        release_wake_lock(sA2dpWakeLock);
         mStandby = true;
     }
 
+    // a warm stream is stopped as soon as the policy no longer allows it
+    if (mStreamStarted && (mWarmUntil.load() == 0 || !keepWarm_l())) {
+        ALOGV_IF(mClosing || !mBluetoothEnabled, "Standby skip stop: closing %d enabled %d",
+                mClosing, mBluetoothEnabled);
+        result = stop_l(!mClosing && mBluetoothEnabled);
+    }
+
     return result;
 }
 
+// called with mLock held. The stream stays started in standby only while
+// nothing else needs the link: not while suspended for SCO, closing or with
+// bluetooth off. A warm stream holds the wake lock, so the warm period is
+// bounded by mWarmStandbyMs rather than by the next suspend.
+bool A2dpAudioInterface::A2dpAudioStreamOut::keepWarm_l() const
+{
+    return mWarmStandbyMs != 0 && mBluetoothEnabled && !mClosing && !mSuspended;
+}
+
+// called with mDataLock held. Ends a warm period and releases the wake lock
+// standby_l() kept for it.
+status_t A2dpAudioInterface::A2dpAudioStreamOut::stop_l(bool linkUp)
+{
+    if (mWarmUntil.exchange(0) != 0) {
+        release_wake_lock(sA2dpWakeLock);
+    }
+    if (!mStreamStarted) {
+        return NO_ERROR;
+    }
+    mStreamStarted = false;
+    if (!linkUp) {
+        return NO_ERROR;
+    }
+    return a2dp_stop(mData);
+}
+
 status_t A2dpAudioInterface::A2dpAudioStreamOut::setParameters(const String8& keyValuePairs)
 {
-    AudioParameter param = AudioParameter(keyValuePairs);
-    String8 value;
-    String8 key = String8("a2dp_sink_address");
+    AudioParameterList param;
+    ALOGV("A2dpAudioStreamOut::setParameters() %s", keyValuePairs.string());
+
+    status_t status = param.parse(keyValuePairs.string());
+    if (status != NO_ERROR) {
+        return status;
+    }
+    return setParameterList(param);
+}
+
+status_t A2dpAudioInterface::A2dpAudioStreamOut::setParameterList(const AudioParameterList& param)
+{
+    const char *value;
+    size_t consumed = 0;
     status_t status = NO_ERROR;
     int device;
-    ALOGV("A2dpAudioStreamOut::setParameters() %s", keyValuePairs.string());
 
-    if (param.get(key, value) == NO_ERROR) {
-        if (value.length() != strlen("00:00:00:00:00:00")) {
+    if (param.get(AudioParameterList::KEY_A2DP_SINK_ADDRESS, &value) == NO_ERROR) {
+        if (strlen(value) != strlen("00:00:00:00:00:00")) {
             status = BAD_VALUE;
         } else {
-            setAddress(value.string());
+            setAddress(value);
         }
-        param.remove(key);
+        consumed++;
     }
-    key = String8("closing");
-    if (param.get(key, value) == NO_ERROR) {
-        mClosing = (value == "true");
+    if (param.get(AudioParameterList::KEY_CLOSING, &value) == NO_ERROR) {
+        mClosing = (strcmp(value, "true") == 0);
         if (mClosing) {
             standby();
         }
-        param.remove(key);
+        consumed++;
     }
-    key = AudioParameter::keyRouting;
-    if (param.getInt(key, device) == NO_ERROR) {
+    if (param.getInt(AudioParameterList::KEY_ROUTING, &device) == NO_ERROR) {
         if (audio_is_a2dp_out_device(device)) {
             mDevice = device;
             status = NO_ERROR;
         } else {
             status = BAD_VALUE;
         }
-        param.remove(key);
+        consumed++;
+    }
+    ssize_t index = param.indexOf(kKeyWarmStandbyMs);
+    if (index >= 0) {
+        char *last;
+        long ms = strtol(param.valueAt(index), &last, 0);
+        if (*last != '\0' || ms < 0) {
+            status = BAD_VALUE;
+        } else {
+            AudioPiMutex::Autolock lock(mLock);
+            mWarmStandbyMs = (uint32_t)ms;
+            // stops a warm stream if the new period is 0
+            if (mStandby) {
+                standby_l();
+            }
+        }
+        consumed++;
     }
 
-    if (param.size()) {
+    if (param.size() > consumed) {
         status = BAD_VALUE;
     }
     return status;
@@ -428,6 +756,10 @@ String8 A2dpAudioInterface::A2dpAudioStreamOut::getParameters(const String8& key
     if (param.get(key, value) == NO_ERROR) {
         param.addInt(key, (int)mDevice);
     }
+    key = kKeyWarmStandbyMs;
+    if (param.get(key, value) == NO_ERROR) {
+        param.addInt(key, (int)mWarmStandbyMs);
+    }
 
     ALOGV("A2dpAudioStreamOut::getParameters() %s", param.toString().string());
     return param.toString();
@@ -435,11 +767,12 @@ String8 A2dpAudioInterface::A2dpAudioStreamOut::getParameters(const String8& key
 
 status_t A2dpAudioInterface::A2dpAudioStreamOut::setAddress(const char* address)
 {
-    Mutex::Autolock lock(mLock);
+    AudioPiMutex::Autolock lock(mLock);
 
     if (strlen(address) != strlen("00:00:00:00:00:00"))
         return -EINVAL;
 
+    AudioPiMutex::Autolock dataLock(mDataLock);
     strcpy(mA2dpAddress, address);
     if (mData)
         a2dp_set_sink(mData, mA2dpAddress);
@@ -451,7 +784,7 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::setBluetoothEnabled(bool enable
 {
     ALOGD("setBluetoothEnabled %d", enabled);
 
-    Mutex::Autolock lock(mLock);
+    AudioPiMutex::Autolock lock(mLock);
 
     mBluetoothEnabled = enabled;
     if (!enabled) {
@@ -470,7 +803,7 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::setSuspended(bool onOff)
 
 status_t A2dpAudioInterface::A2dpAudioStreamOut::close()
 {
-    Mutex::Autolock lock(mLock);
+    AudioPiMutex::Autolock lock(mLock);
     ALOGV("A2dpAudioStreamOut::close() calling close_l()");
     return close_l();
 }
@@ -478,6 +811,8 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::close()
 status_t A2dpAudioInterface::A2dpAudioStreamOut::close_l()
 {
     standby_l();
+    AudioPiMutex::Autolock lock(mDataLock);
+    stop_l(!mClosing && mBluetoothEnabled);
     if (mData) {
         ALOGV("A2dpAudioStreamOut::close_l() calling a2dp_cleanup(mData)");
         a2dp_cleanup(mData);
@@ -488,6 +823,38 @@ status_t A2dpAudioInterface::A2dpAudioStreamOut::close_l()
 
 status_t A2dpAudioInterface::A2dpAudioStreamOut::dump(int fd, const Vector<String16>& args)
 {
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    AudioPiMutex::Autolock lock(mDataLock);
+
+    uint64_t buffers = mBuffersSent != 0 ? mBuffersSent : 1;
+    snprintf(buffer, SIZE, "\tA2dpAudioStreamOut: %u Hz, %u channels, standby %d\n"
+             "\twriter queue: %zu bytes, dropped %llu bytes, %llu buffers cut short\n"
+             "\tsent %llu bytes in %llu buffers, encode %lld us/buffer,"
+             " send %lld us/buffer (max %lld us)\n",
+             mSampleRate, AudioSystem::popCount(mChannels), mStandby,
+             mRing.availableToRead(), (unsigned long long)mBytesDropped.load(),
+             (unsigned long long)mSendDrops,
+             (unsigned long long)mBytesSent, (unsigned long long)mBuffersSent,
+             (long long)ns2us(mEncodeNs / buffers), (long long)ns2us(mSendNs / buffers),
+             (long long)ns2us(mMaxSendNs));
+    ::write(fd, buffer, strlen(buffer));
+
+    nsecs_t warmUntil = mWarmUntil.load();
+    nsecs_t warmLeft = warmUntil != 0 ? warmUntil - systemTime() : 0;
+    snprintf(buffer, SIZE, "\twarm standby: %u ms, stream started %d, stop in %lld ms,"
+             " %u warm resumes\n",
+             mWarmStandbyMs, mStreamStarted, (long long)ns2ms(warmLeft > 0 ? warmLeft : 0),
+             mWarmResumes);
+    ::write(fd, buffer, strlen(buffer));
+
+    nsecs_t sessionNs = mSessionStart != 0 ? systemTime() - mSessionStart : 0;
+    snprintf(buffer, SIZE, "\tlink: %u bytes/s, chunk %zu bytes, session %llu bytes"
+             " in %lld ms (%llu bytes/s)\n",
+             mLinkRate, mChunkSize, (unsigned long long)mSessionBytes,
+             (long long)ns2ms(sessionNs),
+             (unsigned long long)(sessionNs > 0 ? mSessionBytes * 1000000000LL / sessionNs : 0));
+    ::write(fd, buffer, strlen(buffer));
     return NO_ERROR;
 }
 
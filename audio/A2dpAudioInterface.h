@@ -19,16 +19,23 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <atomic>
 
 #include <utils/threads.h>
 
 #include <hardware_legacy/AudioHardwareBase.h>
+#include <hardware_legacy/AudioHardwareExtension.h>
+
+#include "AudioPiMutex.h"
+#include "AudioRingBuffer.h"
+#include "AudioThreadPolicy.h"
 
 
 namespace android_audio_legacy {
-    using android::Mutex;
+    using android::Thread;
+    using android::sp;
 
-class A2dpAudioInterface : public AudioHardwareBase
+class A2dpAudioInterface : public AudioHardwareBase, public AudioHardwareExtension
 {
     class A2dpAudioStreamOut;
 
@@ -48,6 +55,7 @@ public:
 
     virtual status_t    setParameters(const String8& keyValuePairs);
     virtual String8     getParameters(const String8& keys);
+    virtual status_t    setParameterList(const AudioParameterList& param);
 
     virtual size_t      getInputBufferSize(uint32_t sampleRate, int format, int channelCount);
 
@@ -74,37 +82,66 @@ protected:
     virtual status_t    dump(int fd, const Vector<String16>& args);
 
 private:
-    class A2dpAudioStreamOut : public AudioStreamOut {
+    class A2dpAudioStreamOut : public AudioStreamOut, public AudioStreamOutExtension {
     public:
-                            A2dpAudioStreamOut();
+                            A2dpAudioStreamOut(const sp<AudioThreadPolicy>& threadPolicy);
         virtual             ~A2dpAudioStreamOut();
                 status_t    set(uint32_t device,
                                 int *pFormat,
                                 uint32_t *pChannels,
                                 uint32_t *pRate);
-        virtual uint32_t    sampleRate() const { return 44100; }
+        virtual uint32_t    sampleRate() const { return mSampleRate; }
         // SBC codec wants a multiple of 512
         virtual size_t      bufferSize() const { return 512 * 20; }
-        virtual uint32_t    channels() const { return AudioSystem::CHANNEL_OUT_STEREO; }
+        virtual uint32_t    channels() const { return mChannels; }
         virtual int         format() const { return AudioSystem::PCM_16_BIT; }
-        virtual uint32_t    latency() const { return ((1000*bufferSize())/frameSize())/sampleRate() + 200; }
+        // one buffer can wait for the writer thread while another one is sent
+        virtual uint32_t    latency() const { return ((2000*bufferSize())/frameSize())/sampleRate() + 200; }
         virtual status_t    setVolume(float left, float right) { return INVALID_OPERATION; }
         virtual ssize_t     write(const void* buffer, size_t bytes);
                 status_t    standby();
         virtual status_t    dump(int fd, const Vector<String16>& args);
         virtual status_t    setParameters(const String8& keyValuePairs);
         virtual String8     getParameters(const String8& keys);
+        virtual status_t    setParameterList(const AudioParameterList& param);
         virtual status_t    getRenderPosition(uint32_t *dspFrames);
 
     private:
+        // encodes and sends what write() queued, so that a slow link does not
+        // stall the mixer thread
+        class WriteThread : public Thread {
+        public:
+                                WriteThread(A2dpAudioStreamOut *stream,
+                                            const sp<AudioThreadPolicy>& threadPolicy)
+                                    : Thread(false), mStream(stream),
+                                      mThreadPolicy(threadPolicy), mPolicyGeneration(0) {}
+                    bool        exiting() const { return exitPending(); }
+        private:
+            virtual bool        threadLoop() {
+                                    mThreadPolicy->apply(AudioThreadPolicy::ROLE_RENDER,
+                                                         &mPolicyGeneration);
+                                    return !exitPending() && mStream->processWrite();
+                                }
+            A2dpAudioStreamOut  *mStream;
+            const sp<AudioThreadPolicy> mThreadPolicy;
+            uint32_t            mPolicyGeneration;
+        };
+
         friend class A2dpAudioInterface;
-                status_t    init();
+                status_t    init_l();
                 status_t    close();
                 status_t    close_l();
                 status_t    setAddress(const char* address);
                 status_t    setBluetoothEnabled(bool enabled);
                 status_t    setSuspended(bool onOff);
                 status_t    standby_l();
+                status_t    stop_l(bool linkUp);
+                bool        keepWarm_l() const;
+                void        queue(const void* buffer, size_t bytes);
+                bool        processWrite();
+                status_t    send_l(const void* buffer, size_t bytes);
+                void        updateLinkRate_l(size_t bytes, nsecs_t ns);
+                void        stopThread();
 
     private:
                 int         mFd;
@@ -112,14 +149,55 @@ private:
                 int         mStartCount;
                 int         mRetryCount;
                 char        mA2dpAddress[20];
-                void*       mData;
-                Mutex       mLock;
+                // the locks below are shared between the mixer thread, the
+                // writer thread and binder threads
+                AudioPiMutex mLock;
                 bool        mBluetoothEnabled;
                 uint32_t    mDevice;
                 bool        mClosing;
                 bool        mSuspended;
                 nsecs_t     mLastWriteTime;
                 uint32_t    mBufferDurationUs;
+                uint32_t    mSampleRate;
+                uint32_t    mChannels;
+
+                // liba2dp calls are serialized by mDataLock, which the writer thread
+                // holds while sending. Lock order is mLock, then mDataLock.
+                AudioPiMutex mDataLock;
+                void*       mData;
+                uint8_t     *mSendBuffer;
+
+                // write() queues into mRing; mThreadLock and the conditions only
+                // carry wake ups between write() and the writer thread
+                AudioRingBuffer mRing;
+                AudioPiMutex mThreadLock;
+                AudioPiCondition mDataCond;
+                AudioPiCondition mSpaceCond;
+                const sp<AudioThreadPolicy> mThreadPolicy;
+                sp<WriteThread> mThread;
+                std::atomic<status_t> mWriteStatus;     // last error of the writer thread
+
+                // statistics
+                std::atomic<uint64_t> mBytesDropped;    // written while the queue was full
+                uint64_t    mBytesSent;                 // under mDataLock
+                uint64_t    mBuffersSent;
+                nsecs_t     mEncodeNs;                  // writer thread CPU time in a2dp_write()
+                nsecs_t     mSendNs;                    // wall time in a2dp_write()
+                nsecs_t     mMaxSendNs;
+                uint64_t    mSendDrops;                 // buffers cut short by the deadline
+
+                // link pacing, writer thread under mDataLock
+                size_t      mChunkSize;                 // bytes handed to a2dp_write() at once
+                uint32_t    mLinkRate;                  // smoothed throughput in bytes/s, 0 if unknown
+                nsecs_t     mSessionStart;              // first send since standby, 0 if none
+                uint64_t    mSessionBytes;
+
+                // warm standby: the a2dp stream is left running for mWarmStandbyMs
+                // after standby, so that a short sound resumes without a restart
+                uint32_t    mWarmStandbyMs;             // under mLock, 0 to stop at once
+                std::atomic<nsecs_t> mWarmUntil;        // writer thread stops the stream then, 0 if not warm
+                bool        mStreamStarted;             // under mDataLock, a2dp_stop() pending
+                uint32_t    mWarmResumes;               // under mDataLock
     };
 
     friend class A2dpAudioStreamOut;
@@ -129,6 +207,7 @@ private:
     char        mA2dpAddress[20];
     bool        mBluetoothEnabled;
     bool        mSuspended;
+    const sp<AudioThreadPolicy> mThreadPolicy;  // the writer thread's
 };
 
 
@@ -0,0 +1,258 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioCaptureHub"
+//#define LOG_NDEBUG 0
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utils/Log.h>
+
+#include "AudioCaptureHub.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// duration of each device read
+static const uint32_t kPeriodMs = 20;
+// a stream can fall this far behind before it loses frames
+static const uint32_t kRingMs = 500;
+
+// ----------------------------------------------------------------------------
+
+AudioCaptureHub::AudioCaptureHub(int fd, size_t frameSize, uint32_t sampleRate,
+                                 const sp<AudioThreadPolicy>& threadPolicy)
+    : Thread(false),
+      mFd(fd), mFrameSize(frameSize), mSampleRate(sampleRate),
+      mPeriodFrames(0), mFrames(0), mBuffer(NULL), mPartialBytes(0),
+      mThreadPolicy(threadPolicy), mPolicyGeneration(0),
+      mWritePosition(0), mError(NO_ERROR),
+      mReaders(0), mReading(false), mTimePosition(0), mTime(0), mReadErrors(0)
+{
+}
+
+AudioCaptureHub::~AudioCaptureHub()
+{
+    free(mBuffer);
+}
+
+status_t AudioCaptureHub::start()
+{
+    mPeriodFrames = mSampleRate * kPeriodMs / 1000;
+    size_t frames = 1;
+    while (frames < mSampleRate * kRingMs / 1000 + mPeriodFrames) {
+        frames <<= 1;
+    }
+    mBuffer = (uint8_t *)malloc(frames * mFrameSize);
+    if (mBuffer == NULL) {
+        ALOGE("start() cannot allocate %zu frames", frames);
+        return NO_MEMORY;
+    }
+    mFrames = frames;
+    return run("AudioCaptureHub", ANDROID_PRIORITY_AUDIO);
+}
+
+void AudioCaptureHub::stop()
+{
+    requestExit();
+    {
+        AudioPiMutex::Autolock lock(mLock);
+        mReaderCond.signal();
+        mDataCond.broadcast();
+    }
+    requestExitAndWait();
+}
+
+uint64_t AudioCaptureHub::attach()
+{
+    AudioPiMutex::Autolock lock(mLock);
+    if (mReaders++ == 0) {
+        // reads failed while the device was released are not this reader's
+        mError.store(NO_ERROR);
+        mReaderCond.signal();
+    }
+    return mWritePosition.load(std::memory_order_acquire);
+}
+
+void AudioCaptureHub::detach()
+{
+    AudioPiMutex::Autolock lock(mLock);
+    mReaders--;
+}
+
+void AudioCaptureHub::waitIdle()
+{
+    AudioPiMutex::Autolock lock(mLock);
+    while (mReading && mReaders == 0) {
+        mIdleCond.wait(mLock);
+    }
+}
+
+ssize_t AudioCaptureHub::read(uint64_t *position, void *buffer, size_t frames,
+                              uint64_t *framesLost)
+{
+    // the period being read from the device overwrites the oldest frames
+    const uint64_t window = mFrames - mPeriodFrames;
+    uint8_t *out = (uint8_t *)buffer;
+    uint64_t pos = *position;
+    size_t done = 0;
+
+    while (done < frames) {
+        uint64_t write = mWritePosition.load(std::memory_order_acquire);
+        if (write == pos) {
+            AudioPiMutex::Autolock lock(mLock);
+            while (mWritePosition.load(std::memory_order_acquire) == pos &&
+                    mError.load() == NO_ERROR && !exitPending()) {
+                mDataCond.wait(mLock);
+            }
+            if (mWritePosition.load(std::memory_order_acquire) == pos) {
+                status_t error = mError.load();
+                if (done != 0) {
+                    break;
+                }
+                return error != NO_ERROR ? error : NO_INIT;
+            }
+            continue;
+        }
+        if (write - pos > window) {
+            *framesLost += write - window - pos;
+            pos = write - window;
+        }
+
+        size_t count = write - pos < frames - done ? write - pos : frames - done;
+        size_t offset = pos & (mFrames - 1);
+        size_t first = mFrames - offset < count ? mFrames - offset : count;
+        memcpy(out + done * mFrameSize, mBuffer + offset * mFrameSize, first * mFrameSize);
+        memcpy(out + (done + first) * mFrameSize, mBuffer, (count - first) * mFrameSize);
+
+        // the reader thread may have moved on while copying: if the start of
+        // what was copied is now outside the window, it may be overwritten
+        std::atomic_thread_fence(std::memory_order_acquire);
+        write = mWritePosition.load(std::memory_order_relaxed);
+        if (write - pos > window) {
+            *framesLost += write - window - pos;
+            pos = write - window;
+            continue;
+        }
+        pos += count;
+        done += count;
+    }
+    *position = pos;
+    return done;
+}
+
+status_t AudioCaptureHub::getCaptureTime(uint64_t position, nsecs_t *time)
+{
+    AudioPiMutex::Autolock lock(mLock);
+    if (mTimePosition == 0) {
+        return INVALID_OPERATION;
+    }
+    int64_t frames = (int64_t)(mTimePosition - position);
+    *time = mTime - frames * 1000000000LL / mSampleRate;
+    return NO_ERROR;
+}
+
+bool AudioCaptureHub::threadLoop()
+{
+    if (mThreadPolicy != 0) {
+        mThreadPolicy->apply(AudioThreadPolicy::ROLE_CAPTURE, &mPolicyGeneration);
+    }
+    {
+        AudioPiMutex::Autolock lock(mLock);
+        if (mReaders == 0) {
+            while (mReaders == 0 && !exitPending()) {
+                mReaderCond.wait(mLock);
+            }
+            // the device may have been released and reopened meanwhile
+            mPartialBytes = 0;
+        }
+        if (exitPending()) {
+            return false;
+        }
+        mReading = true;
+    }
+
+    // periods do not wrap, so that each is a single device read. A short read
+    // can end inside a frame: the next read completes it in place.
+    uint64_t write = mWritePosition.load(std::memory_order_relaxed);
+    size_t offset = write & (mFrames - 1);
+    size_t frames = mFrames - offset < mPeriodFrames ? mFrames - offset : mPeriodFrames;
+    ssize_t bytes = ::read(mFd, mBuffer + offset * mFrameSize + mPartialBytes,
+                           frames * mFrameSize - mPartialBytes);
+    status_t error = bytes < 0 ? -errno : NOT_ENOUGH_DATA;
+    nsecs_t now = systemTime();
+    {
+        AudioPiMutex::Autolock lock(mLock);
+        mReading = false;
+        mIdleCond.broadcast();
+    }
+
+    if (bytes <= 0) {
+        if (error == -EINTR) {
+            return true;
+        }
+        // the stream is broken, do not complete a frame with later data
+        mPartialBytes = 0;
+        ALOGW_IF(mError.load() == NO_ERROR, "capture device read failed: %d", error);
+        {
+            AudioPiMutex::Autolock lock(mLock);
+            mError.store(error);
+            mReadErrors++;
+            mDataCond.broadcast();
+        }
+        // do not spin on a broken device
+        usleep(kPeriodMs * 1000);
+        return true;
+    }
+
+    bytes += mPartialBytes;
+    mPartialBytes = bytes % mFrameSize;
+    if ((size_t)bytes < mFrameSize) {
+        return true;
+    }
+    write += bytes / mFrameSize;
+    mError.store(NO_ERROR);
+    mWritePosition.store(write, std::memory_order_release);
+
+    AudioPiMutex::Autolock lock(mLock);
+    mTimePosition = write;
+    mTime = now;
+    mDataCond.broadcast();
+    return true;
+}
+
+status_t AudioCaptureHub::dump(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    AudioPiMutex::Autolock lock(mLock);
+    snprintf(buffer, SIZE, "\tcapture hub: %u Hz, %d readers, ring %zu frames, period %zu frames\n"
+             "\tcaptured %llu frames, %u read errors, last error %d\n",
+             mSampleRate, mReaders, mFrames, mPeriodFrames,
+             (unsigned long long)mWritePosition.load(), mReadErrors, mError.load());
+    ::write(fd, buffer, strlen(buffer));
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,123 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_CAPTURE_HUB_H
+#define ANDROID_AUDIO_CAPTURE_HUB_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+#include "AudioPiMutex.h"
+#include "AudioThreadPolicy.h"
+
+namespace android_audio_legacy {
+    using android::Thread;
+    using android::sp;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioCaptureHub shares one capture device between any number of input
+ * streams.
+ *
+ * A single thread reads the device in periods into a ring of frames and
+ * never waits for the streams. Each stream keeps its own cursor, a frame
+ * position in the capture, and copies from the ring at its own pace without
+ * taking a lock. A stream that falls more than the ring behind loses the
+ * oldest frames; read() skips them and reports how many.
+ *
+ * The device is only read while at least one stream is attached.
+ */
+class AudioCaptureHub : public Thread {
+public:
+                        AudioCaptureHub(int fd, size_t frameSize, uint32_t sampleRate,
+                                        const sp<AudioThreadPolicy>& threadPolicy);
+    virtual             ~AudioCaptureHub();
+
+    /** allocate the ring and start the reader thread */
+            status_t    start();
+    /** stop the reader thread and wait for it */
+            void        stop();
+
+    /** start reading the device if needed. Returns the position of the next captured frame */
+            uint64_t    attach();
+            void        detach();
+
+    /**
+     * with no stream attached, wait until the reader thread is out of the
+     * device. It then waits for the next attach() without touching mFd, which
+     * can be pointed at another file.
+     */
+            void        waitIdle();
+
+    /**
+     * copy frames from *position on, waiting for the reader thread until all
+     * are captured. Advances *position, and adds the frames skipped because the
+     * caller fell behind to *framesLost. Returns the frames copied, or the
+     * device error if none could be.
+     */
+            ssize_t     read(uint64_t *position, void *buffer, size_t frames, uint64_t *framesLost);
+
+    /** monotonic time at which the frame at position was captured */
+            status_t    getCaptureTime(uint64_t position, nsecs_t *time);
+
+            size_t      frameSize() const { return mFrameSize; }
+            uint32_t    sampleRate() const { return mSampleRate; }
+            status_t    dump(int fd);
+
+private:
+    virtual bool        threadLoop();
+
+    const int           mFd;
+    const size_t        mFrameSize;
+    const uint32_t      mSampleRate;
+    size_t              mPeriodFrames;  // frames per device read
+    size_t              mFrames;        // ring capacity, a power of two
+    uint8_t             *mBuffer;
+    size_t              mPartialBytes;  // of the frame at mWritePosition, read by the reader thread
+    const sp<AudioThreadPolicy> mThreadPolicy;
+    uint32_t            mPolicyGeneration;
+
+    // frames captured since start(); the ring holds the last mFrames of them,
+    // minus the period being overwritten by the reader thread
+    std::atomic<uint64_t> mWritePosition;
+    std::atomic<status_t> mError;       // last device read error
+
+    // wake ups between the reader thread and the streams, and the time stamp
+    // of the last period. Streams read at the client's priority.
+    AudioPiMutex        mLock;
+    AudioPiCondition    mDataCond;
+    AudioPiCondition    mReaderCond;
+    AudioPiCondition    mIdleCond;
+    int                 mReaders;
+    bool                mReading;       // in a device read
+    uint64_t            mTimePosition;  // end of the last period
+    nsecs_t             mTime;          // and when it was read
+    uint32_t            mReadErrors;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_CAPTURE_HUB_H
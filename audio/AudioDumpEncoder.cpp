@@ -0,0 +1,458 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioDumpEncoder"
+//#define LOG_NDEBUG 0
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include "AudioDumpEncoder.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+static const uint8_t kFileMagic[4] = { 'A', 'D', 'M', 'P' };
+static const uint8_t kBlockMagic[4] = { 'A', 'D', 'B', 'K' };
+
+// sub block methods: verbatim samples, or fixed predictor of order (method - 1)
+static const uint8_t kMethodVerbatim = 0;
+static const uint8_t kMethodFixed = 1;
+static const uint32_t kMaxOrder = 3;
+static const uint32_t kMaxRiceParam = 15;
+// method and Rice parameter bytes
+static const size_t kSubBlockHdrSize = 2;
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+static inline void put64(uint8_t *p, uint64_t v)
+{
+    put32(p, v);
+    put32(p + 4, v >> 32);
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static inline uint64_t get64(const uint8_t *p)
+{
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+// fixed polynomial predictors, as in FLAC
+static inline int32_t residual(const int16_t *s, size_t i, size_t stride, uint32_t order)
+{
+    switch (order) {
+    case 0:
+        return s[i * stride];
+    case 1:
+        return s[i * stride] - s[(i - 1) * stride];
+    case 2:
+        return s[i * stride] - 2 * s[(i - 1) * stride] + s[(i - 2) * stride];
+    default:
+        return s[i * stride] - 3 * s[(i - 1) * stride] + 3 * s[(i - 2) * stride] -
+                s[(i - 3) * stride];
+    }
+}
+
+static inline int32_t predict(const int16_t *s, size_t i, size_t stride, uint32_t order)
+{
+    switch (order) {
+    case 0:
+        return 0;
+    case 1:
+        return s[(i - 1) * stride];
+    case 2:
+        return 2 * s[(i - 1) * stride] - s[(i - 2) * stride];
+    default:
+        return 3 * s[(i - 1) * stride] - 3 * s[(i - 2) * stride] + s[(i - 3) * stride];
+    }
+}
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u)
+{
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t *out) : mOut(out), mAcc(0), mBits(0) {}
+
+    void put(uint32_t value, uint32_t bits) {
+        if (bits == 0) {
+            return;
+        }
+        mAcc = (mAcc << bits) | (value & (0xFFFFFFFFu >> (32 - bits)));
+        mBits += bits;
+        while (mBits >= 8) {
+            mBits -= 8;
+            *mOut++ = mAcc >> mBits;
+        }
+    }
+    void unary(uint32_t zeros) {
+        while (zeros >= 32) {
+            put(0, 32);
+            zeros -= 32;
+        }
+        put(1, zeros + 1);
+    }
+    uint8_t *flush() {
+        if (mBits) {
+            *mOut++ = mAcc << (8 - mBits);
+            mBits = 0;
+        }
+        return mOut;
+    }
+
+private:
+    uint8_t     *mOut;
+    uint64_t    mAcc;
+    uint32_t    mBits;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t *in, size_t bytes) : mIn(in), mEnd(in + bytes), mAcc(0), mBits(0) {}
+
+    // returns false when reading past the end
+    bool get(uint32_t bits, uint32_t *value) {
+        while (mBits < bits) {
+            if (mIn == mEnd) {
+                return false;
+            }
+            mAcc = (mAcc << 8) | *mIn++;
+            mBits += 8;
+        }
+        mBits -= bits;
+        *value = bits ? (uint32_t)(mAcc >> mBits) & (0xFFFFFFFFu >> (32 - bits)) : 0;
+        return true;
+    }
+    bool unary(uint32_t *zeros) {
+        uint32_t count = 0;
+        uint32_t bit;
+        for (;;) {
+            if (!get(1, &bit)) {
+                return false;
+            }
+            if (bit) {
+                break;
+            }
+            count++;
+        }
+        *zeros = count;
+        return true;
+    }
+    const uint8_t *position() const { return mIn; }
+
+private:
+    const uint8_t   *mIn;
+    const uint8_t   *mEnd;
+    uint64_t        mAcc;
+    uint32_t        mBits;
+};
+
+// ----------------------------------------------------------------------------
+
+AudioDumpEncoder::AudioDumpEncoder()
+    : mFormat(AUDIO_FORMAT_PCM_16_BIT), mChannelCount(1), mSampleSize(sizeof(int16_t)),
+      mResidual(NULL), mResidualFrames(0)
+{
+}
+
+AudioDumpEncoder::~AudioDumpEncoder()
+{
+    free(mResidual);
+}
+
+status_t AudioDumpEncoder::set(int format, uint32_t channelCount, size_t maxFrames)
+{
+    size_t sampleSize = audio_bytes_per_sample((audio_format_t)format);
+    if (sampleSize == 0 || channelCount == 0) {
+        return BAD_VALUE;
+    }
+    if (format == AUDIO_FORMAT_PCM_16_BIT && maxFrames > mResidualFrames) {
+        int32_t *residual = (int32_t *)realloc(mResidual, maxFrames * sizeof(int32_t));
+        if (residual == NULL) {
+            return NO_MEMORY;
+        }
+        mResidual = residual;
+        mResidualFrames = maxFrames;
+    }
+    mFormat = format;
+    mChannelCount = channelCount;
+    mSampleSize = sampleSize;
+    return NO_ERROR;
+}
+
+size_t AudioDumpEncoder::maxBlockBytes(size_t frames) const
+{
+    // a channel is never stored larger than verbatim
+    return AUDIO_DUMP_BLOCK_HDR_SIZE + mChannelCount * (kSubBlockHdrSize + frames * mSampleSize);
+}
+
+size_t AudioDumpEncoder::encodeChannel(uint8_t *out, const int16_t *samples, size_t frames)
+{
+    const size_t stride = mChannelCount;
+
+    // pick the predictor with the smallest residual magnitude
+    uint64_t sums[kMaxOrder + 1] = { 0, 0, 0, 0 };
+    for (size_t i = kMaxOrder; i < frames; i++) {
+        for (uint32_t order = 0; order <= kMaxOrder; order++) {
+            int32_t r = residual(samples, i, stride, order);
+            sums[order] += (r < 0) ? -r : r;
+        }
+    }
+    uint32_t order = 0;
+    for (uint32_t o = 1; o <= kMaxOrder; o++) {
+        if (sums[o] < sums[order]) {
+            order = o;
+        }
+    }
+    if (order > frames) {
+        order = frames;
+    }
+
+    size_t count = frames - order;
+    uint64_t mean = 0;
+    for (size_t i = 0; i < count; i++) {
+        mResidual[i] = residual(samples, order + i, stride, order);
+        mean += zigzag(mResidual[i]);
+    }
+
+    // Rice parameter estimated from the mean, then refined around it
+    uint32_t param = 0;
+    if (count) {
+        mean /= count;
+        while (param < kMaxRiceParam && (1ull << (param + 1)) <= mean) {
+            param++;
+        }
+    }
+    uint64_t bestBits = UINT64_MAX;
+    uint32_t best = param;
+    for (uint32_t k = (param ? param - 1 : 0); k <= param + 1 && k <= kMaxRiceParam; k++) {
+        uint64_t bits = (uint64_t)count * (k + 1);
+        for (size_t i = 0; i < count; i++) {
+            bits += zigzag(mResidual[i]) >> k;
+        }
+        if (bits < bestBits) {
+            bestBits = bits;
+            best = k;
+        }
+    }
+
+    size_t encodedBytes = order * sizeof(int16_t) + (bestBits + 7) / 8;
+    if (encodedBytes >= frames * sizeof(int16_t)) {
+        out[0] = kMethodVerbatim;
+        out[1] = 0;
+        uint8_t *p = out + kSubBlockHdrSize;
+        for (size_t i = 0; i < frames; i++, p += 2) {
+            put16(p, samples[i * stride]);
+        }
+        return p - out;
+    }
+
+    out[0] = kMethodFixed + order;
+    out[1] = best;
+    uint8_t *p = out + kSubBlockHdrSize;
+    for (size_t i = 0; i < order; i++, p += 2) {
+        put16(p, samples[i * stride]);
+    }
+    BitWriter writer(p);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t u = zigzag(mResidual[i]);
+        writer.unary(u >> best);
+        writer.put(u, best);
+    }
+    return writer.flush() - out;
+}
+
+size_t AudioDumpEncoder::encodeBlock(uint8_t *out, const void *frames, size_t frameCount,
+                                     uint64_t firstFrame, uint64_t timestampNs)
+{
+    uint8_t *p = out + AUDIO_DUMP_BLOCK_HDR_SIZE;
+
+    if (mFormat == AUDIO_FORMAT_PCM_16_BIT && frameCount <= mResidualFrames) {
+        for (uint32_t c = 0; c < mChannelCount; c++) {
+            p += encodeChannel(p, (const int16_t *)frames + c, frameCount);
+        }
+    } else {
+        // verbatim, still split per channel to keep a single layout
+        const uint8_t *in = (const uint8_t *)frames;
+        const size_t frameSize = mChannelCount * mSampleSize;
+        for (uint32_t c = 0; c < mChannelCount; c++) {
+            *p++ = kMethodVerbatim;
+            *p++ = 0;
+            for (size_t i = 0; i < frameCount; i++, p += mSampleSize) {
+                memcpy(p, in + i * frameSize + c * mSampleSize, mSampleSize);
+            }
+        }
+    }
+
+    memcpy(out, kBlockMagic, sizeof(kBlockMagic));
+    put32(out + 4, (p - out) - AUDIO_DUMP_BLOCK_HDR_SIZE);
+    put32(out + 8, frameCount);
+    put32(out + 12, 0);
+    put64(out + 16, firstFrame);
+    put64(out + 24, timestampNs);
+    return p - out;
+}
+
+ssize_t AudioDumpEncoder::decodeChannel(int16_t *samples, size_t frames,
+                                        const uint8_t *in, size_t bytes) const
+{
+    const size_t stride = mChannelCount;
+    if (bytes < kSubBlockHdrSize) {
+        return BAD_VALUE;
+    }
+    uint8_t method = in[0];
+    uint32_t param = in[1];
+    const uint8_t *p = in + kSubBlockHdrSize;
+    const uint8_t *end = in + bytes;
+
+    if (method == kMethodVerbatim) {
+        if ((size_t)(end - p) < frames * sizeof(int16_t)) {
+            return BAD_VALUE;
+        }
+        for (size_t i = 0; i < frames; i++, p += 2) {
+            samples[i * stride] = get16(p);
+        }
+        return p - in;
+    }
+
+    uint32_t order = method - kMethodFixed;
+    if (order > kMaxOrder || order > frames || param > kMaxRiceParam ||
+            (size_t)(end - p) < order * sizeof(int16_t)) {
+        return BAD_VALUE;
+    }
+    for (size_t i = 0; i < order; i++, p += 2) {
+        samples[i * stride] = get16(p);
+    }
+    BitReader reader(p, end - p);
+    for (size_t i = order; i < frames; i++) {
+        uint32_t high, low;
+        if (!reader.unary(&high) || !reader.get(param, &low)) {
+            return BAD_VALUE;
+        }
+        int32_t r = unzigzag((high << param) | low);
+        samples[i * stride] = predict(samples, i, stride, order) + r;
+    }
+    return reader.position() - in;
+}
+
+ssize_t AudioDumpEncoder::decodeBlock(void *frames, size_t maxFrames,
+                                      const uint8_t *in, size_t bytes) const
+{
+    if (bytes < AUDIO_DUMP_BLOCK_HDR_SIZE || memcmp(in, kBlockMagic, sizeof(kBlockMagic))) {
+        return BAD_VALUE;
+    }
+    size_t payload = get32(in + 4);
+    size_t frameCount = get32(in + 8);
+    if (payload > bytes - AUDIO_DUMP_BLOCK_HDR_SIZE || frameCount > maxFrames) {
+        return BAD_VALUE;
+    }
+    const uint8_t *p = in + AUDIO_DUMP_BLOCK_HDR_SIZE;
+    const uint8_t *end = p + payload;
+
+    for (uint32_t c = 0; c < mChannelCount; c++) {
+        if (mFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            ssize_t used = decodeChannel((int16_t *)frames + c, frameCount, p, end - p);
+            if (used < 0) {
+                return used;
+            }
+            p += used;
+        } else {
+            const size_t frameSize = mChannelCount * mSampleSize;
+            if ((size_t)(end - p) < kSubBlockHdrSize + frameCount * mSampleSize ||
+                    p[0] != kMethodVerbatim) {
+                return BAD_VALUE;
+            }
+            p += kSubBlockHdrSize;
+            for (size_t i = 0; i < frameCount; i++, p += mSampleSize) {
+                memcpy((uint8_t *)frames + i * frameSize + c * mSampleSize, p, mSampleSize);
+            }
+        }
+    }
+    return frameCount;
+}
+
+void AudioDumpEncoder::writeFileHeader(uint8_t *out, const AudioDumpFileHeader& header)
+{
+    memset(out, 0, AUDIO_DUMP_FILE_HDR_SIZE);
+    memcpy(out, kFileMagic, sizeof(kFileMagic));
+    put16(out + 4, AUDIO_DUMP_VERSION);
+    put16(out + 6, AUDIO_DUMP_FILE_HDR_SIZE);
+    put32(out + 8, header.format);
+    put16(out + 12, header.channelCount);
+    put32(out + 16, header.sampleRate);
+    put32(out + 20, header.blockFrames);
+    put32(out + 24, header.sequence);
+    put32(out + 28, header.blockCount);
+    put64(out + 32, header.startRealtimeNs);
+    put64(out + 40, header.startMonotonicNs);
+    put64(out + 48, header.firstFrame);
+    put64(out + 56, header.frameCount);
+    put64(out + 64, header.indexOffset);
+}
+
+status_t AudioDumpEncoder::readFileHeader(const uint8_t *in, AudioDumpFileHeader *header)
+{
+    if (memcmp(in, kFileMagic, sizeof(kFileMagic)) || get16(in + 4) != AUDIO_DUMP_VERSION ||
+            get16(in + 6) != AUDIO_DUMP_FILE_HDR_SIZE) {
+        return BAD_VALUE;
+    }
+    header->format = get32(in + 8);
+    header->channelCount = get16(in + 12);
+    header->sampleRate = get32(in + 16);
+    header->blockFrames = get32(in + 20);
+    header->sequence = get32(in + 24);
+    header->blockCount = get32(in + 28);
+    header->startRealtimeNs = get64(in + 32);
+    header->startMonotonicNs = get64(in + 40);
+    header->firstFrame = get64(in + 48);
+    header->frameCount = get64(in + 56);
+    header->indexOffset = get64(in + 64);
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
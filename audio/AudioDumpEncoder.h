@@ -0,0 +1,126 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_DUMP_ENCODER_H
+#define ANDROID_AUDIO_DUMP_ENCODER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+/**
+ * Compressed dump file layout, all fields little endian:
+ *
+ *   file header     AUDIO_DUMP_FILE_HDR_SIZE bytes, see AudioDumpFileHeader
+ *   block 0..n-1    AUDIO_DUMP_BLOCK_HDR_SIZE bytes of AudioDumpBlockHeader,
+ *                   then one encoded sub block per channel
+ *   index           "ADIX", block count, then per block the first frame and
+ *                   the file offset of its header (16 bytes per entry)
+ *
+ * The header holds the index offset, so a reader can seek to any frame
+ * without scanning the file. Blocks start with a sync word and their size,
+ * so a file that was never closed can still be recovered by a linear scan.
+ *
+ * Each channel of a block is coded like a FLAC "fixed" sub frame: a 0 to 3rd
+ * order polynomial predictor and Rice coded residuals. A channel is stored
+ * verbatim when that is smaller. Only 16 bit PCM is compressed; other sample
+ * formats are always stored verbatim.
+ */
+enum {
+    AUDIO_DUMP_FILE_HDR_SIZE = 80,
+    AUDIO_DUMP_BLOCK_HDR_SIZE = 32,
+    AUDIO_DUMP_INDEX_ENTRY_SIZE = 16,
+    AUDIO_DUMP_VERSION = 1,
+};
+
+struct AudioDumpFileHeader {
+    int32_t     format;
+    uint16_t    channelCount;
+    uint32_t    sampleRate;
+    uint32_t    blockFrames;
+    uint32_t    sequence;           // position of the file in a rotation
+    uint64_t    startRealtimeNs;    // CLOCK_REALTIME of the first frame
+    uint64_t    startMonotonicNs;   // CLOCK_MONOTONIC of the first frame
+    uint64_t    firstFrame;         // frames recorded in earlier files of the rotation
+    uint64_t    frameCount;
+    uint64_t    indexOffset;        // 0 if the file was not closed
+    uint32_t    blockCount;
+};
+
+struct AudioDumpBlockHeader {
+    uint32_t    payloadBytes;       // encoded channels following the header
+    uint32_t    frames;
+    uint64_t    firstFrame;
+    uint64_t    timestampNs;        // CLOCK_MONOTONIC when the block was encoded
+};
+
+class AudioDumpEncoder {
+public:
+                        AudioDumpEncoder();
+                        ~AudioDumpEncoder();
+
+    /**
+     * configure for interleaved frames of the given format and channel count,
+     * in blocks of at most maxFrames frames.
+     */
+    status_t            set(int format, uint32_t channelCount, size_t maxFrames);
+
+    /** worst case encoded size of a block of frames, block header included */
+    size_t              maxBlockBytes(size_t frames) const;
+
+    /**
+     * encode a block into out, which must hold maxBlockBytes(frames).
+     * Returns the number of bytes written, block header included.
+     */
+    size_t              encodeBlock(uint8_t *out, const void *frames, size_t frameCount,
+                                    uint64_t firstFrame, uint64_t timestampNs);
+
+    /**
+     * decode the block at in into interleaved frames. Returns the number of
+     * frames decoded, or a negative error if the block is corrupted.
+     */
+    ssize_t             decodeBlock(void *frames, size_t maxFrames,
+                                    const uint8_t *in, size_t bytes) const;
+
+    static void         writeFileHeader(uint8_t *out, const AudioDumpFileHeader& header);
+    static status_t     readFileHeader(const uint8_t *in, AudioDumpFileHeader *header);
+
+private:
+                        AudioDumpEncoder(const AudioDumpEncoder&);
+    AudioDumpEncoder&   operator=(const AudioDumpEncoder&);
+
+    size_t              encodeChannel(uint8_t *out, const int16_t *samples, size_t frames);
+    ssize_t             decodeChannel(int16_t *samples, size_t frames,
+                                      const uint8_t *in, size_t bytes) const;
+
+    int                 mFormat;
+    uint32_t            mChannelCount;
+    size_t              mSampleSize;
+    int32_t             *mResidual;     // one channel of one block
+    size_t              mResidualFrames;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_DUMP_ENCODER_H
@@ -22,17 +22,69 @@
 #include <sys/types.h>
 #include <utils/Log.h>
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "AudioDumpInterface.h"
 
-namespace android {
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// where flight recorders are flushed while test_cmd_file_name is not set
+static const char * const kFlightRecorderPath = "/data/misc/audioserver/flight";
+
+// recreate the flight recorder of a stream when its duration changed. Called
+// from the audio thread, which is the only one replacing the recorder.
+static void updateFlightRecorder(AudioDumpInterface *interface, Mutex& lock,
+                                 sp<AudioFlightRecorder>& recorder,
+                                 int format, uint32_t channelCount, uint32_t sampleRate)
+{
+    uint32_t durationMs = interface->flightRecorderMs();
+    if (recorder != 0 && recorder->durationMs() == durationMs) {
+        return;
+    }
+    sp<AudioFlightRecorder> newRecorder;
+    if (durationMs != 0) {
+        newRecorder = new AudioFlightRecorder(format, channelCount, sampleRate, durationMs);
+        if (newRecorder->init() != NO_ERROR) {
+            ALOGW("cannot allocate a %u ms flight recorder", durationMs);
+            newRecorder.clear();
+        }
+    }
+    if (recorder == 0 && newRecorder == 0) {
+        return;
+    }
+    Mutex::Autolock _l(lock);
+    recorder = newRecorder;
+}
+
+static status_t flushFlightRecorder(AudioDumpInterface *interface, Mutex& lock,
+                                    const sp<AudioFlightRecorder>& recorder,
+                                    const char *direction, int id, int *count)
+{
+    sp<AudioFlightRecorder> r;
+    {
+        Mutex::Autolock _l(lock);
+        r = recorder;
+    }
+    if (r == 0) {
+        return NO_INIT;
+    }
+    char name[255];
+    snprintf(name, sizeof(name), "%s_%s_%d_flight_%d",
+             interface->fileName() != "" ? interface->fileName().string() : kFlightRecorderPath,
+             direction, id, ++*count);
+    return r->flush(name, interface->dumpConfig());
+}
 
 // ----------------------------------------------------------------------------
 
 AudioDumpInterface::AudioDumpInterface(AudioHardwareInterface* hw)
-    : mPolicyCommands(String8("")), mFileName(String8(""))
+    : mPolicyCommands(String8("")), mFileName(String8("")), mFlightRecorderMs(0),
+      mReplayFileName(String8("")), mReplayLoop(true), mThreadPolicy(new AudioThreadPolicy())
 {
     if(hw == 0) {
         ALOGE("Dump construct hw = 0");
@@ -98,6 +150,7 @@ AudioStreamOut* AudioDumpInterface::openOutputStream(
 
     AudioStreamOutDump *dumOutput = new AudioStreamOutDump(this, mOutputs.size(), outFinal,
             devices, lFormat, lChannels, lRate);
+    Mutex::Autolock _l(mLock);
     mOutputs.add(dumOutput);
 
     return dumOutput;
@@ -119,7 +172,10 @@ void AudioDumpInterface::closeOutputStream(AudioStreamOut* out)
         mFinalInterface->closeOutputStream(dumpOut->finalStream());
     }
 
-    mOutputs.remove(dumpOut);
+    {
+        Mutex::Autolock _l(mLock);
+        mOutputs.remove(dumpOut);
+    }
     delete dumpOut;
 }
 
@@ -164,6 +220,7 @@ AudioStreamIn* AudioDumpInterface::openInputStream(uint32_t devices, int *format
 
     AudioStreamInDump *dumInput = new AudioStreamInDump(this, mInputs.size(), inFinal,
             devices, lFormat, lChannels, lRate);
+    Mutex::Autolock _l(mLock);
     mInputs.add(dumInput);
 
     return dumInput;
@@ -181,7 +238,10 @@ void AudioDumpInterface::closeInputStream(AudioStreamIn* in)
         mFinalInterface->closeInputStream(dumpIn->finalStream());
     }
 
-    mInputs.remove(dumpIn);
+    {
+        Mutex::Autolock _l(mLock);
+        mInputs.remove(dumpIn);
+    }
     delete dumpIn;
 }
 
@@ -197,6 +257,48 @@ status_t AudioDumpInterface::setParameters(const String8& keyValuePairs)
         mFileName = value;
         param.remove(String8("test_cmd_file_name"));
     }
+    // input replay: a new file is opened by inputs leaving standby
+    if (param.get(String8("test_cmd_replay_file"), value) == NO_ERROR) {
+        mReplayFileName = value;
+        param.remove(String8("test_cmd_replay_file"));
+    }
+    if (param.getInt(String8("test_cmd_replay_loop"), valueInt) == NO_ERROR) {
+        mReplayLoop = valueInt != 0;
+        param.remove(String8("test_cmd_replay_loop"));
+    }
+    // dump storage: takes effect for files opened after the change
+    if (param.get(String8("test_cmd_dump_format"), value) == NO_ERROR) {
+        mDumpConfig.dumpFormat = (value == "compressed") ?
+                AudioDumpWriter::DUMP_FORMAT_COMPRESSED : AudioDumpWriter::DUMP_FORMAT_WAV;
+        param.remove(String8("test_cmd_dump_format"));
+    }
+    if (param.getInt(String8("test_cmd_dump_rotate_kb"), valueInt) == NO_ERROR) {
+        mDumpConfig.rotateBytes = valueInt > 0 ? (uint64_t)valueInt * 1024 : 0;
+        param.remove(String8("test_cmd_dump_rotate_kb"));
+    }
+    if (param.getInt(String8("test_cmd_dump_rotate_ms"), valueInt) == NO_ERROR) {
+        mDumpConfig.rotateMs = valueInt > 0 ? valueInt : 0;
+        param.remove(String8("test_cmd_dump_rotate_ms"));
+    }
+    if (param.getInt(String8("test_cmd_dump_max_files"), valueInt) == NO_ERROR) {
+        mDumpConfig.maxFiles = valueInt > 0 ? valueInt : 0;
+        param.remove(String8("test_cmd_dump_max_files"));
+    }
+    // dump writers follow this module's thread policy, the final interface
+    // gets the same keys for its own threads
+    AudioParameterList list;
+    if (list.parse(keyValuePairs.string()) == NO_ERROR) {
+        mThreadPolicy->setParameters(list);
+    }
+    // flight recorders: streams pick up a new duration on their next buffer
+    if (param.getInt(String8("test_cmd_flight_recorder_ms"), valueInt) == NO_ERROR) {
+        mFlightRecorderMs = valueInt > 0 ? valueInt : 0;
+        param.remove(String8("test_cmd_flight_recorder_ms"));
+    }
+    if (param.get(String8("test_cmd_flight_recorder_flush"), value) == NO_ERROR) {
+        flushFlightRecorders();
+        param.remove(String8("test_cmd_flight_recorder_flush"));
+    }
     if (param.get(String8("test_cmd_policy"), value) == NO_ERROR) {
         Mutex::Autolock _l(mLock);
         param.remove(String8("test_cmd_policy"));
@@ -232,6 +334,24 @@ String8 AudioDumpInterface::getParameters(const String8& keys)
         response.add(String8("test_cmd_file_name"), mFileName);
         param.remove(String8("test_cmd_file_name"));
     }
+    if (param.get(String8("test_cmd_replay_file"), value) == NO_ERROR) {
+        response.add(String8("test_cmd_replay_file"), mReplayFileName);
+        param.remove(String8("test_cmd_replay_file"));
+    }
+    if (param.get(String8("test_cmd_replay_loop"), value) == NO_ERROR) {
+        response.addInt(String8("test_cmd_replay_loop"), mReplayLoop ? 1 : 0);
+        param.remove(String8("test_cmd_replay_loop"));
+    }
+    if (param.get(String8("test_cmd_dump_format"), value) == NO_ERROR) {
+        response.add(String8("test_cmd_dump_format"),
+                     String8(mDumpConfig.dumpFormat == AudioDumpWriter::DUMP_FORMAT_COMPRESSED ?
+                             "compressed" : "wav"));
+        param.remove(String8("test_cmd_dump_format"));
+    }
+    if (param.get(String8("test_cmd_flight_recorder_ms"), value) == NO_ERROR) {
+        response.addInt(String8("test_cmd_flight_recorder_ms"), (int)mFlightRecorderMs);
+        param.remove(String8("test_cmd_flight_recorder_ms"));
+    }
 
     String8 keyValuePairs = response.toString();
 
@@ -243,6 +363,25 @@ String8 AudioDumpInterface::getParameters(const String8& keys)
     return keyValuePairs;
 }
 
+void AudioDumpInterface::flushFlightRecorders()
+{
+    Mutex::Autolock _l(mLock);
+    for (size_t i = 0; i < mOutputs.size(); i++) {
+        mOutputs[i]->flushFlightRecorder();
+    }
+    for (size_t i = 0; i < mInputs.size(); i++) {
+        mInputs[i]->flushFlightRecorder();
+    }
+}
+
+// a bug report also captures what the streams played and recorded last
+status_t AudioDumpInterface::dump(int fd, const Vector<String16>& args)
+{
+    flushFlightRecorders();
+    mThreadPolicy->dump(fd);
+    return mFinalInterface->dumpState(fd, args);
+}
+
 status_t AudioDumpInterface::setMode(int mode)
 {
     return mFinalInterface->setMode(mode);
@@ -262,9 +401,9 @@ AudioStreamOutDump::AudioStreamOutDump(AudioDumpInterface *interface,
                                         int format,
                                         uint32_t channels,
                                         uint32_t sampleRate)
-    : mInterface(interface), mId(id),
+    : AudioStreamOutExtension(this), mInterface(interface), mId(id),
       mSampleRate(sampleRate), mFormat(format), mChannels(channels), mLatency(0), mDevice(devices),
-      mBufferSize(1024), mFinalStream(finalStream), mFile(0), mFileCount(0)
+      mBufferSize(1024), mFinalStream(finalStream), mFileCount(0), mFlushCount(0)
 {
     ALOGV("AudioStreamOutDump Constructor %p, mInterface %p, mFinalStream %p", this, mInterface, mFinalStream);
 }
@@ -286,23 +425,39 @@ ssize_t AudioStreamOutDump::write(const void* buffer, size_t bytes)
         usleep((((bytes * 1000) / frameSize()) / sampleRate()) * 1000);
         ret = bytes;
     }
-    if(!mFile) {
+    if (mWriter == 0) {
         if (mInterface->fileName() != "") {
             char name[255];
-            sprintf(name, "%s_out_%d_%d.pcm", mInterface->fileName().string(), mId, ++mFileCount);
-            mFile = fopen(name, "wb");
-            ALOGV("Opening dump file %s, fh %p", name, mFile);
+            snprintf(name, sizeof(name), "%s_out_%d_%d",
+                     mInterface->fileName().string(), mId, ++mFileCount);
+            mWriter = new AudioDumpWriter(name, format(),
+                    audio_channel_count_from_out_mask(channels()), sampleRate(),
+                    mInterface->dumpConfig());
+            if (mWriter->start() != NO_ERROR) {
+                ALOGW("cannot start dump writer for %s", name);
+            }
         }
     }
-    if (mFile) {
-        fwrite(buffer, bytes, 1, mFile);
+    if (mWriter != 0 && ret > 0) {
+        mWriter->write(buffer, ret);
+    }
+    updateFlightRecorder(mInterface, mRecorderLock, mRecorder, format(),
+                         audio_channel_count_from_out_mask(channels()), sampleRate());
+    if (mRecorder != 0 && ret > 0) {
+        mRecorder->write(buffer, ret);
     }
     return ret;
 }
 
+status_t AudioStreamOutDump::flushFlightRecorder()
+{
+    return android_audio_legacy::flushFlightRecorder(mInterface, mRecorderLock, mRecorder,
+                                                     "out", mId, &mFlushCount);
+}
+
 status_t AudioStreamOutDump::standby()
 {
-    ALOGV("AudioStreamOutDump standby(), mFile %p, mFinalStream %p", mFile, mFinalStream);
+    ALOGV("AudioStreamOutDump standby(), mWriter %p, mFinalStream %p", mWriter.get(), mFinalStream);
 
     Close();
     if (mFinalStream != 0 ) return mFinalStream->standby();
@@ -359,7 +514,7 @@ status_t AudioStreamOutDump::setParameters(const String8& keyValuePairs)
     }
 
     if (param.getInt(String8("format"), valueInt) == NO_ERROR) {
-        if (mFile == 0) {
+        if (mWriter == 0) {
             mFormat = valueInt;
         } else {
             status = INVALID_OPERATION;
@@ -374,7 +529,7 @@ status_t AudioStreamOutDump::setParameters(const String8& keyValuePairs)
     }
     if (param.getInt(String8("sampling_rate"), valueInt) == NO_ERROR) {
         if (valueInt > 0 && valueInt <= 48000) {
-            if (mFile == 0) {
+            if (mWriter == 0) {
                 mSampleRate = valueInt;
             } else {
                 status = INVALID_OPERATION;
@@ -386,6 +541,26 @@ status_t AudioStreamOutDump::setParameters(const String8& keyValuePairs)
     return status;
 }
 
+status_t AudioStreamOutDump::setParameterList(const AudioParameterList& param)
+{
+    if (mFinalStream != 0 ) return android_audio_legacy::setParameterList(mFinalStream, param);
+    return AudioStreamOutExtension::setParameterList(param);
+}
+
+status_t AudioStreamOutDump::addAudioEffect(effect_handle_t effect)
+{
+    AudioStreamOutExtension *extension =
+            mFinalStream != 0 ? AudioStreamOutExtension::query(mFinalStream) : NULL;
+    return extension != NULL ? extension->addAudioEffect(effect) : NO_ERROR;
+}
+
+status_t AudioStreamOutDump::removeAudioEffect(effect_handle_t effect)
+{
+    AudioStreamOutExtension *extension =
+            mFinalStream != 0 ? AudioStreamOutExtension::query(mFinalStream) : NULL;
+    return extension != NULL ? extension->removeAudioEffect(effect) : NO_ERROR;
+}
+
 String8 AudioStreamOutDump::getParameters(const String8& keys)
 {
     if (mFinalStream != 0 ) return mFinalStream->getParameters(keys);
@@ -396,15 +571,21 @@ String8 AudioStreamOutDump::getParameters(const String8& keys)
 
 status_t AudioStreamOutDump::dump(int fd, const Vector<String16>& args)
 {
+    if (mWriter != 0) mWriter->dump(fd);
+    {
+        Mutex::Autolock _l(mRecorderLock);
+        if (mRecorder != 0) mRecorder->dump(fd);
+    }
     if (mFinalStream != 0 ) return mFinalStream->dump(fd, args);
     return NO_ERROR;
 }
 
 void AudioStreamOutDump::Close()
 {
-    if(mFile) {
-        fclose(mFile);
-        mFile = 0;
+    if (mWriter != 0) {
+        // the writer thread flushes and closes the file in the background
+        mWriter->stop();
+        mWriter.clear();
     }
 }
 
@@ -423,9 +604,10 @@ AudioStreamInDump::AudioStreamInDump(AudioDumpInterface *interface,
                                         int format,
                                         uint32_t channels,
                                         uint32_t sampleRate)
-    : mInterface(interface), mId(id),
+    : AudioStreamInExtension(this), mInterface(interface), mId(id),
       mSampleRate(sampleRate), mFormat(format), mChannels(channels), mDevice(devices),
-      mBufferSize(1024), mFinalStream(finalStream), mFile(0), mFileCount(0)
+      mBufferSize(1024), mFinalStream(finalStream), mReplayFailed(false), mReplaySeekMs(-1),
+      mFileCount(0), mFlushCount(0)
 {
     ALOGV("AudioStreamInDump Constructor %p, mInterface %p, mFinalStream %p", this, mInterface, mFinalStream);
 }
@@ -442,66 +624,89 @@ ssize_t AudioStreamInDump::read(void* buffer, ssize_t bytes)
 
     if (mFinalStream) {
         ret = mFinalStream->read(buffer, bytes);
-        if(!mFile) {
+        if (mWriter == 0) {
             if (mInterface->fileName() != "") {
                 char name[255];
-                sprintf(name, "%s_in_%d_%d.pcm", mInterface->fileName().string(), mId, ++mFileCount);
-                mFile = fopen(name, "wb");
-                ALOGV("Opening input dump file %s, fh %p", name, mFile);
+                snprintf(name, sizeof(name), "%s_in_%d_%d",
+                         mInterface->fileName().string(), mId, ++mFileCount);
+                mWriter = new AudioDumpWriter(name, format(),
+                        audio_channel_count_from_in_mask(channels()), sampleRate(),
+                        mInterface->dumpConfig());
+                if (mWriter->start() != NO_ERROR) {
+                    ALOGW("cannot start dump writer for %s", name);
+                }
             }
         }
-        if (mFile) {
-            fwrite(buffer, bytes, 1, mFile);
+        if (mWriter != 0 && ret > 0) {
+            mWriter->write(buffer, ret);
         }
     } else {
-        usleep((((bytes * 1000) / frameSize()) / sampleRate()) * 1000);
-        ret = bytes;
-        if(!mFile) {
-            char name[255];
-            strcpy(name, "/sdcard/music/sine440");
-            if (channels() == AudioSystem::CHANNEL_IN_MONO) {
-                strcat(name, "_mo");
-            } else {
-                strcat(name, "_st");
-            }
-            if (format() == AudioSystem::PCM_16_BIT) {
-                strcat(name, "_16b");
-            } else {
-                strcat(name, "_8b");
-            }
-            if (sampleRate() < 16000) {
-                strcat(name, "_8k");
-            } else if (sampleRate() < 32000) {
-                strcat(name, "_22k");
-            } else if (sampleRate() < 48000) {
-                strcat(name, "_44k");
-            } else {
-                strcat(name, "_48k");
-            }
-            strcat(name, ".wav");
-            mFile = fopen(name, "rb");
-            ALOGV("Opening input read file %s, fh %p", name, mFile);
-            if (mFile) {
-                fseek(mFile, AUDIO_DUMP_WAVE_HDR_SIZE, SEEK_SET);
+        if (!mReplay.isOpen() && !mReplayFailed) {
+            mReplayName = mInterface->replayFileName();
+            String8 name = mReplayName;
+            if (name == "") {
+                name = "/sdcard/music/sine440";
+                name += channels() == AudioSystem::CHANNEL_IN_MONO ? "_mo" : "_st";
+                name += format() == AudioSystem::PCM_16_BIT ? "_16b" : "_8b";
+                if (sampleRate() < 16000) {
+                    name += "_8k";
+                } else if (sampleRate() < 32000) {
+                    name += "_22k";
+                } else if (sampleRate() < 48000) {
+                    name += "_44k";
+                } else {
+                    name += "_48k";
+                }
+                name += ".wav";
             }
+            // do not retry on each read, standby() allows another attempt
+            mReplayFailed = mReplay.open(name.string(), format(), channels(),
+                                         sampleRate()) != NO_ERROR;
+            ALOGV("Opening input read file %s: %s", name.string(),
+                  mReplayFailed ? "failed" : "ok");
         }
-        if (mFile) {
-            ssize_t bytesRead = fread(buffer, bytes, 1, mFile);
-            if (bytesRead >=0 && bytesRead < bytes) {
-                fseek(mFile, AUDIO_DUMP_WAVE_HDR_SIZE, SEEK_SET);
-                fread((uint8_t *)buffer+bytesRead, bytes-bytesRead, 1, mFile);
+        int32_t seekMs = mReplaySeekMs.exchange(-1);
+        if (mReplay.isOpen()) {
+            mReplay.setLoop(mInterface->replayLoop());
+            if (seekMs >= 0 && mReplay.seek(seekMs) != NO_ERROR) {
+                ALOGW("cannot seek input file to %d ms", seekMs);
             }
+            ret = mReplay.read(buffer, bytes / frameSize());
+            if (ret > 0) {
+                ret *= frameSize();
+            }
+        } else {
+            usleep((((bytes * 1000) / frameSize()) / sampleRate()) * 1000);
+            memset(buffer, 0, bytes);
+            ret = bytes;
         }
     }
 
+    updateFlightRecorder(mInterface, mRecorderLock, mRecorder, format(),
+                         audio_channel_count_from_in_mask(channels()), sampleRate());
+    if (mRecorder != 0 && ret > 0) {
+        mRecorder->write(buffer, ret);
+    }
     return ret;
 }
 
+status_t AudioStreamInDump::flushFlightRecorder()
+{
+    return android_audio_legacy::flushFlightRecorder(mInterface, mRecorderLock, mRecorder,
+                                                     "in", mId, &mFlushCount);
+}
+
 status_t AudioStreamInDump::standby()
 {
-    ALOGV("AudioStreamInDump standby(), mFile %p, mFinalStream %p", mFile, mFinalStream);
+    ALOGV("AudioStreamInDump standby(), mFinalStream %p", mFinalStream);
 
     Close();
+    // the replay goes on where it was, on a new clock, unless the file changed
+    if (mInterface->replayFileName() != mReplayName) {
+        mReplay.close();
+    }
+    mReplay.restartClock();
+    mReplayFailed = false;
     if (mFinalStream != 0 ) return mFinalStream->standby();
     return NO_ERROR;
 }
@@ -540,6 +745,22 @@ status_t AudioStreamInDump::setParameters(const String8& keyValuePairs)
 {
     ALOGV("AudioStreamInDump::setParameters()");
     if (mFinalStream != 0 ) return mFinalStream->setParameters(keyValuePairs);
+
+    // applied by the next read
+    AudioParameter param = AudioParameter(keyValuePairs);
+    int valueInt;
+    if (param.getInt(String8("replay_seek_ms"), valueInt) == NO_ERROR) {
+        if (valueInt < 0) {
+            return BAD_VALUE;
+        }
+        mReplaySeekMs = valueInt;
+    }
+    return NO_ERROR;
+}
+
+status_t AudioStreamInDump::setParameterList(const AudioParameterList& param)
+{
+    if (mFinalStream != 0 ) return android_audio_legacy::setParameterList(mFinalStream, param);
     return NO_ERROR;
 }
 
@@ -559,15 +780,20 @@ unsigned int AudioStreamInDump::getInputFramesLost() const
 
 status_t AudioStreamInDump::dump(int fd, const Vector<String16>& args)
 {
+    if (mWriter != 0) mWriter->dump(fd);
+    {
+        Mutex::Autolock _l(mRecorderLock);
+        if (mRecorder != 0) mRecorder->dump(fd);
+    }
     if (mFinalStream != 0 ) return mFinalStream->dump(fd, args);
-    return NO_ERROR;
+    return mReplay.dump(fd);
 }
 
 void AudioStreamInDump::Close()
 {
-    if(mFile) {
-        fclose(mFile);
-        mFile = 0;
+    if (mWriter != 0) {
+        mWriter->stop();
+        mWriter.clear();
     }
 }
 }; // namespace android
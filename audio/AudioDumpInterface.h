@@ -20,18 +20,25 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <atomic>
 #include <utils/String8.h>
 #include <utils/SortedVector.h>
 
 #include <hardware_legacy/AudioHardwareBase.h>
+#include <hardware_legacy/AudioHardwareExtension.h>
 
-namespace android {
+#include "AudioDumpWriter.h"
+#include "AudioFlightRecorder.h"
+#include "AudioReplaySource.h"
 
-#define AUDIO_DUMP_WAVE_HDR_SIZE 44
+namespace android_audio_legacy {
+    using android::SortedVector;
+    using android::Mutex;
+    using android::sp;
 
 class AudioDumpInterface;
 
-class AudioStreamOutDump : public AudioStreamOut {
+class AudioStreamOutDump : public AudioStreamOut, public AudioStreamOutExtension {
 public:
                         AudioStreamOutDump(AudioDumpInterface *interface,
                                             int id,
@@ -52,12 +59,16 @@ public:
     virtual status_t    standby();
     virtual status_t    setParameters(const String8& keyValuePairs);
     virtual String8     getParameters(const String8& keys);
+    virtual status_t    setParameterList(const AudioParameterList& param);
+    virtual status_t    addAudioEffect(effect_handle_t effect);
+    virtual status_t    removeAudioEffect(effect_handle_t effect);
     virtual status_t    dump(int fd, const Vector<String16>& args);
     void                Close(void);
     AudioStreamOut*     finalStream() { return mFinalStream; }
     uint32_t            device() { return mDevice; }
     int                 getId()  { return mId; }
     virtual status_t    getRenderPosition(uint32_t *dspFrames);
+    status_t            flushFlightRecorder();
 
 private:
     AudioDumpInterface *mInterface;
@@ -69,11 +80,14 @@ private:
     uint32_t mDevice;                   // current device this output is routed to
     size_t  mBufferSize;
     AudioStreamOut      *mFinalStream;
-    FILE                *mFile;      // output file
+    sp<AudioDumpWriter> mWriter;     // output file
     int                 mFileCount;
+    Mutex               mRecorderLock;  // mRecorder, replaced by the audio thread only
+    sp<AudioFlightRecorder> mRecorder;  // last seconds written
+    int                 mFlushCount;
 };
 
-class AudioStreamInDump : public AudioStreamIn {
+class AudioStreamInDump : public AudioStreamIn, public AudioStreamInExtension {
 public:
                         AudioStreamInDump(AudioDumpInterface *interface,
                                             int id,
@@ -94,11 +108,17 @@ public:
     virtual status_t    standby();
     virtual status_t    setParameters(const String8& keyValuePairs);
     virtual String8     getParameters(const String8& keys);
+    virtual status_t    setParameterList(const AudioParameterList& param);
     virtual unsigned int  getInputFramesLost() const;
+    virtual status_t    addAudioEffect(effect_handle_t effect)
+                            {return mFinalStream ? mFinalStream->addAudioEffect(effect) : NO_ERROR;}
+    virtual status_t    removeAudioEffect(effect_handle_t effect)
+                            {return mFinalStream ? mFinalStream->removeAudioEffect(effect) : NO_ERROR;}
     virtual status_t    dump(int fd, const Vector<String16>& args);
     void                Close(void);
     AudioStreamIn*     finalStream() { return mFinalStream; }
     uint32_t            device() { return mDevice; }
+    status_t            flushFlightRecorder();
 
 private:
     AudioDumpInterface *mInterface;
@@ -109,8 +129,15 @@ private:
     uint32_t mDevice;                   // current device this output is routed to
     size_t  mBufferSize;
     AudioStreamIn      *mFinalStream;
-    FILE                *mFile;      // output file
+    sp<AudioDumpWriter> mWriter;     // capture file
+    AudioReplaySource   mReplay;     // input file replayed when there is no final stream
+    String8             mReplayName;    // replay file set when mReplay was opened
+    bool                mReplayFailed;
+    std::atomic<int32_t> mReplaySeekMs; // seek requested for the next read, -1 for none
     int                 mFileCount;
+    Mutex               mRecorderLock;  // mRecorder, replaced by the audio thread only
+    sp<AudioFlightRecorder> mRecorder;  // last seconds read
+    int                 mFlushCount;
 };
 
 class AudioDumpInterface : public AudioHardwareBase
@@ -152,9 +179,35 @@ public:
             uint32_t *sampleRate, status_t *status, AudioSystem::audio_in_acoustics acoustics);
     virtual    void        closeInputStream(AudioStreamIn* in);
 
-    virtual status_t    dump(int fd, const Vector<String16>& args) { return mFinalInterface->dumpState(fd, args); }
+    virtual int         createAudioPatch(unsigned int num_sources,
+                                         const struct audio_port_config *sources,
+                                         unsigned int num_sinks,
+                                         const struct audio_port_config *sinks,
+                                         audio_patch_handle_t *handle)
+                            {return mFinalInterface->createAudioPatch(num_sources, sources,
+                                                                      num_sinks, sinks, handle);}
+    virtual int         releaseAudioPatch(audio_patch_handle_t handle)
+                            {return mFinalInterface->releaseAudioPatch(handle);}
+    virtual int         getAudioPort(struct audio_port *port)
+                            {return mFinalInterface->getAudioPort(port);}
+    virtual int         setAudioPortConfig(const struct audio_port_config *config)
+                            {return mFinalInterface->setAudioPortConfig(config);}
+
+    virtual status_t    dump(int fd, const Vector<String16>& args);
 
             String8     fileName() const { return mFileName; }
+            AudioDumpWriter::Config dumpConfig() const {
+                AudioDumpWriter::Config config = mDumpConfig;
+                config.threadPolicy = mThreadPolicy;
+                return config;
+            }
+            /** duration each stream keeps in its flight recorder, 0 for none */
+            uint32_t    flightRecorderMs() const { return mFlightRecorderMs; }
+            /** write the flight recorders of all streams to disk, in the background */
+            void        flushFlightRecorders();
+            /** file replayed by inputs without a final stream, "" for the default */
+            String8     replayFileName() const { return mReplayFileName; }
+            bool        replayLoop() const { return mReplayLoop; }
 protected:
 
     AudioHardwareInterface          *mFinalInterface;
@@ -163,6 +216,11 @@ protected:
     Mutex                           mLock;
     String8                         mPolicyCommands;
     String8                         mFileName;
+    AudioDumpWriter::Config         mDumpConfig;
+    std::atomic<uint32_t>           mFlightRecorderMs;
+    String8                         mReplayFileName;
+    std::atomic<bool>               mReplayLoop;
+    const sp<AudioThreadPolicy>     mThreadPolicy;  // dump writers
 };
 
 }; // namespace android
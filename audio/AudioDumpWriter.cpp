@@ -0,0 +1,490 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioDumpWriter"
+//#define LOG_NDEBUG 0
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "AudioDumpWriter.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// size of each file write. A multiple of the block size so that O_DIRECT
+// writes stay aligned in memory and in the file.
+static const size_t kChunkSize = 64 * 1024;
+static const size_t kChunkAlign = 4096;
+// the ring holds at least this much audio while the disk is slow
+static const uint32_t kRingMs = 1000;
+// how long the writer sleeps when the ring is empty
+static const useconds_t kPollUs = 10000;
+// frames per compressed block, the granularity of seeks and rotation
+static const size_t kBlockFrames = 4096;
+
+static const uint16_t kWaveFormatPcm = 1;
+static const uint16_t kWaveFormatIeeeFloat = 3;
+static const uint8_t kIndexMagic[4] = { 'A', 'D', 'I', 'X' };
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void put64(uint8_t *p, uint64_t v)
+{
+    put32(p, v);
+    put32(p + 4, v >> 32);
+}
+
+// WAV has no 8.24 format: samples are scaled in place to 32 bit PCM, and
+// saturate outside [-1.0, 1.0)
+static void q31_from_q8_23(int32_t *samples, size_t count)
+{
+    while (count--) {
+        int32_t s = *samples;
+        if (s >= (1 << 23)) {
+            s = INT32_MAX;
+        } else if (s < -(1 << 23)) {
+            s = INT32_MIN;
+        } else {
+            s = (int32_t)((uint32_t)s << 8);
+        }
+        *samples++ = s;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+AudioDumpWriter::AudioDumpWriter(const char *path, int format,
+                                 uint32_t channelCount, uint32_t sampleRate,
+                                 const Config& config)
+    : Thread(false),
+      mPath(path), mFormat(format), mChannelCount(channelCount), mSampleRate(sampleRate),
+      mFrameSize(channelCount * (audio_bytes_per_sample((audio_format_t)format) ?: 1)),
+      mConfig(config),
+      mStopping(false), mFailed(false), mBytesDropped(0), mOverruns(0),
+      mStarted(false), mStartRealtimeNs(0), mStartMonotonicNs(0),
+      mPolicyGeneration(0), mFd(-1), mDirect(false), mHeaderSize(0), mChunk(NULL), mChunkFill(0), mFileBytes(0),
+      mSequence(0), mFileFrames(0), mTotalFrames(0),
+      mBlock(NULL), mBlockFill(0), mEncoded(NULL)
+{
+}
+
+AudioDumpWriter::~AudioDumpWriter()
+{
+    if (mFd >= 0) {
+        ::close(mFd);
+    }
+    free(mChunk);
+    free(mBlock);
+    free(mEncoded);
+}
+
+status_t AudioDumpWriter::start()
+{
+    uint32_t ringMs = mConfig.ringMs != 0 ? mConfig.ringMs : kRingMs;
+    size_t ringSize = (size_t)((uint64_t)mSampleRate * mFrameSize * ringMs / 1000);
+    if (ringSize < 2 * kChunkSize) {
+        ringSize = 2 * kChunkSize;
+    }
+    status_t status = mRing.init(ringSize);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    if (posix_memalign((void **)&mChunk, kChunkAlign, kChunkSize) != 0) {
+        mChunk = NULL;
+        return NO_MEMORY;
+    }
+    if (mConfig.dumpFormat == DUMP_FORMAT_COMPRESSED) {
+        status = mEncoder.set(mFormat, mChannelCount, kBlockFrames);
+        if (status != NO_ERROR) {
+            return status;
+        }
+        mBlock = (uint8_t *)malloc(kBlockFrames * mFrameSize);
+        mEncoded = (uint8_t *)malloc(mEncoder.maxBlockBytes(kBlockFrames));
+        if (mBlock == NULL || mEncoded == NULL) {
+            return NO_MEMORY;
+        }
+        mHeaderSize = AUDIO_DUMP_FILE_HDR_SIZE;
+    } else {
+        mHeaderSize = AUDIO_DUMP_WAVE_HDR_SIZE;
+    }
+    return run("AudioDumpWriter", ANDROID_PRIORITY_BACKGROUND);
+}
+
+void AudioDumpWriter::write(const void *buffer, size_t bytes)
+{
+    if (mFailed.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!mStarted.load(std::memory_order_relaxed)) {
+        mStartRealtimeNs = systemTime(SYSTEM_TIME_REALTIME);
+        mStartMonotonicNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        mStarted.store(true, std::memory_order_release);
+    }
+    // all or nothing, so that the file never holds a partial frame
+    if (mRing.availableToWrite() < bytes) {
+        mBytesDropped.fetch_add(bytes, std::memory_order_relaxed);
+        mOverruns.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    mRing.write(buffer, bytes);
+}
+
+void AudioDumpWriter::stop()
+{
+    AudioPiMutex::Autolock _l(mStopLock);
+    mStopping.store(true, std::memory_order_release);
+    mStopCond.signal();
+}
+
+String8 AudioDumpWriter::fileName(uint32_t sequence) const
+{
+    char name[PATH_MAX];
+    if (mConfig.dumpFormat == DUMP_FORMAT_COMPRESSED) {
+        snprintf(name, sizeof(name), "%s_%03u.admp", mPath.string(), sequence);
+    } else if (mConfig.rotateBytes != 0 || mConfig.rotateMs != 0) {
+        snprintf(name, sizeof(name), "%s_%03u.wav", mPath.string(), sequence);
+    } else {
+        snprintf(name, sizeof(name), "%s.wav", mPath.string());
+    }
+    return String8(name);
+}
+
+status_t AudioDumpWriter::openFile()
+{
+    String8 name = fileName(mSequence);
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    mFd = ::open(name.string(), flags | O_DIRECT, 0644);
+    mDirect = (mFd >= 0);
+    if (mFd < 0 && errno == EINVAL) {
+        // file system without direct I/O support
+        mFd = ::open(name.string(), flags, 0644);
+    }
+#else
+    mFd = ::open(name.string(), flags, 0644);
+#endif
+    if (mFd < 0) {
+        ALOGE("cannot open dump file %s: %s", name.string(), strerror(errno));
+        mFailed.store(true, std::memory_order_relaxed);
+        return -errno;
+    }
+    ALOGV("Opening dump file %s, fd %d%s", name.string(), mFd, mDirect ? " (direct)" : "");
+
+    // leave room for the header, it is written once the file is complete
+    memset(mChunk, 0, mHeaderSize);
+    mChunkFill = mHeaderSize;
+    mFileBytes = mHeaderSize;
+    mFileFrames = 0;
+    mIndex.clear();
+
+    if (mConfig.maxFiles != 0 && mSequence >= mConfig.maxFiles) {
+        String8 oldest = fileName(mSequence - mConfig.maxFiles);
+        if (unlink(oldest.string()) != 0 && errno != ENOENT) {
+            ALOGW("cannot remove old dump file %s: %s", oldest.string(), strerror(errno));
+        }
+    }
+    return NO_ERROR;
+}
+
+status_t AudioDumpWriter::readyToRun()
+{
+    return openFile();
+}
+
+bool AudioDumpWriter::threadLoop()
+{
+    if (mConfig.threadPolicy != 0) {
+        mConfig.threadPolicy->apply(AudioThreadPolicy::ROLE_DUMP, &mPolicyGeneration);
+    }
+
+    // sample the stop request before draining: anything written before
+    // stop() is then guaranteed to be seen by the read below.
+    bool exiting = mStopping.load(std::memory_order_acquire);
+    size_t bytes;
+
+    // the next file of a rotation is opened once there is something to put in it
+    if (mFd < 0 && mRing.availableToRead() != 0) {
+        openFile();
+    }
+    if (mFd < 0) {
+        bytes = 0;
+    } else if (mConfig.dumpFormat == DUMP_FORMAT_COMPRESSED) {
+        size_t blockBytes = kBlockFrames * mFrameSize;
+        bytes = mRing.read(mBlock + mBlockFill, blockBytes - mBlockFill);
+        mBlockFill += bytes;
+        if (mBlockFill == blockBytes) {
+            encodeBlock();
+            if (rotationDue()) {
+                finishFile();
+                mSequence++;
+            }
+        }
+    } else {
+        // stop at the end of the file so that the next one starts on a frame
+        size_t room = kChunkSize - mChunkFill;
+        uint64_t left = waveBytesLeft();
+        if (room > left) {
+            room = left;
+        }
+        // the header and chunks keep samples aligned in mChunk; a sample cut
+        // by the previous read is converted once complete
+        size_t start = mChunkFill & ~(size_t)3;
+        bytes = mRing.read(mChunk + mChunkFill, room);
+        mChunkFill += bytes;
+        mFileBytes += bytes;
+        if (mFormat == AUDIO_FORMAT_PCM_8_24_BIT) {
+            q31_from_q8_23((int32_t *)(mChunk + start), ((mChunkFill & ~(size_t)3) - start) / 4);
+        }
+        if (mChunkFill == kChunkSize) {
+            writeChunk();
+        }
+        if (bytes != 0 && bytes == left) {
+            finishFile();
+            mSequence++;
+        }
+    }
+
+    if (mFailed.load(std::memory_order_relaxed)) {
+        // keep what made it to the file readable
+        finishFile();
+        return false;
+    }
+    if (bytes == 0) {
+        if (exiting) {
+            finishFile();
+            return false;
+        }
+        AudioPiMutex::Autolock _l(mStopLock);
+        if (!mStopping.load(std::memory_order_relaxed)) {
+            mStopCond.waitRelative(mStopLock, us2ns(kPollUs));
+        }
+    }
+    return true;
+}
+
+void AudioDumpWriter::writeChunk()
+{
+    ssize_t written = ::write(mFd, mChunk, kChunkSize);
+    if (written != (ssize_t)kChunkSize) {
+        ALOGE("write to %s failed: %s", mPath.string(),
+              written < 0 ? strerror(errno) : "short write");
+        mFailed.store(true, std::memory_order_relaxed);
+    }
+    mChunkFill = 0;
+}
+
+void AudioDumpWriter::append(const void *data, size_t bytes)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    mFileBytes += bytes;
+    while (bytes) {
+        size_t count = kChunkSize - mChunkFill;
+        if (count > bytes) {
+            count = bytes;
+        }
+        memcpy(mChunk + mChunkFill, p, count);
+        mChunkFill += count;
+        p += count;
+        bytes -= count;
+        if (mChunkFill == kChunkSize) {
+            writeChunk();
+        }
+    }
+}
+
+void AudioDumpWriter::encodeBlock()
+{
+    size_t frames = mBlockFill / mFrameSize;
+    mBlockFill = 0;
+    if (frames == 0) {
+        return;
+    }
+    IndexEntry entry;
+    entry.firstFrame = mTotalFrames;
+    entry.offset = mFileBytes;
+    mIndex.add(entry);
+
+    size_t bytes = mEncoder.encodeBlock(mEncoded, mBlock, frames, mTotalFrames,
+                                        systemTime(SYSTEM_TIME_MONOTONIC));
+    append(mEncoded, bytes);
+    mFileFrames += frames;
+    mTotalFrames += frames;
+}
+
+// data bytes the current WAV file takes before rotation, a whole number of frames
+uint64_t AudioDumpWriter::waveBytesLeft() const
+{
+    uint64_t frames = UINT64_MAX;
+    if (mConfig.rotateBytes > mHeaderSize) {
+        frames = (mConfig.rotateBytes - mHeaderSize) / mFrameSize;
+    }
+    if (mConfig.rotateMs != 0) {
+        uint64_t msFrames = (uint64_t)mConfig.rotateMs * mSampleRate / 1000;
+        if (msFrames < frames) {
+            frames = msFrames;
+        }
+    }
+    if (frames == UINT64_MAX) {
+        return UINT64_MAX;
+    }
+    if (frames == 0) {
+        frames = 1;
+    }
+    return frames * mFrameSize - (mFileBytes - mHeaderSize);
+}
+
+bool AudioDumpWriter::rotationDue() const
+{
+    if (mConfig.rotateBytes != 0 && mFileBytes >= mConfig.rotateBytes) {
+        return true;
+    }
+    return mConfig.rotateMs != 0 &&
+            mFileFrames * 1000 >= (uint64_t)mConfig.rotateMs * mSampleRate;
+}
+
+void AudioDumpWriter::finishFile()
+{
+    if (mFd < 0) {
+        return;
+    }
+    uint8_t header[AUDIO_DUMP_FILE_HDR_SIZE];
+    if (mConfig.dumpFormat == DUMP_FORMAT_COMPRESSED) {
+        encodeBlock();
+        // the index goes after the last block, the header points to it
+        uint64_t indexOffset = mFileBytes;
+        uint8_t entry[AUDIO_DUMP_INDEX_ENTRY_SIZE];
+        memcpy(entry, kIndexMagic, sizeof(kIndexMagic));
+        put32(entry + 4, mIndex.size());
+        append(entry, 8);
+        for (size_t i = 0; i < mIndex.size(); i++) {
+            put64(entry, mIndex[i].firstFrame);
+            put64(entry + 8, mIndex[i].offset);
+            append(entry, sizeof(entry));
+        }
+        fillCompressedHeader(header, indexOffset);
+    } else {
+        fillWaveHeader(header);
+    }
+
+    if (mDirect) {
+        // the tail is not block sized: finish with buffered I/O
+        int flags = fcntl(mFd, F_GETFL);
+        fcntl(mFd, F_SETFL, flags & ~O_DIRECT);
+        mDirect = false;
+    }
+    if (mChunkFill != 0 && ::write(mFd, mChunk, mChunkFill) != (ssize_t)mChunkFill) {
+        ALOGW("cannot write the end of %s", mPath.string());
+    }
+    mChunkFill = 0;
+
+    if (pwrite(mFd, header, mHeaderSize, 0) != (ssize_t)mHeaderSize) {
+        ALOGW("cannot write header of %s", mPath.string());
+    }
+    ::close(mFd);
+    mFd = -1;
+
+    ALOGW_IF(overruns() != 0, "%s: dropped %llu bytes in %u overruns", mPath.string(),
+             (unsigned long long)bytesDropped(), overruns());
+}
+
+void AudioDumpWriter::fillWaveHeader(uint8_t *header)
+{
+    uint64_t dataBytes = mFileBytes - AUDIO_DUMP_WAVE_HDR_SIZE;
+    if (dataBytes > UINT32_MAX - AUDIO_DUMP_WAVE_HDR_SIZE) {
+        dataBytes = UINT32_MAX - AUDIO_DUMP_WAVE_HDR_SIZE;
+    }
+    uint32_t sampleSize = mFrameSize / mChannelCount;
+    // 8.24 samples were scaled to 32 bit PCM as they were read
+    uint16_t tag = (mFormat == AUDIO_FORMAT_PCM_FLOAT) ? kWaveFormatIeeeFloat : kWaveFormatPcm;
+
+    memcpy(header, "RIFF", 4);
+    put32(header + 4, (uint32_t)dataBytes + AUDIO_DUMP_WAVE_HDR_SIZE - 8);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "fmt ", 4);
+    put32(header + 16, 16);
+    put16(header + 20, tag);
+    put16(header + 22, mChannelCount);
+    put32(header + 24, mSampleRate);
+    put32(header + 28, mSampleRate * mFrameSize);
+    put16(header + 32, mFrameSize);
+    put16(header + 34, sampleSize * 8);
+    memcpy(header + 36, "data", 4);
+    put32(header + 40, (uint32_t)dataBytes);
+}
+
+void AudioDumpWriter::fillCompressedHeader(uint8_t *header, uint64_t indexOffset)
+{
+    AudioDumpFileHeader h;
+    uint64_t firstFrame = mTotalFrames - mFileFrames;
+    uint64_t offsetNs = firstFrame * 1000000000ull / mSampleRate;
+
+    h.format = mFormat;
+    h.channelCount = mChannelCount;
+    h.sampleRate = mSampleRate;
+    h.blockFrames = kBlockFrames;
+    h.sequence = mSequence;
+    h.startRealtimeNs = 0;
+    h.startMonotonicNs = 0;
+    if (mStarted.load(std::memory_order_acquire)) {
+        h.startRealtimeNs = mStartRealtimeNs + offsetNs;
+        h.startMonotonicNs = mStartMonotonicNs + offsetNs;
+    }
+    h.firstFrame = firstFrame;
+    h.frameCount = mFileFrames;
+    h.indexOffset = indexOffset;
+    h.blockCount = mIndex.size();
+    AudioDumpEncoder::writeFileHeader(header, h);
+}
+
+status_t AudioDumpWriter::dump(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    snprintf(buffer, SIZE, "\tdump file: %s (%s)\n\tdump ring: %zu/%zu bytes, dropped %llu bytes"
+             " in %u overruns\n", mPath.string(),
+             mConfig.dumpFormat == DUMP_FORMAT_COMPRESSED ? "compressed" : "wav",
+             mRing.availableToRead(), mRing.size(),
+             (unsigned long long)bytesDropped(), overruns());
+    ::write(fd, buffer, strlen(buffer));
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
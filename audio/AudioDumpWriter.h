@@ -0,0 +1,164 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_DUMP_WRITER_H
+#define ANDROID_AUDIO_DUMP_WRITER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#include <utils/threads.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+#include "AudioDumpEncoder.h"
+#include "AudioPiMutex.h"
+#include "AudioRingBuffer.h"
+#include "AudioThreadPolicy.h"
+
+namespace android_audio_legacy {
+    using android::Thread;
+    using android::sp;
+    using android::String8;
+    using android::Vector;
+
+#define AUDIO_DUMP_WAVE_HDR_SIZE 44
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioDumpWriter records PCM handed over by an audio thread into a file.
+ *
+ * write() only copies into a lock-free ring; if the ring is full the buffer is
+ * dropped and counted instead of waiting for the disk. A background thread
+ * opens the file, drains the ring into large aligned chunks and completes the
+ * file header once the writer is stopped.
+ *
+ * Files are WAV files or compressed files (see AudioDumpEncoder.h). Either
+ * can be split into a rotation by size or duration that keeps at most a given
+ * number of files on disk. WAV files are split on a frame, compressed files
+ * on a block.
+ */
+class AudioDumpWriter : public Thread {
+public:
+    enum {
+        DUMP_FORMAT_WAV,            // <path>.wav, <path>_<sequence>.wav if rotated
+        DUMP_FORMAT_COMPRESSED,     // <path>_<sequence>.admp
+    };
+
+    struct Config {
+        Config() : dumpFormat(DUMP_FORMAT_WAV), rotateBytes(0), rotateMs(0), maxFiles(0),
+                   ringMs(0) {}
+        int         dumpFormat;
+        uint64_t    rotateBytes;    // start a new file past this size, 0 for no limit
+        uint32_t    rotateMs;       // or past this duration, 0 for no limit
+        uint32_t    maxFiles;       // delete the oldest files beyond this count, 0 to keep all
+        uint32_t    ringMs;         // audio write() can queue ahead of the disk, 0 for default
+        sp<AudioThreadPolicy> threadPolicy; // of the module dumped, NULL to leave the thread as is
+    };
+
+                        AudioDumpWriter(const char *path, int format,
+                                        uint32_t channelCount, uint32_t sampleRate,
+                                        const Config& config = Config());
+    virtual             ~AudioDumpWriter();
+
+    /** allocate the ring and start the writer thread */
+            status_t    start();
+
+    /** called from the audio thread: never blocks, never allocates */
+            void        write(const void *buffer, size_t bytes);
+
+    /**
+     * ask the writer thread to drain the ring, complete the file header and
+     * close the file. Does not wait: the thread holds its own reference and
+     * finishes in the background, join() waits for it.
+     */
+            void        stop();
+
+            uint64_t    bytesDropped() const { return mBytesDropped.load(std::memory_order_relaxed); }
+            uint32_t    overruns() const { return mOverruns.load(std::memory_order_relaxed); }
+            status_t    dump(int fd);
+
+private:
+    struct IndexEntry {
+        uint64_t    firstFrame;
+        uint64_t    offset;
+    };
+
+    virtual status_t    readyToRun();
+    virtual bool        threadLoop();
+
+            String8     fileName(uint32_t sequence) const;
+            status_t    openFile();
+            void        finishFile();
+            void        append(const void *data, size_t bytes);
+            void        writeChunk();
+            void        encodeBlock();
+            bool        rotationDue() const;
+            uint64_t    waveBytesLeft() const;
+            void        fillWaveHeader(uint8_t *header);
+            void        fillCompressedHeader(uint8_t *header, uint64_t indexOffset);
+
+    const String8       mPath;
+    const int           mFormat;
+    const uint32_t      mChannelCount;
+    const uint32_t      mSampleRate;
+    const size_t        mFrameSize;
+    const Config        mConfig;
+
+    AudioRingBuffer     mRing;
+    // set by stop(). Not requestExit(): android::Thread leaves the loop as
+    // soon as an exit is pending, while the writer must keep looping until
+    // the ring is drained and the file finished.
+    std::atomic<bool>   mStopping;
+    AudioPiMutex        mStopLock;
+    AudioPiCondition    mStopCond;      // wakes up an idle writer for stop()
+    std::atomic<bool>   mFailed;        // file could not be opened or written
+    std::atomic<uint64_t> mBytesDropped;
+    std::atomic<uint32_t> mOverruns;
+    // time of the first frame handed to write(), set once by the audio thread
+    std::atomic<bool>   mStarted;
+    uint64_t            mStartRealtimeNs;
+    uint64_t            mStartMonotonicNs;
+
+    // writer thread only
+    uint32_t            mPolicyGeneration;
+    int                 mFd;
+    bool                mDirect;        // opened with O_DIRECT
+    size_t              mHeaderSize;
+    uint8_t             *mChunk;        // aligned staging buffer
+    size_t              mChunkFill;
+    uint64_t            mFileBytes;     // appended to the current file, header included
+    uint32_t            mSequence;      // current file in the rotation
+    uint64_t            mFileFrames;    // frames in the current file
+    uint64_t            mTotalFrames;   // frames in all files
+    // compressed format only
+    AudioDumpEncoder    mEncoder;
+    uint8_t             *mBlock;        // raw frames of the block being filled
+    size_t              mBlockFill;
+    uint8_t             *mEncoded;
+    Vector<IndexEntry>  mIndex;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_DUMP_WRITER_H
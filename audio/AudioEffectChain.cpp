@@ -0,0 +1,212 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioEffectChain"
+//#define LOG_NDEBUG 0
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "AudioEffectChain.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// MIPS of the core running the audio thread, to turn a declared load into a
+// share of real time
+static const uint32_t kCpuMips = 1000;
+// per mille of real time assumed for an effect that declares no load
+static const uint32_t kDefaultLoad = 50;
+
+// ----------------------------------------------------------------------------
+
+AudioEffectChain::AudioEffectChain()
+    : mCount(0), mFrameSize(0), mSampleRate(0), mMaxFrames(0), mCpuBudget(0), mRejected(0)
+{
+    mScratch[0] = mScratch[1] = NULL;
+}
+
+AudioEffectChain::~AudioEffectChain()
+{
+    free(mScratch[0]);
+    free(mScratch[1]);
+}
+
+status_t AudioEffectChain::set(size_t frameSize, uint32_t sampleRate, size_t maxFrames)
+{
+    AudioPiMutex::Autolock _l(mLock);
+    if (frameSize * maxFrames > mFrameSize * mMaxFrames) {
+        for (int i = 0; i < 2; i++) {
+            uint8_t *buffer = (uint8_t *)realloc(mScratch[i], frameSize * maxFrames);
+            if (buffer == NULL) {
+                return NO_MEMORY;
+            }
+            mScratch[i] = buffer;
+        }
+    }
+    mFrameSize = frameSize;
+    mSampleRate = sampleRate;
+    mMaxFrames = maxFrames;
+    return NO_ERROR;
+}
+
+status_t AudioEffectChain::addEffect(effect_handle_t effect)
+{
+    AudioPiMutex::Autolock _l(mLock);
+    for (size_t i = 0; i < mEffects.size(); i++) {
+        if (mEffects[i].handle == effect) {
+            return INVALID_OPERATION;
+        }
+    }
+
+    Effect e;
+    memset(&e, 0, sizeof(e));
+    e.handle = effect;
+    effect_descriptor_t desc;
+    if ((*effect)->get_descriptor != NULL && (*effect)->get_descriptor(effect, &desc) == 0) {
+        e.declaredLoad = desc.cpuLoad;
+        strlcpy(e.name, desc.name, sizeof(e.name));
+    }
+    e.estimatedLoad = estimateLoad(e.declaredLoad);
+
+    uint32_t budget = mCpuBudget;
+    if (budget != 0) {
+        uint32_t load = 0;
+        for (size_t i = 0; i < mEffects.size(); i++) {
+            load += load_l(mEffects[i]);
+        }
+        if (load + e.estimatedLoad > budget) {
+            ALOGW("addEffect() chain load %u + %u over budget %u, effect %p %s refused",
+                  load, e.estimatedLoad, budget, effect, e.name);
+            mRejected++;
+            return INVALID_OPERATION;
+        }
+    }
+
+    mEffects.add(e);
+    mCount = mEffects.size();
+    ALOGV("addEffect() %p %s, %zu effects", effect, e.name, mEffects.size());
+    return NO_ERROR;
+}
+
+status_t AudioEffectChain::removeEffect(effect_handle_t effect)
+{
+    AudioPiMutex::Autolock _l(mLock);
+    for (size_t i = 0; i < mEffects.size(); i++) {
+        if (mEffects[i].handle == effect) {
+            mEffects.removeAt(i);
+            mCount = mEffects.size();
+            return NO_ERROR;
+        }
+    }
+    return BAD_VALUE;
+}
+
+void* AudioEffectChain::process(const void *in, size_t frames)
+{
+    void *src = const_cast<void *>(in);
+    AudioPiMutex::Autolock _l(mLock);
+    if (frames > mMaxFrames) {
+        ALOGW("process() %zu frames over %zu, effects skipped", frames, mMaxFrames);
+        return src;
+    }
+
+    int next = 0;
+    for (size_t i = 0; i < mEffects.size(); i++) {
+        Effect& e = mEffects.editItemAt(i);
+        audio_buffer_t inBuffer;
+        audio_buffer_t outBuffer;
+        inBuffer.frameCount = frames;
+        inBuffer.raw = src;
+        outBuffer.frameCount = frames;
+        outBuffer.raw = mScratch[next];
+
+        nsecs_t start = systemTime(SYSTEM_TIME_THREAD);
+        int32_t status = (*e.handle)->process(e.handle, &inBuffer, &outBuffer);
+        e.cpuNs += systemTime(SYSTEM_TIME_THREAD) - start;
+        e.frames += frames;
+
+        if (status == 0) {
+            src = mScratch[next];
+            next ^= 1;
+        } else if (status != -ENODATA) {
+            // -ENODATA: the effect is disabled and produced nothing
+            if (e.errors++ == 0) {
+                ALOGW("process() effect %p %s failed: %d", e.handle, e.name, status);
+            }
+        }
+    }
+    return src;
+}
+
+uint32_t AudioEffectChain::estimateLoad(uint16_t declaredLoad)
+{
+    if (declaredLoad == 0) {
+        return kDefaultLoad;
+    }
+    // 0.1 MIPS units over the core's MIPS, in per mille
+    return ((uint32_t)declaredLoad * 100 + kCpuMips - 1) / kCpuMips;
+}
+
+uint32_t AudioEffectChain::load_l(const Effect& effect) const
+{
+    if (effect.frames == 0) {
+        return effect.estimatedLoad;
+    }
+    // CPU time over the audio duration, in per mille
+    return (uint32_t)((uint64_t)effect.cpuNs * mSampleRate / (effect.frames * 1000000));
+}
+
+uint32_t AudioEffectChain::cpuLoad()
+{
+    AudioPiMutex::Autolock _l(mLock);
+    uint32_t load = 0;
+    for (size_t i = 0; i < mEffects.size(); i++) {
+        load += load_l(mEffects[i]);
+    }
+    return load;
+}
+
+status_t AudioEffectChain::dump(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    AudioPiMutex::Autolock _l(mLock);
+    snprintf(buffer, SIZE, "\teffects: %zu, cpu budget %u per mille, %u refused\n",
+             mEffects.size(), mCpuBudget.load(), mRejected);
+    ::write(fd, buffer, strlen(buffer));
+    for (size_t i = 0; i < mEffects.size(); i++) {
+        const Effect& e = mEffects[i];
+        snprintf(buffer, SIZE, "\t  %p %-31s load %u per mille (declared %u.%u MIPS),"
+                 " %llu frames, %u errors\n",
+                 e.handle, e.name, load_l(e), e.declaredLoad / 10, e.declaredLoad % 10,
+                 (unsigned long long)e.frames, e.errors);
+        ::write(fd, buffer, strlen(buffer));
+    }
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
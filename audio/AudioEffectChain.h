@@ -0,0 +1,111 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_EFFECT_CHAIN_H
+#define ANDROID_AUDIO_EFFECT_CHAIN_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include <hardware/audio_effect.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+#include "AudioPiMutex.h"
+
+namespace android_audio_legacy {
+    using android::Vector;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioEffectChain runs the effects a client attached to a stream, in the
+ * order they were added, on the frames the stream reads or writes.
+ *
+ * Frames are processed in two scratch buffers allocated in set(), so
+ * process() does not allocate. Each effect call is timed on the calling
+ * thread's CPU clock; the measured load of an effect is its CPU time over the
+ * duration of the audio it processed, in per mille of real time. Until an
+ * effect has processed frames, its load is estimated from the cpuLoad of its
+ * descriptor, or taken as a default if it declares none. With a CPU budget
+ * set, addEffect() refuses an effect that would take the load of the chain
+ * over it.
+ */
+class AudioEffectChain {
+public:
+                        AudioEffectChain();
+                        ~AudioEffectChain();
+
+    /** frames of frameSize bytes, at most maxFrames per process() call */
+    status_t            set(size_t frameSize, uint32_t sampleRate, size_t maxFrames);
+
+    status_t            addEffect(effect_handle_t effect);
+    status_t            removeEffect(effect_handle_t effect);
+    bool                isEmpty() const { return mCount.load(std::memory_order_relaxed) == 0; }
+
+    /**
+     * run the effects on frames from in. Returns the processed frames: one of
+     * the scratch buffers, or in itself if no effect produced output.
+     */
+    void*               process(const void *in, size_t frames);
+
+    /** per mille of real time, 0 for no limit */
+    void                setCpuBudget(uint32_t budget) { mCpuBudget = budget; }
+    uint32_t            cpuBudget() const { return mCpuBudget; }
+    uint32_t            cpuLoad();
+
+    status_t            dump(int fd);
+
+private:
+    struct Effect {
+        effect_handle_t handle;
+        uint16_t        declaredLoad;   // descriptor cpuLoad, in 0.1 MIPS
+        uint32_t        estimatedLoad;  // per mille, until measured
+        char            name[32];
+        nsecs_t         cpuNs;
+        uint64_t        frames;
+        uint32_t        errors;
+    };
+
+                        AudioEffectChain(const AudioEffectChain&);
+    AudioEffectChain&   operator=(const AudioEffectChain&);
+
+    static uint32_t     estimateLoad(uint16_t declaredLoad);
+    uint32_t            load_l(const Effect& effect) const;
+
+    // effects list, held by the audio thread while processing and by binder
+    // threads adding or removing effects
+    AudioPiMutex        mLock;
+    Vector<Effect>      mEffects;
+    std::atomic<size_t> mCount;
+    size_t              mFrameSize;
+    uint32_t            mSampleRate;
+    size_t              mMaxFrames;
+    uint8_t             *mScratch[2];
+    std::atomic<uint32_t> mCpuBudget;
+    uint32_t            mRejected;      // effects refused by the budget
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_EFFECT_CHAIN_H
@@ -0,0 +1,174 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioFlightRecorder"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utils/Log.h>
+
+#include "AudioFlightRecorder.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// bytes copied at a time by flush(), checked against the audio thread
+static const size_t kCopyBytes = 4096;
+
+// ----------------------------------------------------------------------------
+
+AudioFlightRecorder::AudioFlightRecorder(int format, uint32_t channelCount,
+                                         uint32_t sampleRate, uint32_t durationMs)
+    : mFormat(format), mChannelCount(channelCount), mSampleRate(sampleRate),
+      mDurationMs(durationMs),
+      mFrameSize(channelCount * (audio_bytes_per_sample((audio_format_t)format) ?: 1)),
+      mBuffer(NULL), mWindow(0), mSize(0), mWritten(0), mWriting(0),
+      mFlushes(0), mBytesSkipped(0)
+{
+}
+
+AudioFlightRecorder::~AudioFlightRecorder()
+{
+    free(mBuffer);
+}
+
+status_t AudioFlightRecorder::init()
+{
+    size_t frames = (size_t)((uint64_t)mSampleRate * mDurationMs / 1000);
+    if (frames == 0) {
+        return BAD_VALUE;
+    }
+    // a quarter of the window is enough for the audio thread to write into
+    // while flush() copies
+    mWindow = frames * mFrameSize;
+    mSize = (frames + frames / 4 + 1) * mFrameSize;
+    mBuffer = (uint8_t *)malloc(mSize);
+    if (mBuffer == NULL) {
+        return NO_MEMORY;
+    }
+    return NO_ERROR;
+}
+
+void AudioFlightRecorder::write(const void *buffer, size_t bytes)
+{
+    if (mBuffer == NULL) {
+        return;
+    }
+    const uint8_t *in = (const uint8_t *)buffer;
+    if (bytes > mSize) {
+        // only the end of a buffer larger than the ring is kept
+        in += bytes - mSize;
+        mWritten.fetch_add(bytes - mSize, std::memory_order_relaxed);
+        bytes = mSize;
+    }
+    uint64_t written = mWritten.load(std::memory_order_relaxed);
+    // published before the copy, see flush()
+    mWriting.store(written + bytes, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    size_t offset = written % mSize;
+    size_t first = mSize - offset < bytes ? mSize - offset : bytes;
+    memcpy(mBuffer + offset, in, first);
+    memcpy(mBuffer, in + first, bytes - first);
+    mWritten.store(written + bytes, std::memory_order_release);
+}
+
+void AudioFlightRecorder::copy(uint8_t *dst, uint64_t position, size_t bytes) const
+{
+    size_t offset = position % mSize;
+    size_t first = mSize - offset < bytes ? mSize - offset : bytes;
+    memcpy(dst, mBuffer + offset, first);
+    memcpy(dst + first, mBuffer, bytes - first);
+}
+
+status_t AudioFlightRecorder::flush(const char *path, const AudioDumpWriter::Config& config)
+{
+    if (mBuffer == NULL) {
+        return NO_INIT;
+    }
+    // the writer queues the whole window before the disk sees any of it
+    AudioDumpWriter::Config writerConfig = config;
+    writerConfig.ringMs = mDurationMs + 100;
+    sp<AudioDumpWriter> writer = new AudioDumpWriter(path, mFormat, mChannelCount,
+                                                     mSampleRate, writerConfig);
+    status_t status = writer->start();
+    if (status != NO_ERROR) {
+        ALOGW("flush() cannot start dump writer for %s: %d", path, status);
+        return status;
+    }
+
+    uint64_t end = mWritten.load(std::memory_order_acquire);
+    uint64_t position = end > mWindow ? end - mWindow : 0;
+    uint8_t chunk[kCopyBytes];
+    const size_t chunkBytes = kCopyBytes - kCopyBytes % mFrameSize;
+    uint64_t skipped = 0;
+    uint64_t flushed = 0;
+
+    while (position < end) {
+        size_t bytes = end - position < chunkBytes ? end - position : chunkBytes;
+        copy(chunk, position, bytes);
+        // the audio thread may be writing up to mWriting, over the oldest
+        // bytes of the ring
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t writing = mWriting.load(std::memory_order_relaxed);
+        if (writing - position > mSize) {
+            // overwritten while copying: move on to the oldest safe frame
+            uint64_t next = writing - mSize;
+            next += (mFrameSize - (next - position) % mFrameSize) % mFrameSize;
+            if (next > end) {
+                next = end;
+            }
+            skipped += next - position;
+            position = next;
+            continue;
+        }
+        writer->write(chunk, bytes);
+        position += bytes;
+        flushed += bytes;
+    }
+    writer->stop();
+
+    mFlushes.fetch_add(1, std::memory_order_relaxed);
+    if (skipped != 0) {
+        mBytesSkipped.fetch_add(skipped, std::memory_order_relaxed);
+        ALOGW("flush() %s: %llu bytes overwritten while copying", path,
+              (unsigned long long)skipped);
+    }
+    ALOGV("flush() %s: %llu bytes", path, (unsigned long long)flushed);
+    return NO_ERROR;
+}
+
+status_t AudioFlightRecorder::dump(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    uint64_t written = mWritten.load(std::memory_order_relaxed);
+    snprintf(buffer, SIZE, "\tflight recorder: %u ms, %zu/%zu bytes held, %u flushes,"
+             " %llu bytes skipped\n",
+             mDurationMs, (size_t)(written < mWindow ? written : mWindow), mWindow,
+             mFlushes.load(), (unsigned long long)mBytesSkipped.load());
+    ::write(fd, buffer, strlen(buffer));
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
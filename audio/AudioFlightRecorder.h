@@ -0,0 +1,95 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_FLIGHT_RECORDER_H
+#define ANDROID_AUDIO_FLIGHT_RECORDER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#include <utils/RefBase.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+#include "AudioDumpWriter.h"
+
+namespace android_audio_legacy {
+    using android::RefBase;
+    using android::sp;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioFlightRecorder keeps the last few seconds of a stream's PCM in memory
+ * so that they can be written to disk after the fact, e.g. when a glitch is
+ * reported.
+ *
+ * write() is called from the audio thread and only copies into a ring that
+ * it overwrites: it never waits, allocates or touches the disk. flush() is
+ * called from any other thread; it copies the recorded window into a new
+ * AudioDumpWriter, which writes the file in the background.
+ *
+ * The ring holds a margin on top of the window, so that the audio thread can
+ * keep writing while flush() copies. Frames overwritten during the copy
+ * anyway are skipped and counted.
+ */
+class AudioFlightRecorder : public RefBase {
+public:
+                        AudioFlightRecorder(int format, uint32_t channelCount,
+                                            uint32_t sampleRate, uint32_t durationMs);
+    virtual             ~AudioFlightRecorder();
+
+    /** allocate the ring */
+            status_t    init();
+
+    /** called from the audio thread: never blocks, never allocates */
+            void        write(const void *buffer, size_t bytes);
+
+    /** start writing the recorded window to path, see AudioDumpWriter */
+            status_t    flush(const char *path, const AudioDumpWriter::Config& config);
+
+            uint32_t    durationMs() const { return mDurationMs; }
+            status_t    dump(int fd);
+
+private:
+                        AudioFlightRecorder(const AudioFlightRecorder&);
+    AudioFlightRecorder& operator=(const AudioFlightRecorder&);
+
+            void        copy(uint8_t *dst, uint64_t position, size_t bytes) const;
+
+    const int           mFormat;
+    const uint32_t      mChannelCount;
+    const uint32_t      mSampleRate;
+    const uint32_t      mDurationMs;
+    const size_t        mFrameSize;
+
+    uint8_t             *mBuffer;
+    size_t              mWindow;        // bytes flushed, a whole number of frames
+    size_t              mSize;          // mWindow plus the margin
+    std::atomic<uint64_t> mWritten;     // bytes ever written, the ring position
+    std::atomic<uint64_t> mWriting;     // end of the write() in progress, ahead of mWritten
+
+    std::atomic<uint32_t> mFlushes;
+    std::atomic<uint64_t> mBytesSkipped;    // overwritten while flushing
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_FLIGHT_RECORDER_H
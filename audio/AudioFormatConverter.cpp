@@ -0,0 +1,587 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioFormatConverter"
+//#define LOG_NDEBUG 0
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include "AudioFormatConverter.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2 1
+#endif
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+static const float kScaleFromQ15 = 1.0f / (1 << 15);
+static const float kScaleFromQ8_23 = 1.0f / (1 << 23);
+static const float kScaleFromQ31 = 1.0f / (1u << 31);
+
+static inline int16_t clamp16(int32_t sample)
+{
+    if ((sample >> 15) ^ (sample >> 31)) {
+        sample = 0x7FFF ^ (sample >> 31);
+    }
+    return sample;
+}
+
+static inline int16_t clamp16_from_float(float f)
+{
+    if (f <= -1.0f) return -0x8000;
+    if (f >= 1.0f) return 0x7FFF;
+    f *= (1 << 15);
+    return clamp16((int32_t)(f > 0 ? f + 0.5f : f - 0.5f));
+}
+
+static inline int32_t clampq8_23_from_float(float f)
+{
+    // Q8.23 covers [-256.0, 256.0)
+    if (f <= -256.0f) return INT32_MIN;
+    if (f >= 256.0f) return INT32_MAX;
+    double d = (double)f * (1 << 23);
+    d = d > 0 ? d + 0.5 : d - 0.5;
+    return d >= INT32_MAX ? INT32_MAX : (int32_t)d;
+}
+
+static inline int32_t clampq31_from_float(float f)
+{
+    if (f <= -1.0f) return INT32_MIN;
+    if (f >= 1.0f) return INT32_MAX;
+    double d = (double)f * (1u << 31);
+    d = d > 0 ? d + 0.5 : d - 0.5;
+    return d >= INT32_MAX ? INT32_MAX : (int32_t)d;
+}
+
+// ----------------------------------------------------------------------------
+// sample format kernels: "count" is a number of samples
+
+static void float_from_i16(void *dst, const void *src, size_t count)
+{
+    float *out = (float *)dst;
+    const int16_t *in = (const int16_t *)src;
+#if defined(USE_NEON)
+    for (; count >= 8; count -= 8, in += 8, out += 8) {
+        int16x8_t s = vld1q_s16(in);
+        vst1q_f32(out, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(s)), 15));
+        vst1q_f32(out + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(s)), 15));
+    }
+#elif defined(USE_SSE2)
+    const __m128 scale = _mm_set1_ps(kScaleFromQ15);
+    for (; count >= 8; count -= 8, in += 8, out += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)in);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+    while (count--) {
+        *out++ = *in++ * kScaleFromQ15;
+    }
+}
+
+static void i16_from_float(void *dst, const void *src, size_t count)
+{
+    int16_t *out = (int16_t *)dst;
+    const float *in = (const float *)src;
+#if defined(USE_NEON)
+    for (; count >= 8; count -= 8, in += 8, out += 8) {
+        // float to Q31 saturates, then round and narrow to Q15
+        int32x4_t lo = vcvtq_n_s32_f32(vld1q_f32(in), 31);
+        int32x4_t hi = vcvtq_n_s32_f32(vld1q_f32(in + 4), 31);
+        vst1q_s16(out, vcombine_s16(vqrshrn_n_s32(lo, 16), vqrshrn_n_s32(hi, 16)));
+    }
+#elif defined(USE_SSE2)
+    const __m128 scale = _mm_set1_ps(1 << 15);
+    const __m128 vmin = _mm_set1_ps(-1.0f);
+    const __m128 vmax = _mm_set1_ps(1.0f);
+    for (; count >= 8; count -= 8, in += 8, out += 8) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in), vmin), vmax);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + 4), vmin), vmax);
+        // cvtps rounds to nearest, packs saturates 32768 to 32767
+        __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+        __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+        _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(lo, hi));
+    }
+#endif
+    while (count--) {
+        *out++ = clamp16_from_float(*in++);
+    }
+}
+
+static void float_from_q8_23(void *dst, const void *src, size_t count)
+{
+    float *out = (float *)dst;
+    const int32_t *in = (const int32_t *)src;
+#if defined(USE_NEON)
+    for (; count >= 4; count -= 4, in += 4, out += 4) {
+        vst1q_f32(out, vcvtq_n_f32_s32(vld1q_s32(in), 23));
+    }
+#elif defined(USE_SSE2)
+    const __m128 scale = _mm_set1_ps(kScaleFromQ8_23);
+    for (; count >= 4; count -= 4, in += 4, out += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)in);
+        _mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+    }
+#endif
+    while (count--) {
+        *out++ = *in++ * kScaleFromQ8_23;
+    }
+}
+
+static void q8_23_from_float(void *dst, const void *src, size_t count)
+{
+    int32_t *out = (int32_t *)dst;
+    const float *in = (const float *)src;
+#if defined(USE_NEON)
+    for (; count >= 4; count -= 4, in += 4, out += 4) {
+        // the saturating conversion truncates toward zero: add half an LSB first
+        float32x4_t f = vld1q_f32(in);
+        float32x4_t half = vbslq_f32(vcltq_f32(f, vdupq_n_f32(0.0f)),
+                vdupq_n_f32(-0.5f / (1 << 23)), vdupq_n_f32(0.5f / (1 << 23)));
+        vst1q_s32(out, vcvtq_n_s32_f32(vaddq_f32(f, half), 23));
+    }
+#elif defined(USE_SSE2)
+    const __m128 scale = _mm_set1_ps(1 << 23);
+    const __m128 vmin = _mm_set1_ps(-256.0f);
+    // largest float below 256.0f, keeps the product within int32 range
+    const __m128 vmax = _mm_set1_ps(255.99998f);
+    for (; count >= 4; count -= 4, in += 4, out += 4) {
+        __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in), vmin), vmax);
+        _mm_storeu_si128((__m128i *)out, _mm_cvtps_epi32(_mm_mul_ps(f, scale)));
+    }
+#endif
+    while (count--) {
+        *out++ = clampq8_23_from_float(*in++);
+    }
+}
+
+static void float_from_q31(void *dst, const void *src, size_t count)
+{
+    float *out = (float *)dst;
+    const int32_t *in = (const int32_t *)src;
+#if defined(USE_NEON)
+    for (; count >= 4; count -= 4, in += 4, out += 4) {
+        vst1q_f32(out, vcvtq_n_f32_s32(vld1q_s32(in), 31));
+    }
+#elif defined(USE_SSE2)
+    const __m128 scale = _mm_set1_ps(kScaleFromQ31);
+    for (; count >= 4; count -= 4, in += 4, out += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)in);
+        _mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+    }
+#endif
+    while (count--) {
+        *out++ = *in++ * kScaleFromQ31;
+    }
+}
+
+// scalar only: +1.0 does not fit the vector conversions, and 32 bit PCM is
+// only met replaying WAV files
+static void q31_from_float(void *dst, const void *src, size_t count)
+{
+    int32_t *out = (int32_t *)dst;
+    const float *in = (const float *)src;
+    while (count--) {
+        *out++ = clampq31_from_float(*in++);
+    }
+}
+
+static void q8_23_from_i16(void *dst, const void *src, size_t count)
+{
+    int32_t *out = (int32_t *)dst;
+    const int16_t *in = (const int16_t *)src;
+#if defined(USE_NEON)
+    for (; count >= 8; count -= 8, in += 8, out += 8) {
+        int16x8_t s = vld1q_s16(in);
+        vst1q_s32(out, vshll_n_s16(vget_low_s16(s), 8));
+        vst1q_s32(out + 4, vshll_n_s16(vget_high_s16(s), 8));
+    }
+#elif defined(USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; count >= 8; count -= 8, in += 8, out += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)in);
+        // move each sample to the upper half, then shift back down by 16 - 8
+        _mm_storeu_si128((__m128i *)out, _mm_srai_epi32(_mm_unpacklo_epi16(zero, s), 8));
+        _mm_storeu_si128((__m128i *)(out + 4), _mm_srai_epi32(_mm_unpackhi_epi16(zero, s), 8));
+    }
+#endif
+    while (count--) {
+        *out++ = (int32_t)*in++ << 8;
+    }
+}
+
+static void i16_from_q8_23(void *dst, const void *src, size_t count)
+{
+    int16_t *out = (int16_t *)dst;
+    const int32_t *in = (const int32_t *)src;
+#if defined(USE_NEON)
+    for (; count >= 8; count -= 8, in += 8, out += 8) {
+        int16x4_t lo = vqrshrn_n_s32(vld1q_s32(in), 8);
+        int16x4_t hi = vqrshrn_n_s32(vld1q_s32(in + 4), 8);
+        vst1q_s16(out, vcombine_s16(lo, hi));
+    }
+#elif defined(USE_SSE2)
+    const __m128i one = _mm_set1_epi32(1);
+    for (; count >= 8; count -= 8, in += 8, out += 8) {
+        // round without overflowing near INT32_MAX: ((x >> 7) + 1) >> 1
+        __m128i lo = _mm_loadu_si128((const __m128i *)in);
+        __m128i hi = _mm_loadu_si128((const __m128i *)(in + 4));
+        lo = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(lo, 7), one), 1);
+        hi = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(hi, 7), one), 1);
+        _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(lo, hi));
+    }
+#endif
+    while (count--) {
+        *out++ = clamp16(((*in++ >> 7) + 1) >> 1);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// direct 16 bit layout kernels: "count" is the number of source samples
+
+static void i16_mono_to_stereo(void *dst, const void *src, size_t count)
+{
+    int16_t *out = (int16_t *)dst;
+    const int16_t *in = (const int16_t *)src;
+#if defined(USE_NEON)
+    for (; count >= 8; count -= 8, in += 8, out += 16) {
+        int16x8x2_t s;
+        s.val[0] = s.val[1] = vld1q_s16(in);
+        vst2q_s16(out, s);
+    }
+#elif defined(USE_SSE2)
+    for (; count >= 8; count -= 8, in += 8, out += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *)in);
+        _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(s, s));
+        _mm_storeu_si128((__m128i *)(out + 8), _mm_unpackhi_epi16(s, s));
+    }
+#endif
+    while (count--) {
+        out[0] = out[1] = *in++;
+        out += 2;
+    }
+}
+
+static void i16_stereo_to_mono(void *dst, const void *src, size_t count)
+{
+    int16_t *out = (int16_t *)dst;
+    const int16_t *in = (const int16_t *)src;
+    size_t frames = count / 2;
+#if defined(USE_NEON)
+    for (; frames >= 8; frames -= 8, in += 16, out += 8) {
+        int16x8x2_t s = vld2q_s16(in);
+        vst1q_s16(out, vhaddq_s16(s.val[0], s.val[1]));
+    }
+#elif defined(USE_SSE2)
+    for (; frames >= 8; frames -= 8, in += 16, out += 8) {
+        // (l + r) >> 1 per frame: madd sums each L/R pair into 32 bits
+        __m128i a = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)in), _mm_set1_epi16(1));
+        __m128i b = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(in + 8)), _mm_set1_epi16(1));
+        _mm_storeu_si128((__m128i *)out,
+                _mm_packs_epi32(_mm_srai_epi32(a, 1), _mm_srai_epi32(b, 1)));
+    }
+#endif
+    while (frames--) {
+        *out++ = ((int32_t)in[0] + in[1]) >> 1;
+        in += 2;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// float layout kernels
+
+static void float_mono_to_stereo(float *dst, const float *src, size_t frames,
+                                 const int8_t *map, uint32_t srcCount, uint32_t dstCount)
+{
+#if defined(USE_NEON)
+    for (; frames >= 4; frames -= 4, src += 4, dst += 8) {
+        float32x4x2_t s;
+        s.val[0] = s.val[1] = vld1q_f32(src);
+        vst2q_f32(dst, s);
+    }
+#elif defined(USE_SSE2)
+    for (; frames >= 4; frames -= 4, src += 4, dst += 8) {
+        __m128 s = _mm_loadu_ps(src);
+        _mm_storeu_ps(dst, _mm_unpacklo_ps(s, s));
+        _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(s, s));
+    }
+#endif
+    while (frames--) {
+        dst[0] = dst[1] = *src++;
+        dst += 2;
+    }
+}
+
+static void float_stereo_to_mono(float *dst, const float *src, size_t frames,
+                                 const int8_t *map, uint32_t srcCount, uint32_t dstCount)
+{
+#if defined(USE_NEON)
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    for (; frames >= 4; frames -= 4, src += 8, dst += 4) {
+        float32x4x2_t s = vld2q_f32(src);
+        vst1q_f32(dst, vmulq_f32(vaddq_f32(s.val[0], s.val[1]), half));
+    }
+#elif defined(USE_SSE2)
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; frames >= 4; frames -= 4, src += 8, dst += 4) {
+        __m128 a = _mm_loadu_ps(src);
+        __m128 b = _mm_loadu_ps(src + 4);
+        __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_add_ps(l, r), half));
+    }
+#endif
+    while (frames--) {
+        *dst++ = (src[0] + src[1]) * 0.5f;
+        src += 2;
+    }
+}
+
+static void float_mono_to_multi(float *dst, const float *src, size_t frames,
+                                const int8_t *map, uint32_t srcCount, uint32_t dstCount)
+{
+    while (frames--) {
+        for (uint32_t i = 0; i < dstCount; i++) {
+            *dst++ = *src;
+        }
+        src++;
+    }
+}
+
+static void float_remap(float *dst, const float *src, size_t frames,
+                        const int8_t *map, uint32_t srcCount, uint32_t dstCount)
+{
+    while (frames--) {
+        for (uint32_t i = 0; i < dstCount; i++) {
+            *dst++ = map[i] < 0 ? 0.0f : src[map[i]];
+        }
+        src += srcCount;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+AudioFormatConverter::AudioFormatConverter()
+    : mSrcFormat(AUDIO_FORMAT_PCM_16_BIT), mDstFormat(AUDIO_FORMAT_PCM_16_BIT),
+      mSrcChannelCount(0), mDstChannelCount(0), mSrcFrameSize(0), mDstFrameSize(0),
+      mPassthrough(true), mDirect(NULL), mToFloat(NULL), mChannelOp(NULL), mFromFloat(NULL),
+      mScratch(NULL)
+{
+    memset(mChannelMap, 0, sizeof(mChannelMap));
+}
+
+AudioFormatConverter::~AudioFormatConverter()
+{
+    free(mScratch);
+}
+
+bool AudioFormatConverter::isSupportedFormat(int format)
+{
+    switch (format) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+    case AUDIO_FORMAT_PCM_32_BIT:
+    case AUDIO_FORMAT_PCM_FLOAT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool AudioFormatConverter::isSupportedChannelMask(uint32_t channelMask)
+{
+    uint32_t count = AudioSystem::popCount(channelMask);
+    return count > 0 && count <= MAX_CHANNELS;
+}
+
+status_t AudioFormatConverter::set(audio_format_t srcFormat, uint32_t srcChannelMask,
+                                   audio_format_t dstFormat, uint32_t dstChannelMask)
+{
+    if (!isSupportedFormat(srcFormat) || !isSupportedFormat(dstFormat) ||
+            !isSupportedChannelMask(srcChannelMask) || !isSupportedChannelMask(dstChannelMask)) {
+        ALOGW("set() unsupported conversion format %#x -> %#x channels %#x -> %#x",
+              srcFormat, dstFormat, srcChannelMask, dstChannelMask);
+        return BAD_VALUE;
+    }
+
+    if (mScratch == NULL) {
+        mScratch = (float *)malloc(2 * SCRATCH_FRAMES * MAX_CHANNELS * sizeof(float));
+        if (mScratch == NULL) {
+            return NO_MEMORY;
+        }
+    }
+
+    uint32_t srcCount = AudioSystem::popCount(srcChannelMask);
+    uint32_t dstCount = AudioSystem::popCount(dstChannelMask);
+
+    // map each destination position to the source channel carrying it. Legacy
+    // masks are positional, so a channel's index is the number of lower bits set.
+    bool matched = false;
+    uint32_t dstBits = dstChannelMask;
+    for (uint32_t i = 0; i < dstCount; i++) {
+        uint32_t bit = dstBits & -dstBits;
+        dstBits &= ~bit;
+        if (srcChannelMask & bit) {
+            mChannelMap[i] = (int8_t)AudioSystem::popCount(srcChannelMask & (bit - 1));
+            matched = true;
+        } else {
+            mChannelMap[i] = -1;
+        }
+    }
+    if (!matched) {
+        // no common positions (e.g. front/back vs left/right): keep channel order
+        for (uint32_t i = 0; i < dstCount; i++) {
+            mChannelMap[i] = i < srcCount ? (int8_t)i : -1;
+        }
+    }
+    bool identity = (srcCount == dstCount);
+    for (uint32_t i = 0; i < dstCount && identity; i++) {
+        identity = (mChannelMap[i] == (int8_t)i);
+    }
+
+    mSrcFormat = srcFormat;
+    mDstFormat = dstFormat;
+    mSrcChannelCount = srcCount;
+    mDstChannelCount = dstCount;
+    mSrcFrameSize = srcCount * audio_bytes_per_sample(srcFormat);
+    mDstFrameSize = dstCount * audio_bytes_per_sample(dstFormat);
+    mPassthrough = identity && (srcFormat == dstFormat);
+    mDirect = NULL;
+    mChannelOp = NULL;
+
+    if (identity) {
+        if (srcFormat == AUDIO_FORMAT_PCM_16_BIT && dstFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            mDirect = float_from_i16;
+        } else if (srcFormat == AUDIO_FORMAT_PCM_FLOAT && dstFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            mDirect = i16_from_float;
+        } else if (srcFormat == AUDIO_FORMAT_PCM_8_24_BIT && dstFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            mDirect = float_from_q8_23;
+        } else if (srcFormat == AUDIO_FORMAT_PCM_FLOAT && dstFormat == AUDIO_FORMAT_PCM_8_24_BIT) {
+            mDirect = q8_23_from_float;
+        } else if (srcFormat == AUDIO_FORMAT_PCM_16_BIT && dstFormat == AUDIO_FORMAT_PCM_8_24_BIT) {
+            mDirect = q8_23_from_i16;
+        } else if (srcFormat == AUDIO_FORMAT_PCM_8_24_BIT && dstFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            mDirect = i16_from_q8_23;
+        }
+    } else if (srcFormat == AUDIO_FORMAT_PCM_16_BIT && dstFormat == AUDIO_FORMAT_PCM_16_BIT) {
+        if (srcCount == 1 && dstCount == 2) {
+            mDirect = i16_mono_to_stereo;
+        } else if (srcCount == 2 && dstCount == 1) {
+            mDirect = i16_stereo_to_mono;
+        }
+    }
+
+    if (!identity) {
+        if (srcCount == 1 && dstCount == 2) {
+            mChannelOp = float_mono_to_stereo;
+        } else if (srcCount == 2 && dstCount == 1) {
+            mChannelOp = float_stereo_to_mono;
+        } else if (srcCount == 1) {
+            mChannelOp = float_mono_to_multi;
+        } else {
+            mChannelOp = float_remap;
+        }
+    }
+    // a NULL stage means the data already is float
+    mToFloat = NULL;
+    switch (srcFormat) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+        mToFloat = float_from_i16;
+        break;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        mToFloat = float_from_q8_23;
+        break;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        mToFloat = float_from_q31;
+        break;
+    default:
+        break;
+    }
+    mFromFloat = NULL;
+    switch (dstFormat) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+        mFromFloat = i16_from_float;
+        break;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        mFromFloat = q8_23_from_float;
+        break;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        mFromFloat = q31_from_float;
+        break;
+    default:
+        break;
+    }
+
+    ALOGV("set() format %#x -> %#x channels %u -> %u passthrough %d direct %d",
+          srcFormat, dstFormat, srcCount, dstCount, mPassthrough, mDirect != NULL);
+    return NO_ERROR;
+}
+
+void AudioFormatConverter::convert(void *dst, const void *src, size_t frames)
+{
+    if (mPassthrough) {
+        memcpy(dst, src, frames * mSrcFrameSize);
+        return;
+    }
+    if (mDirect != NULL) {
+        mDirect(dst, src, frames * mSrcChannelCount);
+        return;
+    }
+
+    // float scratch path, SCRATCH_FRAMES at a time
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = (uint8_t *)dst;
+    float *flt = mScratch;
+    float *mixed = mScratch + SCRATCH_FRAMES * MAX_CHANNELS;
+    while (frames) {
+        size_t chunk = frames < SCRATCH_FRAMES ? frames : SCRATCH_FRAMES;
+        const float *stage = (const float *)in;
+        if (mToFloat != NULL) {
+            mToFloat(flt, in, chunk * mSrcChannelCount);
+            stage = flt;
+        }
+        if (mChannelOp != NULL) {
+            float *target = (mFromFloat != NULL) ? mixed : (float *)out;
+            mChannelOp(target, stage, chunk, mChannelMap, mSrcChannelCount, mDstChannelCount);
+            stage = target;
+        }
+        if (mFromFloat != NULL) {
+            mFromFloat(out, stage, chunk * mDstChannelCount);
+        } else if (stage != (const float *)out) {
+            memcpy(out, stage, chunk * mDstFrameSize);
+        }
+        in += chunk * mSrcFrameSize;
+        out += chunk * mDstFrameSize;
+        frames -= chunk;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,104 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_FORMAT_CONVERTER_H
+#define ANDROID_AUDIO_FORMAT_CONVERTER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioFormatConverter converts interleaved PCM between the sample formats and
+ * channel layouts a client asked for and the ones a legacy driver accepts.
+ *
+ * Supported sample formats are PCM_16, PCM_8_24, PCM_32 and FLOAT; PCM_32
+ * always goes through the float scratch path. Channel masks may hold up to
+ * MAX_CHANNELS positions: mono and stereo are up/down-mixed, other layouts are
+ * remapped by channel position (missing positions are silent).
+ *
+ * The conversion kernels are chosen once in set(); convert() never allocates
+ * and can be called from the audio thread. Inner loops use NEON or SSE2 when
+ * the target supports them and fall back to portable C otherwise.
+ */
+class AudioFormatConverter {
+public:
+    enum { MAX_CHANNELS = 8 };
+
+                        AudioFormatConverter();
+                        ~AudioFormatConverter();
+
+    /**
+     * configure the conversion. Both channel masks must be of the same kind
+     * (both output or both input masks). Returns BAD_VALUE if either side is
+     * not supported, in which case the previous configuration is kept.
+     */
+    status_t            set(audio_format_t srcFormat, uint32_t srcChannelMask,
+                            audio_format_t dstFormat, uint32_t dstChannelMask);
+
+    /** convert frames from src to dst. Buffers must not overlap. */
+    void                convert(void *dst, const void *src, size_t frames);
+
+    /** true if source and destination layouts are identical */
+    bool                isPassthrough() const { return mPassthrough; }
+
+    size_t              srcFrameSize() const { return mSrcFrameSize; }
+    size_t              dstFrameSize() const { return mDstFrameSize; }
+
+    static bool         isSupportedFormat(int format);
+    static bool         isSupportedChannelMask(uint32_t channelMask);
+
+private:
+    // number of frames converted per pass through the float scratch buffer
+    enum { SCRATCH_FRAMES = 256 };
+
+    typedef void (*sample_fn_t)(void *dst, const void *src, size_t samples);
+    typedef void (*channel_fn_t)(float *dst, const float *src, size_t frames,
+                                 const int8_t *map, uint32_t srcCount, uint32_t dstCount);
+
+                        AudioFormatConverter(const AudioFormatConverter&);
+    AudioFormatConverter& operator=(const AudioFormatConverter&);
+
+    audio_format_t      mSrcFormat;
+    audio_format_t      mDstFormat;
+    uint32_t            mSrcChannelCount;
+    uint32_t            mDstChannelCount;
+    size_t              mSrcFrameSize;
+    size_t              mDstFrameSize;
+    bool                mPassthrough;
+
+    // single pass conversion, used when only one of format or layout changes
+    // and a direct kernel exists. NULL if the float scratch path is needed.
+    sample_fn_t         mDirect;
+    // float scratch path: source format to float, channel op, float to destination
+    sample_fn_t         mToFloat;
+    channel_fn_t        mChannelOp;
+    sample_fn_t         mFromFloat;
+    int8_t              mChannelMap[MAX_CHANNELS]; // destination channel -> source channel
+    float               *mScratch;                 // 2 * SCRATCH_FRAMES * MAX_CHANNELS
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_FORMAT_CONVERTER_H
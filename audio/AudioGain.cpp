@@ -0,0 +1,207 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioGain"
+//#define LOG_NDEBUG 0
+
+#include <stdint.h>
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include "AudioGain.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2 1
+#endif
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// PCM_16 samples are scaled by Q14 gains: unity fits in an int16_t and the
+// product of a sample and a gain fits in 32 bits
+static const int kGainShift = 14;
+static const float kUnityQ14 = 1 << kGainShift;
+
+static inline int16_t clamp16(int32_t sample)
+{
+    if ((sample >> 15) ^ (sample >> 31)) {
+        sample = 0x7FFF ^ (sample >> 31);
+    }
+    return sample;
+}
+
+static inline float clampVolume(float v)
+{
+    return v > 1.0f ? 1.0f : (v >= 0.0f ? v : 0.0f);
+}
+
+// ----------------------------------------------------------------------------
+// constant gain kernels: "gains" repeats every 2 samples, "count" is a number of samples
+
+static void gain_i16(int16_t *buffer, size_t count, const int16_t gains[2])
+{
+#if defined(USE_NEON)
+    const int16_t pattern[8] = { gains[0], gains[1], gains[0], gains[1],
+                                 gains[0], gains[1], gains[0], gains[1] };
+    const int16x8_t g = vld1q_s16(pattern);
+    for (; count >= 8; count -= 8, buffer += 8) {
+        int16x8_t s = vld1q_s16(buffer);
+        int32x4_t lo = vmull_s16(vget_low_s16(s), vget_low_s16(g));
+        int32x4_t hi = vmull_s16(vget_high_s16(s), vget_high_s16(g));
+        vst1q_s16(buffer, vcombine_s16(vqrshrn_n_s32(lo, kGainShift),
+                                       vqrshrn_n_s32(hi, kGainShift)));
+    }
+#elif defined(USE_SSE2)
+    const __m128i g = _mm_setr_epi16(gains[0], gains[1], gains[0], gains[1],
+                                     gains[0], gains[1], gains[0], gains[1]);
+    const __m128i round = _mm_set1_epi32(1 << (kGainShift - 1));
+    for (; count >= 8; count -= 8, buffer += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)buffer);
+        // 32 bit products from their low and high halves
+        __m128i plo = _mm_mullo_epi16(s, g);
+        __m128i phi = _mm_mulhi_epi16(s, g);
+        __m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(plo, phi), round), kGainShift);
+        __m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(plo, phi), round), kGainShift);
+        _mm_storeu_si128((__m128i *)buffer, _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] = clamp16((buffer[i] * gains[i & 1] + (1 << (kGainShift - 1))) >> kGainShift);
+    }
+}
+
+static void gain_float(float *buffer, size_t count, const float gains[2])
+{
+#if defined(USE_NEON)
+    const float pattern[4] = { gains[0], gains[1], gains[0], gains[1] };
+    const float32x4_t g = vld1q_f32(pattern);
+    for (; count >= 4; count -= 4, buffer += 4) {
+        vst1q_f32(buffer, vmulq_f32(vld1q_f32(buffer), g));
+    }
+#elif defined(USE_SSE2)
+    const __m128 g = _mm_setr_ps(gains[0], gains[1], gains[0], gains[1]);
+    for (; count >= 4; count -= 4, buffer += 4) {
+        _mm_storeu_ps(buffer, _mm_mul_ps(_mm_loadu_ps(buffer), g));
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] *= gains[i & 1];
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+AudioGain::AudioGain()
+    : mFormat(AUDIO_FORMAT_PCM_16_BIT), mChannelCount(2)
+{
+    mCurrent[0] = mCurrent[1] = 1.0f;
+    mTarget[0] = mTarget[1] = 1.0f;
+}
+
+status_t AudioGain::set(audio_format_t format, uint32_t channelCount)
+{
+    if ((format != AUDIO_FORMAT_PCM_16_BIT && format != AUDIO_FORMAT_PCM_FLOAT) ||
+            channelCount == 0) {
+        return BAD_VALUE;
+    }
+    mFormat = format;
+    mChannelCount = channelCount;
+    mCurrent[0] = mCurrent[1] = 1.0f;
+    mTarget[0] = mTarget[1] = 1.0f;
+    return NO_ERROR;
+}
+
+void AudioGain::setVolume(float left, float right)
+{
+    left = clampVolume(left);
+    right = clampVolume(right);
+    if (mChannelCount != 2) {
+        left = right = (left + right) / 2;
+    }
+    mTarget[0] = left;
+    mTarget[1] = right;
+}
+
+bool AudioGain::isUnity() const
+{
+    return mTarget[0] == 1.0f && mTarget[1] == 1.0f &&
+            mCurrent[0] == 1.0f && mCurrent[1] == 1.0f;
+}
+
+void AudioGain::apply(void *buffer, size_t frames)
+{
+    if (frames == 0) {
+        return;
+    }
+    const size_t count = frames * mChannelCount;
+
+    if (mCurrent[0] != mTarget[0] || mCurrent[1] != mTarget[1]) {
+        // linear ramp over this buffer, in float: it only runs once per change
+        const float step[2] = { (mTarget[0] - mCurrent[0]) / frames,
+                                (mTarget[1] - mCurrent[1]) / frames };
+        float g[2] = { mCurrent[0], mCurrent[1] };
+        size_t stride = mChannelCount == 2 ? 1 : 0;
+        if (mFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            int16_t *p = (int16_t *)buffer;
+            for (size_t i = 0; i < frames; i++) {
+                g[0] += step[0];
+                g[1] += step[1];
+                for (size_t c = 0; c < mChannelCount; c++) {
+                    float s = *p * g[c & stride];
+                    *p++ = clamp16((int32_t)(s > 0 ? s + 0.5f : s - 0.5f));
+                }
+            }
+        } else {
+            float *p = (float *)buffer;
+            for (size_t i = 0; i < frames; i++) {
+                g[0] += step[0];
+                g[1] += step[1];
+                for (size_t c = 0; c < mChannelCount; c++) {
+                    *p++ *= g[c & stride];
+                }
+            }
+        }
+        mCurrent[0] = mTarget[0];
+        mCurrent[1] = mTarget[1];
+        return;
+    }
+
+    if (mTarget[0] == 1.0f && mTarget[1] == 1.0f) {
+        return;
+    }
+    if (mTarget[0] == 0.0f && mTarget[1] == 0.0f) {
+        memset(buffer, 0, count * audio_bytes_per_sample(mFormat));
+        return;
+    }
+    if (mFormat == AUDIO_FORMAT_PCM_16_BIT) {
+        const int16_t gains[2] = { (int16_t)(mTarget[0] * kUnityQ14 + 0.5f),
+                                   (int16_t)(mTarget[1] * kUnityQ14 + 0.5f) };
+        gain_i16((int16_t *)buffer, count, gains);
+    } else {
+        gain_float((float *)buffer, count, mTarget);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,69 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_GAIN_H
+#define ANDROID_AUDIO_GAIN_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioGain applies a left/right volume in place to interleaved PCM_16 or
+ * FLOAT frames. Mono and multichannel frames use the average of both.
+ *
+ * Volumes are linear, in [0.0, 1.0]. A new volume is reached with a linear
+ * ramp over the next buffer handed to apply(), so changes do not click. A
+ * constant volume uses NEON or SSE2 when the target supports them; unity is
+ * left untouched and zero is written as silence.
+ *
+ * Not thread safe: setVolume() and apply() are called from the thread that
+ * writes the stream.
+ */
+class AudioGain {
+public:
+                        AudioGain();
+
+    /** PCM_16 or FLOAT, any channel count. Resets the volume to unity. */
+    status_t            set(audio_format_t format, uint32_t channelCount);
+
+    void                setVolume(float left, float right);
+    void                apply(void *buffer, size_t frames);
+
+    /** true if apply() would leave the buffer untouched */
+    bool                isUnity() const;
+
+    float               left() const { return mTarget[0]; }
+    float               right() const { return mTarget[1]; }
+
+private:
+    audio_format_t      mFormat;
+    uint32_t            mChannelCount;
+    float               mCurrent[2];    // volume the last buffer ended with
+    float               mTarget[2];
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_GAIN_H
@@ -0,0 +1,231 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioHardwareExtension"
+//#define LOG_NDEBUG 0
+
+#include <utils/KeyedVector.h>
+#include <utils/Log.h>
+#include <utils/threads.h>
+
+#include <hardware_legacy/AudioHardwareExtension.h>
+
+namespace android_audio_legacy {
+    using android::KeyedVector;
+    using android::Mutex;
+
+// ----------------------------------------------------------------------------
+
+// extensions by the object they extend. Lookups only happen when a device or
+// stream is opened, so a sorted vector under a lock is enough.
+template <typename T, typename E>
+class ExtensionRegistry {
+public:
+    void add(T *object, E *extension) {
+        Mutex::Autolock _l(mLock);
+        ALOGW_IF(mExtensions.indexOfKey(object) >= 0, "object %p extended twice", object);
+        mExtensions.replaceValueFor(object, extension);
+    }
+    void remove(T *object) {
+        Mutex::Autolock _l(mLock);
+        mExtensions.removeItem(object);
+    }
+    E *query(T *object) {
+        Mutex::Autolock _l(mLock);
+        ssize_t index = mExtensions.indexOfKey(object);
+        return index >= 0 ? mExtensions.valueAt(index) : NULL;
+    }
+
+private:
+    Mutex mLock;
+    KeyedVector<T *, E *> mExtensions;
+};
+
+// constructed on first use: extensions may be created from static constructors
+static ExtensionRegistry<AudioStreamOut, AudioStreamOutExtension>& outputs()
+{
+    static ExtensionRegistry<AudioStreamOut, AudioStreamOutExtension> sOutputs;
+    return sOutputs;
+}
+
+static ExtensionRegistry<AudioStreamIn, AudioStreamInExtension>& inputs()
+{
+    static ExtensionRegistry<AudioStreamIn, AudioStreamInExtension> sInputs;
+    return sInputs;
+}
+
+static ExtensionRegistry<AudioHardwareInterface, AudioHardwareExtension>& devices()
+{
+    static ExtensionRegistry<AudioHardwareInterface, AudioHardwareExtension> sDevices;
+    return sDevices;
+}
+
+// ----------------------------------------------------------------------------
+
+AudioStreamOutExtension::AudioStreamOutExtension(AudioStreamOut *out)
+    : mOut(out)
+{
+    outputs().add(out, this);
+}
+
+AudioStreamOutExtension::~AudioStreamOutExtension()
+{
+    outputs().remove(mOut);
+}
+
+AudioStreamOutExtension* AudioStreamOutExtension::query(AudioStreamOut *out)
+{
+    return outputs().query(out);
+}
+
+status_t AudioStreamOutExtension::setParameterList(const AudioParameterList& params)
+{
+    String8 keyValuePairs;
+    params.toString(&keyValuePairs);
+    return mOut->setParameters(keyValuePairs);
+}
+
+status_t AudioStreamOutExtension::addAudioEffect(effect_handle_t effect)
+{
+    return NO_ERROR;
+}
+
+status_t AudioStreamOutExtension::removeAudioEffect(effect_handle_t effect)
+{
+    return NO_ERROR;
+}
+
+// default implementations are unsupported: the stream is not offloaded
+status_t AudioStreamOutExtension::setCallback(stream_callback_t callback, void *cookie)
+{
+    return INVALID_OPERATION;
+}
+
+status_t AudioStreamOutExtension::pause()
+{
+    return INVALID_OPERATION;
+}
+
+status_t AudioStreamOutExtension::resume()
+{
+    return INVALID_OPERATION;
+}
+
+status_t AudioStreamOutExtension::drain(audio_drain_type_t type)
+{
+    return INVALID_OPERATION;
+}
+
+status_t AudioStreamOutExtension::flush()
+{
+    return INVALID_OPERATION;
+}
+
+AudioStreamInExtension::AudioStreamInExtension(AudioStreamIn *in)
+    : mIn(in)
+{
+    inputs().add(in, this);
+}
+
+AudioStreamInExtension::~AudioStreamInExtension()
+{
+    inputs().remove(mIn);
+}
+
+AudioStreamInExtension* AudioStreamInExtension::query(AudioStreamIn *in)
+{
+    return inputs().query(in);
+}
+
+status_t AudioStreamInExtension::setParameterList(const AudioParameterList& params)
+{
+    String8 keyValuePairs;
+    params.toString(&keyValuePairs);
+    return mIn->setParameters(keyValuePairs);
+}
+
+AudioHardwareExtension::AudioHardwareExtension(AudioHardwareInterface *hw)
+    : mHardware(hw)
+{
+    devices().add(hw, this);
+}
+
+AudioHardwareExtension::~AudioHardwareExtension()
+{
+    devices().remove(mHardware);
+}
+
+AudioHardwareExtension* AudioHardwareExtension::query(AudioHardwareInterface *hw)
+{
+    return devices().query(hw);
+}
+
+status_t AudioHardwareExtension::setParameterList(const AudioParameterList& params)
+{
+    String8 keyValuePairs;
+    params.toString(&keyValuePairs);
+    return mHardware->setParameters(keyValuePairs);
+}
+
+bool AudioHardwareExtension::supportsAudioPatches() const
+{
+    return false;
+}
+
+bool AudioHardwareExtension::supportsOffload() const
+{
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+status_t setParameterList(AudioStreamOut *out, const AudioParameterList& params)
+{
+    AudioStreamOutExtension *extension = AudioStreamOutExtension::query(out);
+    if (extension != NULL) {
+        return extension->setParameterList(params);
+    }
+    String8 keyValuePairs;
+    params.toString(&keyValuePairs);
+    return out->setParameters(keyValuePairs);
+}
+
+status_t setParameterList(AudioStreamIn *in, const AudioParameterList& params)
+{
+    AudioStreamInExtension *extension = AudioStreamInExtension::query(in);
+    if (extension != NULL) {
+        return extension->setParameterList(params);
+    }
+    String8 keyValuePairs;
+    params.toString(&keyValuePairs);
+    return in->setParameters(keyValuePairs);
+}
+
+status_t setParameterList(AudioHardwareInterface *hw, const AudioParameterList& params)
+{
+    AudioHardwareExtension *extension = AudioHardwareExtension::query(hw);
+    if (extension != NULL) {
+        return extension->setParameterList(params);
+    }
+    String8 keyValuePairs;
+    params.toString(&keyValuePairs);
+    return hw->setParameters(keyValuePairs);
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
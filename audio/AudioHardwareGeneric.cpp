@@ -20,7 +20,9 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sched.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
@@ -28,6 +30,7 @@
 #define LOG_TAG "AudioHardware"
 #include <utils/Log.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 
 #include "AudioHardwareGeneric.h"
 #include <media/AudioRecord.h>
@@ -39,20 +42,71 @@ namespace android_audio_legacy {
 // ----------------------------------------------------------------------------
 
 static char const * const kAudioDeviceName = "/dev/eac";
+static char const * const kParkedDeviceName = "/dev/null";
+
+// configuration the driver accepts; streams convert to and from it
+static const int kOutputFormat = AudioSystem::PCM_16_BIT;
+static const uint32_t kOutputChannels = AudioSystem::CHANNEL_OUT_STEREO;
+static const uint32_t kOutputSampleRate = 44100;
+static const int kInputFormat = AudioSystem::PCM_16_BIT;
+static const uint32_t kInputChannels = AudioSystem::CHANNEL_IN_MONO;
+static const uint32_t kInputSampleRate = 8000;
+
+// frames converted per driver read or write when the client format differs
+static const size_t kConvertFrames = 512;
+
+// an output not written for this long releases the device, so the codec can
+// power down between sounds
+static const uint32_t kStandbyDelayMs = 1000;
+static const char * const kKeyStandbyDelayMs = "standby_delay_ms";
+
+// stream parameters for the effect chains, see AudioEffectChain
+static const char * const kKeyEffectsCpuBudget = "effects_cpu_budget";
+static const char * const kKeyEffectsCpuLoad = "effects_cpu_load";
+
+// driver buffer sizes, scaled to the client rate when resampling
+static const size_t kOutputBufferFrames = 1024;
+static const size_t kInputBufferMs = 20;
 
 // ----------------------------------------------------------------------------
 
+// point fd at path, keeping its number: the capture hub and the streams hold
+// on to mFd across parking
+static status_t redirectFd(int fd, const char *path)
+{
+    int newFd = ::open(path, O_RDWR);
+    if (newFd < 0) {
+        return -errno;
+    }
+    status_t status = ::dup2(newFd, fd) < 0 ? -errno : NO_ERROR;
+    ::close(newFd);
+    return status;
+}
+
 AudioHardwareGeneric::AudioHardwareGeneric()
-    : mOutput(0), mInput(0),  mFd(-1), mMicMute(false)
+    : mDeviceUsers(0), mDeviceParked(false), mParkCount(0),
+      mOutput(0), mFd(-1), mMicMute(false),
+      mMasterVolume(1.0f), mVoiceVolume(1.0f), mMasterMute(false),
+      mThreadPolicy(new AudioThreadPolicy())
 {
     mFd = ::open(kAudioDeviceName, O_RDWR);
+    // nothing plays or records until a stream asks for the device
+    if (mFd >= 0) {
+        mDeviceParked = redirectFd(mFd, kParkedDeviceName) == NO_ERROR;
+    }
 }
 
 AudioHardwareGeneric::~AudioHardwareGeneric()
 {
-    if (mFd >= 0) ::close(mFd);
     closeOutputStream((AudioStreamOut *)mOutput);
-    closeInputStream((AudioStreamIn *)mInput);
+    while (mInputs.size()) {
+        closeInputStream((AudioStreamIn *)mInputs[0]);
+    }
+    if (mCaptureHub != 0) {
+        mCaptureHub->stop();
+        mCaptureHub.clear();
+    }
+    if (mFd >= 0) ::close(mFd);
 }
 
 status_t AudioHardwareGeneric::initCheck()
@@ -109,46 +163,122 @@ AudioStreamIn* AudioHardwareGeneric::openInputStream(
 
     AutoMutex lock(mLock);
 
-    // only one input stream allowed
-    if (mInput) {
-        if (status) {
-            *status = INVALID_OPERATION;
+    // all input streams share the device through the capture hub
+    if (mCaptureHub == 0) {
+        sp<AudioCaptureHub> hub = new AudioCaptureHub(mFd,
+                audio_bytes_per_sample((audio_format_t)kInputFormat) *
+                        AudioSystem::popCount(kInputChannels),
+                kInputSampleRate, threadPolicy());
+        status_t lStatus = hub->start();
+        if (lStatus != NO_ERROR) {
+            ALOGE("openInputStream() cannot start capture hub: %d", lStatus);
+            if (status) {
+                *status = lStatus;
+            }
+            return 0;
         }
-        return 0;
+        AudioPiMutex::Autolock deviceLock(mDeviceLock);
+        mCaptureHub = hub;
     }
 
-    // create new output stream
+    // create new input stream
     AudioStreamInGeneric* in = new AudioStreamInGeneric();
-    status_t lStatus = in->set(this, mFd, devices, format, channels, sampleRate, acoustics);
+    status_t lStatus = in->set(this, mCaptureHub, devices, format, channels, sampleRate,
+                               acoustics);
     if (status) {
         *status = lStatus;
     }
-    if (lStatus == NO_ERROR) {
-        mInput = in;
-    } else {
+    if (lStatus != NO_ERROR) {
         delete in;
+        return 0;
     }
-    return mInput;
+    mInputs.add(in);
+    return in;
 }
 
 void AudioHardwareGeneric::closeInputStream(AudioStreamIn* in) {
-    if (mInput && in == mInput) {
-        delete mInput;
-        mInput = 0;
+    AutoMutex lock(mLock);
+    ssize_t index = mInputs.indexOf((AudioStreamInGeneric *)in);
+    if (index >= 0) {
+        mInputs.removeAt(index);
+        delete in;
     }
 }
 
 status_t AudioHardwareGeneric::setVoiceVolume(float v)
 {
-    // Implement: set voice volume
+    if (v < 0.0f || v > 1.0f) {
+        return BAD_VALUE;
+    }
+    mVoiceVolume = v;
     return NO_ERROR;
 }
 
+// applied by the output stream on the driver's format, so the software mixer
+// does not need to
 status_t AudioHardwareGeneric::setMasterVolume(float v)
 {
-    // Implement: set master volume
-    // return error - software mixer will handle it
-    return INVALID_OPERATION;
+    if (v < 0.0f || v > 1.0f) {
+        return BAD_VALUE;
+    }
+    mMasterVolume = v;
+    return NO_ERROR;
+}
+
+status_t AudioHardwareGeneric::getMasterVolume(float *volume)
+{
+    *volume = mMasterVolume;
+    return NO_ERROR;
+}
+
+status_t AudioHardwareGeneric::setMasterMute(bool muted)
+{
+    mMasterMute = muted;
+    return NO_ERROR;
+}
+
+status_t AudioHardwareGeneric::acquireDevice()
+{
+    AudioPiMutex::Autolock lock(mDeviceLock);
+    if (mFd < 0) {
+        return NO_INIT;
+    }
+    if (mDeviceParked) {
+        status_t status = redirectFd(mFd, kAudioDeviceName);
+        if (status != NO_ERROR) {
+            ALOGE("acquireDevice() cannot reopen %s: %d", kAudioDeviceName, status);
+            return status;
+        }
+        mDeviceParked = false;
+    }
+    mDeviceUsers++;
+    return NO_ERROR;
+}
+
+void AudioHardwareGeneric::releaseDevice()
+{
+    AudioPiMutex::Autolock lock(mDeviceLock);
+    if (mDeviceUsers == 0 || --mDeviceUsers != 0) {
+        return;
+    }
+    // every input has detached: let a device read in progress finish before
+    // swapping the file under it
+    if (mCaptureHub != 0) {
+        mCaptureHub->waitIdle();
+    }
+    // closes the device as long as nothing else has it open
+    if (redirectFd(mFd, kParkedDeviceName) == NO_ERROR) {
+        mDeviceParked = true;
+        mParkCount++;
+    }
+}
+
+float AudioHardwareGeneric::outputVolume() const
+{
+    if (mMasterMute) {
+        return 0.0f;
+    }
+    return mMode == AudioSystem::MODE_IN_CALL ? mVoiceVolume : mMasterVolume;
 }
 
 status_t AudioHardwareGeneric::setMicMute(bool state)
@@ -163,6 +293,48 @@ status_t AudioHardwareGeneric::getMicMute(bool* state)
     return NO_ERROR;
 }
 
+status_t AudioHardwareGeneric::setParameters(const String8& keyValuePairs)
+{
+    AudioParameterList param;
+    status_t status = param.parse(keyValuePairs.string());
+    if (status != NO_ERROR) {
+        return status;
+    }
+    return mThreadPolicy->setParameters(param);
+}
+
+String8 AudioHardwareGeneric::getParameters(const String8& keys)
+{
+    AudioParameter param = AudioParameter(keys);
+    AudioParameter response;
+    mThreadPolicy->getParameters(param, &response);
+    String8 keyValuePairs = response.toString();
+    if (param.size()) {
+        if (keyValuePairs != "") {
+            keyValuePairs += ";";
+        }
+        keyValuePairs += param.toString();
+    }
+    return keyValuePairs;
+}
+
+size_t AudioHardwareGeneric::getInputBufferSize(uint32_t sampleRate, int format, int channelCount)
+{
+    if (!AudioFormatConverter::isSupportedFormat(format)) {
+        ALOGW("getInputBufferSize bad format: %d", format);
+        return 0;
+    }
+    if (sampleRate != kInputSampleRate &&
+            !PolyphaseResampler::isSupported(kInputSampleRate, sampleRate)) {
+        ALOGW("getInputBufferSize bad sampling rate: %d", sampleRate);
+        return 0;
+    }
+    // rates and channel counts are checked by the base class on 16 bit samples
+    size_t size = AudioHardwareBase::getInputBufferSize(sampleRate, AudioSystem::PCM_16_BIT,
+                                                        channelCount);
+    return size / sizeof(int16_t) * audio_bytes_per_sample((audio_format_t)format);
+}
+
 status_t AudioHardwareGeneric::dumpInternals(int fd, const Vector<String16>& args)
 {
     const size_t SIZE = 256;
@@ -171,6 +343,15 @@ status_t AudioHardwareGeneric::dumpInternals(int fd, const Vector<String16>& arg
     result.append("AudioHardwareGeneric::dumpInternals\n");
     snprintf(buffer, SIZE, "\tmFd: %d mMicMute: %s\n",  mFd, mMicMute? "true": "false");
     result.append(buffer);
+    snprintf(buffer, SIZE, "\tmaster volume: %.3f voice volume: %.3f master mute: %s\n",
+             mMasterVolume.load(), mVoiceVolume.load(), mMasterMute ? "true" : "false");
+    result.append(buffer);
+    {
+        AudioPiMutex::Autolock lock(mDeviceLock);
+        snprintf(buffer, SIZE, "\tdevice: %s, %d users, parked %u times\n",
+                 mDeviceParked ? "parked" : "open", mDeviceUsers, mParkCount);
+    }
+    result.append(buffer);
     ::write(fd, result.string(), result.size());
     return NO_ERROR;
 }
@@ -178,8 +359,13 @@ status_t AudioHardwareGeneric::dumpInternals(int fd, const Vector<String16>& arg
 status_t AudioHardwareGeneric::dump(int fd, const Vector<String16>& args)
 {
     dumpInternals(fd, args);
-    if (mInput) {
-        mInput->dump(fd, args);
+    mThreadPolicy->dump(fd);
+    AutoMutex lock(mLock);
+    if (mCaptureHub != 0) {
+        mCaptureHub->dump(fd);
+    }
+    for (size_t i = 0; i < mInputs.size(); i++) {
+        mInputs[i]->dump(fd, args);
     }
     if (mOutput) {
         mOutput->dump(fd, args);
@@ -206,10 +392,8 @@ status_t AudioStreamOutGeneric::set(
     if (lChannels == 0) lChannels = channels();
     if (lRate == 0) lRate = sampleRate();
 
-    // check values
-    if ((lFormat != format()) ||
-            (lChannels != channels()) ||
-            (lRate != sampleRate())) {
+    // check values: format, channels and rate are all converted
+    if (configure_l(lFormat, lChannels, lRate) != NO_ERROR) {
         if (pFormat) *pFormat = format();
         if (pChannels) *pChannels = channels();
         if (pRate) *pRate = sampleRate();
@@ -223,25 +407,293 @@ status_t AudioStreamOutGeneric::set(
     mAudioHardware = hw;
     mFd = fd;
     mDevice = devices;
+    mIdleThread = new IdleThread(this, hw->threadPolicy());
+    mIdleThread->run("AudioOutIdle", ANDROID_PRIORITY_AUDIO);
     return NO_ERROR;
 }
 
+AudioStreamOutGeneric::AudioStreamOutGeneric()
+    : AudioStreamOutExtension(this), mAudioHardware(0), mFd(-1),
+      mStandby(true), mLastWriteTime(0), mStandbyDelayMs(kStandbyDelayMs),
+      mStandbyCount(0), mStandbyEntryNs(0), mStandbyExitNs(0), mMaxStandbyExitNs(0),
+      mDevice(0),
+      mFormat(kOutputFormat), mChannels(kOutputChannels), mSampleRate(kOutputSampleRate),
+      mConvertBuffer(0), mResample(false), mResampleBuffer(0), mResampleFrames(0),
+      mLeftVolume(1.0f), mRightVolume(1.0f)
+{
+    mConverter.set((audio_format_t)mFormat, mChannels,
+                   (audio_format_t)kOutputFormat, kOutputChannels);
+    mGain.set((audio_format_t)kOutputFormat, AudioSystem::popCount(kOutputChannels));
+}
+
 AudioStreamOutGeneric::~AudioStreamOutGeneric()
 {
+    if (mIdleThread != 0) {
+        mIdleThread->requestExit();
+        {
+            AudioPiMutex::Autolock _l(mLock);
+            mIdleCond.signal();
+        }
+        mIdleThread->requestExitAndWait();
+        mIdleThread.clear();
+    }
+    standby();
+    free(mConvertBuffer);
+    free(mResampleBuffer);
+}
+
+size_t AudioStreamOutGeneric::bufferSize() const
+{
+    // keep the driver's buffer duration, rounded to 16 frames
+    size_t frames = kOutputBufferFrames * mSampleRate / kOutputSampleRate;
+    return ((frames + 15) & ~15) * frameSize();
+}
+
+status_t AudioStreamOutGeneric::configure_l(int format, uint32_t channels, uint32_t rate)
+{
+    if (!AudioFormatConverter::isSupportedFormat(format) ||
+            !AudioSystem::isOutputChannel((audio_channel_mask_t)channels)) {
+        return BAD_VALUE;
+    }
+    bool resample = (rate != kOutputSampleRate);
+    if (resample && !PolyphaseResampler::isSupported(rate, kOutputSampleRate)) {
+        return BAD_VALUE;
+    }
+    status_t status = mConverter.set((audio_format_t)format, channels,
+                                     (audio_format_t)kOutputFormat, kOutputChannels);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    // also holds unconverted frames while the volume is not unity
+    if (mConvertBuffer == 0) {
+        mConvertBuffer = malloc(kConvertFrames * mConverter.dstFrameSize());
+        if (mConvertBuffer == 0) {
+            return NO_MEMORY;
+        }
+    }
+    if (resample && (!mResample || rate != mSampleRate)) {
+        status = mResampler.set(rate, kOutputSampleRate, AudioSystem::popCount(kOutputChannels));
+        if (status != NO_ERROR) {
+            return status;
+        }
+        // room for everything one converted chunk can produce
+        size_t frames = mResampler.outputFramesFor(kConvertFrames);
+        if (frames > mResampleFrames) {
+            int16_t *buffer = (int16_t *)realloc(mResampleBuffer,
+                                                 frames * mConverter.dstFrameSize());
+            if (buffer == 0) {
+                return NO_MEMORY;
+            }
+            mResampleBuffer = buffer;
+            mResampleFrames = frames;
+        }
+    }
+    status = mEffects.set(audio_bytes_per_sample((audio_format_t)format) *
+                                  AudioSystem::popCount(channels), rate, kConvertFrames);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    mFormat = format;
+    mChannels = channels;
+    mSampleRate = rate;
+    mResample = resample;
+    return NO_ERROR;
 }
 
 ssize_t AudioStreamOutGeneric::write(const void* buffer, size_t bytes)
 {
-    Mutex::Autolock _l(mLock);
-    return ssize_t(::write(mFd, buffer, bytes));
+    AudioPiMutex::Autolock _l(mLock);
+    if (mStandby) {
+        status_t status = exitStandby_l();
+        if (status != NO_ERROR) {
+            return status;
+        }
+    }
+    ssize_t written = write_l(buffer, bytes);
+    mLastWriteTime = systemTime();
+    return written;
+}
+
+ssize_t AudioStreamOutGeneric::write_l(const void* buffer, size_t bytes)
+{
+    updateGain_l();
+    if (mConverter.isPassthrough() && !mResample && mGain.isUnity() && mEffects.isEmpty()) {
+        return ssize_t(::write(mFd, buffer, bytes));
+    }
+
+    // conversion works on whole frames: a partial one would shift every
+    // frame written after it
+    if (bytes % mConverter.srcFrameSize() != 0) {
+        return BAD_VALUE;
+    }
+    const uint8_t *in = (const uint8_t *)buffer;
+    size_t frames = bytes / mConverter.srcFrameSize();
+    while (frames) {
+        size_t count = frames < kConvertFrames ? frames : kConvertFrames;
+        const void *data = in;
+        if (!mEffects.isEmpty()) {
+            data = mEffects.process(in, count);
+        }
+        if (!mConverter.isPassthrough()) {
+            mConverter.convert(mConvertBuffer, data, count);
+            data = mConvertBuffer;
+        }
+        ssize_t done;
+        if (mResample) {
+            done = writeResampled_l((const int16_t *)data, count);
+        } else {
+            void *out = mConvertBuffer;
+            if (data == in) {
+                memcpy(mConvertBuffer, in, count * mConverter.dstFrameSize());
+            } else if (data != mConvertBuffer) {
+                // unconverted output of the effects, in their scratch buffer
+                out = const_cast<void *>(data);
+            }
+            mGain.apply(out, count);
+            done = ::write(mFd, out, count * mConverter.dstFrameSize());
+            if (done > 0) {
+                done /= mConverter.dstFrameSize();
+            }
+        }
+        if (done < 0) {
+            return (in == buffer) ? done : in - (const uint8_t *)buffer;
+        }
+        in += done * mConverter.srcFrameSize();
+        if ((size_t)done < count) {
+            break;
+        }
+        frames -= count;
+    }
+    return in - (const uint8_t *)buffer;
+}
+
+// queue frames in the driver's format at the client rate and write out
+// everything the resampler can produce. Returns the frames consumed.
+ssize_t AudioStreamOutGeneric::writeResampled_l(const int16_t *data, size_t frames)
+{
+    const uint32_t channelCount = AudioSystem::popCount(kOutputChannels);
+    size_t queued = 0;
+    while (queued < frames) {
+        queued += mResampler.write(data + queued * channelCount, frames - queued);
+        size_t count = mResampler.read(mResampleBuffer, mResampleFrames);
+        if (count == 0) {
+            continue;
+        }
+        mGain.apply(mResampleBuffer, count);
+        // the input is already in the resampler: its output must all go out
+        const uint8_t *out = (const uint8_t *)mResampleBuffer;
+        size_t bytes = count * mConverter.dstFrameSize();
+        while (bytes != 0) {
+            ssize_t written = ::write(mFd, out, bytes);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return written < 0 ? -errno : (ssize_t)-EIO;
+            }
+            out += written;
+            bytes -= written;
+        }
+    }
+    return queued;
+}
+
+// master and stream volumes are picked up once per write(); a change ramps over
+// the next buffer
+void AudioStreamOutGeneric::updateGain_l()
+{
+    float volume = mAudioHardware != 0 ? mAudioHardware->outputVolume() : 1.0f;
+    mGain.setVolume(volume * mLeftVolume, volume * mRightVolume);
+}
+
+status_t AudioStreamOutGeneric::setVolume(float left, float right)
+{
+    if (left < 0.0f || left > 1.0f || right < 0.0f || right > 1.0f) {
+        return BAD_VALUE;
+    }
+    mLeftVolume = left;
+    mRightVolume = right;
+    return NO_ERROR;
 }
 
 status_t AudioStreamOutGeneric::standby()
 {
-    // Implement: audio hardware to standby mode
+    AudioPiMutex::Autolock _l(mLock);
+    enterStandby_l();
+    return NO_ERROR;
+}
+
+status_t AudioStreamOutGeneric::exitStandby_l()
+{
+    nsecs_t start = systemTime();
+    status_t status = mAudioHardware->acquireDevice();
+    if (status != NO_ERROR) {
+        return status;
+    }
+    // nothing to reconfigure: the driver keeps its one configuration and the
+    // conversion state was set up by configure_l()
+    mStandby = false;
+    mStandbyExitNs = systemTime() - start;
+    if (mStandbyExitNs > mMaxStandbyExitNs) {
+        mMaxStandbyExitNs = mStandbyExitNs;
+    }
+    // arm the idle timer
+    mIdleCond.signal();
     return NO_ERROR;
 }
 
+void AudioStreamOutGeneric::enterStandby_l()
+{
+    if (mStandby) {
+        return;
+    }
+    nsecs_t start = systemTime();
+    // let the driver play out what was last written before releasing it. The
+    // lock is released meanwhile; a write in that time keeps the stream active.
+    nsecs_t lastWrite = mLastWriteTime;
+    nsecs_t drain = lastWrite + ms2ns(latency()) - start;
+    if (drain > 0) {
+        while (mDrainCond.waitRelative(mLock, drain) == NO_ERROR) {
+            drain = lastWrite + ms2ns(latency()) - systemTime();
+            if (drain <= 0) {
+                break;
+            }
+        }
+        if (mStandby || mLastWriteTime != lastWrite) {
+            return;
+        }
+    }
+    if (mResample) {
+        mResampler.reset();
+    }
+    mAudioHardware->releaseDevice();
+    mStandby = true;
+    mStandbyCount++;
+    mStandbyEntryNs = systemTime() - start;
+}
+
+// runs on the idle thread, returns false to stop it
+bool AudioStreamOutGeneric::checkIdle()
+{
+    AudioPiMutex::Autolock _l(mLock);
+    if (mIdleThread->exiting()) {
+        return false;
+    }
+    uint32_t delayMs = mStandbyDelayMs;
+    if (mStandby || delayMs == 0) {
+        mIdleCond.wait(mLock);
+        return true;
+    }
+    nsecs_t idle = systemTime() - mLastWriteTime;
+    if (idle < ms2ns(delayMs)) {
+        mIdleCond.waitRelative(mLock, ms2ns(delayMs) - idle);
+        return true;
+    }
+    ALOGV("checkIdle() idle for %lld ms, entering standby", (long long)ns2ms(idle));
+    enterStandby_l();
+    return true;
+}
+
 status_t AudioStreamOutGeneric::dump(int fd, const Vector<String16>& args)
 {
     const size_t SIZE = 256;
@@ -263,24 +715,93 @@ status_t AudioStreamOutGeneric::dump(int fd, const Vector<String16>& args)
     result.append(buffer);
     snprintf(buffer, SIZE, "\tmFd: %d\n", mFd);
     result.append(buffer);
+    snprintf(buffer, SIZE, "\tresampling: %s\n", mResample ? "true" : "false");
+    result.append(buffer);
+    snprintf(buffer, SIZE, "\tvolume: %.3f %.3f applied: %.3f %.3f\n",
+             mLeftVolume.load(), mRightVolume.load(), mGain.left(), mGain.right());
+    result.append(buffer);
+    {
+        AudioPiMutex::Autolock _l(mLock);
+        snprintf(buffer, SIZE, "\tstandby: %s, after %u ms idle, entered %u times\n"
+                 "\t  last entry %.2f ms, last exit %.2f ms, max exit %.2f ms\n",
+                 mStandby ? "true" : "false", mStandbyDelayMs.load(), mStandbyCount,
+                 mStandbyEntryNs / 1e6, mStandbyExitNs / 1e6, mMaxStandbyExitNs / 1e6);
+    }
+    result.append(buffer);
     ::write(fd, result.string(), result.size());
+    mEffects.dump(fd);
     return NO_ERROR;
 }
 
 status_t AudioStreamOutGeneric::setParameters(const String8& keyValuePairs)
 {
-    AudioParameter param = AudioParameter(keyValuePairs);
-    String8 key = String8(AudioParameter::keyRouting);
+    AudioParameterList param;
+    ALOGV("setParameters() %s", keyValuePairs.string());
+
+    status_t status = param.parse(keyValuePairs.string());
+    if (status != NO_ERROR) {
+        return status;
+    }
+    return setParameterList(param);
+}
+
+status_t AudioStreamOutGeneric::setParameterList(const AudioParameterList& param)
+{
     status_t status = NO_ERROR;
+    size_t consumed = 0;
     int device;
-    ALOGV("setParameters() %s", keyValuePairs.string());
+    int value;
 
-    if (param.getInt(key, device) == NO_ERROR) {
+    if (param.getInt(AudioParameterList::KEY_ROUTING, &device) == NO_ERROR) {
         mDevice = device;
-        param.remove(key);
+        consumed++;
+    }
+    ssize_t index = param.indexOf(kKeyEffectsCpuBudget);
+    if (index >= 0) {
+        char *last;
+        long budget = strtol(param.valueAt(index), &last, 0);
+        if (*last != '\0' || budget < 0) {
+            status = BAD_VALUE;
+        } else {
+            mEffects.setCpuBudget((uint32_t)budget);
+        }
+        consumed++;
+    }
+    index = param.indexOf(kKeyStandbyDelayMs);
+    if (index >= 0) {
+        char *last;
+        long delayMs = strtol(param.valueAt(index), &last, 0);
+        if (*last != '\0' || delayMs < 0) {
+            status = BAD_VALUE;
+        } else {
+            AudioPiMutex::Autolock _l(mLock);
+            mStandbyDelayMs = (uint32_t)delayMs;
+            mIdleCond.signal();
+        }
+        consumed++;
     }
 
-    if (param.size()) {
+    int lFormat = mFormat;
+    uint32_t lChannels = mChannels;
+    uint32_t lRate = mSampleRate;
+    if (param.getInt(AudioParameterList::KEY_FORMAT, &value) == NO_ERROR) {
+        lFormat = value;
+        consumed++;
+    }
+    if (param.getInt(AudioParameterList::KEY_CHANNELS, &value) == NO_ERROR) {
+        lChannels = value;
+        consumed++;
+    }
+    if (param.getInt(AudioParameterList::KEY_SAMPLING_RATE, &value) == NO_ERROR) {
+        lRate = value;
+        consumed++;
+    }
+    if ((lFormat != mFormat) || (lChannels != mChannels) || (lRate != mSampleRate)) {
+        AudioPiMutex::Autolock _l(mLock);
+        status = configure_l(lFormat, lChannels, lRate);
+    }
+
+    if (param.size() > consumed) {
         status = BAD_VALUE;
     }
     return status;
@@ -295,6 +816,18 @@ String8 AudioStreamOutGeneric::getParameters(const String8& keys)
     if (param.get(key, value) == NO_ERROR) {
         param.addInt(key, (int)mDevice);
     }
+    key = kKeyEffectsCpuBudget;
+    if (param.get(key, value) == NO_ERROR) {
+        param.addInt(key, (int)mEffects.cpuBudget());
+    }
+    key = kKeyEffectsCpuLoad;
+    if (param.get(key, value) == NO_ERROR) {
+        param.addInt(key, (int)mEffects.cpuLoad());
+    }
+    key = kKeyStandbyDelayMs;
+    if (param.get(key, value) == NO_ERROR) {
+        param.addInt(key, (int)mStandbyDelayMs);
+    }
 
     ALOGV("getParameters() %s", param.toString().string());
     return param.toString();
@@ -310,7 +843,7 @@ status_t AudioStreamOutGeneric::getRenderPosition(uint32_t *dspFrames)
 // record functions
 status_t AudioStreamInGeneric::set(
         AudioHardwareGeneric *hw,
-        int fd,
+        const sp<AudioCaptureHub>& hub,
         uint32_t devices,
         int *pFormat,
         uint32_t *pChannels,
@@ -318,11 +851,10 @@ status_t AudioStreamInGeneric::set(
         AudioSystem::audio_in_acoustics acoustics)
 {
     if (pFormat == 0 || pChannels == 0 || pRate == 0) return BAD_VALUE;
-    ALOGV("AudioStreamInGeneric::set(%p, %d, %d, %d, %u)", hw, fd, *pFormat, *pChannels, *pRate);
-    // check values
-    if ((*pFormat != format()) ||
-        (*pChannels != channels()) ||
-        (*pRate != sampleRate())) {
+    ALOGV("AudioStreamInGeneric::set(%p, %p, %d, %d, %u)", hw, hub.get(), *pFormat, *pChannels,
+          *pRate);
+    // check values: format, channels and rate are all converted
+    if (configure_l(*pFormat, *pChannels, *pRate) != NO_ERROR) {
         ALOGE("Error opening input channel");
         *pFormat = format();
         *pChannels = channels();
@@ -331,23 +863,188 @@ status_t AudioStreamInGeneric::set(
     }
 
     mAudioHardware = hw;
-    mFd = fd;
+    mHub = hub;
     mDevice = devices;
     return NO_ERROR;
 }
 
+AudioStreamInGeneric::AudioStreamInGeneric()
+    : AudioStreamInExtension(this), mAudioHardware(0), mAttached(false), mPosition(0), mFramesLost(0), mDevice(0),
+      mFormat(kInputFormat), mChannels(kInputChannels), mSampleRate(kInputSampleRate),
+      mConvertBuffer(0), mResample(false), mReadBuffer(0)
+{
+    mConverter.set((audio_format_t)kInputFormat, kInputChannels,
+                   (audio_format_t)mFormat, mChannels);
+}
+
 AudioStreamInGeneric::~AudioStreamInGeneric()
 {
+    standby();
+    free(mConvertBuffer);
+    free(mReadBuffer);
+}
+
+size_t AudioStreamInGeneric::bufferSize() const
+{
+    // same 20 ms period as AudioHardwareBase::getInputBufferSize()
+    size_t frames = mSampleRate * kInputBufferMs / 1000;
+    return ((frames + 15) & ~15) * frameSize();
+}
+
+status_t AudioStreamInGeneric::configure_l(int format, uint32_t channels, uint32_t rate)
+{
+    if (!AudioFormatConverter::isSupportedFormat(format) ||
+            !AudioSystem::isInputChannel((audio_channel_mask_t)channels)) {
+        return BAD_VALUE;
+    }
+    bool resample = (rate != kInputSampleRate);
+    if (resample && !PolyphaseResampler::isSupported(kInputSampleRate, rate)) {
+        return BAD_VALUE;
+    }
+    status_t status = mConverter.set((audio_format_t)kInputFormat, kInputChannels,
+                                     (audio_format_t)format, channels);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    if (!mConverter.isPassthrough() && mConvertBuffer == 0) {
+        mConvertBuffer = malloc(kConvertFrames * mConverter.srcFrameSize());
+        if (mConvertBuffer == 0) {
+            return NO_MEMORY;
+        }
+    }
+    if (resample && (!mResample || rate != mSampleRate)) {
+        status = mResampler.set(kInputSampleRate, rate, AudioSystem::popCount(kInputChannels));
+        if (status != NO_ERROR) {
+            return status;
+        }
+        if (mReadBuffer == 0) {
+            mReadBuffer = (int16_t *)malloc(kConvertFrames * mConverter.srcFrameSize());
+            if (mReadBuffer == 0) {
+                return NO_MEMORY;
+            }
+        }
+    }
+    status = mEffects.set(audio_bytes_per_sample((audio_format_t)format) *
+                                  AudioSystem::popCount(channels), rate, kConvertFrames);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    mFormat = format;
+    mChannels = channels;
+    mSampleRate = rate;
+    mResample = resample;
+    return NO_ERROR;
 }
 
 ssize_t AudioStreamInGeneric::read(void* buffer, ssize_t bytes)
 {
     AutoMutex lock(mLock);
-    if (mFd < 0) {
+    if (mHub == 0) {
         ALOGE("Attempt to read from unopened device");
         return NO_INIT;
     }
-    return ::read(mFd, buffer, bytes);
+    if (!mAttached) {
+        status_t status = mAudioHardware->acquireDevice();
+        if (status != NO_ERROR) {
+            return status;
+        }
+        mPosition = mHub->attach();
+        mAttached = true;
+    }
+    // the capture hub hands out whole frames
+    if (bytes < 0 || bytes % mConverter.dstFrameSize() != 0) {
+        return BAD_VALUE;
+    }
+    if (mConverter.isPassthrough() && !mResample && mEffects.isEmpty()) {
+        ssize_t done = readDevice_l(buffer, bytes / mConverter.srcFrameSize());
+        return done > 0 ? done * mConverter.srcFrameSize() : done;
+    }
+
+    uint8_t *out = (uint8_t *)buffer;
+    size_t frames = bytes / mConverter.dstFrameSize();
+    while (frames) {
+        size_t count = frames < kConvertFrames ? frames : kConvertFrames;
+        void *data = mConverter.isPassthrough() ? out : mConvertBuffer;
+        ssize_t done;
+        if (mResample) {
+            done = readResampled_l((int16_t *)data, count);
+        } else {
+            done = readDevice_l(data, count);
+        }
+        if (done < 0) {
+            return (out == buffer) ? done : out - (uint8_t *)buffer;
+        }
+        if (!mConverter.isPassthrough()) {
+            mConverter.convert(out, mConvertBuffer, done);
+        }
+        if (!mEffects.isEmpty() && done > 0) {
+            void *processed = mEffects.process(out, done);
+            if (processed != out) {
+                memcpy(out, processed, done * mConverter.dstFrameSize());
+            }
+        }
+        out += done * mConverter.dstFrameSize();
+        if ((size_t)done < count) {
+            break;
+        }
+        frames -= count;
+    }
+    return out - (uint8_t *)buffer;
+}
+
+// fill frames in the driver's format at the client rate, reading only as
+// much from the driver as the resampler still needs. Returns the frames read.
+ssize_t AudioStreamInGeneric::readResampled_l(int16_t *data, size_t frames)
+{
+    const uint32_t channelCount = AudioSystem::popCount(kInputChannels);
+    size_t done = 0;
+    while (true) {
+        done += mResampler.read(data + done * channelCount, frames - done);
+        if (done == frames) {
+            break;
+        }
+        size_t needed = mResampler.inputFramesNeeded(frames - done);
+        if (needed > kConvertFrames) {
+            needed = kConvertFrames;
+        }
+        ssize_t got = readDevice_l(mReadBuffer, needed);
+        if (got <= 0) {
+            return done ? (ssize_t)done : got;
+        }
+        mResampler.write(mReadBuffer, got);
+    }
+    return done;
+}
+
+// read frames in the driver's format from the capture hub. Returns the frames read.
+ssize_t AudioStreamInGeneric::readDevice_l(void *data, size_t frames)
+{
+    uint64_t lost = 0;
+    ssize_t done = mHub->read(&mPosition, data, frames, &lost);
+    if (lost != 0) {
+        ALOGW("AudioStreamInGeneric %p overrun, lost %llu frames", this, (unsigned long long)lost);
+        mFramesLost += (uint32_t)(lost * mSampleRate / kInputSampleRate);
+    }
+    return done;
+}
+
+status_t AudioStreamInGeneric::standby()
+{
+    AutoMutex lock(mLock);
+    if (mAttached) {
+        mHub->detach();
+        mAudioHardware->releaseDevice();
+        mAttached = false;
+        if (mResample) {
+            mResampler.reset();
+        }
+    }
+    return NO_ERROR;
+}
+
+unsigned int AudioStreamInGeneric::getInputFramesLost() const
+{
+    return mFramesLost.exchange(0);
 }
 
 status_t AudioStreamInGeneric::dump(int fd, const Vector<String16>& args)
@@ -369,26 +1066,78 @@ status_t AudioStreamInGeneric::dump(int fd, const Vector<String16>& args)
     result.append(buffer);
     snprintf(buffer, SIZE, "\tmAudioHardware: %p\n", mAudioHardware);
     result.append(buffer);
-    snprintf(buffer, SIZE, "\tmFd: %d\n", mFd);
+    snprintf(buffer, SIZE, "\tattached: %s position: %llu\n", mAttached ? "true" : "false",
+             (unsigned long long)mPosition);
+    result.append(buffer);
+    nsecs_t captureTime;
+    if (mAttached && mHub->getCaptureTime(mPosition, &captureTime) == NO_ERROR) {
+        snprintf(buffer, SIZE, "\tbehind capture: %lld ms\n",
+                 (long long)ns2ms(systemTime() - captureTime));
+        result.append(buffer);
+    }
+    snprintf(buffer, SIZE, "\tresampling: %s\n", mResample ? "true" : "false");
     result.append(buffer);
     ::write(fd, result.string(), result.size());
+    mEffects.dump(fd);
     return NO_ERROR;
 }
 
 status_t AudioStreamInGeneric::setParameters(const String8& keyValuePairs)
 {
-    AudioParameter param = AudioParameter(keyValuePairs);
-    String8 key = String8(AudioParameter::keyRouting);
+    AudioParameterList param;
+    ALOGV("setParameters() %s", keyValuePairs.string());
+
+    status_t status = param.parse(keyValuePairs.string());
+    if (status != NO_ERROR) {
+        return status;
+    }
+    return setParameterList(param);
+}
+
+status_t AudioStreamInGeneric::setParameterList(const AudioParameterList& param)
+{
     status_t status = NO_ERROR;
+    size_t consumed = 0;
     int device;
-    ALOGV("setParameters() %s", keyValuePairs.string());
+    int value;
 
-    if (param.getInt(key, device) == NO_ERROR) {
+    if (param.getInt(AudioParameterList::KEY_ROUTING, &device) == NO_ERROR) {
         mDevice = device;
-        param.remove(key);
+        consumed++;
+    }
+    ssize_t index = param.indexOf(kKeyEffectsCpuBudget);
+    if (index >= 0) {
+        char *last;
+        long budget = strtol(param.valueAt(index), &last, 0);
+        if (*last != '\0' || budget < 0) {
+            status = BAD_VALUE;
+        } else {
+            mEffects.setCpuBudget((uint32_t)budget);
+        }
+        consumed++;
     }
 
-    if (param.size()) {
+    int lFormat = mFormat;
+    uint32_t lChannels = mChannels;
+    uint32_t lRate = mSampleRate;
+    if (param.getInt(AudioParameterList::KEY_FORMAT, &value) == NO_ERROR) {
+        lFormat = value;
+        consumed++;
+    }
+    if (param.getInt(AudioParameterList::KEY_CHANNELS, &value) == NO_ERROR) {
+        lChannels = value;
+        consumed++;
+    }
+    if (param.getInt(AudioParameterList::KEY_SAMPLING_RATE, &value) == NO_ERROR) {
+        lRate = value;
+        consumed++;
+    }
+    if ((lFormat != mFormat) || (lChannels != mChannels) || (lRate != mSampleRate)) {
+        AutoMutex lock(mLock);
+        status = configure_l(lFormat, lChannels, lRate);
+    }
+
+    if (param.size() > consumed) {
         status = BAD_VALUE;
     }
     return status;
@@ -403,6 +1152,14 @@ String8 AudioStreamInGeneric::getParameters(const String8& keys)
     if (param.get(key, value) == NO_ERROR) {
         param.addInt(key, (int)mDevice);
     }
+    key = kKeyEffectsCpuBudget;
+    if (param.get(key, value) == NO_ERROR) {
+        param.addInt(key, (int)mEffects.cpuBudget());
+    }
+    key = kKeyEffectsCpuLoad;
+    if (param.get(key, value) == NO_ERROR) {
+        param.addInt(key, (int)mEffects.cpuLoad());
+    }
 
     ALOGV("getParameters() %s", param.toString().string());
     return param.toString();
@@ -20,23 +20,37 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <atomic>
 
 #include <utils/threads.h>
+#include <utils/SortedVector.h>
 
 #include <hardware_legacy/AudioSystemLegacy.h>
 #include <hardware_legacy/AudioHardwareBase.h>
+#include <hardware_legacy/AudioHardwareExtension.h>
+
+#include "AudioCaptureHub.h"
+#include "AudioEffectChain.h"
+#include "AudioFormatConverter.h"
+#include "AudioGain.h"
+#include "AudioPiMutex.h"
+#include "AudioThreadPolicy.h"
+#include "PolyphaseResampler.h"
 
 namespace android_audio_legacy {
     using android::Mutex;
     using android::AutoMutex;
+    using android::SortedVector;
+    using android::Thread;
+    using android::sp;
 
 // ----------------------------------------------------------------------------
 
 class AudioHardwareGeneric;
 
-class AudioStreamOutGeneric : public AudioStreamOut {
+class AudioStreamOutGeneric : public AudioStreamOut, public AudioStreamOutExtension {
 public:
-                        AudioStreamOutGeneric() : mAudioHardware(0), mFd(-1) {}
+                        AudioStreamOutGeneric();
     virtual             ~AudioStreamOutGeneric();
 
     virtual status_t    set(
@@ -47,59 +61,132 @@ public:
             uint32_t *pChannels,
             uint32_t *pRate);
 
-    virtual uint32_t    sampleRate() const { return 44100; }
-    virtual size_t      bufferSize() const { return 4096; }
-    virtual uint32_t    channels() const { return AudioSystem::CHANNEL_OUT_STEREO; }
-    virtual int         format() const { return AudioSystem::PCM_16_BIT; }
+    virtual uint32_t    sampleRate() const { return mSampleRate; }
+    virtual size_t      bufferSize() const;
+    virtual uint32_t    channels() const { return mChannels; }
+    virtual int         format() const { return mFormat; }
     virtual uint32_t    latency() const { return 20; }
-    virtual status_t    setVolume(float left, float right) { return INVALID_OPERATION; }
+    virtual status_t    setVolume(float left, float right);
     virtual ssize_t     write(const void* buffer, size_t bytes);
     virtual status_t    standby();
     virtual status_t    dump(int fd, const Vector<String16>& args);
     virtual status_t    setParameters(const String8& keyValuePairs);
     virtual String8     getParameters(const String8& keys);
+    virtual status_t    setParameterList(const AudioParameterList& param);
     virtual status_t    getRenderPosition(uint32_t *dspFrames);
+    virtual status_t    addAudioEffect(effect_handle_t effect) { return mEffects.addEffect(effect); }
+    virtual status_t    removeAudioEffect(effect_handle_t effect)
+                            { return mEffects.removeEffect(effect); }
 
 private:
+    // puts the stream in standby once it has not been written for mStandbyDelayMs
+    class IdleThread : public Thread {
+    public:
+                            IdleThread(AudioStreamOutGeneric *stream,
+                                       const sp<AudioThreadPolicy>& threadPolicy)
+                                : Thread(false), mStream(stream), mThreadPolicy(threadPolicy),
+                                  mPolicyGeneration(0) {}
+                bool        exiting() const { return exitPending(); }
+    private:
+        virtual bool        threadLoop() {
+                                mThreadPolicy->apply(AudioThreadPolicy::ROLE_RENDER,
+                                                     &mPolicyGeneration);
+                                return !exitPending() && mStream->checkIdle();
+                            }
+        AudioStreamOutGeneric *mStream;
+        const sp<AudioThreadPolicy> mThreadPolicy;
+        uint32_t            mPolicyGeneration;
+    };
+
+    status_t            configure_l(int format, uint32_t channels, uint32_t rate);
+    ssize_t             write_l(const void* buffer, size_t bytes);
+    ssize_t             writeResampled_l(const int16_t *data, size_t frames);
+    void                updateGain_l();
+    status_t            exitStandby_l();
+    void                enterStandby_l();
+    bool                checkIdle();
+
     AudioHardwareGeneric *mAudioHardware;
-    Mutex   mLock;
+    AudioPiMutex mLock;                 // shared with the idle thread
     int     mFd;
+    // the device is only held between the first write and standby
+    bool    mStandby;
+    nsecs_t mLastWriteTime;
+    std::atomic<uint32_t> mStandbyDelayMs;  // 0 leaves standby to the client
+    sp<IdleThread> mIdleThread;
+    AudioPiCondition mIdleCond;         // write after standby, delay change, exit
+    AudioPiCondition mDrainCond;        // never signaled, releases mLock while draining
+    uint32_t mStandbyCount;
+    nsecs_t mStandbyEntryNs;            // drain and release, last time
+    nsecs_t mStandbyExitNs;             // reopen, last time
+    nsecs_t mMaxStandbyExitNs;
     uint32_t mDevice;
+    int     mFormat;                    // format and channels seen by the client,
+    uint32_t mChannels;                 // converted to the driver's by mConverter
+    uint32_t mSampleRate;               // and rate, converted by mResampler
+    AudioFormatConverter mConverter;
+    void    *mConvertBuffer;
+    PolyphaseResampler mResampler;
+    bool    mResample;
+    int16_t *mResampleBuffer;
+    size_t  mResampleFrames;
+    // volume applied on the driver's format, last thing before the driver
+    std::atomic<float> mLeftVolume;
+    std::atomic<float> mRightVolume;
+    AudioGain mGain;
+    AudioEffectChain mEffects;          // on the client's format, before conversion
 };
 
-class AudioStreamInGeneric : public AudioStreamIn {
+class AudioStreamInGeneric : public AudioStreamIn, public AudioStreamInExtension {
 public:
-                        AudioStreamInGeneric() : mAudioHardware(0), mFd(-1) {}
+                        AudioStreamInGeneric();
     virtual             ~AudioStreamInGeneric();
 
     virtual status_t    set(
             AudioHardwareGeneric *hw,
-            int mFd,
+            const sp<AudioCaptureHub>& hub,
             uint32_t devices,
             int *pFormat,
             uint32_t *pChannels,
             uint32_t *pRate,
             AudioSystem::audio_in_acoustics acoustics);
 
-    virtual uint32_t    sampleRate() const { return 8000; }
-    virtual size_t      bufferSize() const { return 320; }
-    virtual uint32_t    channels() const { return AudioSystem::CHANNEL_IN_MONO; }
-    virtual int         format() const { return AudioSystem::PCM_16_BIT; }
+    virtual uint32_t    sampleRate() const { return mSampleRate; }
+    virtual size_t      bufferSize() const;
+    virtual uint32_t    channels() const { return mChannels; }
+    virtual int         format() const { return mFormat; }
     virtual status_t    setGain(float gain) { return INVALID_OPERATION; }
     virtual ssize_t     read(void* buffer, ssize_t bytes);
     virtual status_t    dump(int fd, const Vector<String16>& args);
-    virtual status_t    standby() { return NO_ERROR; }
+    virtual status_t    standby();
     virtual status_t    setParameters(const String8& keyValuePairs);
     virtual String8     getParameters(const String8& keys);
-    virtual unsigned int  getInputFramesLost() const { return 0; }
-    virtual status_t addAudioEffect(effect_handle_t effect) { return NO_ERROR; }
-    virtual status_t removeAudioEffect(effect_handle_t effect) { return NO_ERROR; }
+    virtual status_t    setParameterList(const AudioParameterList& param);
+    virtual unsigned int  getInputFramesLost() const;
+    virtual status_t addAudioEffect(effect_handle_t effect) { return mEffects.addEffect(effect); }
+    virtual status_t removeAudioEffect(effect_handle_t effect) { return mEffects.removeEffect(effect); }
 
 private:
+    status_t            configure_l(int format, uint32_t channels, uint32_t rate);
+    ssize_t             readResampled_l(int16_t *data, size_t frames);
+    ssize_t             readDevice_l(void *data, size_t frames);
+
     AudioHardwareGeneric *mAudioHardware;
     Mutex   mLock;
-    int     mFd;
+    sp<AudioCaptureHub> mHub;           // shared with the other input streams
+    bool    mAttached;                  // reading from the hub, false in standby
+    uint64_t mPosition;                 // next frame to read from the hub
+    mutable std::atomic<uint32_t> mFramesLost;  // at the client rate, since last reported
     uint32_t mDevice;
+    int     mFormat;                    // format and channels seen by the client,
+    uint32_t mChannels;                 // converted from the driver's by mConverter
+    uint32_t mSampleRate;               // and rate, converted by mResampler
+    AudioFormatConverter mConverter;
+    void    *mConvertBuffer;
+    PolyphaseResampler mResampler;
+    bool    mResample;
+    int16_t *mReadBuffer;
+    AudioEffectChain mEffects;          // on the client's format, after conversion
 };
 
 
@@ -111,11 +198,18 @@ public:
     virtual status_t    initCheck();
     virtual status_t    setVoiceVolume(float volume);
     virtual status_t    setMasterVolume(float volume);
+    virtual status_t    getMasterVolume(float *volume);
+    virtual status_t    setMasterMute(bool muted);
 
     // mic mute
     virtual status_t    setMicMute(bool state);
     virtual status_t    getMicMute(bool* state);
 
+    virtual status_t    setParameters(const String8& keyValuePairs);
+    virtual String8     getParameters(const String8& keys);
+
+    virtual size_t      getInputBufferSize(uint32_t sampleRate, int format, int channelCount);
+
     // create I/O streams
     virtual AudioStreamOut* openOutputStream(
             uint32_t devices,
@@ -136,6 +230,20 @@ public:
 
             void            closeOutputStream(AudioStreamOutGeneric* out);
             void            closeInputStream(AudioStreamInGeneric* in);
+
+            /** volume the output stream applies on top of its own */
+            float           outputVolume() const;
+
+            /**
+             * reopen the device if it is parked. Streams call it before using
+             * the device and match it with releaseDevice() in standby.
+             */
+            status_t        acquireDevice();
+            /** park the device once no stream uses it */
+            void            releaseDevice();
+
+            /** scheduling of the threads this module owns */
+            const sp<AudioThreadPolicy>& threadPolicy() const { return mThreadPolicy; }
 protected:
     virtual status_t        dump(int fd, const Vector<String16>& args);
 
@@ -143,10 +251,19 @@ private:
     status_t                dumpInternals(int fd, const Vector<String16>& args);
 
     Mutex                   mLock;
+    AudioPiMutex            mDeviceLock;    // device users, parking and mCaptureHub
+    int                     mDeviceUsers;
+    bool                    mDeviceParked;  // mFd points to /dev/null
+    uint32_t                mParkCount;
     AudioStreamOutGeneric   *mOutput;
-    AudioStreamInGeneric    *mInput;
+    SortedVector<AudioStreamInGeneric*> mInputs;
+    sp<AudioCaptureHub>     mCaptureHub;    // reads the device for all inputs
     int                     mFd;
     bool                    mMicMute;
+    std::atomic<float>      mMasterVolume;
+    std::atomic<float>      mVoiceVolume;   // replaces the master volume in call
+    std::atomic<bool>       mMasterMute;
+    const sp<AudioThreadPolicy> mThreadPolicy;
 };
 
 // ----------------------------------------------------------------------------
@@ -37,6 +37,12 @@
 
 namespace android_audio_legacy {
 
+// capture rates the default getInputBufferSize() reports a size for
+static const uint32_t kInputSampleRates[] = {
+    8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000
+};
+static const uint32_t kInputBufferMs = 20;
+
 #if LOG_ROUTING_CALLS
 static const char* routingModeStrings[] =
 {
@@ -76,6 +82,12 @@ status_t AudioStreamOut::getNextWriteTimestamp(int64_t *timestamp)
     return INVALID_OPERATION;
 }
 
+// default implementation is unsupported
+status_t AudioStreamOut::getPresentationPosition(uint64_t *frames, struct timespec *timestamp)
+{
+    return INVALID_OPERATION;
+}
+
 AudioStreamIn::~AudioStreamIn() {}
 
 AudioHardwareBase::AudioHardwareBase()
@@ -112,7 +124,13 @@ String8 AudioHardwareBase::getParameters(const String8& keys)
 // default implementation
 size_t AudioHardwareBase::getInputBufferSize(uint32_t sampleRate, int format, int channelCount)
 {
-    if (sampleRate != 8000) {
+    size_t i;
+    for (i = 0; i < sizeof(kInputSampleRates) / sizeof(kInputSampleRates[0]); i++) {
+        if (sampleRate == kInputSampleRates[i]) {
+            break;
+        }
+    }
+    if (i == sizeof(kInputSampleRates) / sizeof(kInputSampleRates[0])) {
         ALOGW("getInputBufferSize bad sampling rate: %d", sampleRate);
         return 0;
     }
@@ -120,12 +138,15 @@ size_t AudioHardwareBase::getInputBufferSize(uint32_t sampleRate, int format, in
         ALOGW("getInputBufferSize bad format: %d", format);
         return 0;
     }
-    if (channelCount != 1) {
+    if (channelCount != 1 && channelCount != 2) {
         ALOGW("getInputBufferSize bad channel count: %d", channelCount);
         return 0;
     }
 
-    return 320;
+    // 20 ms worth of frames rounded up to a multiple of 16, i.e. 320 bytes
+    // for 8 kHz mono
+    size_t frames = (sampleRate * kInputBufferMs / 1000 + 15) & ~15;
+    return frames * channelCount * sizeof(int16_t);
 }
 
 // default implementation is unsupported
@@ -148,6 +169,32 @@ status_t AudioHardwareBase::dumpState(int fd, const Vector<String16>& args)
     return NO_ERROR;
 }
 
+// patches are opt-in, see AudioPatchList
+int AudioHardwareBase::createAudioPatch(unsigned int num_sources,
+                                        const struct audio_port_config *sources,
+                                        unsigned int num_sinks,
+                                        const struct audio_port_config *sinks,
+                                        audio_patch_handle_t *handle)
+{
+    return INVALID_OPERATION;
+}
+
+int AudioHardwareBase::releaseAudioPatch(audio_patch_handle_t handle)
+{
+    return INVALID_OPERATION;
+}
+
+// ports are not enumerated by the legacy interface
+int AudioHardwareBase::getAudioPort(struct audio_port *port)
+{
+    return INVALID_OPERATION;
+}
+
+int AudioHardwareBase::setAudioPortConfig(const struct audio_port_config *config)
+{
+    return INVALID_OPERATION;
+}
+
 // default implementation calls its "without flags" counterpart
 AudioStreamOut* AudioHardwareInterface::openOutputStreamWithFlags(uint32_t devices,
                                           audio_output_flags_t flags,
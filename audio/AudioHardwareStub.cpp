@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 
 #include "AudioHardwareStub.h"
 #include <media/AudioRecord.h>
@@ -29,12 +30,15 @@ namespace android_audio_legacy {
 
 // ----------------------------------------------------------------------------
 
-AudioHardwareStub::AudioHardwareStub() : mMicMute(false)
+AudioHardwareStub::AudioHardwareStub()
+    : AudioHardwareExtension(this), mMicMute(false), mThreadPolicy(new AudioThreadPolicy()),
+      mPatches(this, mThreadPolicy), mOffloadOutputs(this, mThreadPolicy)
 {
 }
 
 AudioHardwareStub::~AudioHardwareStub()
 {
+    mPatches.releaseAll();
 }
 
 status_t AudioHardwareStub::initCheck()
@@ -45,7 +49,8 @@ status_t AudioHardwareStub::initCheck()
 AudioStreamOut* AudioHardwareStub::openOutputStream(
         uint32_t devices, int *format, uint32_t *channels, uint32_t *sampleRate, status_t *status)
 {
-    AudioStreamOutStub* out = new AudioStreamOutStub();
+    AudioStreamOutStub* out = new AudioStreamOutStub(devices);
+    out->setClock(mClockConfig);
     status_t lStatus = out->set(format, channels, sampleRate);
     if (status) {
         *status = lStatus;
@@ -56,8 +61,21 @@ AudioStreamOut* AudioHardwareStub::openOutputStream(
     return 0;
 }
 
+AudioStreamOut* AudioHardwareStub::openOutputStreamWithFlags(
+        uint32_t devices, audio_output_flags_t flags, int *format, uint32_t *channels,
+        uint32_t *sampleRate, status_t *status)
+{
+    if (flags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) {
+        return mOffloadOutputs.open(devices, format, channels, sampleRate, status);
+    }
+    return openOutputStream(devices, format, channels, sampleRate, status);
+}
+
 void AudioHardwareStub::closeOutputStream(AudioStreamOut* out)
 {
+    if (mOffloadOutputs.close(out)) {
+        return;
+    }
     delete out;
 }
 
@@ -70,7 +88,8 @@ AudioStreamIn* AudioHardwareStub::openInputStream(
         return 0;
     }
 
-    AudioStreamInStub* in = new AudioStreamInStub();
+    AudioStreamInStub* in = new AudioStreamInStub(devices);
+    in->setClock(mClockConfig);
     status_t lStatus = in->set(format, channels, sampleRate, acoustics);
     if (status) {
         *status = lStatus;
@@ -96,6 +115,49 @@ status_t AudioHardwareStub::setMasterVolume(float volume)
     return NO_ERROR;
 }
 
+status_t AudioHardwareStub::setParameters(const String8& keyValuePairs)
+{
+    AudioParameter param = AudioParameter(keyValuePairs);
+    AudioParameterList list;
+    int value;
+
+    if (param.getInt(String8("stub_virtual_clock"), value) == NO_ERROR) {
+        mClockConfig.virtualTime = value != 0;
+    }
+    if (param.getInt(String8("stub_jitter_us"), value) == NO_ERROR && value >= 0) {
+        mClockConfig.jitterUs = value;
+    }
+    if (param.getInt(String8("stub_underrun_period"), value) == NO_ERROR && value >= 0) {
+        mClockConfig.underrunPeriod = value;
+    }
+    if (param.getInt(String8("stub_underrun_ms"), value) == NO_ERROR && value >= 0) {
+        mClockConfig.underrunMs = value;
+    }
+    if (param.getInt(String8("stub_seed"), value) == NO_ERROR) {
+        mClockConfig.seed = value;
+    }
+    status_t status = list.parse(keyValuePairs.string());
+    if (status != NO_ERROR) {
+        return status;
+    }
+    return mThreadPolicy->setParameters(list);
+}
+
+String8 AudioHardwareStub::getParameters(const String8& keys)
+{
+    AudioParameter param = AudioParameter(keys);
+    AudioParameter response;
+    mThreadPolicy->getParameters(param, &response);
+    String8 keyValuePairs = response.toString();
+    if (param.size()) {
+        if (keyValuePairs != "") {
+            keyValuePairs += ";";
+        }
+        keyValuePairs += param.toString();
+    }
+    return keyValuePairs;
+}
+
 status_t AudioHardwareStub::dumpInternals(int fd, const Vector<String16>& args)
 {
     const size_t SIZE = 256;
@@ -104,7 +166,14 @@ status_t AudioHardwareStub::dumpInternals(int fd, const Vector<String16>& args)
     result.append("AudioHardwareStub::dumpInternals\n");
     snprintf(buffer, SIZE, "\tmMicMute: %s\n", mMicMute? "true": "false");
     result.append(buffer);
+    snprintf(buffer, SIZE, "\tclock: %s, jitter %u us, underrun every %u transfers for %u ms\n",
+            mClockConfig.virtualTime ? "virtual" : "real time", mClockConfig.jitterUs,
+            mClockConfig.underrunPeriod, mClockConfig.underrunMs);
+    result.append(buffer);
     ::write(fd, result.string(), result.size());
+    mThreadPolicy->dump(fd);
+    mPatches.dump(fd);
+    mOffloadOutputs.dump(fd);
     return NO_ERROR;
 }
 
@@ -116,25 +185,70 @@ status_t AudioHardwareStub::dump(int fd, const Vector<String16>& args)
 
 // ----------------------------------------------------------------------------
 
-status_t AudioStreamOutStub::set(int *pFormat, uint32_t *pChannels, uint32_t *pRate)
+// takes the requested PCM configuration, or suggests the default one
+static status_t setStubConfig(int *pFormat, uint32_t *pChannels, uint32_t *pRate,
+                              bool input, int *format, uint32_t *channels, uint32_t *rate)
 {
-    if (pFormat) *pFormat = format();
-    if (pChannels) *pChannels = channels();
-    if (pRate) *pRate = sampleRate();
+    status_t status = NO_ERROR;
+    if (pFormat && *pFormat != 0) {
+        if (audio_is_linear_pcm((audio_format_t)*pFormat)) {
+            *format = *pFormat;
+        } else {
+            status = BAD_VALUE;
+        }
+    }
+    if (pChannels && *pChannels != 0) {
+        uint32_t count = input ? audio_channel_count_from_in_mask(*pChannels) :
+                audio_channel_count_from_out_mask(*pChannels);
+        if (count != 0) {
+            *channels = *pChannels;
+        } else {
+            status = BAD_VALUE;
+        }
+    }
+    if (pRate && *pRate != 0) {
+        *rate = *pRate;
+    }
 
-    return NO_ERROR;
+    if (pFormat) *pFormat = *format;
+    if (pChannels) *pChannels = *channels;
+    if (pRate) *pRate = *rate;
+    return status;
+}
+
+// returns the "routing" value asked for by keys, and the other keys as is
+static String8 getStubParameters(const String8& keys, uint32_t devices)
+{
+    AudioParameter param = AudioParameter(keys);
+    String8 key = String8(AudioParameter::keyRouting);
+    String8 value;
+    if (param.get(key, value) == NO_ERROR) {
+        param.addInt(key, (int)devices);
+    }
+    return param.toString();
+}
+
+AudioStreamOutStub::AudioStreamOutStub(uint32_t devices)
+    : mDevices(devices), mSampleRate(44100), mChannels(AudioSystem::CHANNEL_OUT_STEREO),
+      mFormat(AudioSystem::PCM_16_BIT)
+{
+}
+
+status_t AudioStreamOutStub::set(int *pFormat, uint32_t *pChannels, uint32_t *pRate)
+{
+    return setStubConfig(pFormat, pChannels, pRate, false, &mFormat, &mChannels, &mSampleRate);
 }
 
 ssize_t AudioStreamOutStub::write(const void* buffer, size_t bytes)
 {
     // fake timing for audio output
-    usleep(bytes * 1000000 / sizeof(int16_t) /
-               audio_channel_count_from_out_mask(channels()) / sampleRate());
+    mClock.advance(bytes / frameSize(), sampleRate());
     return bytes;
 }
 
 status_t AudioStreamOutStub::standby()
 {
+    mClock.reset();
     return NO_ERROR;
 }
 
@@ -145,42 +259,90 @@ status_t AudioStreamOutStub::dump(int fd, const Vector<String16>& args)
     String8 result;
     snprintf(buffer, SIZE, "AudioStreamOutStub::dump\n");
     snprintf(buffer, SIZE, "\tsample rate: %d\n", sampleRate());
-    snprintf(buffer, SIZE, "\tbuffer size: %d\n", bufferSize());
+    snprintf(buffer, SIZE, "\tbuffer size: %zu\n", bufferSize());
     snprintf(buffer, SIZE, "\tchannels: %d\n", channels());
     snprintf(buffer, SIZE, "\tformat: %d\n", format());
     result.append(buffer);
+    snprintf(buffer, SIZE, "\tframes written: %llu, underruns: %u\n",
+            (unsigned long long)mClock.frames(), mClock.underruns());
+    result.append(buffer);
     ::write(fd, result.string(), result.size());
     return NO_ERROR;
 }
 
+status_t AudioStreamOutStub::setParameters(const String8& keyValuePairs)
+{
+    AudioParameter param = AudioParameter(keyValuePairs);
+    int value;
+    if (param.getInt(String8(AudioParameter::keyRouting), value) == NO_ERROR) {
+        mDevices = (uint32_t)value;
+    }
+    return NO_ERROR;
+}
+
 String8 AudioStreamOutStub::getParameters(const String8& keys)
 {
-    AudioParameter param = AudioParameter(keys);
-    return param.toString();
+    return getStubParameters(keys, mDevices);
 }
 
 status_t AudioStreamOutStub::getRenderPosition(uint32_t *dspFrames)
 {
-    return INVALID_OPERATION;
+    *dspFrames = (uint32_t)mClock.frames();
+    return NO_ERROR;
+}
+
+status_t AudioStreamOutStub::getPresentationPosition(uint64_t *frames, struct timespec *timestamp)
+{
+    nsecs_t time = mClock.time();
+    *frames = mClock.frames();
+    timestamp->tv_sec = ns2s(time);
+    timestamp->tv_nsec = time - s2ns(timestamp->tv_sec);
+    return NO_ERROR;
 }
 
 // ----------------------------------------------------------------------------
 
+AudioStreamInStub::AudioStreamInStub(uint32_t devices)
+    : mFramesLostReported(0), mDevices(devices), mSampleRate(8000),
+      mChannels(AudioSystem::CHANNEL_IN_MONO), mFormat(AudioSystem::PCM_16_BIT)
+{
+}
+
 status_t AudioStreamInStub::set(int *pFormat, uint32_t *pChannels, uint32_t *pRate,
                 AudioSystem::audio_in_acoustics acoustics)
 {
-    return NO_ERROR;
+    return setStubConfig(pFormat, pChannels, pRate, true, &mFormat, &mChannels, &mSampleRate);
+}
+
+// 20 ms, 320 bytes for the default configuration
+size_t AudioStreamInStub::bufferSize() const
+{
+    return mSampleRate / 50 * frameSize();
 }
 
 ssize_t AudioStreamInStub::read(void* buffer, ssize_t bytes)
 {
     // fake timing for audio input
-    usleep(bytes * 1000000 / sizeof(int16_t) /
-           audio_channel_count_from_in_mask(channels()) / sampleRate());
+    mClock.advance(bytes / frameSize(), sampleRate());
     memset(buffer, 0, bytes);
     return bytes;
 }
 
+status_t AudioStreamInStub::standby()
+{
+    mClock.reset();
+    mFramesLostReported = 0;
+    return NO_ERROR;
+}
+
+unsigned int AudioStreamInStub::getInputFramesLost() const
+{
+    uint64_t lost = mClock.framesLost();
+    unsigned int count = (unsigned int)(lost - mFramesLostReported);
+    mFramesLostReported = lost;
+    return count;
+}
+
 status_t AudioStreamInStub::dump(int fd, const Vector<String16>& args)
 {
     const size_t SIZE = 256;
@@ -190,20 +352,32 @@ status_t AudioStreamInStub::dump(int fd, const Vector<String16>& args)
     result.append(buffer);
     snprintf(buffer, SIZE, "\tsample rate: %d\n", sampleRate());
     result.append(buffer);
-    snprintf(buffer, SIZE, "\tbuffer size: %d\n", bufferSize());
+    snprintf(buffer, SIZE, "\tbuffer size: %zu\n", bufferSize());
     result.append(buffer);
     snprintf(buffer, SIZE, "\tchannels: %d\n", channels());
     result.append(buffer);
     snprintf(buffer, SIZE, "\tformat: %d\n", format());
     result.append(buffer);
+    snprintf(buffer, SIZE, "\tframes read: %llu, overruns: %u\n",
+            (unsigned long long)mClock.frames(), mClock.underruns());
+    result.append(buffer);
     ::write(fd, result.string(), result.size());
     return NO_ERROR;
 }
 
+status_t AudioStreamInStub::setParameters(const String8& keyValuePairs)
+{
+    AudioParameter param = AudioParameter(keyValuePairs);
+    int value;
+    if (param.getInt(String8(AudioParameter::keyRouting), value) == NO_ERROR) {
+        mDevices = (uint32_t)value;
+    }
+    return NO_ERROR;
+}
+
 String8 AudioStreamInStub::getParameters(const String8& keys)
 {
-    AudioParameter param = AudioParameter(keys);
-    return param.toString();
+    return getStubParameters(keys, mDevices);
 }
 
 AudioHardwareInterface* createAudioHardware(void) {
@@ -21,48 +21,80 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
 #include <hardware_legacy/AudioHardwareBase.h>
+#include <hardware_legacy/AudioHardwareExtension.h>
+
+#include "AudioOffloadStream.h"
+#include "AudioPatch.h"
+#include "AudioStubClock.h"
 
 namespace android_audio_legacy {
+    using android::Mutex;
 
 // ----------------------------------------------------------------------------
 
+// The stub streams take any PCM configuration; unset values default to
+// 44.1 kHz stereo for outputs and 8 kHz mono for inputs. They keep the device
+// set by the "routing" parameter.
 class AudioStreamOutStub : public AudioStreamOut {
 public:
+                        AudioStreamOutStub(uint32_t devices);
     virtual status_t    set(int *pFormat, uint32_t *pChannels, uint32_t *pRate);
-    virtual uint32_t    sampleRate() const { return 44100; }
+            void        setClock(const AudioStubClock::Config& config) { mClock.configure(config); }
+    virtual uint32_t    sampleRate() const { return mSampleRate; }
     virtual size_t      bufferSize() const { return 4096; }
-    virtual uint32_t    channels() const { return AudioSystem::CHANNEL_OUT_STEREO; }
-    virtual int         format() const { return AudioSystem::PCM_16_BIT; }
+    virtual uint32_t    channels() const { return mChannels; }
+    virtual int         format() const { return mFormat; }
     virtual uint32_t    latency() const { return 0; }
     virtual status_t    setVolume(float left, float right) { return NO_ERROR; }
     virtual ssize_t     write(const void* buffer, size_t bytes);
     virtual status_t    standby();
     virtual status_t    dump(int fd, const Vector<String16>& args);
-    virtual status_t    setParameters(const String8& keyValuePairs) { return NO_ERROR;}
+    virtual status_t    setParameters(const String8& keyValuePairs);
     virtual String8     getParameters(const String8& keys);
     virtual status_t    getRenderPosition(uint32_t *dspFrames);
+    virtual status_t    getPresentationPosition(uint64_t *frames, struct timespec *timestamp);
+
+private:
+    AudioStubClock      mClock;
+    uint32_t            mDevices;
+    uint32_t            mSampleRate;
+    uint32_t            mChannels;
+    int                 mFormat;
 };
 
 class AudioStreamInStub : public AudioStreamIn {
 public:
+                        AudioStreamInStub(uint32_t devices);
     virtual status_t    set(int *pFormat, uint32_t *pChannels, uint32_t *pRate, AudioSystem::audio_in_acoustics acoustics);
-    virtual uint32_t    sampleRate() const { return 8000; }
-    virtual size_t      bufferSize() const { return 320; }
-    virtual uint32_t    channels() const { return AudioSystem::CHANNEL_IN_MONO; }
-    virtual int         format() const { return AudioSystem::PCM_16_BIT; }
+            void        setClock(const AudioStubClock::Config& config) { mClock.configure(config); }
+    virtual uint32_t    sampleRate() const { return mSampleRate; }
+    virtual size_t      bufferSize() const;
+    virtual uint32_t    channels() const { return mChannels; }
+    virtual int         format() const { return mFormat; }
     virtual status_t    setGain(float gain) { return NO_ERROR; }
     virtual ssize_t     read(void* buffer, ssize_t bytes);
     virtual status_t    dump(int fd, const Vector<String16>& args);
-    virtual status_t    standby() { return NO_ERROR; }
-    virtual status_t    setParameters(const String8& keyValuePairs) { return NO_ERROR;}
+    virtual status_t    standby();
+    virtual status_t    setParameters(const String8& keyValuePairs);
     virtual String8     getParameters(const String8& keys);
-    virtual unsigned int  getInputFramesLost() const { return 0; }
+    virtual unsigned int  getInputFramesLost() const;
     virtual status_t addAudioEffect(effect_handle_t effect) { return NO_ERROR; }
     virtual status_t removeAudioEffect(effect_handle_t effect) { return NO_ERROR; }
+
+private:
+    AudioStubClock      mClock;
+    mutable uint64_t    mFramesLostReported;
+    uint32_t            mDevices;
+    uint32_t            mSampleRate;
+    uint32_t            mChannels;
+    int                 mFormat;
 };
 
-class AudioHardwareStub : public  AudioHardwareBase
+class AudioHardwareStub : public  AudioHardwareBase, public AudioHardwareExtension
 {
 public:
                         AudioHardwareStub();
@@ -75,6 +107,12 @@ public:
     virtual status_t    setMicMute(bool state) { mMicMute = state;  return  NO_ERROR; }
     virtual status_t    getMicMute(bool* state) { *state = mMicMute ; return NO_ERROR; }
 
+    // stub_virtual_clock, stub_jitter_us, stub_underrun_period, stub_underrun_ms and
+    // stub_seed configure the clock of streams opened afterwards
+    virtual status_t    setParameters(const String8& keyValuePairs);
+    virtual String8     getParameters(const String8& keys);
+            void        setClock(const AudioStubClock::Config& config) { mClockConfig = config; }
+
     // create I/O streams
     virtual AudioStreamOut* openOutputStream(
                                 uint32_t devices,
@@ -82,7 +120,16 @@ public:
                                 uint32_t *channels=0,
                                 uint32_t *sampleRate=0,
                                 status_t *status=0);
+    // compressed offload outputs decoded to a stub output
+    virtual AudioStreamOut* openOutputStreamWithFlags(
+                                uint32_t devices,
+                                audio_output_flags_t flags=(audio_output_flags_t)0,
+                                int *format=0,
+                                uint32_t *channels=0,
+                                uint32_t *sampleRate=0,
+                                status_t *status=0);
     virtual    void        closeOutputStream(AudioStreamOut* out);
+    virtual bool        supportsOffload() const { return true; }
 
     virtual AudioStreamIn* openInputStream(
                                 uint32_t devices,
@@ -93,10 +140,28 @@ public:
                                 AudioSystem::audio_in_acoustics acoustics);
     virtual    void        closeInputStream(AudioStreamIn* in);
 
+    virtual status_t    setMasterMute(bool muted) { return NO_ERROR; }
+
+    // device to device patches between stub streams
+    virtual bool        supportsAudioPatches() const { return true; }
+    virtual int createAudioPatch(unsigned int num_sources,
+                               const struct audio_port_config *sources,
+                               unsigned int num_sinks,
+                               const struct audio_port_config *sinks,
+                               audio_patch_handle_t *handle)
+                            { return mPatches.create(num_sources, sources, num_sinks, sinks,
+                                                     handle); }
+    virtual int releaseAudioPatch(audio_patch_handle_t handle)
+                            { return mPatches.release(handle); }
+
 protected:
     virtual status_t    dump(int fd, const Vector<String16>& args);
 
             bool        mMicMute;
+            AudioStubClock::Config mClockConfig;
+            const sp<AudioThreadPolicy> mThreadPolicy;  // patch and decoder threads
+            AudioPatchList mPatches;
+            AudioOffloadOutputs mOffloadOutputs;
 private:
     status_t            dumpInternals(int fd, const Vector<String16>& args);
 };
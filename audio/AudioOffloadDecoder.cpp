@@ -0,0 +1,302 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioOffloadDecoder"
+//#define LOG_NDEBUG 0
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include <pvmp3decoder_api.h>
+#include <aacdecoder_lib.h>
+
+#include "AudioOffloadDecoder.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+// MP3
+
+// sync, version, layer and sampling rate: fixed for the frames of a track
+static const uint32_t kMp3SyncMask = 0xfffe0c00;
+
+// frame size in bytes of a layer III header, 0 if it is not one
+static size_t parseMp3Header(uint32_t header, uint32_t *sampleRate, uint32_t *channels,
+                             size_t *samples)
+{
+    static const uint32_t kSampleRates[] = { 44100, 48000, 32000 };
+    static const uint16_t kBitratesV1[] = {
+        0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+    static const uint16_t kBitratesV2[] = {
+        0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 };
+
+    uint32_t version = (header >> 19) & 3;      // 3: MPEG 1, 2: MPEG 2, 0: MPEG 2.5
+    uint32_t layer = (header >> 17) & 3;        // 1: layer III
+    uint32_t bitrateIndex = (header >> 12) & 0xf;
+    uint32_t rateIndex = (header >> 10) & 3;
+    if ((header & 0xffe00000) != 0xffe00000 || version == 1 || layer != 1 ||
+            bitrateIndex == 0 || bitrateIndex == 0xf || rateIndex == 3) {
+        return 0;
+    }
+    uint32_t rate = kSampleRates[rateIndex] >> (version == 3 ? 0 : (version == 2 ? 1 : 2));
+    uint32_t padding = (header >> 9) & 1;
+    if (sampleRate != NULL) {
+        *sampleRate = rate;
+    }
+    if (channels != NULL) {
+        *channels = ((header >> 6) & 3) == 3 ? 1 : 2;
+    }
+    if (version == 3) {
+        if (samples != NULL) {
+            *samples = 1152;
+        }
+        return 144000 * kBitratesV1[bitrateIndex] / rate + padding;
+    }
+    if (samples != NULL) {
+        *samples = 576;
+    }
+    return 72000 * kBitratesV2[bitrateIndex] / rate + padding;
+}
+
+class Mp3Decoder : public AudioOffloadDecoder {
+public:
+                        Mp3Decoder()
+                            : mDecoderBuf(NULL), mSyncHeader(0), mSampleRate(0),
+                              mChannelCount(0), mErrors(0) {
+                            memset(&mConfig, 0, sizeof(mConfig));
+                        }
+    virtual             ~Mp3Decoder() { free(mDecoderBuf); }
+
+    virtual ssize_t     frameSize(const uint8_t *data, size_t size);
+    virtual ssize_t     decode(const uint8_t *data, size_t size, int16_t *out,
+                               size_t maxFrames);
+    virtual status_t    reset();
+    virtual uint32_t    sampleRate() const { return mSampleRate; }
+    virtual uint32_t    channelCount() const { return mChannelCount; }
+    virtual uint32_t    errors() const { return mErrors; }
+
+private:
+    tPVMP3DecoderExternal mConfig;
+    void                *mDecoderBuf;
+    uint32_t            mSyncHeader;    // first header since reset(), 0 if none
+    uint32_t            mSampleRate;
+    uint32_t            mChannelCount;
+    uint32_t            mErrors;
+};
+
+ssize_t Mp3Decoder::frameSize(const uint8_t *data, size_t size)
+{
+    if (size < 4) {
+        return -1;
+    }
+    uint32_t header = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    // a lone sync word in the audio data does not match the frames around it
+    if (mSyncHeader != 0 && (header & kMp3SyncMask) != (mSyncHeader & kMp3SyncMask)) {
+        return 0;
+    }
+    return parseMp3Header(header, NULL, NULL, NULL);
+}
+
+ssize_t Mp3Decoder::decode(const uint8_t *data, size_t size, int16_t *out, size_t maxFrames)
+{
+    uint32_t header = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    uint32_t rate;
+    uint32_t channels;
+    size_t samples;
+    if (parseMp3Header(header, &rate, &channels, &samples) == 0 || samples > maxFrames) {
+        return BAD_VALUE;
+    }
+    if (mSyncHeader == 0) {
+        mSyncHeader = header;
+    }
+
+    mConfig.pInputBuffer = const_cast<uint8_t *>(data);
+    mConfig.inputBufferCurrentLength = size;
+    mConfig.inputBufferMaxLength = 0;
+    mConfig.inputBufferUsedLength = 0;
+    mConfig.pOutputBuffer = out;
+    mConfig.outputFrameSize = maxFrames * MAX_CHANNELS;
+    ERROR_CODE error = pvmp3_framedecoder(&mConfig, mDecoderBuf);
+    if (error != NO_DECODING_ERROR || mConfig.num_channels == 0) {
+        // the first frames after a reset refer to a bit reservoir that was
+        // not decoded: they are silent, but are not errors
+        if (error != NO_ENOUGH_MAIN_DATA_ERROR && mErrors++ == 0) {
+            ALOGW("decode() frame error %d", error);
+        }
+        memset(out, 0, samples * channels * sizeof(int16_t));
+        mSampleRate = rate;
+        mChannelCount = channels;
+        return samples;
+    }
+    mSampleRate = mConfig.samplingRate;
+    mChannelCount = mConfig.num_channels;
+    return mConfig.outputFrameSize / mConfig.num_channels;
+}
+
+status_t Mp3Decoder::reset()
+{
+    if (mDecoderBuf == NULL) {
+        mDecoderBuf = malloc(pvmp3_decoderMemRequirements());
+        if (mDecoderBuf == NULL) {
+            return NO_MEMORY;
+        }
+    }
+    memset(&mConfig, 0, sizeof(mConfig));
+    mConfig.equalizerType = flat;
+    mConfig.crcEnabled = false;
+    pvmp3_InitDecoder(&mConfig, mDecoderBuf);
+    mSyncHeader = 0;
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+// AAC in ADTS framing
+
+static const size_t kAdtsHeaderSize = 7;
+static const uint32_t kAacFrameSamples = 1024;
+
+class AdtsDecoder : public AudioOffloadDecoder {
+public:
+                        AdtsDecoder()
+                            : mDecoder(NULL), mSampleRate(0), mChannelCount(0),
+                              mFrameSamples(kAacFrameSamples), mErrors(0) {}
+    virtual             ~AdtsDecoder() {
+                            if (mDecoder != NULL) {
+                                aacDecoder_Close(mDecoder);
+                            }
+                        }
+
+    virtual ssize_t     frameSize(const uint8_t *data, size_t size);
+    virtual ssize_t     decode(const uint8_t *data, size_t size, int16_t *out,
+                               size_t maxFrames);
+    virtual status_t    reset();
+    virtual uint32_t    sampleRate() const { return mSampleRate; }
+    virtual uint32_t    channelCount() const { return mChannelCount; }
+    virtual uint32_t    errors() const { return mErrors; }
+
+private:
+    HANDLE_AACDECODER   mDecoder;
+    uint32_t            mSampleRate;
+    uint32_t            mChannelCount;
+    uint32_t            mFrameSamples;  // of the last decoded frame, SBR doubles it
+    uint32_t            mErrors;
+};
+
+ssize_t AdtsDecoder::frameSize(const uint8_t *data, size_t size)
+{
+    if (size < kAdtsHeaderSize) {
+        return -1;
+    }
+    // 12 bit sync word, layer 0, and a valid sampling frequency index
+    if (data[0] != 0xff || (data[1] & 0xf6) != 0xf0 || ((data[2] >> 2) & 0xf) > 12) {
+        return 0;
+    }
+    size_t bytes = ((data[3] & 0x03) << 11) | (data[4] << 3) | (data[5] >> 5);
+    size_t headerSize = (data[1] & 0x01) ? kAdtsHeaderSize : kAdtsHeaderSize + 2;
+    if (bytes <= headerSize || bytes > MAX_FRAME_BYTES) {
+        return 0;
+    }
+    return bytes;
+}
+
+ssize_t AdtsDecoder::decode(const uint8_t *data, size_t size, int16_t *out, size_t maxFrames)
+{
+    UCHAR *in[1] = { const_cast<UCHAR *>(data) };
+    const UINT inSize[1] = { (UINT)size };
+    UINT valid = size;
+    AAC_DECODER_ERROR error = aacDecoder_Fill(mDecoder, in, inSize, &valid);
+    if (error == AAC_DEC_OK) {
+        error = aacDecoder_DecodeFrame(mDecoder, out, maxFrames * MAX_CHANNELS, 0);
+    }
+    CStreamInfo *info = aacDecoder_GetStreamInfo(mDecoder);
+    if (error != AAC_DEC_OK || info == NULL || info->numChannels <= 0 ||
+            info->frameSize <= 0 || (size_t)info->frameSize > maxFrames) {
+        if (mErrors++ == 0) {
+            ALOGW("decode() frame error %#x", error);
+        }
+        if (mChannelCount == 0) {
+            // nothing decoded yet: the configuration is in the header
+            static const uint32_t kSampleRates[] = {
+                96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+                16000, 12000, 11025, 8000, 7350 };
+            uint32_t channels = ((data[2] & 0x01) << 2) | (data[3] >> 6);
+            mSampleRate = kSampleRates[(data[2] >> 2) & 0xf];
+            mChannelCount = channels == 1 ? 1 : 2;
+        }
+        size_t frames = mFrameSamples < maxFrames ? mFrameSamples : maxFrames;
+        memset(out, 0, frames * mChannelCount * sizeof(int16_t));
+        return frames;
+    }
+    mSampleRate = info->sampleRate;
+    mChannelCount = info->numChannels;
+    mFrameSamples = info->frameSize;
+    return info->frameSize;
+}
+
+status_t AdtsDecoder::reset()
+{
+    // the decoder keeps SBR and PS state across frames: start from scratch
+    if (mDecoder != NULL) {
+        aacDecoder_Close(mDecoder);
+    }
+    mDecoder = aacDecoder_Open(TT_MP4_ADTS, 1);
+    if (mDecoder == NULL) {
+        return NO_MEMORY;
+    }
+    aacDecoder_SetParam(mDecoder, AAC_PCM_MAX_OUTPUT_CHANNELS, MAX_CHANNELS);
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+bool AudioOffloadDecoder::isSupported(audio_format_t format)
+{
+    switch (format & AUDIO_FORMAT_MAIN_MASK) {
+    case AUDIO_FORMAT_MP3:
+    case AUDIO_FORMAT_AAC_ADTS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+AudioOffloadDecoder* AudioOffloadDecoder::create(audio_format_t format)
+{
+    AudioOffloadDecoder *decoder;
+    switch (format & AUDIO_FORMAT_MAIN_MASK) {
+    case AUDIO_FORMAT_MP3:
+        decoder = new Mp3Decoder();
+        break;
+    case AUDIO_FORMAT_AAC_ADTS:
+        decoder = new AdtsDecoder();
+        break;
+    default:
+        return NULL;
+    }
+    if (decoder->reset() != NO_ERROR) {
+        ALOGE("create() cannot initialize decoder for format %#x", format);
+        delete decoder;
+        return NULL;
+    }
+    return decoder;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,82 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_OFFLOAD_DECODER_H
+#define ANDROID_AUDIO_OFFLOAD_DECODER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioOffloadDecoder decodes the compressed stream of an offloaded output to
+ * interleaved PCM_16, in software, where hardware with a compressed offload
+ * path would use its DSP.
+ *
+ * Offloaded data is written in arbitrary pieces, so the caller finds frame
+ * boundaries with frameSize() and hands decode() one whole frame at a time.
+ * MP3 and AAC in ADTS framing are supported.
+ */
+class AudioOffloadDecoder {
+public:
+    /** largest frame decode() accepts, and largest output in frames per channel */
+    enum { MAX_FRAME_BYTES = 8192, MAX_FRAME_SAMPLES = 2048 };
+    /** decoded frames have at most this many channels */
+    enum { MAX_CHANNELS = 2 };
+
+    /** a decoder for format, NULL if it is not supported */
+    static AudioOffloadDecoder* create(audio_format_t format);
+    static bool         isSupported(audio_format_t format);
+
+    virtual             ~AudioOffloadDecoder() {}
+
+    /**
+     * size of the frame starting at data. Returns 0 if data does not start
+     * with a frame header, or -1 if more than size bytes are needed to tell.
+     */
+    virtual ssize_t     frameSize(const uint8_t *data, size_t size) = 0;
+
+    /**
+     * decode the whole frame at data into at most maxFrames frames; out holds
+     * maxFrames * MAX_CHANNELS samples. Returns the number of frames written;
+     * a frame that cannot be decoded is replaced with silence so that the
+     * stream keeps its length.
+     */
+    virtual ssize_t     decode(const uint8_t *data, size_t size, int16_t *out,
+                               size_t maxFrames) = 0;
+
+    /** forget the decoder history, e.g. between tracks */
+    virtual status_t    reset() = 0;
+
+    /** configuration of the last decoded frame, 0 before the first one */
+    virtual uint32_t    sampleRate() const = 0;
+    virtual uint32_t    channelCount() const = 0;
+
+    /** frames that could not be decoded since creation */
+    virtual uint32_t    errors() const = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_OFFLOAD_DECODER_H
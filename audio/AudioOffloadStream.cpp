@@ -0,0 +1,671 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioOffloadStream"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "AudioOffloadStream.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// size of the buffers the framework writes, and number of them queued
+static const size_t kFragmentBytes = 32 * 1024;
+static const size_t kFragments = 4;
+// compressed bytes parsed at once: a whole frame fits after a partial one
+static const size_t kInputBytes = 2 * AudioOffloadDecoder::MAX_FRAME_BYTES;
+// longest padding held back at the end of a track
+static const uint32_t kMaxPaddingFrames = 4096;
+// end of the track being written
+static const uint64_t kOpenTrack = ~0ULL;
+
+// ----------------------------------------------------------------------------
+
+AudioOffloadStream::AudioOffloadStream(AudioStreamOut *sink, audio_format_t format,
+                                       const sp<AudioThreadPolicy>& threadPolicy)
+    : AudioStreamOutExtension(this), mSink(sink), mFormat(format), mThreadPolicy(threadPolicy), mDecoder(NULL),
+      mCallback(NULL), mCookie(NULL), mWriteOffset(0), mTracksDrained(0), mTracksDone(0),
+      mWriteReadyPending(false), mPaused(false), mFlushPending(false),
+      mInput(NULL), mInputBytes(0), mDecoded(NULL), mPcm(NULL), mPcmFrames(0), mPcmCapacity(0),
+      mDecodedChannels(0), mTrackStarted(false), mDelayLeft(0), mErrorNotified(false),
+      mReadOffset(0), mFramesWritten(0), mSkippedBytes(0), mSinkErrors(0), mRateErrors(0)
+{
+    Track track = { kOpenTrack, 0, 0, false };
+    mTracks.add(track);
+}
+
+AudioOffloadStream::~AudioOffloadStream()
+{
+    if (mThread != 0) {
+        mThread->requestExit();
+        {
+            AudioPiMutex::Autolock _l(mLock);
+            mWorkCond.signal();
+            mSpaceCond.broadcast();
+            mDrainCond.broadcast();
+        }
+        mThread->requestExitAndWait();
+    }
+    delete mDecoder;
+    free(mInput);
+    free(mDecoded);
+    free(mPcm);
+}
+
+status_t AudioOffloadStream::init()
+{
+    if (mSink->format() != AUDIO_FORMAT_PCM_16_BIT) {
+        return BAD_VALUE;
+    }
+    mDecoder = AudioOffloadDecoder::create(mFormat);
+    if (mDecoder == NULL) {
+        return BAD_VALUE;
+    }
+    mPcmCapacity = kMaxPaddingFrames + AudioOffloadDecoder::MAX_FRAME_SAMPLES;
+    mInput = (uint8_t *)malloc(kInputBytes);
+    mDecoded = (int16_t *)malloc(AudioOffloadDecoder::MAX_FRAME_SAMPLES *
+                                 AudioOffloadDecoder::MAX_CHANNELS * sizeof(int16_t));
+    mPcm = (int16_t *)malloc(mPcmCapacity * mSink->frameSize());
+    if (mInput == NULL || mDecoded == NULL || mPcm == NULL) {
+        return NO_MEMORY;
+    }
+    status_t status = mRing.init(kFragmentBytes * kFragments);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    mThread = new DecodeThread(this, mThreadPolicy);
+    return mThread->run("AudioOffloadDecode", ANDROID_PRIORITY_AUDIO);
+}
+
+size_t AudioOffloadStream::bufferSize() const
+{
+    return kFragmentBytes;
+}
+
+ssize_t AudioOffloadStream::write(const void* buffer, size_t bytes)
+{
+    const uint8_t *data = (const uint8_t *)buffer;
+    size_t done = 0;
+
+    AudioPiMutex::Autolock _l(mLock);
+    for (;;) {
+        size_t count = mRing.write(data + done, bytes - done);
+        if (count != 0) {
+            done += count;
+            mWriteOffset += count;
+            mWorkCond.signal();
+        }
+        if (done == bytes) {
+            break;
+        }
+        if (mCallback != NULL) {
+            // the client waits for STREAM_CBK_EVENT_WRITE_READY
+            mWriteReadyPending = true;
+            break;
+        }
+        if (mPaused || mThread->exiting()) {
+            break;
+        }
+        mSpaceCond.wait(mLock);
+    }
+    return done;
+}
+
+status_t AudioOffloadStream::standby()
+{
+    return mSink->standby();
+}
+
+status_t AudioOffloadStream::setCallback(stream_callback_t callback, void *cookie)
+{
+    AudioPiMutex::Autolock _l(mLock);
+    mCallback = callback;
+    mCookie = cookie;
+    return NO_ERROR;
+}
+
+status_t AudioOffloadStream::pause()
+{
+    AudioPiMutex::Autolock _l(mLock);
+    mPaused = true;
+    // a blocking write() returns what it queued so far
+    mSpaceCond.broadcast();
+    return NO_ERROR;
+}
+
+status_t AudioOffloadStream::resume()
+{
+    AudioPiMutex::Autolock _l(mLock);
+    mPaused = false;
+    mWorkCond.signal();
+    return NO_ERROR;
+}
+
+status_t AudioOffloadStream::drain(audio_drain_type_t type)
+{
+    AudioPiMutex::Autolock _l(mLock);
+    Track track = mTracks[mTracks.size() - 1];
+    track.end = mWriteOffset;
+    track.drainAll = type == AUDIO_DRAIN_ALL;
+    mTracks.editItemAt(mTracks.size() - 1) = track;
+    // the next track keeps the gapless parameters until they are set again
+    track.end = kOpenTrack;
+    track.drainAll = false;
+    mTracks.add(track);
+    uint32_t drained = ++mTracksDrained;
+    mWorkCond.signal();
+    ALOGV("drain() %s at %llu", type == AUDIO_DRAIN_ALL ? "all" : "early notify",
+          (unsigned long long)mWriteOffset);
+
+    if (mCallback == NULL) {
+        // nothing will signal the end of the drain: wait for it
+        while ((int32_t)(mTracksDone - drained) < 0 && !mThread->exiting()) {
+            mDrainCond.wait(mLock);
+        }
+    }
+    return NO_ERROR;
+}
+
+status_t AudioOffloadStream::flush()
+{
+    AudioPiMutex::Autolock _l(mLock);
+    if (!mPaused) {
+        return INVALID_OPERATION;
+    }
+    // the decoder thread owns the consumer side of the ring
+    mFlushPending = true;
+    mWorkCond.signal();
+    while (mFlushPending && !mThread->exiting()) {
+        mDrainCond.wait(mLock);
+    }
+    return NO_ERROR;
+}
+
+status_t AudioOffloadStream::setParameters(const String8& keyValuePairs)
+{
+    AudioParameter param = AudioParameter(keyValuePairs);
+    String8 delayKey = String8(AUDIO_OFFLOAD_CODEC_DELAY_SAMPLES);
+    String8 paddingKey = String8(AUDIO_OFFLOAD_CODEC_PADDING_SAMPLES);
+    int value;
+    status_t status = NO_ERROR;
+
+    {
+        // gapless parameters apply to the track being written
+        AudioPiMutex::Autolock _l(mLock);
+        Track& track = mTracks.editItemAt(mTracks.size() - 1);
+        if (param.getInt(delayKey, value) == NO_ERROR) {
+            if (value >= 0) {
+                track.delay = value;
+            } else {
+                status = BAD_VALUE;
+            }
+            param.remove(delayKey);
+        }
+        if (param.getInt(paddingKey, value) == NO_ERROR) {
+            if (value >= 0) {
+                ALOGW_IF((uint32_t)value > kMaxPaddingFrames, "setParameters() padding %d"
+                         " limited to %u frames", value, kMaxPaddingFrames);
+                track.padding = (uint32_t)value < kMaxPaddingFrames ? value : kMaxPaddingFrames;
+            } else {
+                status = BAD_VALUE;
+            }
+            param.remove(paddingKey);
+        }
+    }
+
+    if (param.size() != 0) {
+        status_t sinkStatus = mSink->setParameters(param.toString());
+        if (status == NO_ERROR) {
+            status = sinkStatus;
+        }
+    }
+    return status;
+}
+
+String8 AudioOffloadStream::getParameters(const String8& keys)
+{
+    AudioParameter param = AudioParameter(keys);
+    AudioParameter response;
+    String8 delayKey = String8(AUDIO_OFFLOAD_CODEC_DELAY_SAMPLES);
+    String8 paddingKey = String8(AUDIO_OFFLOAD_CODEC_PADDING_SAMPLES);
+    String8 value;
+
+    {
+        AudioPiMutex::Autolock _l(mLock);
+        const Track& track = mTracks[mTracks.size() - 1];
+        if (param.get(delayKey, value) == NO_ERROR) {
+            response.addInt(delayKey, track.delay);
+            param.remove(delayKey);
+        }
+        if (param.get(paddingKey, value) == NO_ERROR) {
+            response.addInt(paddingKey, track.padding);
+            param.remove(paddingKey);
+        }
+    }
+
+    String8 keyValuePairs = response.toString();
+    if (param.size() != 0) {
+        String8 sinkPairs = mSink->getParameters(param.toString());
+        if (keyValuePairs != "" && sinkPairs != "") {
+            keyValuePairs += ";";
+        }
+        keyValuePairs += sinkPairs;
+    }
+    return keyValuePairs;
+}
+
+uint64_t AudioOffloadStream::presentedFrames() const
+{
+    // what the output was given, less what it has not played yet
+    uint64_t written = mFramesWritten.load();
+    uint64_t pending = (uint64_t)mSink->latency() * mSink->sampleRate() / 1000;
+    return written > pending ? written - pending : 0;
+}
+
+status_t AudioOffloadStream::getRenderPosition(uint32_t *dspFrames)
+{
+    *dspFrames = (uint32_t)presentedFrames();
+    return NO_ERROR;
+}
+
+status_t AudioOffloadStream::getPresentationPosition(uint64_t *frames,
+                                                     struct timespec *timestamp)
+{
+    *frames = presentedFrames();
+    clock_gettime(CLOCK_MONOTONIC, timestamp);
+    return NO_ERROR;
+}
+
+void AudioOffloadStream::notify(stream_callback_event_t event)
+{
+    stream_callback_t callback;
+    void *cookie;
+    {
+        AudioPiMutex::Autolock _l(mLock);
+        callback = mCallback;
+        cookie = mCookie;
+    }
+    // never under mLock: the client calls back into the stream
+    if (callback != NULL) {
+        callback(event, NULL, cookie);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// decoder thread
+
+bool AudioOffloadStream::processDecode()
+{
+    Track track;
+    if (!waitForWork(&track)) {
+        return false;
+    }
+
+    uint64_t readOffset = mReadOffset.load();
+    if (readOffset < track.end) {
+        // never past the end of the track, so that its frames are not mixed with the next
+        size_t count = kInputBytes - mInputBytes;
+        if (track.end - readOffset < count) {
+            count = track.end - readOffset;
+        }
+        count = mRing.read(mInput + mInputBytes, count);
+        mInputBytes += count;
+        mReadOffset.store(readOffset + count);
+
+        bool writeReady = false;
+        {
+            AudioPiMutex::Autolock _l(mLock);
+            mSpaceCond.signal();
+            if (mWriteReadyPending && mRing.availableToWrite() >= kFragmentBytes) {
+                mWriteReadyPending = false;
+                writeReady = true;
+            }
+        }
+        if (writeReady) {
+            notify(STREAM_CBK_EVENT_WRITE_READY);
+        }
+    }
+
+    if (decodeInput(track) && mReadOffset.load() == track.end) {
+        finishTrack(track);
+    }
+    return true;
+}
+
+bool AudioOffloadStream::waitForWork(Track *track)
+{
+    AudioPiMutex::Autolock _l(mLock);
+    for (;;) {
+        if (mThread->exiting()) {
+            return false;
+        }
+        if (mFlushPending) {
+            flush_l();
+            continue;
+        }
+        if (!mPaused) {
+            *track = mTracks[0];
+            uint64_t readOffset = mReadOffset.load();
+            if (readOffset == track->end ||
+                    (readOffset < track->end && mRing.availableToRead() != 0)) {
+                return true;
+            }
+        }
+        mWorkCond.wait(mLock);
+    }
+}
+
+bool AudioOffloadStream::decodeInput(const Track& track)
+{
+    bool complete = true;
+    size_t pos = 0;
+    while (pos < mInputBytes) {
+        // pause and flush take effect within a frame
+        if (mPaused || mFlushPending || mThread->exiting()) {
+            complete = false;
+            break;
+        }
+        ssize_t bytes = mDecoder->frameSize(mInput + pos, mInputBytes - pos);
+        if (bytes == 0) {
+            // not a frame header: resynchronize on the next byte
+            mSkippedBytes++;
+            pos++;
+            continue;
+        }
+        if (bytes < 0 || pos + bytes > mInputBytes) {
+            break;
+        }
+        ssize_t frames = mDecoder->decode(mInput + pos, bytes, mDecoded,
+                                          AudioOffloadDecoder::MAX_FRAME_SAMPLES);
+        pos += bytes;
+        if (frames > 0) {
+            queueFrames(frames, track);
+        }
+    }
+    memmove(mInput, mInput + pos, mInputBytes - pos);
+    mInputBytes -= pos;
+    return complete;
+}
+
+void AudioOffloadStream::queueFrames(size_t frames, const Track& track)
+{
+    if (mDecoder->sampleRate() != mSink->sampleRate()) {
+        // the output was opened at the rate the framework announced
+        if (mRateErrors++ == 0) {
+            ALOGE("queueFrames() decoded %u Hz, output %u Hz", mDecoder->sampleRate(),
+                  mSink->sampleRate());
+        }
+        if (!mErrorNotified) {
+            mErrorNotified = true;
+            notify(STREAM_CBK_EVENT_ERROR);
+        }
+        return;
+    }
+    uint32_t channels = mDecoder->channelCount();
+    if (channels != mDecodedChannels) {
+        if (mConverter.set(AUDIO_FORMAT_PCM_16_BIT, audio_channel_out_mask_from_count(channels),
+                           AUDIO_FORMAT_PCM_16_BIT, mSink->channels()) != NO_ERROR) {
+            ALOGE("queueFrames() cannot convert %u channels to %#x", channels,
+                  mSink->channels());
+            return;
+        }
+        mDecodedChannels = channels;
+    }
+
+    const int16_t *src = mDecoded;
+    if (!mTrackStarted) {
+        mTrackStarted = true;
+        mDelayLeft = track.delay;
+    }
+    if (mDelayLeft != 0) {
+        size_t skip = mDelayLeft < frames ? mDelayLeft : frames;
+        src += skip * channels;
+        frames -= skip;
+        mDelayLeft -= skip;
+    }
+
+    // all but the last padding frames can be played
+    const size_t frameSize = mSink->frameSize();
+    mConverter.convert((uint8_t *)mPcm + mPcmFrames * frameSize, src, frames);
+    mPcmFrames += frames;
+    if (mPcmFrames > track.padding) {
+        size_t count = mPcmFrames - track.padding;
+        writeSink(mPcm, count);
+        memmove(mPcm, (uint8_t *)mPcm + count * frameSize, track.padding * frameSize);
+        mPcmFrames = track.padding;
+    }
+}
+
+void AudioOffloadStream::writeSink(const int16_t *buffer, size_t frames)
+{
+    const size_t frameSize = mSink->frameSize();
+    const uint8_t *data = (const uint8_t *)buffer;
+    size_t bytes = frames * frameSize;
+    while (bytes != 0) {
+        ssize_t written = mSink->write(data, bytes);
+        if (written <= 0) {
+            if (mSinkErrors++ == 0) {
+                ALOGW("writeSink() output write failed: %zd", written);
+            }
+            if (!mErrorNotified) {
+                mErrorNotified = true;
+                notify(STREAM_CBK_EVENT_ERROR);
+            }
+            // do not spin on a broken output: drop the frames in their own time
+            usleep((uint64_t)(bytes / frameSize) * 1000000 / mSink->sampleRate());
+            break;
+        }
+        data += written;
+        bytes -= written;
+    }
+    mFramesWritten += frames;
+}
+
+void AudioOffloadStream::finishTrack(const Track& track)
+{
+    if (mInputBytes != 0) {
+        ALOGW("finishTrack() %zu bytes of a partial frame dropped", mInputBytes);
+        mSkippedBytes += mInputBytes;
+        mInputBytes = 0;
+    }
+    // what is held back is the padding of the track
+    ALOGV("finishTrack() at %llu, %zu padding frames dropped", (unsigned long long)track.end,
+          mPcmFrames);
+    mPcmFrames = 0;
+    mTrackStarted = false;
+    status_t status = mDecoder->reset();
+    ALOGE_IF(status != NO_ERROR, "finishTrack() decoder reset failed: %d", status);
+
+    {
+        AudioPiMutex::Autolock _l(mLock);
+        if (track.drainAll) {
+            // the output plays what it was given
+            nsecs_t deadline = systemTime() + (nsecs_t)mSink->latency() * 1000000;
+            nsecs_t now;
+            while (!mThread->exiting() && !mFlushPending && (now = systemTime()) < deadline) {
+                mWorkCond.waitRelative(mLock, deadline - now);
+            }
+            if (mThread->exiting() || mFlushPending) {
+                // the flush completes the drain
+                return;
+            }
+        }
+        mTracks.removeAt(0);
+        mTracksDone++;
+        mDrainCond.broadcast();
+    }
+    notify(STREAM_CBK_EVENT_DRAIN_READY);
+}
+
+void AudioOffloadStream::flush_l()
+{
+    // write() is not called during flush(), so both sides of the ring are idle
+    mRing.reset();
+    mWriteOffset = 0;
+    mReadOffset.store(0);
+    mInputBytes = 0;
+    mPcmFrames = 0;
+    mTrackStarted = false;
+    mDecoder->reset();
+    mFramesWritten.store(0);
+
+    Track track = mTracks[mTracks.size() - 1];
+    mTracks.clear();
+    mTracks.add(track);
+    mTracksDone = mTracksDrained;
+    mWriteReadyPending = false;
+    mFlushPending = false;
+    mDrainCond.broadcast();
+    ALOGV("flush()");
+}
+
+status_t AudioOffloadStream::dump(int fd, const Vector<String16>& args)
+{
+    const size_t SIZE = 512;
+    char buffer[SIZE];
+    {
+        AudioPiMutex::Autolock _l(mLock);
+        const Track& track = mTracks[mTracks.size() - 1];
+        snprintf(buffer, SIZE, "\toffload: format %#x, %s, %zu tracks queued, delay %u,"
+                 " padding %u\n"
+                 "\tcompressed: %llu bytes written, %llu decoded, %u skipped\n"
+                 "\tdecoded: %llu frames played, %zu held back, %u frame errors,"
+                 " %u rate errors, %u output errors\n",
+                 mFormat, mPaused ? "paused" : "running", mTracks.size(),
+                 track.delay, track.padding,
+                 (unsigned long long)mWriteOffset, (unsigned long long)mReadOffset.load(),
+                 mSkippedBytes.load(), (unsigned long long)mFramesWritten.load(), mPcmFrames,
+                 mDecoder != NULL ? mDecoder->errors() : 0, mRateErrors.load(),
+                 mSinkErrors.load());
+    }
+    ::write(fd, buffer, strlen(buffer));
+    return mSink->dump(fd, args);
+}
+
+// ----------------------------------------------------------------------------
+
+AudioOffloadOutputs::AudioOffloadOutputs(AudioHardwareInterface *hardware,
+                                         const sp<AudioThreadPolicy>& threadPolicy)
+    : mHardware(hardware), mThreadPolicy(threadPolicy)
+{
+}
+
+AudioOffloadOutputs::~AudioOffloadOutputs()
+{
+    // the PCM outputs can no longer be closed from here
+    ALOGW_IF(mStreams.size() != 0, "%zu offload outputs left open", mStreams.size());
+}
+
+AudioStreamOut* AudioOffloadOutputs::open(uint32_t devices, int *format, uint32_t *channels,
+                                          uint32_t *sampleRate, status_t *status)
+{
+    audio_format_t compressed = format != 0 ? (audio_format_t)*format : AUDIO_FORMAT_DEFAULT;
+    if (!AudioOffloadDecoder::isSupported(compressed) || sampleRate == 0 || *sampleRate == 0) {
+        ALOGW("open() cannot offload format %#x", compressed);
+        if (status) {
+            *status = BAD_VALUE;
+        }
+        return 0;
+    }
+
+    // the decoded frames are played by a PCM output at the announced rate
+    int pcmFormat = AUDIO_FORMAT_PCM_16_BIT;
+    uint32_t pcmChannels = (channels != 0 && *channels != 0) ?
+            *channels : (uint32_t)AUDIO_CHANNEL_OUT_STEREO;
+    uint32_t pcmRate = *sampleRate;
+    status_t lStatus;
+    AudioStreamOut *sink = mHardware->openOutputStream(devices, &pcmFormat, &pcmChannels,
+                                                       &pcmRate, &lStatus);
+    if (sink == 0) {
+        ALOGW("open() no PCM output for offload: %d", lStatus);
+        if (status) {
+            *status = lStatus != NO_ERROR ? lStatus : BAD_VALUE;
+        }
+        return 0;
+    }
+    AudioOffloadStream *out = new AudioOffloadStream(sink, compressed, mThreadPolicy);
+    lStatus = sink->sampleRate() == *sampleRate ? out->init() : BAD_VALUE;
+    if (lStatus != NO_ERROR) {
+        ALOGW("open() cannot start offload output: %d", lStatus);
+        delete out;
+        mHardware->closeOutputStream(sink);
+        if (status) {
+            *status = lStatus;
+        }
+        return 0;
+    }
+    if (channels) {
+        *channels = sink->channels();
+    }
+    if (status) {
+        *status = NO_ERROR;
+    }
+    ALOGV("open() offload %#x, %u Hz, channels %#x", compressed, *sampleRate,
+          sink->channels());
+
+    Mutex::Autolock _l(mLock);
+    mStreams.add(out);
+    return out;
+}
+
+bool AudioOffloadOutputs::close(AudioStreamOut *out)
+{
+    {
+        Mutex::Autolock _l(mLock);
+        ssize_t index = mStreams.indexOf(out);
+        if (index < 0) {
+            return false;
+        }
+        mStreams.removeAt(index);
+    }
+    // the decoder thread stops before its output is closed
+    AudioOffloadStream *offload = static_cast<AudioOffloadStream *>(out);
+    AudioStreamOut *sink = offload->sink();
+    delete offload;
+    mHardware->closeOutputStream(sink);
+    return true;
+}
+
+size_t AudioOffloadOutputs::size()
+{
+    Mutex::Autolock _l(mLock);
+    return mStreams.size();
+}
+
+status_t AudioOffloadOutputs::dump(int fd)
+{
+    Vector<String16> args;
+    Mutex::Autolock _l(mLock);
+    for (size_t i = 0; i < mStreams.size(); i++) {
+        mStreams[i]->dump(fd, args);
+    }
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,224 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_OFFLOAD_STREAM_H
+#define ANDROID_AUDIO_OFFLOAD_STREAM_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#include <utils/SortedVector.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include <hardware_legacy/AudioHardwareExtension.h>
+#include <hardware_legacy/AudioHardwareInterface.h>
+
+#include "AudioFormatConverter.h"
+#include "AudioOffloadDecoder.h"
+#include "AudioPiMutex.h"
+#include "AudioRingBuffer.h"
+#include "AudioThreadPolicy.h"
+
+namespace android_audio_legacy {
+    using android::Mutex;
+    using android::SortedVector;
+    using android::sp;
+    using android::Thread;
+    using android::Vector;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioOffloadStream is a compressed offload output: the framework writes MP3
+ * or AAC frames, and a decoder thread standing in for the DSP of offload
+ * capable hardware decodes them into a PCM_16 output of the same module.
+ *
+ * write() queues compressed data in a ring. Once a callback is set, write()
+ * no longer blocks: it takes what fits and STREAM_CBK_EVENT_WRITE_READY is
+ * signalled when a buffer fits again.
+ *
+ * drain() ends the current track at the data written so far. The decoder is
+ * reset between tracks, and the delay_samples and padding_samples parameters
+ * set while a track is written are trimmed from its start and end, padding
+ * frames being held back until the end of the track is known, so that
+ * gapless albums play without gaps. STREAM_CBK_EVENT_DRAIN_READY is signalled
+ * as soon as the track is decoded for AUDIO_DRAIN_EARLY_NOTIFY, leaving the
+ * PCM output's buffer to cover the next track's first write, and after the
+ * PCM output has played it for AUDIO_DRAIN_ALL.
+ *
+ * The offload calls are those of its AudioStreamOutExtension.
+ */
+class AudioOffloadStream : public AudioStreamOut, public AudioStreamOutExtension {
+public:
+    /** decoded frames are written to sink, which the caller closes after this stream */
+                        AudioOffloadStream(AudioStreamOut *sink, audio_format_t format,
+                                           const sp<AudioThreadPolicy>& threadPolicy);
+    virtual             ~AudioOffloadStream();
+
+    /** allocate the buffers and the decoder and start the decoder thread */
+            status_t    init();
+            AudioStreamOut* sink() const { return mSink; }
+
+    virtual uint32_t    sampleRate() const { return mSink->sampleRate(); }
+    virtual size_t      bufferSize() const;
+    virtual uint32_t    channels() const { return mSink->channels(); }
+    virtual int         format() const { return mFormat; }
+    virtual uint32_t    latency() const { return mSink->latency(); }
+    virtual status_t    setVolume(float left, float right)
+                            { return mSink->setVolume(left, right); }
+    virtual ssize_t     write(const void* buffer, size_t bytes);
+    virtual status_t    standby();
+    virtual status_t    dump(int fd, const Vector<String16>& args);
+    virtual status_t    setParameters(const String8& keyValuePairs);
+    virtual String8     getParameters(const String8& keys);
+    virtual status_t    getRenderPosition(uint32_t *dspFrames);
+    virtual status_t    getPresentationPosition(uint64_t *frames, struct timespec *timestamp);
+
+    virtual status_t    setCallback(stream_callback_t callback, void *cookie);
+    virtual status_t    pause();
+    virtual status_t    resume();
+    virtual status_t    drain(audio_drain_type_t type);
+    virtual status_t    flush();
+
+private:
+    class DecodeThread : public Thread {
+    public:
+                            DecodeThread(AudioOffloadStream *stream,
+                                         const sp<AudioThreadPolicy>& threadPolicy)
+                                : Thread(false), mStream(stream),
+                                  mThreadPolicy(threadPolicy), mPolicyGeneration(0) {}
+                bool        exiting() const { return exitPending(); }
+    private:
+        virtual bool        threadLoop() {
+                                if (mThreadPolicy != 0) {
+                                    mThreadPolicy->apply(AudioThreadPolicy::ROLE_RENDER,
+                                                         &mPolicyGeneration);
+                                }
+                                return mStream->processDecode();
+                            }
+        AudioOffloadStream  *mStream;
+        const sp<AudioThreadPolicy> mThreadPolicy;
+        uint32_t            mPolicyGeneration;
+    };
+
+    // the data between two drain() calls
+    struct Track {
+        uint64_t            end;        // stream offset after its last byte, kOpenTrack until drained
+        uint32_t            delay;      // frames trimmed from its start
+        uint32_t            padding;    // frames trimmed from its end
+        bool                drainAll;
+    };
+
+                        AudioOffloadStream(const AudioOffloadStream&);
+    AudioOffloadStream& operator=(const AudioOffloadStream&);
+
+            bool        processDecode();
+            bool        waitForWork(Track *track);
+            bool        decodeInput(const Track& track);
+            void        queueFrames(size_t frames, const Track& track);
+            void        writeSink(const int16_t *buffer, size_t frames);
+            void        finishTrack(const Track& track);
+            void        flush_l();
+            uint64_t    presentedFrames() const;
+            void        notify(stream_callback_event_t event);
+
+    AudioStreamOut      *mSink;
+    const audio_format_t mFormat;
+    const sp<AudioThreadPolicy> mThreadPolicy;
+    sp<DecodeThread>    mThread;
+    AudioOffloadDecoder *mDecoder;
+    AudioRingBuffer     mRing;
+
+    // shared by write(), the control calls and the decoder thread
+    AudioPiMutex        mLock;
+    AudioPiCondition    mWorkCond;      // data, control or exit for the decoder thread
+    AudioPiCondition    mSpaceCond;     // room in the ring for a blocking write()
+    AudioPiCondition    mDrainCond;     // a track or a flush completed
+    stream_callback_t   mCallback;
+    void                *mCookie;
+    Vector<Track>       mTracks;        // decoded first, the last one is being written
+    uint64_t            mWriteOffset;   // compressed bytes written since the last flush
+    uint32_t            mTracksDrained; // drain() calls since open
+    uint32_t            mTracksDone;    // tracks completed or flushed since open
+    bool                mWriteReadyPending;
+    std::atomic<bool>   mPaused;
+    std::atomic<bool>   mFlushPending;
+
+    // decoder thread
+    uint8_t             *mInput;        // compressed bytes read from the ring
+    size_t              mInputBytes;
+    int16_t             *mDecoded;      // one decoded frame
+    int16_t             *mPcm;          // decoded frames held back as padding
+    size_t              mPcmFrames;
+    size_t              mPcmCapacity;
+    AudioFormatConverter mConverter;    // decoded channels to the sink's
+    uint32_t            mDecodedChannels;
+    bool                mTrackStarted;
+    uint32_t            mDelayLeft;     // frames still to be trimmed from the track start
+    bool                mErrorNotified;
+    std::atomic<uint64_t> mReadOffset;  // compressed bytes read since the last flush
+    std::atomic<uint64_t> mFramesWritten; // to the sink since the last flush
+
+    // statistics
+    std::atomic<uint32_t> mSkippedBytes; // not part of a frame
+    std::atomic<uint32_t> mSinkErrors;
+    std::atomic<uint32_t> mRateErrors;  // frames dropped for a sample rate other than the sink's
+};
+
+/**
+ * AudioOffloadOutputs opens the compressed offload outputs of a module that
+ * opts in to them, each an AudioOffloadStream over a PCM_16 output opened
+ * with openOutputStream() at the announced rate. The module holds one,
+ * forwards the offload flag of openOutputStreamWithFlags() to open(), calls
+ * close() first in closeOutputStream() and advertises offload with
+ * AudioHardwareExtension::supportsOffload().
+ *
+ * The module must be able to open a PCM output next to the outputs the
+ * framework has open. Offload lives in libaudiohw_legacy_offload, with the
+ * decoders, so that modules without it do not link them.
+ */
+class AudioOffloadOutputs {
+public:
+                        AudioOffloadOutputs(AudioHardwareInterface *hardware,
+                                            const sp<AudioThreadPolicy>& threadPolicy);
+                        ~AudioOffloadOutputs();
+
+            AudioStreamOut* open(uint32_t devices, int *format, uint32_t *channels,
+                                 uint32_t *sampleRate, status_t *status);
+    /** if out is an offload output, close it with its PCM output and return true */
+            bool        close(AudioStreamOut *out);
+
+            size_t      size();
+            status_t    dump(int fd);
+
+private:
+                        AudioOffloadOutputs(const AudioOffloadOutputs&);
+    AudioOffloadOutputs& operator=(const AudioOffloadOutputs&);
+
+    AudioHardwareInterface * const mHardware;
+    const sp<AudioThreadPolicy> mThreadPolicy;
+    Mutex               mLock;
+    SortedVector<AudioStreamOut *> mStreams;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_OFFLOAD_STREAM_H
@@ -0,0 +1,330 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioParameterList"
+//#define LOG_NDEBUG 0
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include <hardware_legacy/AudioParameterList.h>
+
+namespace android_audio_legacy {
+    using android::NO_ERROR;
+    using android::NO_MEMORY;
+    using android::BAD_VALUE;
+    using android::NAME_NOT_FOUND;
+
+// names of the interned keys, in the order of the KEY_ ids
+static const char * const kKeyNames[AudioParameterList::NUM_KEYS] = {
+    "routing",              // AudioParameter::keyRouting
+    "sampling_rate",        // AudioParameter::keySamplingRate
+    "format",               // AudioParameter::keyFormat
+    "channels",             // AudioParameter::keyChannels
+    "frame_count",          // AudioParameter::keyFrameCount
+    "input_source",         // AudioParameter::keyInputSource
+    "screen_state",         // AudioParameter::keyScreenState
+    "bluetooth_enabled",
+    "A2dpSuspended",
+    "a2dp_sink_address",
+    "closing",
+};
+
+// offsets into the storage are 16 bit
+static const size_t kMaxStorage = 0xffff;
+
+// ----------------------------------------------------------------------------
+
+AudioParameterList::AudioParameterList()
+    : mStorage(mInlineStorage), mStorageSize(INLINE_STORAGE), mStorageUsed(0),
+      mEntries(mInlineEntries), mCapacity(INLINE_ENTRIES), mCount(0)
+{
+}
+
+AudioParameterList::~AudioParameterList()
+{
+    if (mStorage != mInlineStorage) {
+        free(mStorage);
+    }
+    if (mEntries != mInlineEntries) {
+        free(mEntries);
+    }
+}
+
+const char* AudioParameterList::keyName(int id)
+{
+    if (id < 0 || id >= NUM_KEYS) {
+        return NULL;
+    }
+    return kKeyNames[id];
+}
+
+int AudioParameterList::keyId(const char *key)
+{
+    for (int id = 0; id < NUM_KEYS; id++) {
+        if (strcmp(key, kKeyNames[id]) == 0) {
+            return id;
+        }
+    }
+    return KEY_OTHER;
+}
+
+void AudioParameterList::clear()
+{
+    mStorageUsed = 0;
+    mCount = 0;
+}
+
+status_t AudioParameterList::parse(const char *keyValuePairs)
+{
+    clear();
+    ssize_t offset = store(keyValuePairs, strlen(keyValuePairs));
+    if (offset < 0) {
+        return (status_t)offset;
+    }
+
+    // split "key1=value1;key2=value2" in place
+    size_t end = mStorageUsed - 1;
+    size_t pos = offset;
+    while (pos < end) {
+        char *pair = mStorage + pos;
+        char *next = strchr(pair, ';');
+        size_t length = next != NULL ? (size_t)(next - pair) : strlen(pair);
+        if (next != NULL) {
+            *next = '\0';
+        }
+        if (length != 0) {
+            char *equal = strchr(pair, '=');
+            size_t value;
+            if (equal != NULL) {
+                *equal = '\0';
+                value = equal + 1 - mStorage;
+            } else {
+                // a key without value, as in the keys given to getParameters()
+                value = pair + length - mStorage;
+            }
+            int id = keyId(pair);
+            ssize_t index = id != KEY_OTHER ? indexOf(id) : indexOf(pair);
+            if (index >= 0) {
+                mEntries[index].value = value;
+            } else {
+                status_t status = append(id, id != KEY_OTHER ? 0 : pos, value);
+                if (status != NO_ERROR) {
+                    return status;
+                }
+            }
+        }
+        pos += length + 1;
+    }
+    return NO_ERROR;
+}
+
+const char* AudioParameterList::keyAt(size_t index) const
+{
+    const Entry& entry = mEntries[index];
+    if (entry.id != KEY_OTHER) {
+        return kKeyNames[entry.id];
+    }
+    return mStorage + entry.key;
+}
+
+ssize_t AudioParameterList::indexOf(int id) const
+{
+    if (id == KEY_OTHER) {
+        return NAME_NOT_FOUND;
+    }
+    for (size_t i = 0; i < mCount; i++) {
+        if (mEntries[i].id == id) {
+            return i;
+        }
+    }
+    return NAME_NOT_FOUND;
+}
+
+ssize_t AudioParameterList::indexOf(const char *key) const
+{
+    int id = keyId(key);
+    if (id != KEY_OTHER) {
+        return indexOf(id);
+    }
+    for (size_t i = 0; i < mCount; i++) {
+        if (mEntries[i].id == KEY_OTHER && strcmp(mStorage + mEntries[i].key, key) == 0) {
+            return i;
+        }
+    }
+    return NAME_NOT_FOUND;
+}
+
+status_t AudioParameterList::get(int id, const char **value) const
+{
+    ssize_t index = indexOf(id);
+    if (index < 0) {
+        return NAME_NOT_FOUND;
+    }
+    *value = valueAt(index);
+    return NO_ERROR;
+}
+
+status_t AudioParameterList::getInt(int id, int *value) const
+{
+    const char *str;
+    status_t status = get(id, &str);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    char *last;
+    errno = 0;
+    long val = strtol(str, &last, 0);
+    if (*last != '\0' || errno != 0) {
+        return BAD_VALUE;
+    }
+    *value = (int)val;
+    return NO_ERROR;
+}
+
+status_t AudioParameterList::add(int id, const char *value)
+{
+    if (id < 0 || id >= NUM_KEYS) {
+        return BAD_VALUE;
+    }
+    return set(id, NULL, value);
+}
+
+status_t AudioParameterList::add(const char *key, const char *value)
+{
+    return set(keyId(key), key, value);
+}
+
+status_t AudioParameterList::addInt(int id, int value)
+{
+    char str[16];
+    snprintf(str, sizeof(str), "%d", value);
+    return add(id, str);
+}
+
+status_t AudioParameterList::remove(int id)
+{
+    ssize_t index = indexOf(id);
+    if (index < 0) {
+        return NAME_NOT_FOUND;
+    }
+    memmove(&mEntries[index], &mEntries[index + 1], (mCount - index - 1) * sizeof(Entry));
+    mCount--;
+    return NO_ERROR;
+}
+
+void AudioParameterList::toString(String8 *result) const
+{
+    result->clear();
+    for (size_t i = 0; i < mCount; i++) {
+        if (i != 0) {
+            result->append(";");
+        }
+        result->append(keyAt(i));
+        result->append("=");
+        result->append(valueAt(i));
+    }
+}
+
+status_t AudioParameterList::set(int id, const char *key, const char *value)
+{
+    ssize_t index = id != KEY_OTHER ? indexOf(id) : indexOf(key);
+    ssize_t valueOffset = store(value, strlen(value));
+    if (valueOffset < 0) {
+        return (status_t)valueOffset;
+    }
+    if (index >= 0) {
+        mEntries[index].value = valueOffset;
+        return NO_ERROR;
+    }
+    ssize_t keyOffset = 0;
+    if (id == KEY_OTHER) {
+        keyOffset = store(key, strlen(key));
+        if (keyOffset < 0) {
+            return (status_t)keyOffset;
+        }
+    }
+    return append(id, keyOffset, valueOffset);
+}
+
+ssize_t AudioParameterList::store(const char *text, size_t length)
+{
+    size_t needed = mStorageUsed + length + 1;
+    if (needed > kMaxStorage) {
+        ALOGE("store() parameters longer than %zu bytes", kMaxStorage);
+        return BAD_VALUE;
+    }
+    if (needed > mStorageSize) {
+        size_t size = mStorageSize * 2;
+        while (size < needed) {
+            size *= 2;
+        }
+        char *storage;
+        if (mStorage == mInlineStorage) {
+            storage = (char *)malloc(size);
+            if (storage != NULL) {
+                memcpy(storage, mInlineStorage, mStorageUsed);
+            }
+        } else {
+            storage = (char *)realloc(mStorage, size);
+        }
+        if (storage == NULL) {
+            return NO_MEMORY;
+        }
+        mStorage = storage;
+        mStorageSize = size;
+    }
+    size_t offset = mStorageUsed;
+    memcpy(mStorage + offset, text, length);
+    mStorage[offset + length] = '\0';
+    mStorageUsed = needed;
+    return offset;
+}
+
+status_t AudioParameterList::append(int id, size_t key, size_t value)
+{
+    if (mCount == mCapacity) {
+        size_t capacity = mCapacity * 2;
+        Entry *entries;
+        if (mEntries == mInlineEntries) {
+            entries = (Entry *)malloc(capacity * sizeof(Entry));
+            if (entries != NULL) {
+                memcpy(entries, mInlineEntries, mCount * sizeof(Entry));
+            }
+        } else {
+            entries = (Entry *)realloc(mEntries, capacity * sizeof(Entry));
+        }
+        if (entries == NULL) {
+            return NO_MEMORY;
+        }
+        mEntries = entries;
+        mCapacity = capacity;
+    }
+    Entry& entry = mEntries[mCount++];
+    entry.id = id;
+    entry.key = key;
+    entry.value = value;
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,283 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioPatch"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utils/Log.h>
+
+#include "AudioPatch.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+AudioPatch::AudioPatch(audio_patch_handle_t handle, AudioStreamIn *input,
+                       AudioStreamOut *output, const sp<AudioThreadPolicy>& threadPolicy)
+    : Thread(false),
+      mHandle(handle), mInput(input), mOutput(output),
+      mBuffer(NULL), mBufferSize(0), mPeriodNs(0),
+      mThreadPolicy(threadPolicy), mPolicyGeneration(0),
+      mFrames(0), mLatencyNs(0), mMinLatencyNs(0), mMaxLatencyNs(0),
+      mReadErrors(0), mWriteErrors(0)
+{
+}
+
+AudioPatch::~AudioPatch()
+{
+    free(mBuffer);
+}
+
+status_t AudioPatch::start()
+{
+    size_t frameSize = mInput->frameSize();
+    if (frameSize == 0 || frameSize != mOutput->frameSize() ||
+            mInput->sampleRate() != mOutput->sampleRate()) {
+        ALOGE("start() input %zu bytes at %u Hz cannot feed output %u bytes at %u Hz",
+              frameSize, mInput->sampleRate(), mOutput->frameSize(), mOutput->sampleRate());
+        return BAD_VALUE;
+    }
+    mBufferSize = mInput->bufferSize() - mInput->bufferSize() % frameSize;
+    mBuffer = (uint8_t *)malloc(mBufferSize);
+    if (mBuffer == NULL) {
+        return NO_MEMORY;
+    }
+    mPeriodNs = (nsecs_t)(mBufferSize / frameSize) * 1000000000LL / mInput->sampleRate();
+    return run("AudioPatch", ANDROID_PRIORITY_URGENT_AUDIO);
+}
+
+void AudioPatch::stop()
+{
+    requestExitAndWait();
+}
+
+bool AudioPatch::threadLoop()
+{
+    if (mThreadPolicy != 0) {
+        mThreadPolicy->apply(AudioThreadPolicy::ROLE_PATCH, &mPolicyGeneration);
+    }
+
+    ssize_t bytes = mInput->read(mBuffer, mBufferSize);
+    nsecs_t captured = systemTime();
+    if (bytes <= 0) {
+        {
+            AudioPiMutex::Autolock _l(mLock);
+            ALOGW_IF(mReadErrors == 0, "patch %d read failed: %d", mHandle, (int)bytes);
+            mReadErrors++;
+        }
+        // do not spin on a broken source
+        usleep(mPeriodNs / 1000);
+        return true;
+    }
+
+    size_t written = 0;
+    while (written < (size_t)bytes) {
+        ssize_t done = mOutput->write(mBuffer + written, bytes - written);
+        if (done <= 0) {
+            AudioPiMutex::Autolock _l(mLock);
+            ALOGW_IF(mWriteErrors == 0, "patch %d write failed: %d", mHandle, (int)done);
+            mWriteErrors++;
+            break;
+        }
+        written += done;
+    }
+
+    // the last frame read was captured at most a buffer ago, and plays once
+    // the output has played what it holds
+    nsecs_t latency = mPeriodNs + (systemTime() - captured) +
+            (nsecs_t)mOutput->latency() * 1000000LL;
+
+    AudioPiMutex::Autolock _l(mLock);
+    if (mFrames == 0) {
+        mLatencyNs = mMinLatencyNs = mMaxLatencyNs = latency;
+    } else {
+        mLatencyNs += (latency - mLatencyNs) / 16;
+        if (latency < mMinLatencyNs) {
+            mMinLatencyNs = latency;
+        }
+        if (latency > mMaxLatencyNs) {
+            mMaxLatencyNs = latency;
+        }
+    }
+    mFrames += written / mInput->frameSize();
+    return true;
+}
+
+uint32_t AudioPatch::latency()
+{
+    AudioPiMutex::Autolock _l(mLock);
+    return (uint32_t)(mLatencyNs / 1000000);
+}
+
+status_t AudioPatch::dump(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    AudioPiMutex::Autolock _l(mLock);
+    snprintf(buffer, SIZE, "\tpatch %d: %u Hz, buffer %zu bytes, %llu frames,"
+             " %u read errors, %u write errors\n"
+             "\t  latency %.1f ms (min %.1f, max %.1f)\n",
+             mHandle, mInput->sampleRate(), mBufferSize, (unsigned long long)mFrames,
+             mReadErrors, mWriteErrors,
+             mLatencyNs / 1e6, mMinLatencyNs / 1e6, mMaxLatencyNs / 1e6);
+    ::write(fd, buffer, strlen(buffer));
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+AudioPatchList::AudioPatchList(AudioHardwareInterface *hardware,
+                               const sp<AudioThreadPolicy>& threadPolicy)
+    : mHardware(hardware), mThreadPolicy(threadPolicy), mNextHandle(AUDIO_PATCH_HANDLE_NONE)
+{
+}
+
+AudioPatchList::~AudioPatchList()
+{
+    // the streams can no longer be closed from here
+    ALOGW_IF(mPatches.size() != 0, "%zu audio patches left running", mPatches.size());
+    for (size_t i = 0; i < mPatches.size(); i++) {
+        mPatches.valueAt(i)->stop();
+    }
+}
+
+int AudioPatchList::create(unsigned int num_sources,
+                           const struct audio_port_config *sources,
+                           unsigned int num_sinks,
+                           const struct audio_port_config *sinks,
+                           audio_patch_handle_t *handle)
+{
+    if (num_sources != 1 || num_sinks != 1 ||
+            sources[0].type != AUDIO_PORT_TYPE_DEVICE || sinks[0].type != AUDIO_PORT_TYPE_DEVICE) {
+        return INVALID_OPERATION;
+    }
+    const struct audio_port_config& source = sources[0];
+    const struct audio_port_config& sink = sinks[0];
+
+    Mutex::Autolock _l(mLock);
+    // an existing patch is replaced, keeping its handle
+    ssize_t index = mPatches.indexOfKey(*handle);
+    if (*handle != AUDIO_PATCH_HANDLE_NONE && index < 0) {
+        return BAD_VALUE;
+    }
+    if (index >= 0) {
+        release_l(index);
+    }
+
+    int format = (source.config_mask & AUDIO_PORT_CONFIG_FORMAT) ?
+            (int)source.format : (int)AUDIO_FORMAT_PCM_16_BIT;
+    uint32_t channels = (source.config_mask & AUDIO_PORT_CONFIG_CHANNEL_MASK) ?
+            (uint32_t)source.channel_mask : (uint32_t)AUDIO_CHANNEL_IN_STEREO;
+    uint32_t rate = (source.config_mask & AUDIO_PORT_CONFIG_SAMPLE_RATE) ?
+            source.sample_rate : 0;
+    status_t status;
+    AudioStreamIn *in = mHardware->openInputStream(source.ext.device.type, &format, &channels,
+                                                   &rate, &status,
+                                                   (AudioSystem::audio_in_acoustics)0);
+    if (in == 0 && status == BAD_VALUE) {
+        // retry with the configuration the implementation suggested
+        in = mHardware->openInputStream(source.ext.device.type, &format, &channels, &rate,
+                                        &status, (AudioSystem::audio_in_acoustics)0);
+    }
+    if (in == 0) {
+        ALOGW("create() cannot open source device %#x: %d", source.ext.device.type, status);
+        return status != NO_ERROR ? status : BAD_VALUE;
+    }
+
+    // the sink plays the frames as read
+    channels = audio_channel_out_mask_from_count(audio_channel_count_from_in_mask(in->channels()));
+    format = in->format();
+    rate = in->sampleRate();
+    AudioStreamOut *out = mHardware->openOutputStream(sink.ext.device.type, &format, &channels,
+                                                      &rate, &status);
+    if (out == 0) {
+        ALOGW("create() cannot open sink device %#x: %d", sink.ext.device.type, status);
+        mHardware->closeInputStream(in);
+        return status != NO_ERROR ? status : BAD_VALUE;
+    }
+
+    audio_patch_handle_t patchHandle = *handle;
+    if (patchHandle == AUDIO_PATCH_HANDLE_NONE) {
+        do {
+            patchHandle = ++mNextHandle;
+        } while (patchHandle == AUDIO_PATCH_HANDLE_NONE || mPatches.indexOfKey(patchHandle) >= 0);
+    }
+    sp<AudioPatch> patch = new AudioPatch(patchHandle, in, out, mThreadPolicy);
+    status = patch->start();
+    if (status != NO_ERROR) {
+        mHardware->closeOutputStream(out);
+        mHardware->closeInputStream(in);
+        return status;
+    }
+    mPatches.add(patchHandle, patch);
+    *handle = patchHandle;
+    ALOGV("create() %d: %#x -> %#x, %d Hz", patchHandle, source.ext.device.type,
+          sink.ext.device.type, rate);
+    return NO_ERROR;
+}
+
+int AudioPatchList::release(audio_patch_handle_t handle)
+{
+    Mutex::Autolock _l(mLock);
+    ssize_t index = mPatches.indexOfKey(handle);
+    if (index < 0) {
+        return BAD_VALUE;
+    }
+    release_l(index);
+    return NO_ERROR;
+}
+
+void AudioPatchList::release_l(ssize_t index)
+{
+    sp<AudioPatch> patch = mPatches.valueAt(index);
+    mPatches.removeItemsAt(index);
+    patch->stop();
+    mHardware->closeOutputStream(patch->output());
+    mHardware->closeInputStream(patch->input());
+}
+
+void AudioPatchList::releaseAll()
+{
+    Mutex::Autolock _l(mLock);
+    while (mPatches.size() != 0) {
+        release_l(0);
+    }
+}
+
+size_t AudioPatchList::size()
+{
+    Mutex::Autolock _l(mLock);
+    return mPatches.size();
+}
+
+status_t AudioPatchList::dump(int fd)
+{
+    Mutex::Autolock _l(mLock);
+    for (size_t i = 0; i < mPatches.size(); i++) {
+        mPatches.valueAt(i)->dump(fd);
+    }
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,146 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_PATCH_H
+#define ANDROID_AUDIO_PATCH_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/KeyedVector.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+#include <hardware_legacy/AudioHardwareInterface.h>
+
+#include "AudioPiMutex.h"
+#include "AudioThreadPolicy.h"
+
+namespace android_audio_legacy {
+    using android::KeyedVector;
+    using android::Mutex;
+    using android::Thread;
+    using android::sp;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioPatch connects a source device to a sink device inside the HAL: one
+ * thread reads an input stream opened on the source and writes what it read
+ * to an output stream opened on the sink, without going through the
+ * framework.
+ *
+ * Each input buffer is read into a single patch buffer and written out of it
+ * as is, so frames are not copied and no more than one input buffer is held
+ * on top of the streams' own buffering. Both streams must have the same
+ * frame size and rate.
+ *
+ * The latency of every buffer is measured from the end of its capture to the
+ * time the output is expected to play it, and reported in dump().
+ */
+class AudioPatch : public Thread {
+public:
+                        AudioPatch(audio_patch_handle_t handle, AudioStreamIn *input,
+                                   AudioStreamOut *output,
+                                   const sp<AudioThreadPolicy>& threadPolicy);
+    virtual             ~AudioPatch();
+
+    /** allocate the patch buffer and start the thread */
+            status_t    start();
+    /** stop the thread and wait for it. The streams are left open. */
+            void        stop();
+
+            audio_patch_handle_t handle() const { return mHandle; }
+            AudioStreamIn*  input() const { return mInput; }
+            AudioStreamOut* output() const { return mOutput; }
+
+    /** average measured latency, in ms */
+            uint32_t    latency();
+            status_t    dump(int fd);
+
+private:
+                        AudioPatch(const AudioPatch&);
+    AudioPatch&         operator=(const AudioPatch&);
+
+    virtual bool        threadLoop();
+
+    const audio_patch_handle_t mHandle;
+    AudioStreamIn       *mInput;
+    AudioStreamOut      *mOutput;
+    uint8_t             *mBuffer;
+    size_t              mBufferSize;
+    nsecs_t             mPeriodNs;      // duration of mBufferSize
+    const sp<AudioThreadPolicy> mThreadPolicy;
+    uint32_t            mPolicyGeneration;
+
+    AudioPiMutex        mLock;          // statistics below
+    uint64_t            mFrames;
+    nsecs_t             mLatencyNs;     // moving average
+    nsecs_t             mMinLatencyNs;
+    nsecs_t             mMaxLatencyNs;
+    uint32_t            mReadErrors;
+    uint32_t            mWriteErrors;
+};
+
+/**
+ * AudioPatchList runs the device to device patches of a module that opts in
+ * to them. The module holds one, forwards createAudioPatch() and
+ * releaseAudioPatch() to it and advertises them with
+ * AudioHardwareExtension::supportsAudioPatches(). Patches between a mix and
+ * devices are routed by the HAL shim and never reach the module.
+ *
+ * The streams of a patch are opened and closed through the module, which
+ * must be able to open them next to the streams the framework has open.
+ * The module calls releaseAll() from its destructor, while it can still
+ * close them.
+ */
+class AudioPatchList {
+public:
+                        AudioPatchList(AudioHardwareInterface *hardware,
+                                       const sp<AudioThreadPolicy>& threadPolicy);
+                        ~AudioPatchList();
+
+    /** one device source and one device sink. A handle already in use is replaced. */
+            int         create(unsigned int num_sources,
+                               const struct audio_port_config *sources,
+                               unsigned int num_sinks,
+                               const struct audio_port_config *sinks,
+                               audio_patch_handle_t *handle);
+            int         release(audio_patch_handle_t handle);
+            void        releaseAll();
+
+            size_t      size();
+            status_t    dump(int fd);
+
+private:
+                        AudioPatchList(const AudioPatchList&);
+    AudioPatchList&     operator=(const AudioPatchList&);
+
+            void        release_l(ssize_t index);
+
+    AudioHardwareInterface * const mHardware;
+    const sp<AudioThreadPolicy> mThreadPolicy;
+    Mutex               mLock;
+    KeyedVector<audio_patch_handle_t, sp<AudioPatch> > mPatches;
+    audio_patch_handle_t mNextHandle;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_PATCH_H
@@ -0,0 +1,113 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_PI_MUTEX_H
+#define ANDROID_AUDIO_PI_MUTEX_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+
+namespace android_audio_legacy {
+    using android::status_t;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioPiMutex is a Mutex with priority inheritance, for locks that a
+ * SCHED_FIFO thread shares with threads of lower priority.
+ *
+ * While it holds the lock, a binder or dump thread runs at the priority of
+ * the highest waiter, so an audio thread does not wait for it to be
+ * scheduled behind unrelated work. android::Mutex cannot be configured this
+ * way, and android::Condition only waits on android::Mutex, hence
+ * AudioPiCondition.
+ */
+class AudioPiMutex {
+public:
+                        AudioPiMutex() {
+                            pthread_mutexattr_t attr;
+                            pthread_mutexattr_init(&attr);
+                            pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+                            pthread_mutex_init(&mMutex, &attr);
+                            pthread_mutexattr_destroy(&attr);
+                        }
+                        ~AudioPiMutex() { pthread_mutex_destroy(&mMutex); }
+
+    status_t            lock() { return -pthread_mutex_lock(&mMutex); }
+    void                unlock() { pthread_mutex_unlock(&mMutex); }
+    status_t            tryLock() { return -pthread_mutex_trylock(&mMutex); }
+
+    class Autolock {
+    public:
+        inline explicit Autolock(AudioPiMutex& mutex) : mLock(mutex) { mLock.lock(); }
+        inline ~Autolock() { mLock.unlock(); }
+    private:
+        AudioPiMutex&   mLock;
+    };
+
+private:
+    friend class AudioPiCondition;
+
+                        AudioPiMutex(const AudioPiMutex&);
+    AudioPiMutex&       operator=(const AudioPiMutex&);
+
+    pthread_mutex_t     mMutex;
+};
+
+/** android::Condition for an AudioPiMutex. Timeouts use CLOCK_MONOTONIC. */
+class AudioPiCondition {
+public:
+                        AudioPiCondition() {
+                            pthread_condattr_t attr;
+                            pthread_condattr_init(&attr);
+                            pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+                            pthread_cond_init(&mCond, &attr);
+                            pthread_condattr_destroy(&attr);
+                        }
+                        ~AudioPiCondition() { pthread_cond_destroy(&mCond); }
+
+    status_t            wait(AudioPiMutex& mutex) {
+                            return -pthread_cond_wait(&mCond, &mutex.mMutex);
+                        }
+    status_t            waitRelative(AudioPiMutex& mutex, nsecs_t reltime) {
+                            struct timespec ts;
+                            clock_gettime(CLOCK_MONOTONIC, &ts);
+                            int64_t ns = ts.tv_nsec + (reltime > 0 ? reltime : 0);
+                            ts.tv_sec += ns / 1000000000;
+                            ts.tv_nsec = ns % 1000000000;
+                            return -pthread_cond_timedwait(&mCond, &mutex.mMutex, &ts);
+                        }
+    void                signal() { pthread_cond_signal(&mCond); }
+    void                broadcast() { pthread_cond_broadcast(&mCond); }
+
+private:
+                        AudioPiCondition(const AudioPiCondition&);
+    AudioPiCondition&   operator=(const AudioPiCondition&);
+
+    pthread_cond_t      mCond;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_PI_MUTEX_H
@@ -0,0 +1,361 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioReplaySource"
+//#define LOG_NDEBUG 0
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <utils/Log.h>
+
+#include "AudioReplaySource.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// frames converted or resampled per pass through the scratch buffer
+static const size_t kChunkFrames = 256;
+// a read returned this late is counted in the dump
+static const nsecs_t kLateNs = 10000000;
+
+static const uint16_t kWaveFormatPcm = 1;
+static const uint16_t kWaveFormatIeeeFloat = 3;
+static const uint16_t kWaveFormatExtensible = 0xFFFE;
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ----------------------------------------------------------------------------
+
+AudioReplaySource::AudioReplaySource()
+    : mMap(MAP_FAILED), mMapSize(0), mData(NULL), mFrames(0), mPosition(0),
+      mLoop(true), mLoops(0),
+      mFileFormat(AUDIO_FORMAT_PCM_16_BIT), mFileChannelMask(0), mFileRate(0),
+      mRate(0), mChannelCount(0), mFrameSize(0), mResample(false), mScratch(NULL),
+      mLateReads(0)
+{
+}
+
+AudioReplaySource::~AudioReplaySource()
+{
+    close();
+}
+
+status_t AudioReplaySource::open(const char *path, int format, uint32_t channelMask,
+                                 uint32_t sampleRate)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGV("open() cannot open %s: %s", path, strerror(errno));
+        return -errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return BAD_VALUE;
+    }
+    mMapSize = st.st_size;
+    mMap = mmap(NULL, mMapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file
+    ::close(fd);
+    if (mMap == MAP_FAILED) {
+        ALOGW("open() cannot map %s: %s", path, strerror(errno));
+        return -errno;
+    }
+    madvise(mMap, mMapSize, MADV_SEQUENTIAL);
+
+    status_t status;
+    const uint8_t *base = (const uint8_t *)mMap;
+    if (mMapSize >= 12 && !memcmp(base, "RIFF", 4) && !memcmp(base + 8, "WAVE", 4)) {
+        status = parseWave();
+    } else {
+        // raw PCM in the stream configuration
+        mFileFormat = (audio_format_t)format;
+        mFileChannelMask = channelMask;
+        mFileRate = sampleRate;
+        mData = base;
+        size_t frameSize = audio_bytes_per_sample(mFileFormat) *
+                audio_channel_count_from_in_mask(channelMask);
+        mFrames = frameSize != 0 ? mMapSize / frameSize : 0;
+        status = NO_ERROR;
+    }
+
+    if (status == NO_ERROR) {
+        mRate = sampleRate;
+        mChannelCount = audio_channel_count_from_in_mask(channelMask);
+        mResample = mFileRate != sampleRate;
+        if (mResample && !PolyphaseResampler::isSupported(mFileRate, sampleRate)) {
+            ALOGW("open() %s: no resampler from %u to %u Hz", path, mFileRate, sampleRate);
+            status = BAD_VALUE;
+        } else if (mResample) {
+            mScratch = (int16_t *)malloc(2 * kChunkFrames * mChannelCount * sizeof(int16_t));
+            status = mScratch == NULL ? NO_MEMORY :
+                    mConverter.set(mFileFormat, mFileChannelMask, AUDIO_FORMAT_PCM_16_BIT,
+                                   channelMask);
+            if (status == NO_ERROR) {
+                status = mOutConverter.set(AUDIO_FORMAT_PCM_16_BIT, channelMask,
+                                           (audio_format_t)format, channelMask);
+            }
+            if (status == NO_ERROR) {
+                status = mResampler.set(mFileRate, sampleRate, mChannelCount);
+            }
+            mFrameSize = mOutConverter.dstFrameSize();
+        } else {
+            status = mConverter.set(mFileFormat, mFileChannelMask, (audio_format_t)format,
+                                    channelMask);
+            mFrameSize = mConverter.dstFrameSize();
+        }
+    }
+    if (status != NO_ERROR || mFrames == 0) {
+        ALOGW("open() cannot replay %s: %d", path, status);
+        close();
+        return status != NO_ERROR ? status : BAD_VALUE;
+    }
+
+    ALOGV("open() %s: %zu frames, format %#x, mask %#x, %u Hz", path, mFrames, mFileFormat,
+          mFileChannelMask, mFileRate);
+    mPosition = 0;
+    mLoops = 0;
+    mLateReads = 0;
+    mClock.reset();
+    return NO_ERROR;
+}
+
+status_t AudioReplaySource::parseWave()
+{
+    const uint8_t *base = (const uint8_t *)mMap;
+    const uint8_t *fmt = NULL;
+    size_t fmtSize = 0;
+    size_t offset = 12;
+
+    // chunks are word aligned; a data chunk may be cut short by a dump that
+    // was never finalized, in which case the file ends it
+    while (offset + 8 <= mMapSize) {
+        const uint8_t *chunk = base + offset;
+        size_t size = get32(chunk + 4);
+        offset += 8;
+        if (!memcmp(chunk, "fmt ", 4)) {
+            fmt = base + offset;
+            fmtSize = size;
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (size == 0 || size > mMapSize - offset) {
+                size = mMapSize - offset;
+            }
+            mData = base + offset;
+            mFrames = size;     // in bytes until the format is known
+            break;
+        }
+        offset += size + (size & 1);
+    }
+    if (fmt == NULL || fmtSize < 16 || fmt + fmtSize > base + mMapSize || mData == NULL) {
+        return BAD_VALUE;
+    }
+
+    uint16_t tag = get16(fmt);
+    uint32_t channelCount = get16(fmt + 2);
+    uint16_t bits = get16(fmt + 14);
+    if (tag == kWaveFormatExtensible && fmtSize >= 26) {
+        // the sub format GUID starts with the format tag
+        tag = get16(fmt + 24);
+    }
+    mFileRate = get32(fmt + 4);
+
+    if (tag == kWaveFormatPcm && bits == 16) {
+        mFileFormat = AUDIO_FORMAT_PCM_16_BIT;
+    } else if (tag == kWaveFormatPcm && bits == 32) {
+        mFileFormat = AUDIO_FORMAT_PCM_32_BIT;
+    } else if (tag == kWaveFormatIeeeFloat && bits == 32) {
+        mFileFormat = AUDIO_FORMAT_PCM_FLOAT;
+    } else {
+        ALOGW("parseWave() unsupported format %#x, %u bits", tag, bits);
+        return BAD_VALUE;
+    }
+    if (channelCount == 1) {
+        mFileChannelMask = AUDIO_CHANNEL_IN_MONO;
+    } else if (channelCount == 2) {
+        mFileChannelMask = AUDIO_CHANNEL_IN_STEREO;
+    } else {
+        ALOGW("parseWave() unsupported channel count %u", channelCount);
+        return BAD_VALUE;
+    }
+    if (mFileRate == 0) {
+        return BAD_VALUE;
+    }
+    mFrames /= channelCount * audio_bytes_per_sample(mFileFormat);
+    return NO_ERROR;
+}
+
+void AudioReplaySource::close()
+{
+    if (mMap != MAP_FAILED) {
+        munmap(mMap, mMapSize);
+        mMap = MAP_FAILED;
+    }
+    mMapSize = 0;
+    mData = NULL;
+    mFrames = 0;
+    free(mScratch);
+    mScratch = NULL;
+}
+
+status_t AudioReplaySource::seek(uint32_t ms)
+{
+    if (!isOpen()) {
+        return NO_INIT;
+    }
+    uint64_t frame = (uint64_t)ms * mFileRate / 1000;
+    if (frame >= mFrames) {
+        return BAD_VALUE;
+    }
+    mPosition = frame;
+    if (mResample) {
+        mResampler.reset();
+    }
+    return NO_ERROR;
+}
+
+size_t AudioReplaySource::fileFrames(const uint8_t **data, size_t frames)
+{
+    if (mPosition == mFrames) {
+        if (!mLoop) {
+            return 0;
+        }
+        mPosition = 0;
+        mLoops++;
+    }
+    if (frames > mFrames - mPosition) {
+        frames = mFrames - mPosition;
+    }
+    *data = mData + mPosition * mConverter.srcFrameSize();
+    mPosition += frames;
+    return frames;
+}
+
+size_t AudioReplaySource::readResampled(uint8_t *out, size_t frames)
+{
+    int16_t *resampled = mScratch + kChunkFrames * mChannelCount;
+    size_t done = 0;
+
+    while (done < frames) {
+        size_t want = frames - done < kChunkFrames ? frames - done : kChunkFrames;
+        int16_t *dst = mOutConverter.isPassthrough() ?
+                (int16_t *)(out + done * mFrameSize) : resampled;
+        size_t count = mResampler.read(dst, want);
+        if (count != 0) {
+            if (dst == resampled) {
+                mOutConverter.convert(out + done * mFrameSize, resampled, count);
+            }
+            done += count;
+            continue;
+        }
+
+        size_t needed = mResampler.inputFramesNeeded(want);
+        if (needed > kChunkFrames) {
+            needed = kChunkFrames;
+        }
+        const uint8_t *src;
+        size_t got = fileFrames(&src, needed);
+        if (got == 0) {
+            break;
+        }
+        mConverter.convert(mScratch, src, got);
+        size_t accepted = mResampler.write(mScratch, got);
+        // what was not accepted is read again, fileFrames() did not wrap
+        mPosition -= got - accepted;
+        if (accepted == 0) {
+            ALOGW("readResampled() resampler stalled");
+            break;
+        }
+    }
+    return done;
+}
+
+ssize_t AudioReplaySource::read(void *buffer, size_t frames)
+{
+    if (!isOpen()) {
+        return NO_INIT;
+    }
+
+    uint8_t *out = (uint8_t *)buffer;
+    size_t done = 0;
+    if (mResample) {
+        done = readResampled(out, frames);
+    } else {
+        while (done < frames) {
+            const uint8_t *src;
+            size_t count = fileFrames(&src, frames - done);
+            if (count == 0) {
+                break;
+            }
+            mConverter.convert(out + done * mFrameSize, src, count);
+            done += count;
+        }
+    }
+    if (done < frames) {
+        // past the end of a file that does not loop
+        memset(out + done * mFrameSize, 0, (frames - done) * mFrameSize);
+        done = frames;
+    }
+
+    // frames are due at the time they would have been captured since the
+    // first read, whatever time the conversion or the caller took. The clock
+    // does not wait for frames that are already late.
+    mClock.advance(done, mRate);
+    if (systemTime(SYSTEM_TIME_MONOTONIC) - mClock.time() > kLateNs) {
+        mLateReads++;
+    }
+    return done;
+}
+
+status_t AudioReplaySource::dump(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    if (!isOpen()) {
+        snprintf(buffer, SIZE, "\treplay: no file\n");
+    } else {
+        snprintf(buffer, SIZE, "\treplay: %zu frames, format %#x, mask %#x, %u Hz%s\n"
+                 "\t  position %zu, %u loops%s, %llu frames read, %u late reads\n",
+                 mFrames, mFileFormat, mFileChannelMask, mFileRate,
+                 mResample ? ", resampled" : "",
+                 mPosition, mLoops, mLoop ? "" : " (no loop)",
+                 (unsigned long long)mClock.frames(), mLateReads);
+    }
+    ::write(fd, buffer, strlen(buffer));
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
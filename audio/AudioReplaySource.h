@@ -0,0 +1,115 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_REPLAY_SOURCE_H
+#define ANDROID_AUDIO_REPLAY_SOURCE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/Timers.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+#include "AudioFormatConverter.h"
+#include "AudioStubClock.h"
+#include "PolyphaseResampler.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioReplaySource plays a PCM file back as if it were captured, to feed an
+ * input stream in tests.
+ *
+ * The file is memory mapped and read in place: large files cost no stdio
+ * buffering and seeking is free. WAV files are read in their own format,
+ * channel count and rate and converted to the stream's configuration; files
+ * without a RIFF header are taken as raw PCM in the stream's configuration.
+ *
+ * read() paces itself on an AudioStubClock started by the first read: frames
+ * are returned when they would have been captured, so long runs do not drift
+ * however long each call takes.
+ */
+class AudioReplaySource {
+public:
+                        AudioReplaySource();
+                        ~AudioReplaySource();
+
+    /** map path and set up the conversion to the stream configuration */
+            status_t    open(const char *path, int format, uint32_t channelMask,
+                             uint32_t sampleRate);
+            void        close();
+            bool        isOpen() const { return mData != NULL; }
+
+    /** start over at the beginning when reaching the end, true by default */
+            void        setLoop(bool loop) { mLoop = loop; }
+    /** move to a position in the file, in ms */
+            status_t    seek(uint32_t ms);
+    /** restart the clock with the next read(), e.g. after standby */
+            void        restartClock() { mClock.reset(); }
+
+    /**
+     * fill frames in the stream configuration and wait until the last of
+     * them is due. A file that does not loop is followed by silence.
+     */
+            ssize_t     read(void *buffer, size_t frames);
+
+            status_t    dump(int fd);
+
+private:
+                        AudioReplaySource(const AudioReplaySource&);
+    AudioReplaySource&  operator=(const AudioReplaySource&);
+
+            status_t    parseWave();
+            size_t      fileFrames(const uint8_t **data, size_t frames);
+            size_t      readResampled(uint8_t *out, size_t frames);
+
+    // mapping
+    void                *mMap;
+    size_t              mMapSize;
+    const uint8_t       *mData;         // first frame in the file
+    size_t              mFrames;        // frames in the file
+    size_t              mPosition;      // next file frame
+    bool                mLoop;
+    uint32_t            mLoops;
+
+    // file configuration
+    audio_format_t      mFileFormat;
+    uint32_t            mFileChannelMask;
+    uint32_t            mFileRate;
+
+    // stream configuration
+    uint32_t            mRate;
+    uint32_t            mChannelCount;
+    size_t              mFrameSize;
+    AudioFormatConverter mConverter;    // file to stream, or file to PCM_16 when resampling
+    bool                mResample;
+    PolyphaseResampler  mResampler;
+    AudioFormatConverter mOutConverter; // PCM_16 to stream after resampling
+    int16_t             *mScratch;      // converted file frames, then resampled frames
+
+    AudioStubClock      mClock;         // real time, frames read since it started
+    uint32_t            mLateReads;     // returned after their frames were due
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_REPLAY_SOURCE_H
@@ -0,0 +1,125 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioRingBuffer"
+//#define LOG_NDEBUG 0
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include "AudioRingBuffer.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+AudioRingBuffer::AudioRingBuffer()
+    : mBuffer(NULL), mSize(0), mReadPos(0), mWritePos(0)
+{
+}
+
+AudioRingBuffer::~AudioRingBuffer()
+{
+    free(mBuffer);
+}
+
+status_t AudioRingBuffer::init(size_t size)
+{
+    size_t capacity = 1;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    uint8_t *buffer = (uint8_t *)realloc(mBuffer, capacity);
+    if (buffer == NULL) {
+        ALOGE("init() cannot allocate %zu bytes", capacity);
+        return NO_MEMORY;
+    }
+    mBuffer = buffer;
+    mSize = capacity;
+    reset();
+    return NO_ERROR;
+}
+
+void AudioRingBuffer::reset()
+{
+    mReadPos.store(0, std::memory_order_relaxed);
+    mWritePos.store(0, std::memory_order_relaxed);
+}
+
+size_t AudioRingBuffer::availableToRead() const
+{
+    return mWritePos.load(std::memory_order_acquire) - mReadPos.load(std::memory_order_relaxed);
+}
+
+size_t AudioRingBuffer::availableToWrite() const
+{
+    return mSize - (mWritePos.load(std::memory_order_relaxed) -
+                    mReadPos.load(std::memory_order_acquire));
+}
+
+size_t AudioRingBuffer::write(const void *buffer, size_t bytes)
+{
+    size_t writePos = mWritePos.load(std::memory_order_relaxed);
+    size_t avail = mSize - (writePos - mReadPos.load(std::memory_order_acquire));
+    if (bytes > avail) {
+        bytes = avail;
+    }
+    size_t offset = writePos & (mSize - 1);
+    size_t first = mSize - offset;
+    if (first > bytes) {
+        first = bytes;
+    }
+    memcpy(mBuffer + offset, buffer, first);
+    memcpy(mBuffer, (const uint8_t *)buffer + first, bytes - first);
+    mWritePos.store(writePos + bytes, std::memory_order_release);
+    return bytes;
+}
+
+size_t AudioRingBuffer::read(void *buffer, size_t bytes)
+{
+    size_t readPos = mReadPos.load(std::memory_order_relaxed);
+    size_t avail = mWritePos.load(std::memory_order_acquire) - readPos;
+    if (bytes > avail) {
+        bytes = avail;
+    }
+    size_t offset = readPos & (mSize - 1);
+    size_t first = mSize - offset;
+    if (first > bytes) {
+        first = bytes;
+    }
+    memcpy(buffer, mBuffer + offset, first);
+    memcpy((uint8_t *)buffer + first, mBuffer, bytes - first);
+    mReadPos.store(readPos + bytes, std::memory_order_release);
+    return bytes;
+}
+
+size_t AudioRingBuffer::skip(size_t bytes)
+{
+    size_t readPos = mReadPos.load(std::memory_order_relaxed);
+    size_t avail = mWritePos.load(std::memory_order_acquire) - readPos;
+    if (bytes > avail) {
+        bytes = avail;
+    }
+    mReadPos.store(readPos + bytes, std::memory_order_release);
+    return bytes;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,75 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_RING_BUFFER_H
+#define ANDROID_AUDIO_RING_BUFFER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioRingBuffer is a byte FIFO for exactly one producer thread and one
+ * consumer thread. Neither side takes a lock or allocates, so the audio thread
+ * can hand data to a worker thread without ever waiting on it.
+ *
+ * The capacity is rounded up to a power of two in init().
+ */
+class AudioRingBuffer {
+public:
+                        AudioRingBuffer();
+                        ~AudioRingBuffer();
+
+    /** allocate the buffer. Must be called before the producer and consumer start. */
+    status_t            init(size_t size);
+
+    /** producer side: copy up to bytes in, returns the number of bytes copied */
+    size_t              write(const void *buffer, size_t bytes);
+    /** consumer side: copy up to bytes out, returns the number of bytes copied */
+    size_t              read(void *buffer, size_t bytes);
+    /** consumer side: drop up to bytes without copying them */
+    size_t              skip(size_t bytes);
+
+    size_t              availableToRead() const;
+    size_t              availableToWrite() const;
+    size_t              size() const { return mSize; }
+
+    /** empty the buffer. Only valid while neither side is running. */
+    void                reset();
+
+private:
+                        AudioRingBuffer(const AudioRingBuffer&);
+    AudioRingBuffer&    operator=(const AudioRingBuffer&);
+
+    uint8_t             *mBuffer;
+    size_t              mSize;
+    // free running positions, masked with mSize - 1 on access
+    std::atomic<size_t> mReadPos;
+    std::atomic<size_t> mWritePos;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_RING_BUFFER_H
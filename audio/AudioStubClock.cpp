@@ -0,0 +1,124 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <unistd.h>
+
+#include "AudioStubClock.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+AudioStubClock::AudioStubClock()
+{
+    reset();
+}
+
+void AudioStubClock::configure(const Config& config)
+{
+    Mutex::Autolock _l(mLock);
+    mConfig = config;
+    mRandom = config.seed != 0 ? config.seed : 1;
+}
+
+void AudioStubClock::reset()
+{
+    Mutex::Autolock _l(mLock);
+    mStarted = false;
+    mStartNs = 0;
+    mTimeNs = 0;
+    mStallNs = 0;
+    mFrames = 0;
+    mFramesLost = 0;
+    mTransfers = 0;
+    mUnderruns = 0;
+    mRandom = mConfig.seed != 0 ? mConfig.seed : 1;
+}
+
+// xorshift32, so that jitter and underruns repeat from run to run
+uint32_t AudioStubClock::random()
+{
+    mRandom ^= mRandom << 13;
+    mRandom ^= mRandom >> 17;
+    mRandom ^= mRandom << 5;
+    return mRandom;
+}
+
+void AudioStubClock::advance(size_t frames, uint32_t sampleRate)
+{
+    nsecs_t due;
+    bool virtualTime;
+    {
+        Mutex::Autolock _l(mLock);
+        virtualTime = mConfig.virtualTime;
+        if (!mStarted) {
+            mStarted = true;
+            mStartNs = virtualTime ? 0 : systemTime(SYSTEM_TIME_MONOTONIC);
+        }
+        mFrames += frames;
+        mTransfers++;
+        if (mConfig.underrunPeriod != 0 && (mTransfers % mConfig.underrunPeriod) == 0) {
+            mStallNs += ms2ns(mConfig.underrunMs);
+            mFramesLost += (uint64_t)mConfig.underrunMs * sampleRate / 1000;
+            mUnderruns++;
+        }
+        // whole seconds first so that the product cannot overflow
+        due = mStartNs + mStallNs + s2ns(mFrames / sampleRate) +
+                s2ns(mFrames % sampleRate) / sampleRate;
+        if (mConfig.jitterUs != 0) {
+            due += us2ns(random() % (mConfig.jitterUs + 1));
+        }
+        if (due > mTimeNs) {
+            mTimeNs = due;
+        }
+    }
+
+    if (!virtualTime) {
+        nsecs_t delay = due - systemTime(SYSTEM_TIME_MONOTONIC);
+        if (delay > 0) {
+            usleep(ns2us(delay));
+        }
+    }
+}
+
+uint64_t AudioStubClock::frames() const
+{
+    Mutex::Autolock _l(mLock);
+    return mFrames;
+}
+
+nsecs_t AudioStubClock::time() const
+{
+    Mutex::Autolock _l(mLock);
+    return mTimeNs;
+}
+
+uint32_t AudioStubClock::underruns() const
+{
+    Mutex::Autolock _l(mLock);
+    return mUnderruns;
+}
+
+uint64_t AudioStubClock::framesLost() const
+{
+    Mutex::Autolock _l(mLock);
+    return mFramesLost;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,96 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_STUB_CLOCK_H
+#define ANDROID_AUDIO_STUB_CLOCK_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+namespace android_audio_legacy {
+    using android::Mutex;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioStubClock paces the stub streams and AudioReplaySource.
+ *
+ * In real time mode a transfer returns when the device would have consumed
+ * or produced it, measured from the first transfer after standby so that
+ * sleeping does not drift. In virtual mode nothing sleeps: a simulated device
+ * clock advances by the duration of each transfer, so a pipeline can be
+ * driven as fast as the CPU allows and still see exact, repeatable positions
+ * and timestamps.
+ *
+ * Both modes can add jitter to the completion time of each transfer, and
+ * periodic underruns that stall the device for a while. Jitter and underruns
+ * come from a seeded generator so a run can be reproduced.
+ */
+class AudioStubClock {
+public:
+    struct Config {
+        Config() : virtualTime(false), jitterUs(0), underrunPeriod(0), underrunMs(0), seed(1) {}
+        bool        virtualTime;
+        uint32_t    jitterUs;       // up to this much late per transfer
+        uint32_t    underrunPeriod; // stall the device every n transfers, 0 for never
+        uint32_t    underrunMs;     // for this long
+        uint32_t    seed;
+    };
+
+                        AudioStubClock();
+
+            void        configure(const Config& config);
+            const Config& config() const { return mConfig; }
+            void        reset();
+
+    /** account for frames transferred at the given rate, sleeping in real time mode */
+            void        advance(size_t frames, uint32_t sampleRate);
+
+    /** frames transferred since reset() */
+            uint64_t    frames() const;
+    /** device time of the last transfer */
+            nsecs_t     time() const;
+            uint32_t    underruns() const;
+    /** frames the device missed during underruns since reset() */
+            uint64_t    framesLost() const;
+
+private:
+            uint32_t    random();
+
+    mutable Mutex       mLock;
+    Config              mConfig;
+    bool                mStarted;
+    nsecs_t             mStartNs;
+    nsecs_t             mTimeNs;
+    nsecs_t             mStallNs;       // total underrun time
+    uint64_t            mFrames;
+    uint64_t            mFramesLost;
+    uint32_t            mTransfers;
+    uint32_t            mUnderruns;
+    uint32_t            mRandom;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_STUB_CLOCK_H
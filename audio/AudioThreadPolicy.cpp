@@ -0,0 +1,403 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "AudioThreadPolicy"
+//#define LOG_NDEBUG 0
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <utils/Log.h>
+
+#include "AudioThreadPolicy.h"
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+// SCHED_FIFO priority when only the policy is given, that of AudioFlinger's
+// own real time audio threads
+static const int kDefaultRtPriority = 2;
+
+static const char *kRoleNames[AudioThreadPolicy::ROLE_CNT] = {
+    "render",
+    "capture",
+    "patch",
+    "dump",
+};
+
+// cgroup hierarchies threads may be moved into
+static const char *kCgroupRoots[] = {
+    "/dev/cpuset",
+    "/dev/stune",
+};
+
+static const char *kFields[] = {
+    "policy",
+    "priority",
+    "cpus",
+    "cgroup",
+};
+
+static String8 keyName(int role, const char *field)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "sched_%s_%s", kRoleNames[role], field);
+    return String8(key);
+}
+
+// a directory under one of kCgroupRoots, without "." or ".." components
+static bool isCgroupPath(const char *path)
+{
+    const char *rest = NULL;
+    for (size_t i = 0; i < sizeof(kCgroupRoots) / sizeof(kCgroupRoots[0]); i++) {
+        size_t length = strlen(kCgroupRoots[i]);
+        if (!strncmp(path, kCgroupRoots[i], length) &&
+                (path[length] == '\0' || path[length] == '/')) {
+            rest = path + length;
+            break;
+        }
+    }
+    if (rest == NULL) {
+        return false;
+    }
+    while (*rest == '/') {
+        const char *name = rest + 1;
+        const char *end = strchr(name, '/');
+        if (end == NULL) {
+            end = name + strlen(name);
+        }
+        size_t length = end - name;
+        if (length == 0 || (length == 1 && name[0] == '.') ||
+                (length == 2 && name[0] == '.' && name[1] == '.')) {
+            return false;
+        }
+        rest = end;
+    }
+    return true;
+}
+
+static const char *policyName(int policy)
+{
+    switch (policy) {
+    case SCHED_OTHER:
+        return "other";
+    case SCHED_FIFO:
+        return "fifo";
+    case SCHED_RR:
+        return "rr";
+    default:
+        return "default";
+    }
+}
+
+// "0-3,6": CPU numbers and ranges separated by commas
+static status_t parseCpuList(const char *list, cpu_set_t *cpus)
+{
+    CPU_ZERO(cpus);
+    if (!strcmp(list, "all")) {
+        long count = sysconf(_SC_NPROCESSORS_CONF);
+        for (long i = 0; i < count && i < CPU_SETSIZE; i++) {
+            CPU_SET(i, cpus);
+        }
+        return NO_ERROR;
+    }
+    const char *p = list;
+    while (*p != '\0') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p) {
+            return BAD_VALUE;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p) {
+                return BAD_VALUE;
+            }
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            return BAD_VALUE;
+        }
+        for (long i = first; i <= last; i++) {
+            CPU_SET(i, cpus);
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return BAD_VALUE;
+        }
+        p = end;
+    }
+    return CPU_COUNT(cpus) != 0 ? NO_ERROR : BAD_VALUE;
+}
+
+// cgroup v1 hierarchies such as Android's cpusets take threads in "tasks",
+// cgroup v2 in "cgroup.threads"
+static status_t moveToCgroup(const String8& cgroup, pid_t tid)
+{
+    static const char *kFiles[] = { "/tasks", "/cgroup.threads" };
+    status_t status = NO_INIT;
+    for (size_t i = 0; i < sizeof(kFiles) / sizeof(kFiles[0]); i++) {
+        String8 path = cgroup;
+        path += kFiles[i];
+        int fd = open(path.string(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0) {
+            status = -errno;
+            continue;
+        }
+        char buffer[16];
+        int length = snprintf(buffer, sizeof(buffer), "%d", tid);
+        status = ::write(fd, buffer, length) == length ? NO_ERROR : -errno;
+        close(fd);
+        return status;
+    }
+    return status;
+}
+
+// ----------------------------------------------------------------------------
+
+AudioThreadPolicy::AudioThreadPolicy()
+    : mGeneration(0)
+{
+    for (int i = 0; i < ROLE_CNT; i++) {
+        Config& config = mConfigs[i];
+        config.policy = -1;
+        config.priority = 0;
+        config.hasPriority = false;
+        config.hasCpus = false;
+        CPU_ZERO(&config.cpus);
+        config.threads = 0;
+        config.failures = 0;
+        config.lastError = NO_ERROR;
+    }
+}
+
+const char* AudioThreadPolicy::roleName(role r)
+{
+    return r < ROLE_CNT ? kRoleNames[r] : "unknown";
+}
+
+status_t AudioThreadPolicy::setParameters(const AudioParameterList& params)
+{
+    status_t status = NO_ERROR;
+    bool changed = false;
+
+    // most calls carry no sched_ key: none of the names below is then built
+    size_t i;
+    for (i = 0; i < params.size(); i++) {
+        if (params.idAt(i) == AudioParameterList::KEY_OTHER &&
+                !strncmp(params.keyAt(i), "sched_", 6)) {
+            break;
+        }
+    }
+    if (i == params.size()) {
+        return NO_ERROR;
+    }
+
+    Mutex::Autolock _l(mLock);
+    for (int r = 0; r < ROLE_CNT; r++) {
+        // fields in kFields order, the policy before the priority
+        for (size_t f = 0; f < sizeof(kFields) / sizeof(kFields[0]); f++) {
+            char key[64];
+            snprintf(key, sizeof(key), "sched_%s_%s", kRoleNames[r], kFields[f]);
+            ssize_t index = params.indexOf(key);
+            if (index < 0) {
+                continue;
+            }
+            const char *value = params.valueAt(index);
+            status_t fieldStatus = setParameter_l(mConfigs[r], kFields[f], value);
+            if (fieldStatus != NO_ERROR) {
+                ALOGW("setParameters() invalid %s=%s", key, value);
+                status = fieldStatus;
+            } else {
+                changed = true;
+            }
+        }
+    }
+    if (changed) {
+        mGeneration.fetch_add(1, std::memory_order_release);
+    }
+    return status;
+}
+
+status_t AudioThreadPolicy::setParameter_l(Config& config, const char *field,
+                                           const char *value)
+{
+    if (!strcmp(field, "policy")) {
+        if (!strcmp(value, "other")) {
+            config.policy = SCHED_OTHER;
+        } else if (!strcmp(value, "fifo")) {
+            config.policy = SCHED_FIFO;
+        } else if (!strcmp(value, "rr")) {
+            config.policy = SCHED_RR;
+        } else {
+            return BAD_VALUE;
+        }
+        // a priority given with the policy is parsed after it
+        config.hasPriority = config.policy != SCHED_OTHER;
+        config.priority = config.hasPriority ? kDefaultRtPriority : 0;
+        return NO_ERROR;
+    }
+    if (!strcmp(field, "priority")) {
+        char *end;
+        long priority = strtol(value, &end, 10);
+        if (end == value || *end != '\0') {
+            return BAD_VALUE;
+        }
+        // nice for SCHED_OTHER, or before the policy is known
+        bool rt = config.policy == SCHED_FIFO || config.policy == SCHED_RR;
+        if (rt ? (priority < 1 || priority > MAX_RT_PRIORITY) :
+                (priority < -20 || priority > 19)) {
+            return BAD_VALUE;
+        }
+        config.priority = priority;
+        config.hasPriority = true;
+        return NO_ERROR;
+    }
+    if (!strcmp(field, "cpus")) {
+        cpu_set_t cpus;
+        if (parseCpuList(value, &cpus) != NO_ERROR) {
+            return BAD_VALUE;
+        }
+        config.cpus = cpus;
+        config.cpuList = value;
+        config.hasCpus = true;
+        return NO_ERROR;
+    }
+    if (!strcmp(field, "cgroup")) {
+        if (!isCgroupPath(value)) {
+            return BAD_VALUE;
+        }
+        config.cgroup = value;
+        return NO_ERROR;
+    }
+    return BAD_VALUE;
+}
+
+void AudioThreadPolicy::getParameters(AudioParameter& keys, AudioParameter *response)
+{
+    Mutex::Autolock _l(mLock);
+    for (int i = 0; i < ROLE_CNT; i++) {
+        const Config& config = mConfigs[i];
+        for (size_t f = 0; f < sizeof(kFields) / sizeof(kFields[0]); f++) {
+            String8 key = keyName(i, kFields[f]);
+            String8 value;
+            if (keys.get(key, value) != NO_ERROR) {
+                continue;
+            }
+            if (!strcmp(kFields[f], "policy")) {
+                response->add(key, String8(policyName(config.policy)));
+            } else if (!strcmp(kFields[f], "priority")) {
+                response->addInt(key, config.priority);
+            } else if (!strcmp(kFields[f], "cpus")) {
+                response->add(key, config.cpuList);
+            } else {
+                response->add(key, config.cgroup);
+            }
+            keys.remove(key);
+        }
+    }
+}
+
+void AudioThreadPolicy::applyConfig(role r)
+{
+    if (r >= ROLE_CNT) {
+        return;
+    }
+    const pid_t tid = gettid();
+
+    Mutex::Autolock _l(mLock);
+    Config& config = mConfigs[r];
+    status_t status = NO_ERROR;
+
+    if (config.policy == SCHED_FIFO || config.policy == SCHED_RR) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = config.priority;
+        // children of the audio server must not inherit real time priority
+        if (sched_setscheduler(tid, config.policy | SCHED_RESET_ON_FORK, &param) != 0) {
+            status = -errno;
+        }
+    } else if (config.policy == SCHED_OTHER) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        if (sched_setscheduler(tid, SCHED_OTHER, &param) != 0) {
+            status = -errno;
+        }
+    }
+    if (status == NO_ERROR && config.hasPriority &&
+            (config.policy == SCHED_OTHER || config.policy == -1)) {
+        if (setpriority(PRIO_PROCESS, tid, config.priority) != 0) {
+            status = -errno;
+        }
+    }
+    if (config.hasCpus && sched_setaffinity(tid, sizeof(config.cpus), &config.cpus) != 0) {
+        status = -errno;
+    }
+    if (config.cgroup.length() != 0) {
+        status_t cgroupStatus = moveToCgroup(config.cgroup, tid);
+        if (cgroupStatus != NO_ERROR) {
+            status = cgroupStatus;
+        }
+    }
+
+    config.threads++;
+    if (status != NO_ERROR) {
+        ALOGW_IF(config.failures == 0, "cannot configure %s thread %d: %d",
+                 kRoleNames[r], tid, status);
+        config.failures++;
+        config.lastError = status;
+    }
+    ALOGV("applyConfig() %s thread %d: policy %s, priority %d, cpus %s, cgroup %s: %d",
+          kRoleNames[r], tid, policyName(config.policy), config.priority,
+          config.cpuList.string(), config.cgroup.string(), status);
+}
+
+status_t AudioThreadPolicy::dump(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    Mutex::Autolock _l(mLock);
+    snprintf(buffer, SIZE, "\tthread policy, generation %u:\n", mGeneration.load());
+    ::write(fd, buffer, strlen(buffer));
+    for (int i = 0; i < ROLE_CNT; i++) {
+        const Config& config = mConfigs[i];
+        if (config.policy == -1 && !config.hasPriority && !config.hasCpus &&
+                config.cgroup.length() == 0) {
+            continue;
+        }
+        snprintf(buffer, SIZE, "\t  %-8s %s, priority %d, cpus %s, cgroup %s,"
+                 " %u threads configured, %u failures (last %d)\n",
+                 kRoleNames[i], policyName(config.policy), config.priority,
+                 config.hasCpus ? config.cpuList.string() : "any",
+                 config.cgroup.length() != 0 ? config.cgroup.string() : "none",
+                 config.threads, config.failures, config.lastError);
+        ::write(fd, buffer, strlen(buffer));
+    }
+    return NO_ERROR;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
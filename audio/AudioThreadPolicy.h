@@ -0,0 +1,125 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_AUDIO_THREAD_POLICY_H
+#define ANDROID_AUDIO_THREAD_POLICY_H
+
+#include <sched.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#include <utils/RefBase.h>
+#include <utils/String8.h>
+#include <utils/threads.h>
+
+#include <hardware_legacy/AudioHardwareInterface.h>
+#include <hardware_legacy/AudioParameterList.h>
+
+namespace android_audio_legacy {
+    using android::Mutex;
+    using android::RefBase;
+    using android::String8;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioThreadPolicy holds how a HAL module schedules the threads it owns.
+ *
+ * Threads are grouped by role. Each role can be given a scheduling policy
+ * and priority, a set of CPUs and a cgroup, through the module parameters:
+ *
+ *   sched_<role>_policy=other|fifo|rr
+ *   sched_<role>_priority=<nice for other, 1 to MAX_RT_PRIORITY for fifo and rr>
+ *   sched_<role>_cpus=<list such as 0-3,6, or all>
+ *   sched_<role>_cgroup=<cpuset or schedtune group the thread is moved to>
+ *
+ * Any client that can set audio parameters can set these keys, so real time
+ * priorities stop at those of the audio server's own threads, and threads
+ * only move to groups under the cpuset and schedtune hierarchies.
+ *
+ * A role keeps the priority its threads were started with until it is
+ * configured. Threads call apply() at the top of their loop and pick up
+ * changes there, so nothing is pushed to a thread from outside.
+ */
+class AudioThreadPolicy : public RefBase {
+public:
+    enum role {
+        ROLE_RENDER,        // output helpers: A2DP writer, standby timer
+        ROLE_CAPTURE,       // capture hub
+        ROLE_PATCH,         // device to device patches
+        ROLE_DUMP,          // dump and flight recorder writers
+        ROLE_CNT
+    };
+
+    /** highest SCHED_FIFO or SCHED_RR priority, that of AudioFlinger's fast threads */
+    enum { MAX_RT_PRIORITY = 3 };
+
+                        AudioThreadPolicy();
+
+    /** apply the sched_ keys in params, other keys are ignored */
+            status_t    setParameters(const AudioParameterList& params);
+    /** move the sched_ keys in keys to response, with their values */
+            void        getParameters(AudioParameter& keys, AudioParameter *response);
+
+    /**
+     * configure the calling thread for role if the configuration changed
+     * since generation, which the thread keeps and starts at 0. Costs an
+     * atomic load when nothing changed.
+     */
+            void        apply(role r, uint32_t *generation) {
+                            uint32_t current = mGeneration.load(std::memory_order_acquire);
+                            if (*generation != current) {
+                                applyConfig(r);
+                                *generation = current;
+                            }
+                        }
+
+            status_t    dump(int fd);
+
+    static  const char* roleName(role r);
+
+private:
+    struct Config {
+        int             policy;         // -1 until configured
+        int             priority;
+        bool            hasPriority;
+        bool            hasCpus;
+        cpu_set_t       cpus;
+        String8         cpuList;
+        String8         cgroup;
+        uint32_t        threads;        // configured so far
+        uint32_t        failures;
+        int             lastError;
+    };
+
+                        AudioThreadPolicy(const AudioThreadPolicy&);
+    AudioThreadPolicy&  operator=(const AudioThreadPolicy&);
+
+            void        applyConfig(role r);
+            status_t    setParameter_l(Config& config, const char *field, const char *value);
+
+    Mutex               mLock;
+    Config              mConfigs[ROLE_CNT];
+    std::atomic<uint32_t> mGeneration;
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_THREAD_POLICY_H
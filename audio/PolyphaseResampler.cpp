@@ -0,0 +1,316 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#define LOG_TAG "PolyphaseResampler"
+//#define LOG_NDEBUG 0
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils/Log.h>
+#include <utils/threads.h>
+#include <utils/KeyedVector.h>
+
+#include "PolyphaseResampler.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2 1
+#endif
+
+namespace android_audio_legacy {
+    using android::Mutex;
+    using android::KeyedVector;
+
+// ----------------------------------------------------------------------------
+
+// largest number of phases (interpolation factor after reduction) accepted.
+// 8000 <-> 44100 needs 441, 11025 <-> 48000 needs 640.
+static const uint32_t kMaxPhases = 1024;
+static const uint32_t kMinRate = 4000;
+static const uint32_t kMaxRate = 192000;
+// passband edge relative to the lower of the two Nyquist frequencies
+static const double kCutoff = 0.90;
+// Kaiser window shape, about 80 dB of stopband attenuation
+static const double kKaiserBeta = 8.0;
+
+struct PolyphaseResampler::Coefficients {
+    uint32_t    phases;     // L: interpolation factor
+    uint32_t    step;       // M: decimation factor
+    int16_t     *taps;      // phases * TAPS, Q15, reversed within each phase
+};
+
+static Mutex sCoefficientsLock;
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// zeroth order modified Bessel function of the first kind
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+static inline int16_t clamp16(int32_t sample)
+{
+    if ((sample >> 15) ^ (sample >> 31)) {
+        sample = 0x7FFF ^ (sample >> 31);
+    }
+    return sample;
+}
+
+// n must be a multiple of 8
+static inline int32_t dotProduct(const int16_t *x, const int16_t *h, size_t n)
+{
+#if defined(USE_NEON)
+    int32x4_t acc = vdupq_n_s32(0);
+    for (; n; n -= 8, x += 8, h += 8) {
+        int16x8_t vx = vld1q_s16(x);
+        int16x8_t vh = vld1q_s16(h);
+        acc = vmlal_s16(acc, vget_low_s16(vx), vget_low_s16(vh));
+        acc = vmlal_s16(acc, vget_high_s16(vx), vget_high_s16(vh));
+    }
+    int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    return vget_lane_s32(vpadd_s32(sum, sum), 0);
+#elif defined(USE_SSE2)
+    __m128i acc = _mm_setzero_si128();
+    for (; n; n -= 8, x += 8, h += 8) {
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)x),
+                                                _mm_loadu_si128((const __m128i *)h)));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+#else
+    int32_t acc = 0;
+    while (n--) {
+        acc += (int32_t)*x++ * *h++;
+    }
+    return acc;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+bool PolyphaseResampler::isSupported(uint32_t inRate, uint32_t outRate)
+{
+    if (inRate < kMinRate || inRate > kMaxRate || outRate < kMinRate || outRate > kMaxRate) {
+        return false;
+    }
+    return (outRate / gcd(inRate, outRate)) <= kMaxPhases;
+}
+
+const PolyphaseResampler::Coefficients *PolyphaseResampler::getCoefficients(
+        uint32_t inRate, uint32_t outRate)
+{
+    // tables are never freed: there are only a handful of rate pairs in use
+    static KeyedVector<uint64_t, const Coefficients *> sCoefficients;
+    uint64_t key = ((uint64_t)inRate << 32) | outRate;
+
+    Mutex::Autolock _l(sCoefficientsLock);
+    ssize_t index = sCoefficients.indexOfKey(key);
+    if (index >= 0) {
+        return sCoefficients.valueAt(index);
+    }
+
+    uint32_t div = gcd(inRate, outRate);
+    uint32_t phases = outRate / div;
+    uint32_t step = inRate / div;
+    size_t length = (size_t)phases * TAPS;
+
+    Coefficients *coefs = new Coefficients;
+    coefs->phases = phases;
+    coefs->step = step;
+    coefs->taps = new int16_t[length];
+
+    // prototype low pass filter at the upsampled rate phases * inRate
+    double fc = kCutoff * 0.5 * (inRate < outRate ? inRate : outRate) / ((double)phases * inRate);
+    double center = (length - 1) / 2.0;
+    double norm = besselI0(kKaiserBeta);
+    double *proto = new double[TAPS];
+    for (uint32_t p = 0; p < phases; p++) {
+        // phase p uses prototype taps p, p + L, p + 2L...; normalize each
+        // phase to unity DC gain so that no phase adds a ripple.
+        double sum = 0;
+        for (uint32_t k = 0; k < TAPS; k++) {
+            double n = (double)p + (double)k * phases;
+            double t = n - center;
+            double x = 2.0 * fc * t;
+            double sinc = (t == 0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double r = t / (center + 1.0);
+            double window = besselI0(kKaiserBeta * sqrt(1.0 - r * r)) / norm;
+            proto[k] = sinc * window;
+            sum += proto[k];
+        }
+        int16_t *taps = coefs->taps + (size_t)p * TAPS;
+        for (uint32_t k = 0; k < TAPS; k++) {
+            // reversed so that the oldest queued frame meets the last tap
+            long q = lround(proto[k] / sum * (1 << 15));
+            taps[TAPS - 1 - k] = clamp16((int32_t)q);
+        }
+    }
+    delete[] proto;
+
+    ALOGV("getCoefficients() %u -> %u: %u phases, step %u", inRate, outRate, phases, step);
+    sCoefficients.add(key, coefs);
+    return coefs;
+}
+
+// ----------------------------------------------------------------------------
+
+PolyphaseResampler::PolyphaseResampler()
+    : mCoefs(NULL), mInRate(0), mOutRate(0), mChannelCount(0), mHistory(NULL),
+      mFill(0), mBase(0), mPhase(0)
+{
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+    free(mHistory);
+}
+
+status_t PolyphaseResampler::set(uint32_t inRate, uint32_t outRate, uint32_t channelCount)
+{
+    if (!isSupported(inRate, outRate) || channelCount == 0 || channelCount > MAX_CHANNELS) {
+        ALOGW("set() unsupported conversion %u -> %u, %u channels",
+              inRate, outRate, channelCount);
+        return BAD_VALUE;
+    }
+
+    if (channelCount > mChannelCount) {
+        int16_t *history = (int16_t *)realloc(mHistory,
+                channelCount * (TAPS + INPUT_FRAMES) * sizeof(int16_t));
+        if (history == NULL) {
+            return NO_MEMORY;
+        }
+        mHistory = history;
+    }
+    mCoefs = getCoefficients(inRate, outRate);
+    mInRate = inRate;
+    mOutRate = outRate;
+    mChannelCount = channelCount;
+    reset();
+    return NO_ERROR;
+}
+
+void PolyphaseResampler::reset()
+{
+    // prime the history with silence so that output starts right away
+    if (mHistory != NULL) {
+        for (uint32_t c = 0; c < mChannelCount; c++) {
+            memset(mHistory + c * (TAPS + INPUT_FRAMES), 0, (TAPS - 1) * sizeof(int16_t));
+        }
+    }
+    mFill = TAPS - 1;
+    mBase = 0;
+    mPhase = 0;
+}
+
+size_t PolyphaseResampler::write(const int16_t *in, size_t frames)
+{
+    const size_t capacity = TAPS + INPUT_FRAMES;
+
+    if (mBase > 0 && mFill + frames > capacity) {
+        for (uint32_t c = 0; c < mChannelCount; c++) {
+            int16_t *history = mHistory + c * capacity;
+            memmove(history, history + mBase, (mFill - mBase) * sizeof(int16_t));
+        }
+        mFill -= mBase;
+        mBase = 0;
+    }
+    if (frames > capacity - mFill) {
+        frames = capacity - mFill;
+    }
+
+    if (mChannelCount == 1) {
+        memcpy(mHistory + mFill, in, frames * sizeof(int16_t));
+    } else {
+        for (uint32_t c = 0; c < mChannelCount; c++) {
+            int16_t *history = mHistory + c * capacity + mFill;
+            const int16_t *src = in + c;
+            for (size_t i = 0; i < frames; i++) {
+                history[i] = *src;
+                src += mChannelCount;
+            }
+        }
+    }
+    mFill += frames;
+    return frames;
+}
+
+size_t PolyphaseResampler::read(int16_t *out, size_t frames)
+{
+    const size_t capacity = TAPS + INPUT_FRAMES;
+    const uint32_t phases = mCoefs->phases;
+    const uint32_t step = mCoefs->step;
+    size_t produced = 0;
+
+    while (produced < frames && mBase + TAPS <= mFill) {
+        const int16_t *taps = mCoefs->taps + (size_t)mPhase * TAPS;
+        for (uint32_t c = 0; c < mChannelCount; c++) {
+            int32_t acc = dotProduct(mHistory + c * capacity + mBase, taps, TAPS);
+            *out++ = clamp16((acc + (1 << 14)) >> 15);
+        }
+        mPhase += step;
+        mBase += mPhase / phases;
+        mPhase %= phases;
+        produced++;
+    }
+    return produced;
+}
+
+size_t PolyphaseResampler::inputFramesNeeded(size_t frames) const
+{
+    if (frames == 0) {
+        return 0;
+    }
+    // frames consumed before the last requested output, plus its own taps
+    uint64_t last = mBase + ((uint64_t)mPhase + (uint64_t)(frames - 1) * mCoefs->step) /
+            mCoefs->phases;
+    uint64_t needed = last + TAPS;
+    return needed > mFill ? (size_t)(needed - mFill) : 0;
+}
+
+size_t PolyphaseResampler::outputFramesFor(size_t frames) const
+{
+    return (size_t)(((uint64_t)frames * mCoefs->phases + mCoefs->step - 1) / mCoefs->step) + 1;
+}
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
@@ -0,0 +1,98 @@
+/*
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_POLYPHASE_RESAMPLER_H
+#define ANDROID_POLYPHASE_RESAMPLER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+/**
+ * PolyphaseResampler converts interleaved 16 bit PCM between two sample rates
+ * with a Kaiser windowed sinc filter split into one phase per output position.
+ *
+ * Filter coefficients only depend on the rate pair, so they are computed once
+ * per pair and shared by every resampler instance in the process.
+ *
+ * Input is queued with write() and output pulled with read(); neither call
+ * allocates, so both can be used from the audio thread.
+ */
+class PolyphaseResampler {
+public:
+    enum { MAX_CHANNELS = 8 };
+
+                        PolyphaseResampler();
+                        ~PolyphaseResampler();
+
+    /** configure the rate pair and channel count and reset the filter state */
+    status_t            set(uint32_t inRate, uint32_t outRate, uint32_t channelCount);
+
+    /** clear queued input, e.g. when the stream leaves standby */
+    void                reset();
+
+    /** queue input frames, returns the number of frames accepted */
+    size_t              write(const int16_t *in, size_t frames);
+
+    /** produce up to frames output frames from queued input */
+    size_t              read(int16_t *out, size_t frames);
+
+    /** number of additional input frames needed before read() can return frames */
+    size_t              inputFramesNeeded(size_t frames) const;
+
+    /** upper bound of output frames produced by frames input frames */
+    size_t              outputFramesFor(size_t frames) const;
+
+    uint32_t            inRate() const { return mInRate; }
+    uint32_t            outRate() const { return mOutRate; }
+
+    /** true if set() accepts this rate pair */
+    static bool         isSupported(uint32_t inRate, uint32_t outRate);
+
+private:
+    // taps per phase, a multiple of 8 for the SIMD dot product
+    enum { TAPS = 64 };
+    // input frames that can be queued beyond the filter history
+    enum { INPUT_FRAMES = 1024 };
+
+    struct Coefficients;
+
+                        PolyphaseResampler(const PolyphaseResampler&);
+    PolyphaseResampler& operator=(const PolyphaseResampler&);
+
+    static const Coefficients *getCoefficients(uint32_t inRate, uint32_t outRate);
+
+    const Coefficients  *mCoefs;
+    uint32_t            mInRate;
+    uint32_t            mOutRate;
+    uint32_t            mChannelCount;
+    int16_t             *mHistory;      // one deinterleaved queue per channel
+    size_t              mFill;          // frames queued in each channel
+    size_t              mBase;          // oldest frame used by the next output
+    uint32_t            mPhase;         // next output position between mBase and mBase + 1
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_POLYPHASE_RESAMPLER_H
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_DEVICE_CONV_H
+#define ANDROID_AUDIO_DEVICE_CONV_H
+
+#include <stdint.h>
+
+#include <system/audio.h>
+
+#include <hardware_legacy/AudioSystemLegacy.h>
+
+namespace android_audio_legacy {
+
+enum {
+    HAL_API_REV_1_0,
+    HAL_API_REV_2_0,
+    HAL_API_REV_NUM
+};
+
+static constexpr uint32_t audio_device_conv_table[][HAL_API_REV_NUM] =
+{
+    /* output devices */
+    { AudioSystem::DEVICE_OUT_EARPIECE, AUDIO_DEVICE_OUT_EARPIECE },
+    { AudioSystem::DEVICE_OUT_SPEAKER, AUDIO_DEVICE_OUT_SPEAKER },
+    { AudioSystem::DEVICE_OUT_WIRED_HEADSET, AUDIO_DEVICE_OUT_WIRED_HEADSET },
+    { AudioSystem::DEVICE_OUT_WIRED_HEADPHONE, AUDIO_DEVICE_OUT_WIRED_HEADPHONE },
+    { AudioSystem::DEVICE_OUT_BLUETOOTH_SCO, AUDIO_DEVICE_OUT_BLUETOOTH_SCO },
+    { AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_HEADSET, AUDIO_DEVICE_OUT_BLUETOOTH_SCO_HEADSET },
+    { AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_CARKIT, AUDIO_DEVICE_OUT_BLUETOOTH_SCO_CARKIT },
+    { AudioSystem::DEVICE_OUT_BLUETOOTH_A2DP, AUDIO_DEVICE_OUT_BLUETOOTH_A2DP },
+    { AudioSystem::DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES, AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES },
+    { AudioSystem::DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER, AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER },
+    { AudioSystem::DEVICE_OUT_AUX_DIGITAL, AUDIO_DEVICE_OUT_AUX_DIGITAL },
+    { AudioSystem::DEVICE_OUT_ANLG_DOCK_HEADSET, AUDIO_DEVICE_OUT_ANLG_DOCK_HEADSET },
+    { AudioSystem::DEVICE_OUT_DGTL_DOCK_HEADSET, AUDIO_DEVICE_OUT_DGTL_DOCK_HEADSET },
+    { AudioSystem::DEVICE_OUT_DEFAULT, AUDIO_DEVICE_OUT_DEFAULT },
+    /* input devices */
+    { AudioSystem::DEVICE_IN_COMMUNICATION, AUDIO_DEVICE_IN_COMMUNICATION },
+    { AudioSystem::DEVICE_IN_AMBIENT, AUDIO_DEVICE_IN_AMBIENT },
+    { AudioSystem::DEVICE_IN_BUILTIN_MIC, AUDIO_DEVICE_IN_BUILTIN_MIC },
+    { AudioSystem::DEVICE_IN_BLUETOOTH_SCO_HEADSET, AUDIO_DEVICE_IN_BLUETOOTH_SCO_HEADSET },
+    { AudioSystem::DEVICE_IN_WIRED_HEADSET, AUDIO_DEVICE_IN_WIRED_HEADSET },
+    { AudioSystem::DEVICE_IN_AUX_DIGITAL, AUDIO_DEVICE_IN_AUX_DIGITAL },
+    { AudioSystem::DEVICE_IN_VOICE_CALL, AUDIO_DEVICE_IN_VOICE_CALL },
+    { AudioSystem::DEVICE_IN_BACK_MIC, AUDIO_DEVICE_IN_BACK_MIC },
+    { AudioSystem::DEVICE_IN_DEFAULT, AUDIO_DEVICE_IN_DEFAULT },
+};
+
+static constexpr uint32_t k_num_conv_devices =
+        sizeof(audio_device_conv_table) / sizeof(audio_device_conv_table[0]);
+
+/*
+ * audio_device_conv_table expanded into one entry per device bit, built at
+ * compile time. Entry i holds the translation of the single device (1 << i),
+ * or AUDIO_DEVICE_NONE if that bit has no counterpart. HAL_API_REV_2_0 input
+ * devices are looked up with AUDIO_DEVICE_BIT_IN stripped, so they get a
+ * table of their own.
+ */
+struct audio_device_bit_table {
+    uint32_t device[32];
+};
+
+static constexpr audio_device_bit_table make_audio_device_bit_table(int from_rev, int to_rev,
+                                                                    uint32_t in_bit)
+{
+    audio_device_bit_table table = {};
+    for (uint32_t i = 0; i < 32; i++) {
+        for (uint32_t j = 0; j < k_num_conv_devices; j++) {
+            if (audio_device_conv_table[j][from_rev] == ((1u << i) | in_bit)) {
+                table.device[i] = audio_device_conv_table[j][to_rev];
+                break;
+            }
+        }
+    }
+    return table;
+}
+
+static constexpr audio_device_bit_table k_device_bits_1_0_to_2_0 =
+        make_audio_device_bit_table(HAL_API_REV_1_0, HAL_API_REV_2_0, 0);
+static constexpr audio_device_bit_table k_device_bits_2_0_out_to_1_0 =
+        make_audio_device_bit_table(HAL_API_REV_2_0, HAL_API_REV_1_0, 0);
+static constexpr audio_device_bit_table k_device_bits_2_0_in_to_1_0 =
+        make_audio_device_bit_table(HAL_API_REV_2_0, HAL_API_REV_1_0, AUDIO_DEVICE_BIT_IN);
+
+static inline audio_devices_t convert_audio_device(uint32_t from_device, int from_rev, int to_rev)
+{
+    const audio_device_bit_table *table = &k_device_bits_1_0_to_2_0;
+    uint32_t to_device = AUDIO_DEVICE_NONE;
+
+    if (from_rev != HAL_API_REV_1_0) {
+        table = (from_device & AUDIO_DEVICE_BIT_IN) ?
+                &k_device_bits_2_0_in_to_1_0 : &k_device_bits_2_0_out_to_1_0;
+        from_device &= ~AUDIO_DEVICE_BIT_IN;
+    }
+
+    while (from_device) {
+        to_device |= table->device[__builtin_ctz(from_device)];
+        from_device &= from_device - 1;
+    }
+    return (audio_devices_t)to_device;
+}
+
+/* every row of audio_device_conv_table must survive the trip through the bit tables */
+static constexpr bool audio_device_bit_tables_match()
+{
+    for (uint32_t j = 0; j < k_num_conv_devices; j++) {
+        uint32_t legacy = audio_device_conv_table[j][HAL_API_REV_1_0];
+        uint32_t hal = audio_device_conv_table[j][HAL_API_REV_2_0];
+        bool input = (hal & AUDIO_DEVICE_BIT_IN) != 0;
+        uint32_t bit = hal & ~AUDIO_DEVICE_BIT_IN;
+
+        if (legacy == 0 || (legacy & (legacy - 1)) != 0 ||
+                bit == 0 || (bit & (bit - 1)) != 0) {
+            return false;
+        }
+        if (k_device_bits_1_0_to_2_0.device[__builtin_ctz(legacy)] != hal) {
+            return false;
+        }
+        const audio_device_bit_table& to_legacy = input ?
+                k_device_bits_2_0_in_to_1_0 : k_device_bits_2_0_out_to_1_0;
+        if (to_legacy.device[__builtin_ctz(bit)] != legacy) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(HAL_API_REV_NUM == 2, "device bit tables only cover HAL_API_REV_1_0 <-> 2_0");
+static_assert(audio_device_bit_tables_match(),
+              "device bit tables do not match audio_device_conv_table");
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_DEVICE_CONV_H
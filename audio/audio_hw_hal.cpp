@@ -17,15 +17,19 @@
 #define LOG_TAG "legacy_audio_hw_hal"
 //#define LOG_NDEBUG 0
 
+#include <pthread.h>
 #include <stdint.h>
 
 #include <hardware/hardware.h>
 #include <system/audio.h>
 #include <hardware/audio.h>
 
+#include <hardware_legacy/AudioHardwareExtension.h>
 #include <hardware_legacy/AudioHardwareInterface.h>
 #include <hardware_legacy/AudioSystemLegacy.h>
 
+#include "audio_device_conv.h"
+
 namespace android_audio_legacy {
 
 class AudioHardwareInterface;
@@ -36,87 +40,68 @@ struct legacy_audio_module {
     struct audio_module module;
 };
 
+/* a patch handed out by create_audio_patch() */
+struct legacy_patch {
+    audio_patch_handle_t handle;
+    audio_patch_handle_t hw_handle;     // device to device patch of hwif, or NONE
+    audio_io_handle_t io_handle;        // stream routed by a mix patch
+    bool output;
+    struct legacy_patch *next;
+};
+
 struct legacy_audio_device {
     struct audio_hw_device device;
 
     AudioHardwareInterface *hwif;
+    AudioHardwareExtension *hwext;      // NULL if hwif has no extension
+
+    /* open streams and patches, for AUDIO_DEVICE_API_VERSION_3_0 only */
+    pthread_mutex_t lock;
+    struct legacy_stream_out *outputs;
+    struct legacy_stream_in *inputs;
+    struct legacy_patch *patches;
+    audio_patch_handle_t next_patch_handle;
 };
 
 struct legacy_stream_out {
     struct audio_stream_out stream;
 
     AudioStreamOut *legacy_out;
+    AudioStreamOutExtension *legacy_ext;
+    audio_io_handle_t handle;
+    struct legacy_stream_out *next;
 };
 
 struct legacy_stream_in {
     struct audio_stream_in stream;
 
     AudioStreamIn *legacy_in;
+    AudioStreamInExtension *legacy_ext;
+    audio_io_handle_t handle;
+    struct legacy_stream_in *next;
 };
 
-
-enum {
-    HAL_API_REV_1_0,
-    HAL_API_REV_2_0,
-    HAL_API_REV_NUM
-} hal_api_rev;
-
-static uint32_t audio_device_conv_table[][HAL_API_REV_NUM] =
-{
-    /* output devices */
-    { AudioSystem::DEVICE_OUT_EARPIECE, AUDIO_DEVICE_OUT_EARPIECE },
-    { AudioSystem::DEVICE_OUT_SPEAKER, AUDIO_DEVICE_OUT_SPEAKER },
-    { AudioSystem::DEVICE_OUT_WIRED_HEADSET, AUDIO_DEVICE_OUT_WIRED_HEADSET },
-    { AudioSystem::DEVICE_OUT_WIRED_HEADPHONE, AUDIO_DEVICE_OUT_WIRED_HEADPHONE },
-    { AudioSystem::DEVICE_OUT_BLUETOOTH_SCO, AUDIO_DEVICE_OUT_BLUETOOTH_SCO },
-    { AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_HEADSET, AUDIO_DEVICE_OUT_BLUETOOTH_SCO_HEADSET },
-    { AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_CARKIT, AUDIO_DEVICE_OUT_BLUETOOTH_SCO_CARKIT },
-    { AudioSystem::DEVICE_OUT_BLUETOOTH_A2DP, AUDIO_DEVICE_OUT_BLUETOOTH_A2DP },
-    { AudioSystem::DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES, AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES },
-    { AudioSystem::DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER, AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER },
-    { AudioSystem::DEVICE_OUT_AUX_DIGITAL, AUDIO_DEVICE_OUT_AUX_DIGITAL },
-    { AudioSystem::DEVICE_OUT_ANLG_DOCK_HEADSET, AUDIO_DEVICE_OUT_ANLG_DOCK_HEADSET },
-    { AudioSystem::DEVICE_OUT_DGTL_DOCK_HEADSET, AUDIO_DEVICE_OUT_DGTL_DOCK_HEADSET },
-    { AudioSystem::DEVICE_OUT_DEFAULT, AUDIO_DEVICE_OUT_DEFAULT },
-    /* input devices */
-    { AudioSystem::DEVICE_IN_COMMUNICATION, AUDIO_DEVICE_IN_COMMUNICATION },
-    { AudioSystem::DEVICE_IN_AMBIENT, AUDIO_DEVICE_IN_AMBIENT },
-    { AudioSystem::DEVICE_IN_BUILTIN_MIC, AUDIO_DEVICE_IN_BUILTIN_MIC },
-    { AudioSystem::DEVICE_IN_BLUETOOTH_SCO_HEADSET, AUDIO_DEVICE_IN_BLUETOOTH_SCO_HEADSET },
-    { AudioSystem::DEVICE_IN_WIRED_HEADSET, AUDIO_DEVICE_IN_WIRED_HEADSET },
-    { AudioSystem::DEVICE_IN_AUX_DIGITAL, AUDIO_DEVICE_IN_AUX_DIGITAL },
-    { AudioSystem::DEVICE_IN_VOICE_CALL, AUDIO_DEVICE_IN_VOICE_CALL },
-    { AudioSystem::DEVICE_IN_BACK_MIC, AUDIO_DEVICE_IN_BACK_MIC },
-    { AudioSystem::DEVICE_IN_DEFAULT, AUDIO_DEVICE_IN_DEFAULT },
-};
-
-static audio_devices_t convert_audio_device(uint32_t from_device, int from_rev, int to_rev)
+/* parsed parameters go to the extension, the others get them serialized */
+static int out_set_parameter_list(struct legacy_stream_out *out, const AudioParameterList& parms)
 {
-    const uint32_t k_num_devices = sizeof(audio_device_conv_table)/sizeof(uint32_t)/HAL_API_REV_NUM;
-    audio_devices_t to_device = AUDIO_DEVICE_NONE;
-    uint32_t in_bit = 0;
+    String8 s8;
 
-    if (from_rev != HAL_API_REV_1_0) {
-        in_bit = from_device & AUDIO_DEVICE_BIT_IN;
-        from_device &= ~AUDIO_DEVICE_BIT_IN;
-    }
+    if (out->legacy_ext)
+        return out->legacy_ext->setParameterList(parms);
+    parms.toString(&s8);
+    return out->legacy_out->setParameters(s8);
+}
 
-    while (from_device) {
-        uint32_t i = 31 - __builtin_clz(from_device);
-        uint32_t cur_device = (1 << i) | in_bit;
+static int in_set_parameter_list(struct legacy_stream_in *in, const AudioParameterList& parms)
+{
+    String8 s8;
 
-        for (i = 0; i < k_num_devices; i++) {
-            if (audio_device_conv_table[i][from_rev] == cur_device) {
-                to_device = (audio_devices_t)(to_device | audio_device_conv_table[i][to_rev]);
-                break;
-            }
-        }
-        from_device &= ~cur_device;
-    }
-    return to_device;
+    if (in->legacy_ext)
+        return in->legacy_ext->setParameterList(parms);
+    parms.toString(&s8);
+    return in->legacy_in->setParameters(s8);
 }
 
-
 /** audio_stream_out implementation **/
 static uint32_t out_get_sample_rate(const struct audio_stream *stream)
 {
@@ -161,9 +146,14 @@ static int out_set_format(struct audio_stream *stream, audio_format_t format)
 {
     struct legacy_stream_out *out =
         reinterpret_cast<struct legacy_stream_out *>(stream);
-    ALOGE("(%s:%d) %s: Implement me!", __FILE__, __LINE__, __func__);
-    /* TODO: implement me */
-    return 0;
+    AudioParameterList parms;
+
+    if ((int)format == out->legacy_out->format())
+        return 0;
+
+    // legacy streams that convert sample formats accept the standard key
+    parms.addInt(AudioParameterList::KEY_FORMAT, (int)format);
+    return out_set_parameter_list(out, parms);
 }
 
 static int out_standby(struct audio_stream *stream)
@@ -186,17 +176,17 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
     struct legacy_stream_out *out =
         reinterpret_cast<struct legacy_stream_out *>(stream);
     int val;
-    String8 s8 = String8(kvpairs);
-    AudioParameter parms = AudioParameter(String8(kvpairs));
+    AudioParameterList parms;
 
-    if (parms.getInt(String8(AUDIO_PARAMETER_STREAM_ROUTING), val) == NO_ERROR) {
+    if (parms.parse(kvpairs) != NO_ERROR)
+        return out->legacy_out->setParameters(String8(kvpairs));
+
+    if (parms.getInt(AudioParameterList::KEY_ROUTING, &val) == NO_ERROR) {
         val = convert_audio_device(val, HAL_API_REV_2_0, HAL_API_REV_1_0);
-        parms.remove(String8(AUDIO_PARAMETER_STREAM_ROUTING));
-        parms.addInt(String8(AUDIO_PARAMETER_STREAM_ROUTING), val);
-        s8 = parms.toString();
+        parms.addInt(AudioParameterList::KEY_ROUTING, val);
     }
 
-    return out->legacy_out->setParameters(s8);
+    return out_set_parameter_list(out, parms);
 }
 
 static char * out_get_parameters(const struct audio_stream *stream, const char *keys)
@@ -206,14 +196,15 @@ static char * out_get_parameters(const struct audio_stream *stream, const char *
     String8 s8;
     int val;
 
+    AudioParameterList parms;
+
     s8 = out->legacy_out->getParameters(String8(keys));
 
-    AudioParameter parms = AudioParameter(s8);
-    if (parms.getInt(String8(AUDIO_PARAMETER_STREAM_ROUTING), val) == NO_ERROR) {
+    if (parms.parse(s8.string()) == NO_ERROR &&
+            parms.getInt(AudioParameterList::KEY_ROUTING, &val) == NO_ERROR) {
         val = convert_audio_device(val, HAL_API_REV_1_0, HAL_API_REV_2_0);
-        parms.remove(String8(AUDIO_PARAMETER_STREAM_ROUTING));
-        parms.addInt(String8(AUDIO_PARAMETER_STREAM_ROUTING), val);
-        s8 = parms.toString();
+        parms.addInt(AudioParameterList::KEY_ROUTING, val);
+        parms.toString(&s8);
     }
 
     return strdup(s8.string());
@@ -260,12 +251,65 @@ static int out_get_next_write_timestamp(const struct audio_stream_out *stream,
 
 static int out_add_audio_effect(const struct audio_stream *stream, effect_handle_t effect)
 {
-    return 0;
+    const struct legacy_stream_out *out =
+        reinterpret_cast<const struct legacy_stream_out *>(stream);
+    if (!out->legacy_ext)
+        return 0;
+    return out->legacy_ext->addAudioEffect(effect);
 }
 
 static int out_remove_audio_effect(const struct audio_stream *stream, effect_handle_t effect)
 {
-    return 0;
+    const struct legacy_stream_out *out =
+        reinterpret_cast<const struct legacy_stream_out *>(stream);
+    if (!out->legacy_ext)
+        return 0;
+    return out->legacy_ext->removeAudioEffect(effect);
+}
+
+static int out_get_presentation_position(const struct audio_stream_out *stream,
+                                         uint64_t *frames, struct timespec *timestamp)
+{
+    const struct legacy_stream_out *out =
+        reinterpret_cast<const struct legacy_stream_out *>(stream);
+    return out->legacy_out->getPresentationPosition(frames, timestamp);
+}
+
+/** compressed offload outputs only **/
+static int out_set_callback(struct audio_stream_out *stream, stream_callback_t callback,
+                            void *cookie)
+{
+    struct legacy_stream_out *out =
+        reinterpret_cast<struct legacy_stream_out *>(stream);
+    return out->legacy_ext->setCallback(callback, cookie);
+}
+
+static int out_pause(struct audio_stream_out *stream)
+{
+    struct legacy_stream_out *out =
+        reinterpret_cast<struct legacy_stream_out *>(stream);
+    return out->legacy_ext->pause();
+}
+
+static int out_resume(struct audio_stream_out *stream)
+{
+    struct legacy_stream_out *out =
+        reinterpret_cast<struct legacy_stream_out *>(stream);
+    return out->legacy_ext->resume();
+}
+
+static int out_drain(struct audio_stream_out *stream, audio_drain_type_t type)
+{
+    struct legacy_stream_out *out =
+        reinterpret_cast<struct legacy_stream_out *>(stream);
+    return out->legacy_ext->drain(type);
+}
+
+static int out_flush(struct audio_stream_out *stream)
+{
+    struct legacy_stream_out *out =
+        reinterpret_cast<struct legacy_stream_out *>(stream);
+    return out->legacy_ext->flush();
 }
 
 /** audio_stream_in implementation **/
@@ -312,9 +356,14 @@ static int in_set_format(struct audio_stream *stream, audio_format_t format)
 {
     struct legacy_stream_in *in =
         reinterpret_cast<struct legacy_stream_in *>(stream);
-    ALOGE("(%s:%d) %s: Implement me!", __FILE__, __LINE__, __func__);
-    /* TODO: implement me */
-    return 0;
+    AudioParameterList parms;
+
+    if ((int)format == in->legacy_in->format())
+        return 0;
+
+    // legacy streams that convert sample formats accept the standard key
+    parms.addInt(AudioParameterList::KEY_FORMAT, (int)format);
+    return in_set_parameter_list(in, parms);
 }
 
 static int in_standby(struct audio_stream *stream)
@@ -336,17 +385,17 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
     struct legacy_stream_in *in =
         reinterpret_cast<struct legacy_stream_in *>(stream);
     int val;
-    AudioParameter parms = AudioParameter(String8(kvpairs));
-    String8 s8 = String8(kvpairs);
+    AudioParameterList parms;
+
+    if (parms.parse(kvpairs) != NO_ERROR)
+        return in->legacy_in->setParameters(String8(kvpairs));
 
-    if (parms.getInt(String8(AUDIO_PARAMETER_STREAM_ROUTING), val) == NO_ERROR) {
+    if (parms.getInt(AudioParameterList::KEY_ROUTING, &val) == NO_ERROR) {
         val = convert_audio_device(val, HAL_API_REV_2_0, HAL_API_REV_1_0);
-        parms.remove(String8(AUDIO_PARAMETER_STREAM_ROUTING));
-        parms.addInt(String8(AUDIO_PARAMETER_STREAM_ROUTING), val);
-        s8 = parms.toString();
+        parms.addInt(AudioParameterList::KEY_ROUTING, val);
     }
 
-    return in->legacy_in->setParameters(s8);
+    return in_set_parameter_list(in, parms);
 }
 
 static char * in_get_parameters(const struct audio_stream *stream,
@@ -357,14 +406,15 @@ static char * in_get_parameters(const struct audio_stream *stream,
     String8 s8;
     int val;
 
+    AudioParameterList parms;
+
     s8 = in->legacy_in->getParameters(String8(keys));
 
-    AudioParameter parms = AudioParameter(s8);
-    if (parms.getInt(String8(AUDIO_PARAMETER_STREAM_ROUTING), val) == NO_ERROR) {
+    if (parms.parse(s8.string()) == NO_ERROR &&
+            parms.getInt(AudioParameterList::KEY_ROUTING, &val) == NO_ERROR) {
         val = convert_audio_device(val, HAL_API_REV_1_0, HAL_API_REV_2_0);
-        parms.remove(String8(AUDIO_PARAMETER_STREAM_ROUTING));
-        parms.addInt(String8(AUDIO_PARAMETER_STREAM_ROUTING), val);
-        s8 = parms.toString();
+        parms.addInt(AudioParameterList::KEY_ROUTING, val);
+        parms.toString(&s8);
     }
 
     return strdup(s8.string());
@@ -464,7 +514,11 @@ static int adev_get_mic_mute(const struct audio_hw_device *dev, bool *state)
 static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
 {
     struct legacy_audio_device *ladev = to_ladev(dev);
-    return ladev->hwif->setParameters(String8(kvpairs));
+    AudioParameterList parms;
+
+    if (!ladev->hwext || parms.parse(kvpairs) != NO_ERROR)
+        return ladev->hwif->setParameters(String8(kvpairs));
+    return ladev->hwext->setParameterList(parms);
 }
 
 static char * adev_get_parameters(const struct audio_hw_device *dev,
@@ -498,6 +552,10 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     struct legacy_stream_out *out;
     int ret;
 
+    if ((flags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) &&
+            (!ladev->hwext || !ladev->hwext->supportsOffload()))
+        return -EINVAL;
+
     out = (struct legacy_stream_out *)calloc(1, sizeof(*out));
     if (!out)
         return -ENOMEM;
@@ -514,6 +572,13 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
         goto err_open;
     }
     config->channel_mask = (audio_channel_mask_t)raw_channel_mask;
+    out->legacy_ext = AudioStreamOutExtension::query(out->legacy_out);
+    if ((flags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) && !out->legacy_ext) {
+        ladev->hwif->closeOutputStream(out->legacy_out);
+        ret = -EINVAL;
+        goto err_open;
+    }
+    out->handle = handle;
 
     out->stream.common.get_sample_rate = out_get_sample_rate;
     out->stream.common.set_sample_rate = out_set_sample_rate;
@@ -532,6 +597,19 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     out->stream.write = out_write;
     out->stream.get_render_position = out_get_render_position;
     out->stream.get_next_write_timestamp = out_get_next_write_timestamp;
+    out->stream.get_presentation_position = out_get_presentation_position;
+    if (flags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) {
+        out->stream.set_callback = out_set_callback;
+        out->stream.pause = out_pause;
+        out->stream.resume = out_resume;
+        out->stream.drain = out_drain;
+        out->stream.flush = out_flush;
+    }
+
+    pthread_mutex_lock(&ladev->lock);
+    out->next = ladev->outputs;
+    ladev->outputs = out;
+    pthread_mutex_unlock(&ladev->lock);
 
     *stream_out = &out->stream;
     return 0;
@@ -547,6 +625,16 @@ static void adev_close_output_stream(struct audio_hw_device *dev,
 {
     struct legacy_audio_device *ladev = to_ladev(dev);
     struct legacy_stream_out *out = reinterpret_cast<struct legacy_stream_out *>(stream);
+    struct legacy_stream_out **prev;
+
+    pthread_mutex_lock(&ladev->lock);
+    for (prev = &ladev->outputs; *prev; prev = &(*prev)->next) {
+        if (*prev == out) {
+            *prev = out->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ladev->lock);
 
     ladev->hwif->closeOutputStream(out->legacy_out);
     free(out);
@@ -582,6 +670,8 @@ static int adev_open_input_stream(struct audio_hw_device *dev,
         goto err_open;
     }
     config->channel_mask = (audio_channel_mask_t)raw_channel_mask;
+    in->legacy_ext = AudioStreamInExtension::query(in->legacy_in);
+    in->handle = handle;
 
     in->stream.common.get_sample_rate = in_get_sample_rate;
     in->stream.common.set_sample_rate = in_set_sample_rate;
@@ -599,6 +689,11 @@ static int adev_open_input_stream(struct audio_hw_device *dev,
     in->stream.read = in_read;
     in->stream.get_input_frames_lost = in_get_input_frames_lost;
 
+    pthread_mutex_lock(&ladev->lock);
+    in->next = ladev->inputs;
+    ladev->inputs = in;
+    pthread_mutex_unlock(&ladev->lock);
+
     *stream_in = &in->stream;
     return 0;
 
@@ -614,6 +709,16 @@ static void adev_close_input_stream(struct audio_hw_device *dev,
     struct legacy_audio_device *ladev = to_ladev(dev);
     struct legacy_stream_in *in =
         reinterpret_cast<struct legacy_stream_in *>(stream);
+    struct legacy_stream_in **prev;
+
+    pthread_mutex_lock(&ladev->lock);
+    for (prev = &ladev->inputs; *prev; prev = &(*prev)->next) {
+        if (*prev == in) {
+            *prev = in->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ladev->lock);
 
     ladev->hwif->closeInputStream(in->legacy_in);
     free(in);
@@ -627,6 +732,197 @@ static int adev_dump(const struct audio_hw_device *dev, int fd)
     return ladev->hwif->dumpState(fd, args);
 }
 
+/* the legacy interface takes devices in the HAL_API_REV_1_0 encoding */
+static void convert_port_configs(unsigned int num_configs,
+                                 const struct audio_port_config *configs,
+                                 struct audio_port_config *legacy_configs)
+{
+    for (unsigned int i = 0; i < num_configs; i++) {
+        legacy_configs[i] = configs[i];
+        if (configs[i].type == AUDIO_PORT_TYPE_DEVICE) {
+            legacy_configs[i].ext.device.type = (audio_devices_t)
+                    convert_audio_device(configs[i].ext.device.type,
+                                         HAL_API_REV_2_0, HAL_API_REV_1_0);
+        }
+    }
+}
+
+/*
+ * With AUDIO_DEVICE_API_VERSION_3_0 the framework routes streams with mix
+ * patches instead of the routing parameter. The legacy interface only patches
+ * devices to devices, so mix patches are turned into the routing and input
+ * source parameters the framework sets on older devices.
+ */
+static int route_stream_l(struct legacy_audio_device *ladev, audio_io_handle_t io_handle,
+                          bool output, audio_devices_t devices, audio_source_t source)
+{
+    AudioParameterList parms;
+
+    parms.addInt(AudioParameterList::KEY_ROUTING,
+                 (int)convert_audio_device(devices, HAL_API_REV_2_0, HAL_API_REV_1_0));
+    if (output) {
+        for (struct legacy_stream_out *out = ladev->outputs; out; out = out->next) {
+            if (out->handle == io_handle)
+                return out_set_parameter_list(out, parms);
+        }
+    } else {
+        if (source != ::AUDIO_SOURCE_DEFAULT)
+            parms.addInt(AudioParameterList::KEY_INPUT_SOURCE, (int)source);
+        for (struct legacy_stream_in *in = ladev->inputs; in; in = in->next) {
+            if (in->handle == io_handle)
+                return in_set_parameter_list(in, parms);
+        }
+    }
+    return -EINVAL;
+}
+
+/* undoes what create_audio_patch() did for patch, which stays listed */
+static void release_patch_l(struct legacy_audio_device *ladev, struct legacy_patch *patch)
+{
+    if (patch->hw_handle != AUDIO_PATCH_HANDLE_NONE) {
+        ladev->hwif->releaseAudioPatch(patch->hw_handle);
+        patch->hw_handle = AUDIO_PATCH_HANDLE_NONE;
+    } else if (patch->io_handle != AUDIO_IO_HANDLE_NONE) {
+        // the stream may be closed already
+        route_stream_l(ladev, patch->io_handle, patch->output, AUDIO_DEVICE_NONE,
+                       ::AUDIO_SOURCE_DEFAULT);
+        patch->io_handle = AUDIO_IO_HANDLE_NONE;
+    }
+}
+
+static int create_patch_l(struct legacy_audio_device *ladev, struct legacy_patch *patch,
+                          unsigned int num_sources, const struct audio_port_config *sources,
+                          unsigned int num_sinks, const struct audio_port_config *sinks)
+{
+    struct audio_port_config legacy_sources[AUDIO_PATCH_PORTS_MAX];
+    struct audio_port_config legacy_sinks[AUDIO_PATCH_PORTS_MAX];
+    audio_devices_t devices = AUDIO_DEVICE_NONE;
+    int ret;
+
+    if (sources[0].type == AUDIO_PORT_TYPE_MIX) {
+        /* playback: the output mix to its devices */
+        for (unsigned int i = 0; i < num_sinks; i++) {
+            if (sinks[i].type != AUDIO_PORT_TYPE_DEVICE)
+                return -EINVAL;
+            devices = (audio_devices_t)(devices | sinks[i].ext.device.type);
+        }
+        ret = route_stream_l(ladev, sources[0].ext.mix.handle, true, devices,
+                             ::AUDIO_SOURCE_DEFAULT);
+        if (ret == 0) {
+            patch->io_handle = sources[0].ext.mix.handle;
+            patch->output = true;
+        }
+        return ret;
+    }
+
+    if (sinks[0].type == AUDIO_PORT_TYPE_MIX) {
+        /* capture: a device to the input mix */
+        if (num_sinks != 1 || sources[0].type != AUDIO_PORT_TYPE_DEVICE)
+            return -EINVAL;
+        ret = route_stream_l(ladev, sinks[0].ext.mix.handle, false, sources[0].ext.device.type,
+                             sinks[0].ext.mix.usecase.source);
+        if (ret == 0) {
+            patch->io_handle = sinks[0].ext.mix.handle;
+            patch->output = false;
+        }
+        return ret;
+    }
+
+    convert_port_configs(num_sources, sources, legacy_sources);
+    convert_port_configs(num_sinks, sinks, legacy_sinks);
+    return ladev->hwif->createAudioPatch(num_sources, legacy_sources,
+                                         num_sinks, legacy_sinks, &patch->hw_handle);
+}
+
+static int adev_create_audio_patch(struct audio_hw_device *dev,
+                                   unsigned int num_sources,
+                                   const struct audio_port_config *sources,
+                                   unsigned int num_sinks,
+                                   const struct audio_port_config *sinks,
+                                   audio_patch_handle_t *handle)
+{
+    struct legacy_audio_device *ladev = to_ladev(dev);
+    struct legacy_patch *patch;
+    int ret;
+
+    if (num_sources != 1 || num_sinks == 0 || num_sinks > AUDIO_PATCH_PORTS_MAX)
+        return -EINVAL;
+
+    pthread_mutex_lock(&ladev->lock);
+    if (*handle != AUDIO_PATCH_HANDLE_NONE) {
+        /* an update replaces what the patch connected */
+        for (patch = ladev->patches; patch; patch = patch->next) {
+            if (patch->handle == *handle)
+                break;
+        }
+        if (!patch) {
+            pthread_mutex_unlock(&ladev->lock);
+            return -EINVAL;
+        }
+        release_patch_l(ladev, patch);
+    } else {
+        patch = (struct legacy_patch *)calloc(1, sizeof(*patch));
+        if (!patch) {
+            pthread_mutex_unlock(&ladev->lock);
+            return -ENOMEM;
+        }
+    }
+
+    ret = create_patch_l(ladev, patch, num_sources, sources, num_sinks, sinks);
+    if (ret == 0 && *handle == AUDIO_PATCH_HANDLE_NONE) {
+        if (ladev->next_patch_handle == AUDIO_PATCH_HANDLE_NONE)
+            ladev->next_patch_handle++;
+        patch->handle = ladev->next_patch_handle++;
+        patch->next = ladev->patches;
+        ladev->patches = patch;
+        *handle = patch->handle;
+    } else if (ret != 0 && *handle == AUDIO_PATCH_HANDLE_NONE) {
+        free(patch);
+    }
+    ALOGV("%s: patch %d: %d", __func__, *handle, ret);
+    pthread_mutex_unlock(&ladev->lock);
+    return ret;
+}
+
+static int adev_release_audio_patch(struct audio_hw_device *dev,
+                                    audio_patch_handle_t handle)
+{
+    struct legacy_audio_device *ladev = to_ladev(dev);
+    struct legacy_patch **prev;
+
+    pthread_mutex_lock(&ladev->lock);
+    for (prev = &ladev->patches; *prev; prev = &(*prev)->next) {
+        struct legacy_patch *patch = *prev;
+
+        if (patch->handle == handle) {
+            release_patch_l(ladev, patch);
+            *prev = patch->next;
+            pthread_mutex_unlock(&ladev->lock);
+            free(patch);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&ladev->lock);
+    return -EINVAL;
+}
+
+static int adev_get_audio_port(struct audio_hw_device *dev,
+                               struct audio_port *port)
+{
+    struct legacy_audio_device *ladev = to_ladev(dev);
+    return ladev->hwif->getAudioPort(port);
+}
+
+static int adev_set_audio_port_config(struct audio_hw_device *dev,
+                                      const struct audio_port_config *config)
+{
+    struct legacy_audio_device *ladev = to_ladev(dev);
+    struct audio_port_config legacy_config;
+
+    convert_port_configs(1, config, &legacy_config);
+    return ladev->hwif->setAudioPortConfig(&legacy_config);
+}
+
 static int legacy_adev_close(hw_device_t* device)
 {
     struct audio_hw_device *hwdev =
@@ -636,9 +932,17 @@ static int legacy_adev_close(hw_device_t* device)
     if (!ladev)
         return 0;
 
+    while (ladev->patches) {
+        struct legacy_patch *patch = ladev->patches;
+
+        ladev->patches = patch->next;
+        free(patch);
+    }
+
     if (ladev->hwif)
         delete ladev->hwif;
 
+    pthread_mutex_destroy(&ladev->lock);
     free(ladev);
     return 0;
 }
@@ -676,18 +980,30 @@ static int legacy_adev_open(const hw_module_t* module, const char* name,
     ladev->device.open_input_stream = adev_open_input_stream;
     ladev->device.close_input_stream = adev_close_input_stream;
     ladev->device.dump = adev_dump;
+    pthread_mutex_init(&ladev->lock, NULL);
 
     ladev->hwif = createAudioHardware();
     if (!ladev->hwif) {
         ret = -EIO;
         goto err_create_audio_hw;
     }
+    ladev->hwext = AudioHardwareExtension::query(ladev->hwif);
+
+    /* patches need a legacy device that connects devices itself */
+    if (ladev->hwext && ladev->hwext->supportsAudioPatches()) {
+        ladev->device.common.version = AUDIO_DEVICE_API_VERSION_3_0;
+        ladev->device.create_audio_patch = adev_create_audio_patch;
+        ladev->device.release_audio_patch = adev_release_audio_patch;
+        ladev->device.get_audio_port = adev_get_audio_port;
+        ladev->device.set_audio_port_config = adev_set_audio_port_config;
+    }
 
     *device = &ladev->device.common;
 
     return 0;
 
 err_create_audio_hw:
+    pthread_mutex_destroy(&ladev->lock);
     free(ladev);
     return ret;
 }
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "audio_device_conv.h"
+
+using namespace android_audio_legacy;
+
+// the per bit linear scan convert_audio_device() used before the bit tables
+static audio_devices_t convert_audio_device_scan(uint32_t from_device, int from_rev, int to_rev)
+{
+    audio_devices_t to_device = AUDIO_DEVICE_NONE;
+    uint32_t in_bit = 0;
+
+    if (from_rev != HAL_API_REV_1_0) {
+        in_bit = from_device & AUDIO_DEVICE_BIT_IN;
+        from_device &= ~AUDIO_DEVICE_BIT_IN;
+    }
+
+    while (from_device) {
+        uint32_t i = 31 - __builtin_clz(from_device);
+        uint32_t cur_device = (1 << i) | in_bit;
+
+        for (i = 0; i < k_num_conv_devices; i++) {
+            if (audio_device_conv_table[i][from_rev] == cur_device) {
+                to_device = (audio_devices_t)(to_device | audio_device_conv_table[i][to_rev]);
+                break;
+            }
+        }
+        from_device &= ~cur_device;
+    }
+    return to_device;
+}
+
+// every combination of the devices of one direction of audio_device_conv_table
+static std::vector<uint32_t> allMasks(int rev, bool input)
+{
+    std::vector<uint32_t> devices;
+    for (uint32_t j = 0; j < k_num_conv_devices; j++) {
+        uint32_t hal = audio_device_conv_table[j][HAL_API_REV_2_0];
+        if (((hal & AUDIO_DEVICE_BIT_IN) != 0) == input) {
+            devices.push_back(audio_device_conv_table[j][rev]);
+        }
+    }
+    std::vector<uint32_t> masks;
+    for (uint32_t combo = 1; combo < (1u << devices.size()); combo++) {
+        uint32_t mask = 0;
+        for (size_t k = 0; k < devices.size(); k++) {
+            if (combo & (1u << k)) {
+                mask |= devices[k];
+            }
+        }
+        masks.push_back(mask);
+    }
+    return masks;
+}
+
+template <audio_devices_t (*CONVERT)(uint32_t, int, int), int FROM, int TO, bool INPUT>
+static void BM_convert(benchmark::State& state)
+{
+    const std::vector<uint32_t> masks = allMasks(FROM, INPUT);
+    for (auto _ : state) {
+        for (uint32_t mask : masks) {
+            benchmark::DoNotOptimize(CONVERT(mask, FROM, TO));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * masks.size());
+}
+
+static void BM_table_out_1_0_to_2_0(benchmark::State& state) {
+    BM_convert<convert_audio_device, HAL_API_REV_1_0, HAL_API_REV_2_0, false>(state);
+}
+static void BM_table_in_1_0_to_2_0(benchmark::State& state) {
+    BM_convert<convert_audio_device, HAL_API_REV_1_0, HAL_API_REV_2_0, true>(state);
+}
+static void BM_table_out_2_0_to_1_0(benchmark::State& state) {
+    BM_convert<convert_audio_device, HAL_API_REV_2_0, HAL_API_REV_1_0, false>(state);
+}
+static void BM_table_in_2_0_to_1_0(benchmark::State& state) {
+    BM_convert<convert_audio_device, HAL_API_REV_2_0, HAL_API_REV_1_0, true>(state);
+}
+static void BM_scan_out_1_0_to_2_0(benchmark::State& state) {
+    BM_convert<convert_audio_device_scan, HAL_API_REV_1_0, HAL_API_REV_2_0, false>(state);
+}
+static void BM_scan_in_1_0_to_2_0(benchmark::State& state) {
+    BM_convert<convert_audio_device_scan, HAL_API_REV_1_0, HAL_API_REV_2_0, true>(state);
+}
+static void BM_scan_out_2_0_to_1_0(benchmark::State& state) {
+    BM_convert<convert_audio_device_scan, HAL_API_REV_2_0, HAL_API_REV_1_0, false>(state);
+}
+static void BM_scan_in_2_0_to_1_0(benchmark::State& state) {
+    BM_convert<convert_audio_device_scan, HAL_API_REV_2_0, HAL_API_REV_1_0, true>(state);
+}
+
+// the tables must give the same answer as the scan for every mask
+static void BM_check_all_masks(benchmark::State& state)
+{
+    static const struct { int from; int to; bool input; } kCases[] = {
+        { HAL_API_REV_1_0, HAL_API_REV_2_0, false },
+        { HAL_API_REV_1_0, HAL_API_REV_2_0, true },
+        { HAL_API_REV_2_0, HAL_API_REV_1_0, false },
+        { HAL_API_REV_2_0, HAL_API_REV_1_0, true },
+    };
+    for (auto _ : state) {
+        for (const auto& c : kCases) {
+            for (uint32_t mask : allMasks(c.from, c.input)) {
+                if (convert_audio_device(mask, c.from, c.to) !=
+                        convert_audio_device_scan(mask, c.from, c.to)) {
+                    state.SkipWithError("bit table and linear scan disagree");
+                    return;
+                }
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_table_out_1_0_to_2_0);
+BENCHMARK(BM_table_in_1_0_to_2_0);
+BENCHMARK(BM_table_out_2_0_to_1_0);
+BENCHMARK(BM_table_in_2_0_to_1_0);
+BENCHMARK(BM_scan_out_1_0_to_2_0);
+BENCHMARK(BM_scan_in_1_0_to_2_0);
+BENCHMARK(BM_scan_out_2_0_to_1_0);
+BENCHMARK(BM_scan_in_2_0_to_1_0);
+BENCHMARK(BM_check_all_masks);
+
+BENCHMARK_MAIN();
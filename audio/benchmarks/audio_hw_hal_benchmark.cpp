@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the legacy_audio_device shim in audio_hw_hal.cpp, linked over
+// AudioHardwareStub with its virtual clock so that nothing waits for a device.
+// Items per second is periods (or calls) per second; allocs_per_call counts
+// malloc/calloc/realloc calls made by the shim and the legacy HAL below it.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#include <benchmark/benchmark.h>
+
+#include <hardware/hardware.h>
+#include <hardware/audio.h>
+#include <system/audio.h>
+
+extern "C" struct audio_module HAL_MODULE_INFO_SYM;
+
+static std::atomic<uint64_t> sAllocations(0);
+
+#if defined(__GLIBC__)
+static const bool sCountingAllocations = true;
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+#else
+static const bool sCountingAllocations = false;
+#endif
+
+static const size_t kPeriodFrames = 1024;
+
+static audio_hw_device_t *openDevice()
+{
+    hw_device_t *device = NULL;
+    const hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+    if (module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device) != 0) {
+        return NULL;
+    }
+    audio_hw_device_t *dev = reinterpret_cast<audio_hw_device_t *>(device);
+    dev->set_parameters(dev, "stub_virtual_clock=1");
+    return dev;
+}
+
+static void closeDevice(audio_hw_device_t *dev)
+{
+    dev->common.close(&dev->common);
+}
+
+static audio_stream_out_t *openOutput(audio_hw_device_t *dev)
+{
+    struct audio_config config;
+    memset(&config, 0, sizeof(config));
+    audio_stream_out_t *out = NULL;
+    if (dev->open_output_stream(dev, 0, AUDIO_DEVICE_OUT_SPEAKER, AUDIO_OUTPUT_FLAG_NONE,
+                                &config, &out, "") != 0) {
+        return NULL;
+    }
+    return out;
+}
+
+static audio_stream_in_t *openInput(audio_hw_device_t *dev)
+{
+    struct audio_config config;
+    memset(&config, 0, sizeof(config));
+    audio_stream_in_t *in = NULL;
+    if (dev->open_input_stream(dev, 0, AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &in,
+                               AUDIO_INPUT_FLAG_NONE, "", AUDIO_SOURCE_MIC) != 0) {
+        return NULL;
+    }
+    return in;
+}
+
+// sets the counters common to all benchmarks from the allocations made since start
+static void report(benchmark::State& state, uint64_t start)
+{
+    state.SetItemsProcessed(state.iterations());
+    if (sCountingAllocations) {
+        state.counters["allocs_per_call"] =
+                (double)(sAllocations.load() - start) / state.iterations();
+    } else {
+        state.SetLabel("allocation counting needs glibc");
+    }
+}
+
+static void BM_out_write(benchmark::State& state)
+{
+    audio_hw_device_t *dev = openDevice();
+    audio_stream_out_t *out = dev != NULL ? openOutput(dev) : NULL;
+    if (out == NULL) {
+        state.SkipWithError("cannot open output");
+        return;
+    }
+    size_t bytes = kPeriodFrames * audio_bytes_per_sample(out->common.get_format(&out->common)) *
+            audio_channel_count_from_out_mask(out->common.get_channels(&out->common));
+    void *buffer = calloc(1, bytes);
+
+    uint64_t start = sAllocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(out->write(out, buffer, bytes));
+    }
+    report(state, start);
+    state.SetBytesProcessed(state.iterations() * bytes);
+
+    free(buffer);
+    dev->close_output_stream(dev, out);
+    closeDevice(dev);
+}
+
+static void BM_in_read(benchmark::State& state)
+{
+    audio_hw_device_t *dev = openDevice();
+    audio_stream_in_t *in = dev != NULL ? openInput(dev) : NULL;
+    if (in == NULL) {
+        state.SkipWithError("cannot open input");
+        return;
+    }
+    size_t bytes = in->common.get_buffer_size(&in->common);
+    void *buffer = calloc(1, bytes);
+
+    uint64_t start = sAllocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(in->read(in, buffer, bytes));
+    }
+    report(state, start);
+    state.SetBytesProcessed(state.iterations() * bytes);
+
+    free(buffer);
+    dev->close_input_stream(dev, in);
+    closeDevice(dev);
+}
+
+static void BM_out_set_parameters_routing(benchmark::State& state)
+{
+    audio_hw_device_t *dev = openDevice();
+    audio_stream_out_t *out = dev != NULL ? openOutput(dev) : NULL;
+    if (out == NULL) {
+        state.SkipWithError("cannot open output");
+        return;
+    }
+    static const char * const kRoutes[] = { "routing=2", "routing=1" };
+    size_t i = 0;
+
+    uint64_t start = sAllocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(out->common.set_parameters(&out->common, kRoutes[i++ & 1]));
+    }
+    report(state, start);
+
+    dev->close_output_stream(dev, out);
+    closeDevice(dev);
+}
+
+static void BM_out_get_parameters_routing(benchmark::State& state)
+{
+    audio_hw_device_t *dev = openDevice();
+    audio_stream_out_t *out = dev != NULL ? openOutput(dev) : NULL;
+    if (out == NULL) {
+        state.SkipWithError("cannot open output");
+        return;
+    }
+
+    uint64_t start = sAllocations.load();
+    for (auto _ : state) {
+        char *reply = out->common.get_parameters(&out->common, "routing");
+        benchmark::DoNotOptimize(reply);
+        free(reply);
+    }
+    report(state, start);
+
+    dev->close_output_stream(dev, out);
+    closeDevice(dev);
+}
+
+static void BM_in_set_parameters_routing(benchmark::State& state)
+{
+    audio_hw_device_t *dev = openDevice();
+    audio_stream_in_t *in = dev != NULL ? openInput(dev) : NULL;
+    if (in == NULL) {
+        state.SkipWithError("cannot open input");
+        return;
+    }
+    static const char * const kRoutes[] = { "routing=-2147483644", "routing=-2147483520" };
+    size_t i = 0;
+
+    uint64_t start = sAllocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(in->common.set_parameters(&in->common, kRoutes[i++ & 1]));
+    }
+    report(state, start);
+
+    dev->close_input_stream(dev, in);
+    closeDevice(dev);
+}
+
+static void BM_adev_set_parameters(benchmark::State& state)
+{
+    audio_hw_device_t *dev = openDevice();
+    if (dev == NULL) {
+        state.SkipWithError("cannot open device");
+        return;
+    }
+
+    uint64_t start = sAllocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dev->set_parameters(dev, "screen_state=on"));
+    }
+    report(state, start);
+
+    closeDevice(dev);
+}
+
+static void BM_open_close_output(benchmark::State& state)
+{
+    audio_hw_device_t *dev = openDevice();
+    if (dev == NULL) {
+        state.SkipWithError("cannot open device");
+        return;
+    }
+
+    uint64_t start = sAllocations.load();
+    for (auto _ : state) {
+        audio_stream_out_t *out = openOutput(dev);
+        if (out == NULL) {
+            state.SkipWithError("cannot open output");
+            break;
+        }
+        dev->close_output_stream(dev, out);
+    }
+    report(state, start);
+
+    closeDevice(dev);
+}
+
+static void BM_open_close_input(benchmark::State& state)
+{
+    audio_hw_device_t *dev = openDevice();
+    if (dev == NULL) {
+        state.SkipWithError("cannot open device");
+        return;
+    }
+
+    uint64_t start = sAllocations.load();
+    for (auto _ : state) {
+        audio_stream_in_t *in = openInput(dev);
+        if (in == NULL) {
+            state.SkipWithError("cannot open input");
+            break;
+        }
+        dev->close_input_stream(dev, in);
+    }
+    report(state, start);
+
+    closeDevice(dev);
+}
+
+BENCHMARK(BM_out_write);
+BENCHMARK(BM_in_read);
+BENCHMARK(BM_out_set_parameters_routing);
+BENCHMARK(BM_out_get_parameters_routing);
+BENCHMARK(BM_in_set_parameters_routing);
+BENCHMARK(BM_adev_set_parameters);
+BENCHMARK(BM_open_close_output);
+BENCHMARK(BM_open_close_input);
+
+BENCHMARK_MAIN();
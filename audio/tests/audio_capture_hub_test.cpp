@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "AudioCaptureHub.h"
+
+namespace android_audio_legacy {
+
+static const uint32_t kSampleRate = 8000;
+
+// a capture device fed from a pipe with 32 bit frames counting up from 0
+class AudioCaptureHubTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        ASSERT_EQ(0, pipe(mFds));
+        mHub = new AudioCaptureHub(mFds[0], sizeof(uint32_t), kSampleRate, NULL);
+        ASSERT_EQ(NO_ERROR, mHub->start());
+    }
+
+    virtual void TearDown() {
+        if (mProducer.joinable()) {
+            mProducer.join();
+        }
+        // end of file wakes up the reader thread if it waits for the device
+        close(mFds[1]);
+        mHub->stop();
+        close(mFds[0]);
+    }
+
+    // writes frames in chunks of the given size, pausing after each so that
+    // the hub sees short reads
+    void produce(uint32_t frames, size_t chunk, useconds_t pauseUs) {
+        mProducer = std::thread([=] {
+            std::vector<uint32_t> data(frames);
+            for (uint32_t i = 0; i < frames; i++) {
+                data[i] = i;
+            }
+            const uint8_t *bytes = (const uint8_t *)data.data();
+            size_t size = frames * sizeof(uint32_t);
+            for (size_t done = 0; done < size; ) {
+                size_t count = size - done < chunk ? size - done : chunk;
+                ssize_t written = write(mFds[1], bytes + done, count);
+                if (written <= 0) {
+                    break;
+                }
+                done += written;
+                if (pauseUs != 0) {
+                    usleep(pauseUs);
+                }
+            }
+        });
+    }
+
+    int mFds[2];
+    sp<AudioCaptureHub> mHub;
+    std::thread mProducer;
+};
+
+TEST_F(AudioCaptureHubTest, ShortReadsKeepPartialFrames) {
+    uint64_t position = mHub->attach();
+    EXPECT_EQ(0u, position);
+    // 6 byte writes end every other device read half way through a frame
+    produce(500, 6, 200);
+
+    std::vector<uint32_t> buffer(500);
+    uint64_t lost = 0;
+    size_t done = 0;
+    while (done < buffer.size()) {
+        ssize_t frames = mHub->read(&position, &buffer[done], buffer.size() - done, &lost);
+        ASSERT_GT(frames, 0);
+        done += frames;
+    }
+    EXPECT_EQ(0u, lost);
+    EXPECT_EQ(500u, position);
+    for (uint32_t i = 0; i < buffer.size(); i++) {
+        ASSERT_EQ(i, buffer[i]) << "frame " << i;
+    }
+    mHub->detach();
+}
+
+TEST_F(AudioCaptureHubTest, StreamsShareCapture) {
+    uint64_t first = mHub->attach();
+    uint64_t second = mHub->attach();
+    produce(1000, 1000, 1000);
+
+    std::vector<uint32_t> a(1000), b(1000);
+    uint64_t lost = 0;
+    for (size_t done = 0; done < a.size(); ) {
+        ssize_t frames = mHub->read(&first, &a[done], a.size() - done, &lost);
+        ASSERT_GT(frames, 0);
+        done += frames;
+    }
+    for (size_t done = 0; done < b.size(); ) {
+        ssize_t frames = mHub->read(&second, &b[done], 100, &lost);
+        ASSERT_GT(frames, 0);
+        done += frames;
+    }
+    EXPECT_EQ(0u, lost);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(999u, b.back());
+    mHub->detach();
+    mHub->detach();
+}
+
+TEST_F(AudioCaptureHubTest, LateStreamLosesOldestFrames) {
+    uint64_t position = mHub->attach();
+    produce(10000, 4096, 0);
+    mProducer.join();
+    // let the reader thread drain the pipe into the ring
+    usleep(300000);
+
+    // the ring keeps 500 ms plus a period, rounded up to 8192 frames, less
+    // the period the reader thread is overwriting
+    const uint64_t window = 8192 - kSampleRate * 20 / 1000;
+    uint32_t frame;
+    uint64_t lost = 0;
+    ASSERT_EQ(1, mHub->read(&position, &frame, 1, &lost));
+    EXPECT_EQ(10000 - window, lost);
+    EXPECT_EQ(10000 - window, frame);
+    mHub->detach();
+}
+
+// releasing the device waits for the device read in progress, after which
+// the hub leaves the device alone
+TEST_F(AudioCaptureHubTest, WaitIdleWaitsForDeviceRead) {
+    mHub->attach();
+    // the reader thread blocks in a read of the empty pipe
+    usleep(50000);
+    mHub->detach();
+
+    std::atomic<bool> idle(false);
+    std::thread waiter([&] {
+        mHub->waitIdle();
+        idle = true;
+    });
+    usleep(50000);
+    EXPECT_FALSE(idle);
+
+    std::vector<uint32_t> period(kSampleRate * 20 / 1000);
+    ASSERT_EQ((ssize_t)(period.size() * sizeof(uint32_t)),
+              write(mFds[1], period.data(), period.size() * sizeof(uint32_t)));
+    waiter.join();
+    EXPECT_TRUE(idle);
+
+    ASSERT_EQ(4, write(mFds[1], period.data(), 4));
+    usleep(50000);
+    int pending = 0;
+    ASSERT_EQ(0, ioctl(mFds[0], FIONREAD, &pending));
+    EXPECT_EQ(4, pending);
+}
+
+}  // namespace android_audio_legacy
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "AudioDumpEncoder.h"
+
+namespace android_audio_legacy {
+
+static const size_t kBlockFrames = 4096;
+
+static std::vector<int16_t> tone(size_t frames, uint32_t channelCount)
+{
+    std::vector<int16_t> data(frames * channelCount);
+    for (size_t i = 0; i < frames; i++) {
+        for (uint32_t c = 0; c < channelCount; c++) {
+            data[i * channelCount + c] = (int16_t)lrint(12000 * sin(0.01 * i * (c + 1)));
+        }
+    }
+    return data;
+}
+
+static void roundTrip(int format, uint32_t channelCount, const void *frames, size_t frameCount,
+                      size_t *encodedBytes)
+{
+    const size_t frameSize = channelCount * audio_bytes_per_sample((audio_format_t)format);
+    AudioDumpEncoder encoder;
+    ASSERT_EQ(NO_ERROR, encoder.set(format, channelCount, kBlockFrames));
+    std::vector<uint8_t> encoded(encoder.maxBlockBytes(frameCount));
+    size_t bytes = encoder.encodeBlock(encoded.data(), frames, frameCount, 1234, 5678);
+    ASSERT_LE(bytes, encoded.size());
+    *encodedBytes = bytes;
+
+    std::vector<uint8_t> decoded(kBlockFrames * frameSize);
+    ASSERT_EQ((ssize_t)frameCount,
+              encoder.decodeBlock(decoded.data(), kBlockFrames, encoded.data(), bytes));
+    EXPECT_EQ(0, memcmp(frames, decoded.data(), frameCount * frameSize));
+}
+
+TEST(AudioDumpEncoderTest, ToneCompresses) {
+    std::vector<int16_t> pcm = tone(kBlockFrames, 2);
+    size_t bytes;
+    roundTrip(AUDIO_FORMAT_PCM_16_BIT, 2, pcm.data(), kBlockFrames, &bytes);
+    EXPECT_LT(bytes, pcm.size() * sizeof(int16_t) / 2);
+}
+
+TEST(AudioDumpEncoderTest, ExtremesAndSilence) {
+    std::vector<int16_t> pcm(kBlockFrames);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = (i / 64) % 3 == 0 ? 0 : ((i & 1) ? INT16_MAX : INT16_MIN);
+    }
+    size_t bytes;
+    roundTrip(AUDIO_FORMAT_PCM_16_BIT, 1, pcm.data(), kBlockFrames, &bytes);
+}
+
+// noise does not compress: the channels are stored verbatim
+TEST(AudioDumpEncoderTest, NoiseIsStoredVerbatim) {
+    std::vector<int16_t> pcm(kBlockFrames * 2);
+    srand(42);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = (int16_t)(rand() & 0xffff);
+    }
+    size_t bytes;
+    roundTrip(AUDIO_FORMAT_PCM_16_BIT, 2, pcm.data(), kBlockFrames, &bytes);
+    EXPECT_LE(bytes, AUDIO_DUMP_BLOCK_HDR_SIZE + 2 * (2 + kBlockFrames * sizeof(int16_t)));
+}
+
+TEST(AudioDumpEncoderTest, ShortBlockAndWideSamples) {
+    std::vector<int16_t> pcm = tone(1001, 2);
+    size_t bytes;
+    roundTrip(AUDIO_FORMAT_PCM_16_BIT, 2, pcm.data(), 1001, &bytes);
+
+    std::vector<float> samples(1001 * 2);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = sinf(0.003f * i);
+    }
+    roundTrip(AUDIO_FORMAT_PCM_FLOAT, 2, samples.data(), 1001, &bytes);
+}
+
+TEST(AudioDumpEncoderTest, CorruptBlockIsRejected) {
+    std::vector<int16_t> pcm = tone(kBlockFrames, 1);
+    AudioDumpEncoder encoder;
+    ASSERT_EQ(NO_ERROR, encoder.set(AUDIO_FORMAT_PCM_16_BIT, 1, kBlockFrames));
+    std::vector<uint8_t> encoded(encoder.maxBlockBytes(kBlockFrames));
+    size_t bytes = encoder.encodeBlock(encoded.data(), pcm.data(), kBlockFrames, 0, 0);
+    std::vector<int16_t> decoded(kBlockFrames);
+
+    // truncated
+    EXPECT_LT(encoder.decodeBlock(decoded.data(), kBlockFrames, encoded.data(), bytes - 1), 0);
+    // more frames than the caller has room for
+    EXPECT_LT(encoder.decodeBlock(decoded.data(), kBlockFrames / 2, encoded.data(), bytes), 0);
+    // not a block
+    encoded[0] ^= 0xff;
+    EXPECT_LT(encoder.decodeBlock(decoded.data(), kBlockFrames, encoded.data(), bytes), 0);
+}
+
+TEST(AudioDumpEncoderTest, FileHeaderRoundTrip) {
+    AudioDumpFileHeader header;
+    header.format = AUDIO_FORMAT_PCM_16_BIT;
+    header.channelCount = 2;
+    header.sampleRate = 48000;
+    header.blockFrames = kBlockFrames;
+    header.sequence = 7;
+    header.startRealtimeNs = 0x123456789abcdefull;
+    header.startMonotonicNs = 0xfedcba987654321ull;
+    header.firstFrame = 1ull << 40;
+    header.frameCount = 96000;
+    header.indexOffset = 0x10000;
+    header.blockCount = 24;
+
+    uint8_t bytes[AUDIO_DUMP_FILE_HDR_SIZE];
+    AudioDumpEncoder::writeFileHeader(bytes, header);
+    AudioDumpFileHeader read;
+    memset(&read, 0, sizeof(read));
+    ASSERT_EQ(NO_ERROR, AudioDumpEncoder::readFileHeader(bytes, &read));
+    EXPECT_EQ(header.format, read.format);
+    EXPECT_EQ(header.channelCount, read.channelCount);
+    EXPECT_EQ(header.sampleRate, read.sampleRate);
+    EXPECT_EQ(header.blockFrames, read.blockFrames);
+    EXPECT_EQ(header.sequence, read.sequence);
+    EXPECT_EQ(header.startRealtimeNs, read.startRealtimeNs);
+    EXPECT_EQ(header.startMonotonicNs, read.startMonotonicNs);
+    EXPECT_EQ(header.firstFrame, read.firstFrame);
+    EXPECT_EQ(header.frameCount, read.frameCount);
+    EXPECT_EQ(header.indexOffset, read.indexOffset);
+    EXPECT_EQ(header.blockCount, read.blockCount);
+
+    bytes[0] = 'X';
+    EXPECT_EQ(BAD_VALUE, AudioDumpEncoder::readFileHeader(bytes, &read));
+}
+
+}  // namespace android_audio_legacy
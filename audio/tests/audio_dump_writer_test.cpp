@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "AudioDumpEncoder.h"
+#include "AudioDumpWriter.h"
+
+namespace android_audio_legacy {
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static std::vector<int16_t> ramp(size_t samples)
+{
+    std::vector<int16_t> pcm(samples);
+    for (size_t i = 0; i < samples; i++) {
+        pcm[i] = (int16_t)(i * 7);
+    }
+    return pcm;
+}
+
+static void writeAll(AudioDumpWriter *writer, const std::vector<int16_t>& pcm,
+                     uint32_t channelCount)
+{
+    size_t frames = pcm.size() / channelCount;
+    for (size_t done = 0; done < frames; ) {
+        size_t count = frames - done < 333 ? frames - done : 333;
+        writer->write(&pcm[done * channelCount], count * channelCount * sizeof(int16_t));
+        done += count;
+    }
+}
+
+static bool readFile(const std::string& name, std::vector<uint8_t> *data)
+{
+    FILE *f = fopen(name.c_str(), "rb");
+    if (f == NULL) {
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t count;
+    data->clear();
+    while ((count = fread(buffer, 1, sizeof(buffer), f)) != 0) {
+        data->insert(data->end(), buffer, buffer + count);
+    }
+    fclose(f);
+    return true;
+}
+
+class AudioDumpWriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::string dir = ::testing::TempDir() + "audio_dump_writer_XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(&dir[0]));
+        mDir = dir;
+    }
+    void TearDown() override {
+        std::string command = "rm -rf " + mDir;
+        system(command.c_str());
+    }
+
+    std::string mDir;
+};
+
+// stop() drains the ring and completes the header, with data still queued
+TEST_F(AudioDumpWriterTest, StopFinishesWaveFile) {
+    static const uint32_t kChannels = 2;
+    static const size_t kFrames = 100000;
+    std::vector<int16_t> pcm = ramp(kFrames * kChannels);
+
+    std::string path = mDir + "/out";
+    AudioDumpWriter::Config config;
+    config.ringMs = 5000;
+    sp<AudioDumpWriter> writer = new AudioDumpWriter(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                                     kChannels, 48000, config);
+    ASSERT_EQ(NO_ERROR, writer->start());
+    // odd sized pieces, all queued before the writer could catch up
+    writeAll(writer.get(), pcm, kChannels);
+    writer->stop();
+    writer->join();
+    EXPECT_EQ(0u, writer->overruns());
+
+    std::vector<uint8_t> file;
+    ASSERT_TRUE(readFile(path + ".wav", &file));
+    const size_t dataBytes = pcm.size() * sizeof(int16_t);
+    ASSERT_EQ(AUDIO_DUMP_WAVE_HDR_SIZE + dataBytes, file.size());
+    EXPECT_EQ(0, memcmp(&file[0], "RIFF", 4));
+    EXPECT_EQ(file.size() - 8, get32(&file[4]));
+    EXPECT_EQ(0, memcmp(&file[8], "WAVE", 4));
+    EXPECT_EQ(kChannels, (uint32_t)(file[22] | (file[23] << 8)));
+    EXPECT_EQ(48000u, get32(&file[24]));
+    EXPECT_EQ(0, memcmp(&file[36], "data", 4));
+    EXPECT_EQ(dataBytes, get32(&file[40]));
+    EXPECT_EQ(0, memcmp(&file[AUDIO_DUMP_WAVE_HDR_SIZE], pcm.data(), dataBytes));
+}
+
+// WAV has no 8.24 format, the samples are written as 32 bit PCM
+TEST_F(AudioDumpWriterTest, Q8_23IsStoredAsPcm32) {
+    const int32_t samples[] = { 0, 1 << 22, -(1 << 22), 1 << 23, -(1 << 23), INT32_MAX, -1 };
+    const int32_t expected[] = { 0, 1 << 30, -(1 << 30), INT32_MAX, INT32_MIN, INT32_MAX, -256 };
+    const size_t count = sizeof(samples) / sizeof(samples[0]);
+
+    std::string path = mDir + "/q8_23";
+    sp<AudioDumpWriter> writer = new AudioDumpWriter(path.c_str(), AUDIO_FORMAT_PCM_8_24_BIT,
+                                                     1, 48000);
+    ASSERT_EQ(NO_ERROR, writer->start());
+    // a sample cut between two writes is converted once
+    writer->write(samples, 6);
+    writer->write((const uint8_t *)samples + 6, sizeof(samples) - 6);
+    writer->stop();
+    writer->join();
+
+    std::vector<uint8_t> file;
+    ASSERT_TRUE(readFile(path + ".wav", &file));
+    ASSERT_EQ(AUDIO_DUMP_WAVE_HDR_SIZE + sizeof(samples), file.size());
+    EXPECT_EQ(1, file[20] | (file[21] << 8));
+    EXPECT_EQ(32, file[34] | (file[35] << 8));
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(expected[i], (int32_t)get32(&file[AUDIO_DUMP_WAVE_HDR_SIZE + 4 * i]))
+                << "sample " << i;
+    }
+}
+
+TEST_F(AudioDumpWriterTest, FullRingDropsWholeBuffers) {
+    std::string path = mDir + "/full";
+    sp<AudioDumpWriter> writer = new AudioDumpWriter(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                                     1, 8000);
+    ASSERT_EQ(NO_ERROR, writer->start());
+    // larger than any ring the writer allocates for 8 kHz mono
+    std::vector<uint8_t> buffer(4 * 1024 * 1024);
+    writer->write(buffer.data(), buffer.size());
+    EXPECT_EQ(1u, writer->overruns());
+    EXPECT_EQ(buffer.size(), writer->bytesDropped());
+    writer->stop();
+    writer->join();
+
+    std::vector<uint8_t> file;
+    ASSERT_TRUE(readFile(path + ".wav", &file));
+    EXPECT_EQ((size_t)AUDIO_DUMP_WAVE_HDR_SIZE, file.size());
+    EXPECT_EQ(0u, get32(&file[40]));
+}
+
+// rotated WAV files split on frames and only the last max_files are kept
+TEST_F(AudioDumpWriterTest, WaveRotation) {
+    static const uint32_t kChannels = 3;
+    static const size_t kFrames = 48000;
+    std::vector<int16_t> pcm = ramp(kFrames * kChannels);
+
+    std::string path = mDir + "/rotated";
+    AudioDumpWriter::Config config;
+    config.rotateMs = 100;
+    config.maxFiles = 4;
+    config.ringMs = 2000;
+    sp<AudioDumpWriter> writer = new AudioDumpWriter(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                                     kChannels, 48000, config);
+    ASSERT_EQ(NO_ERROR, writer->start());
+    writeAll(writer.get(), pcm, kChannels);
+    writer->stop();
+    writer->join();
+
+    // one second in files of 100 ms: 000 to 009
+    std::vector<uint8_t> file;
+    EXPECT_FALSE(readFile(path + "_005.wav", &file));
+    EXPECT_TRUE(readFile(path + "_006.wav", &file));
+    EXPECT_FALSE(readFile(path + "_010.wav", &file));
+    const size_t fileBytes = 4800 * kChannels * sizeof(int16_t);
+    for (uint32_t sequence = 6; sequence <= 9; sequence++) {
+        char name[16];
+        snprintf(name, sizeof(name), "_%03u.wav", sequence);
+        ASSERT_TRUE(readFile(path + name, &file)) << name;
+        ASSERT_EQ(AUDIO_DUMP_WAVE_HDR_SIZE + fileBytes, file.size()) << name;
+        EXPECT_EQ(fileBytes, get32(&file[40])) << name;
+        EXPECT_EQ(0, memcmp(&file[AUDIO_DUMP_WAVE_HDR_SIZE],
+                            (const uint8_t *)pcm.data() + sequence * fileBytes, fileBytes))
+                << name;
+    }
+}
+
+// the compressed files decode back to what was written
+TEST_F(AudioDumpWriterTest, CompressedRoundTrip) {
+    static const uint32_t kChannels = 2;
+    static const size_t kFrames = 30000;
+    std::vector<int16_t> pcm = ramp(kFrames * kChannels);
+
+    std::string path = mDir + "/compressed";
+    AudioDumpWriter::Config config;
+    config.dumpFormat = AudioDumpWriter::DUMP_FORMAT_COMPRESSED;
+    config.ringMs = 2000;
+    sp<AudioDumpWriter> writer = new AudioDumpWriter(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                                     kChannels, 44100, config);
+    ASSERT_EQ(NO_ERROR, writer->start());
+    writeAll(writer.get(), pcm, kChannels);
+    writer->stop();
+    writer->join();
+
+    std::vector<uint8_t> file;
+    ASSERT_TRUE(readFile(path + "_000.admp", &file));
+    ASSERT_GE(file.size(), (size_t)AUDIO_DUMP_FILE_HDR_SIZE);
+    AudioDumpFileHeader header;
+    ASSERT_EQ(NO_ERROR, AudioDumpEncoder::readFileHeader(file.data(), &header));
+    EXPECT_EQ(AUDIO_FORMAT_PCM_16_BIT, header.format);
+    EXPECT_EQ(kChannels, header.channelCount);
+    EXPECT_EQ(44100u, header.sampleRate);
+    EXPECT_EQ(kFrames, header.frameCount);
+    EXPECT_EQ(0u, header.firstFrame);
+    ASSERT_LT(header.indexOffset, file.size());
+    EXPECT_EQ(0, memcmp(&file[header.indexOffset], "ADIX", 4));
+    EXPECT_EQ(header.blockCount, get32(&file[header.indexOffset + 4]));
+
+    AudioDumpEncoder decoder;
+    ASSERT_EQ(NO_ERROR, decoder.set(header.format, header.channelCount, header.blockFrames));
+    std::vector<int16_t> decoded;
+    std::vector<int16_t> block(header.blockFrames * kChannels);
+    size_t offset = AUDIO_DUMP_FILE_HDR_SIZE;
+    for (uint32_t i = 0; i < header.blockCount; i++) {
+        ASSERT_LT(offset, header.indexOffset);
+        ssize_t frames = decoder.decodeBlock(block.data(), header.blockFrames, &file[offset],
+                                             header.indexOffset - offset);
+        ASSERT_GT(frames, 0) << "block " << i;
+        decoded.insert(decoded.end(), block.begin(), block.begin() + frames * kChannels);
+        offset += AUDIO_DUMP_BLOCK_HDR_SIZE + get32(&file[offset + 4]);
+    }
+    EXPECT_EQ(header.indexOffset, offset);
+    EXPECT_EQ(pcm, decoded);
+}
+
+}  // namespace android_audio_legacy
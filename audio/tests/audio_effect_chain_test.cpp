@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <string.h>
+#include <vector>
+
+#include "AudioEffectChain.h"
+
+namespace android_audio_legacy {
+
+// an effect that adds a constant to each PCM_16 sample, with the given
+// declared load. The interface pointer comes first so that the address of a
+// FakeEffect is its effect_handle_t.
+struct FakeEffect {
+    FakeEffect(int16_t offset, uint16_t cpuLoad = 0, int32_t status = 0)
+        : itfe(&sInterface), offset(offset), cpuLoad(cpuLoad), status(status) {}
+
+    effect_handle_t handle() { return (effect_handle_t)this; }
+
+    static int32_t process(effect_handle_t self, audio_buffer_t *in, audio_buffer_t *out) {
+        FakeEffect *effect = (FakeEffect *)self;
+        if (effect->status != 0) {
+            return effect->status;
+        }
+        for (size_t i = 0; i < in->frameCount; i++) {
+            out->s16[i] = in->s16[i] + effect->offset;
+        }
+        return 0;
+    }
+
+    static int32_t getDescriptor(effect_handle_t self, effect_descriptor_t *desc) {
+        memset(desc, 0, sizeof(*desc));
+        desc->cpuLoad = ((FakeEffect *)self)->cpuLoad;
+        strcpy(desc->name, "fake");
+        return 0;
+    }
+
+    static const struct effect_interface_s sInterface;
+
+    const struct effect_interface_s *itfe;
+    int16_t offset;
+    uint16_t cpuLoad;
+    int32_t status;
+};
+
+const struct effect_interface_s FakeEffect::sInterface = {
+    FakeEffect::process, NULL, FakeEffect::getDescriptor, NULL,
+};
+
+TEST(AudioEffectChainTest, ProcessRunsEffectsInOrder) {
+    AudioEffectChain chain;
+    ASSERT_EQ(NO_ERROR, chain.set(sizeof(int16_t), 48000, 64));
+    EXPECT_TRUE(chain.isEmpty());
+
+    FakeEffect a(1), b(10), disabled(100, 0, -ENODATA);
+    ASSERT_EQ(NO_ERROR, chain.addEffect(a.handle()));
+    ASSERT_EQ(NO_ERROR, chain.addEffect(disabled.handle()));
+    ASSERT_EQ(NO_ERROR, chain.addEffect(b.handle()));
+    EXPECT_EQ(INVALID_OPERATION, chain.addEffect(a.handle()));
+    EXPECT_FALSE(chain.isEmpty());
+
+    std::vector<int16_t> in(64, 1000);
+    const int16_t *out = (const int16_t *)chain.process(in.data(), in.size());
+    ASSERT_NE(in.data(), out);
+    for (size_t i = 0; i < in.size(); i++) {
+        ASSERT_EQ(1011, out[i]);
+    }
+    EXPECT_EQ(1000, in[0]);
+
+    // too many frames for the scratch buffers: passed through
+    std::vector<int16_t> big(65, 7);
+    EXPECT_EQ(big.data(), chain.process(big.data(), big.size()));
+
+    EXPECT_EQ(NO_ERROR, chain.removeEffect(a.handle()));
+    EXPECT_EQ(BAD_VALUE, chain.removeEffect(a.handle()));
+    out = (const int16_t *)chain.process(in.data(), in.size());
+    EXPECT_EQ(1010, out[0]);
+}
+
+// effects that have not run yet count with their declared load
+TEST(AudioEffectChainTest, BudgetUsesDeclaredLoad) {
+    AudioEffectChain chain;
+    ASSERT_EQ(NO_ERROR, chain.set(sizeof(int16_t), 48000, 64));
+    chain.setCpuBudget(100);
+
+    // 60 MIPS each, 60 per mille of a 1000 MIPS core
+    FakeEffect first(1, 600), second(1, 600), small(1, 400);
+    EXPECT_EQ(NO_ERROR, chain.addEffect(first.handle()));
+    EXPECT_EQ(60u, chain.cpuLoad());
+    EXPECT_EQ(INVALID_OPERATION, chain.addEffect(second.handle()));
+    EXPECT_EQ(NO_ERROR, chain.addEffect(small.handle()));
+    EXPECT_EQ(100u, chain.cpuLoad());
+
+    chain.setCpuBudget(0);
+    EXPECT_EQ(NO_ERROR, chain.addEffect(second.handle()));
+}
+
+TEST(AudioEffectChainTest, BudgetAssumesLoadWhenNoneDeclared) {
+    AudioEffectChain chain;
+    ASSERT_EQ(NO_ERROR, chain.set(sizeof(int16_t), 48000, 64));
+    chain.setCpuBudget(120);
+
+    FakeEffect effects[3] = { FakeEffect(1), FakeEffect(1), FakeEffect(1) };
+    EXPECT_EQ(NO_ERROR, chain.addEffect(effects[0].handle()));
+    EXPECT_EQ(NO_ERROR, chain.addEffect(effects[1].handle()));
+    EXPECT_EQ(INVALID_OPERATION, chain.addEffect(effects[2].handle()));
+
+    // once measured, the trivial effects leave room for the third
+    std::vector<int16_t> in(64);
+    for (int i = 0; i < 100; i++) {
+        chain.process(in.data(), in.size());
+    }
+    EXPECT_LT(chain.cpuLoad(), 70u);
+    EXPECT_EQ(NO_ERROR, chain.addEffect(effects[2].handle()));
+}
+
+}  // namespace android_audio_legacy
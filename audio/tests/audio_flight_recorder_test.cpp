@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioDumpEncoder.h"
+#include "AudioFlightRecorder.h"
+
+namespace android_audio_legacy {
+
+static const uint32_t kSampleRate = 8000;
+// 800 mono frames
+static const uint32_t kDurationMs = 100;
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// the samples of a WAV file, once its writer has finished the header
+static bool readSamples(const std::string& name, std::vector<int16_t> *samples)
+{
+    for (int retry = 0; retry < 200; retry++) {
+        FILE *f = fopen(name.c_str(), "rb");
+        if (f != NULL) {
+            std::vector<uint8_t> data;
+            uint8_t buffer[4096];
+            size_t count;
+            while ((count = fread(buffer, 1, sizeof(buffer), f)) != 0) {
+                data.insert(data.end(), buffer, buffer + count);
+            }
+            fclose(f);
+            if (data.size() >= AUDIO_DUMP_WAVE_HDR_SIZE &&
+                    get32(&data[40]) == data.size() - AUDIO_DUMP_WAVE_HDR_SIZE) {
+                const int16_t *pcm = (const int16_t *)&data[AUDIO_DUMP_WAVE_HDR_SIZE];
+                samples->assign(pcm, pcm + (data.size() - AUDIO_DUMP_WAVE_HDR_SIZE) / 2);
+                return true;
+            }
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+class AudioFlightRecorderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::string dir = ::testing::TempDir() + "audio_flight_recorder_XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(&dir[0]));
+        mDir = dir;
+        mRecorder = new AudioFlightRecorder(AUDIO_FORMAT_PCM_16_BIT, 1, kSampleRate,
+                                            kDurationMs);
+        ASSERT_EQ(NO_ERROR, mRecorder->init());
+    }
+    void TearDown() override {
+        std::string command = "rm -rf " + mDir;
+        system(command.c_str());
+    }
+
+    // samples counting up from first, written in pieces of the given size
+    void record(int16_t first, size_t samples, size_t piece) {
+        std::vector<int16_t> pcm(samples);
+        for (size_t i = 0; i < samples; i++) {
+            pcm[i] = (int16_t)(first + i);
+        }
+        for (size_t done = 0; done < samples; done += piece) {
+            size_t count = samples - done < piece ? samples - done : piece;
+            mRecorder->write(&pcm[done], count * sizeof(int16_t));
+        }
+    }
+
+    std::vector<int16_t> flush(const char *name) {
+        std::string path = mDir + "/" + name;
+        std::vector<int16_t> samples;
+        EXPECT_EQ(NO_ERROR, mRecorder->flush(path.c_str(), AudioDumpWriter::Config()));
+        EXPECT_TRUE(readSamples(path + ".wav", &samples));
+        return samples;
+    }
+
+    std::string mDir;
+    sp<AudioFlightRecorder> mRecorder;
+};
+
+TEST_F(AudioFlightRecorderTest, FlushWritesLastWindow) {
+    record(0, 3000, 160);
+    std::vector<int16_t> samples = flush("last");
+    ASSERT_EQ(800u, samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        ASSERT_EQ((int16_t)(2200 + i), samples[i]) << "sample " << i;
+    }
+
+    // the recorder keeps going after a flush
+    record(3000, 100, 100);
+    samples = flush("again");
+    ASSERT_EQ(800u, samples.size());
+    EXPECT_EQ(2300, samples.front());
+    EXPECT_EQ(3099, samples.back());
+}
+
+TEST_F(AudioFlightRecorderTest, FlushBeforeWindowFills) {
+    record(0, 100, 33);
+    std::vector<int16_t> samples = flush("short");
+    ASSERT_EQ(100u, samples.size());
+    EXPECT_EQ(0, samples.front());
+    EXPECT_EQ(99, samples.back());
+}
+
+// a write larger than the ring keeps its end
+TEST_F(AudioFlightRecorderTest, LargeWriteKeepsItsEnd) {
+    record(0, 5000, 5000);
+    std::vector<int16_t> samples = flush("large");
+    ASSERT_EQ(800u, samples.size());
+    EXPECT_EQ(4200, samples.front());
+    EXPECT_EQ(4999, samples.back());
+}
+
+// the audio thread keeps writing while flush() copies: what reaches the file
+// moves forward through the stream, skipping what was overwritten
+TEST_F(AudioFlightRecorderTest, FlushDuringWrites) {
+    std::atomic<bool> done(false);
+    std::thread audio([&] {
+        int16_t buffer[37];
+        uint16_t next = 0;
+        while (!done) {
+            for (size_t i = 0; i < 37; i++) {
+                buffer[i] = (int16_t)next++;
+            }
+            mRecorder->write(buffer, sizeof(buffer));
+        }
+    });
+    for (int n = 0; n < 20; n++) {
+        std::vector<int16_t> samples = flush(("busy" + std::to_string(n)).c_str());
+        ASSERT_LE(samples.size(), 800u);
+        for (size_t i = 1; i < samples.size(); i++) {
+            uint16_t step = (uint16_t)(samples[i] - samples[i - 1]);
+            ASSERT_TRUE(step >= 1 && step < 1001) << "flush " << n << " sample " << i;
+        }
+    }
+    done = true;
+    audio.join();
+}
+
+TEST(AudioFlightRecorderInitTest, FlushNeedsInit) {
+    sp<AudioFlightRecorder> recorder =
+            new AudioFlightRecorder(AUDIO_FORMAT_PCM_16_BIT, 1, kSampleRate, 0);
+    EXPECT_EQ(BAD_VALUE, recorder->init());
+    recorder->write("\0\0", 2);
+    EXPECT_EQ(NO_INIT, recorder->flush("/dev/null", AudioDumpWriter::Config()));
+}
+
+}  // namespace android_audio_legacy
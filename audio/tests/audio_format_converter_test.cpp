@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <vector>
+
+#include "AudioFormatConverter.h"
+
+namespace android_audio_legacy {
+
+// odd frame counts exercise the tails after the vector loops
+static const size_t kFrames = 1001;
+
+static std::vector<int16_t> ramp(size_t samples)
+{
+    std::vector<int16_t> data(samples);
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = (int16_t)(i * 37 - 30000);
+    }
+    data[0] = INT16_MIN;
+    data[1] = INT16_MAX;
+    return data;
+}
+
+TEST(AudioFormatConverterTest, RejectsUnsupportedFormats) {
+    AudioFormatConverter converter;
+    EXPECT_FALSE(AudioFormatConverter::isSupportedFormat(AUDIO_FORMAT_MP3));
+    EXPECT_NE(NO_ERROR, converter.set(AUDIO_FORMAT_MP3, AUDIO_CHANNEL_OUT_STEREO,
+                                      AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO));
+}
+
+TEST(AudioFormatConverterTest, Passthrough) {
+    AudioFormatConverter converter;
+    ASSERT_EQ(NO_ERROR, converter.set(AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+                                      AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO));
+    EXPECT_TRUE(converter.isPassthrough());
+    EXPECT_EQ(4u, converter.srcFrameSize());
+    EXPECT_EQ(4u, converter.dstFrameSize());
+}
+
+// 16 bit samples survive a round trip through the wider formats
+TEST(AudioFormatConverterTest, SampleFormatRoundTrip) {
+    static const audio_format_t kFormats[] = {
+        AUDIO_FORMAT_PCM_8_24_BIT, AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_FLOAT
+    };
+    std::vector<int16_t> src = ramp(kFrames * 2);
+
+    for (audio_format_t format : kFormats) {
+        AudioFormatConverter to, from;
+        ASSERT_EQ(NO_ERROR, to.set(AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+                                   format, AUDIO_CHANNEL_OUT_STEREO));
+        ASSERT_EQ(NO_ERROR, from.set(format, AUDIO_CHANNEL_OUT_STEREO,
+                                     AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO));
+        EXPECT_EQ(8u, to.dstFrameSize());
+        std::vector<uint8_t> wide(kFrames * to.dstFrameSize());
+        std::vector<int16_t> back(kFrames * 2);
+        to.convert(wide.data(), src.data(), kFrames);
+        from.convert(back.data(), wide.data(), kFrames);
+        EXPECT_EQ(src, back) << "format " << format;
+    }
+}
+
+TEST(AudioFormatConverterTest, FloatIsClamped) {
+    const float src[] = { 2.0f, -2.0f, 0.5f, -0.5f, 1.0f, -1.0f, 0.0f, 0.0f };
+    int16_t dst[8];
+    AudioFormatConverter converter;
+    ASSERT_EQ(NO_ERROR, converter.set(AUDIO_FORMAT_PCM_FLOAT, AUDIO_CHANNEL_OUT_STEREO,
+                                      AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO));
+    converter.convert(dst, src, 4);
+    EXPECT_EQ(INT16_MAX, dst[0]);
+    EXPECT_EQ(INT16_MIN, dst[1]);
+    EXPECT_EQ(16384, dst[2]);
+    EXPECT_EQ(-16384, dst[3]);
+    EXPECT_EQ(INT16_MAX, dst[4]);
+    EXPECT_EQ(INT16_MIN, dst[5]);
+    EXPECT_EQ(0, dst[6]);
+}
+
+TEST(AudioFormatConverterTest, MonoIsDuplicated) {
+    std::vector<int16_t> src = ramp(kFrames);
+    std::vector<int16_t> dst(kFrames * 2);
+    AudioFormatConverter converter;
+    ASSERT_EQ(NO_ERROR, converter.set(AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_MONO,
+                                      AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO));
+    converter.convert(dst.data(), src.data(), kFrames);
+    for (size_t i = 0; i < kFrames; i++) {
+        ASSERT_EQ(src[i], dst[2 * i]) << "frame " << i;
+        ASSERT_EQ(src[i], dst[2 * i + 1]) << "frame " << i;
+    }
+}
+
+TEST(AudioFormatConverterTest, StereoIsAveraged) {
+    std::vector<int16_t> src = ramp(kFrames * 2);
+    std::vector<int16_t> dst(kFrames);
+    AudioFormatConverter converter;
+    ASSERT_EQ(NO_ERROR, converter.set(AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_IN_STEREO,
+                                      AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_IN_MONO));
+    converter.convert(dst.data(), src.data(), kFrames);
+    for (size_t i = 0; i < kFrames; i++) {
+        int expected = (src[2 * i] + src[2 * i + 1]) / 2;
+        ASSERT_NEAR(expected, dst[i], 1) << "frame " << i;
+    }
+}
+
+// other layouts are remapped by position, missing positions are silent
+TEST(AudioFormatConverterTest, RemapByPosition) {
+    static const size_t kFrames51 = 100;
+    std::vector<int16_t> src(kFrames51 * 2);
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = (int16_t)(i + 1);
+    }
+    std::vector<int16_t> dst(kFrames51 * 6, -1);
+    AudioFormatConverter converter;
+    ASSERT_EQ(NO_ERROR, converter.set(AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+                                      AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_5POINT1));
+    converter.convert(dst.data(), src.data(), kFrames51);
+    for (size_t i = 0; i < kFrames51; i++) {
+        ASSERT_EQ(src[2 * i], dst[6 * i]) << "frame " << i;
+        ASSERT_EQ(src[2 * i + 1], dst[6 * i + 1]) << "frame " << i;
+        for (size_t c = 2; c < 6; c++) {
+            ASSERT_EQ(0, dst[6 * i + c]) << "frame " << i << " channel " << c;
+        }
+    }
+}
+
+}  // namespace android_audio_legacy
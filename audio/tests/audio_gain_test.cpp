@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <vector>
+
+#include "AudioGain.h"
+
+namespace android_audio_legacy {
+
+TEST(AudioGainTest, SetChecksFormat) {
+    AudioGain gain;
+    EXPECT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_16_BIT, 2));
+    EXPECT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_FLOAT, 6));
+    EXPECT_EQ(BAD_VALUE, gain.set(AUDIO_FORMAT_PCM_8_24_BIT, 2));
+    EXPECT_EQ(BAD_VALUE, gain.set(AUDIO_FORMAT_PCM_16_BIT, 0));
+}
+
+TEST(AudioGainTest, VolumeIsClampedAndAveragedForMono) {
+    AudioGain gain;
+    ASSERT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_16_BIT, 2));
+    gain.setVolume(2.0f, -1.0f);
+    EXPECT_EQ(1.0f, gain.left());
+    EXPECT_EQ(0.0f, gain.right());
+
+    ASSERT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_16_BIT, 1));
+    gain.setVolume(1.0f, 0.5f);
+    EXPECT_EQ(0.75f, gain.left());
+    EXPECT_EQ(0.75f, gain.right());
+}
+
+TEST(AudioGainTest, UnityLeavesBufferUntouched) {
+    AudioGain gain;
+    ASSERT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_16_BIT, 2));
+    EXPECT_TRUE(gain.isUnity());
+    std::vector<int16_t> buffer(64);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = (int16_t)(i * 1021 - 32768);
+    }
+    std::vector<int16_t> expected(buffer);
+    gain.apply(buffer.data(), buffer.size() / 2);
+    EXPECT_EQ(expected, buffer);
+}
+
+// a change ramps linearly over the next buffer, then holds
+TEST(AudioGainTest, RampReachesTargetOverOneBuffer) {
+    const size_t kFrames = 100;
+    AudioGain gain;
+    ASSERT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_16_BIT, 2));
+    gain.setVolume(0.5f, 0.25f);
+    EXPECT_FALSE(gain.isUnity());
+
+    std::vector<int16_t> buffer(kFrames * 2, 16384);
+    gain.apply(buffer.data(), kFrames);
+    for (size_t i = 0; i < kFrames; i++) {
+        float t = (float)(i + 1) / kFrames;
+        EXPECT_NEAR(16384 * (1.0f - 0.5f * t), buffer[2 * i], 1.0) << "frame " << i;
+        EXPECT_NEAR(16384 * (1.0f - 0.75f * t), buffer[2 * i + 1], 1.0) << "frame " << i;
+    }
+    EXPECT_EQ(8192, buffer[2 * kFrames - 2]);
+    EXPECT_EQ(4096, buffer[2 * kFrames - 1]);
+
+    std::fill(buffer.begin(), buffer.end(), 16384);
+    gain.apply(buffer.data(), kFrames);
+    for (size_t i = 0; i < kFrames; i++) {
+        ASSERT_EQ(8192, buffer[2 * i]);
+        ASSERT_EQ(4096, buffer[2 * i + 1]);
+    }
+}
+
+TEST(AudioGainTest, FloatRamp) {
+    const size_t kFrames = 64;
+    AudioGain gain;
+    ASSERT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_FLOAT, 1));
+    gain.setVolume(0.0f, 0.0f);
+    std::vector<float> buffer(kFrames, 1.0f);
+    gain.apply(buffer.data(), kFrames);
+    for (size_t i = 1; i < kFrames; i++) {
+        ASSERT_LT(buffer[i], buffer[i - 1]);
+    }
+    EXPECT_NEAR(0.0f, buffer[kFrames - 1], 1e-6);
+
+    // once at zero, buffers are silenced
+    std::fill(buffer.begin(), buffer.end(), 0.5f);
+    gain.apply(buffer.data(), kFrames);
+    EXPECT_EQ(std::vector<float>(kFrames, 0.0f), buffer);
+}
+
+// the NEON/SSE2 kernels and their scalar tail agree with the Q14 reference
+TEST(AudioGainTest, ConstantGainMatchesReference) {
+    const size_t kFrames = 37;
+    AudioGain gain;
+    ASSERT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_16_BIT, 2));
+    gain.setVolume(0.8f, 0.3f);
+    std::vector<int16_t> ramp(kFrames * 2);
+    gain.apply(ramp.data(), kFrames);
+
+    srand(42);
+    std::vector<int16_t> buffer(kFrames * 2);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = (int16_t)(rand() & 0xFFFF);
+    }
+    buffer[0] = -32768;
+    buffer[1] = 32767;
+    std::vector<int16_t> input(buffer);
+    gain.apply(buffer.data(), kFrames);
+
+    const int32_t gains[2] = { (int32_t)(0.8f * 16384 + 0.5f), (int32_t)(0.3f * 16384 + 0.5f) };
+    for (size_t i = 0; i < buffer.size(); i++) {
+        int32_t expected = (input[i] * gains[i & 1] + (1 << 13)) >> 14;
+        ASSERT_EQ(expected, buffer[i]) << "sample " << i;
+    }
+
+    std::vector<float> samples(kFrames * 2);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = input[i] / 32768.0f;
+    }
+    ASSERT_EQ(NO_ERROR, gain.set(AUDIO_FORMAT_PCM_FLOAT, 2));
+    gain.setVolume(0.8f, 0.3f);
+    std::vector<float> ignored(kFrames * 2);
+    gain.apply(ignored.data(), kFrames);
+    gain.apply(samples.data(), kFrames);
+    for (size_t i = 0; i < samples.size(); i++) {
+        ASSERT_FLOAT_EQ(input[i] / 32768.0f * (i & 1 ? 0.3f : 0.8f), samples[i]) << "sample " << i;
+    }
+}
+
+}  // namespace android_audio_legacy
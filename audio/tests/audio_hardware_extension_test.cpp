@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <hardware_legacy/AudioHardwareExtension.h>
+
+namespace android_audio_legacy {
+
+// an output that records the last setParameters() string
+class FakeStreamOut : public AudioStreamOut {
+public:
+    virtual uint32_t    sampleRate() const { return 48000; }
+    virtual size_t      bufferSize() const { return 4096; }
+    virtual uint32_t    channels() const { return AUDIO_CHANNEL_OUT_STEREO; }
+    virtual int         format() const { return AUDIO_FORMAT_PCM_16_BIT; }
+    virtual uint32_t    latency() const { return 0; }
+    virtual status_t    setVolume(float left, float right) { return NO_ERROR; }
+    virtual ssize_t     write(const void* buffer, size_t bytes) { return bytes; }
+    virtual status_t    standby() { return NO_ERROR; }
+    virtual status_t    dump(int fd, const Vector<String16>& args) { return NO_ERROR; }
+    virtual status_t    setParameters(const String8& keyValuePairs) {
+                            mKeyValuePairs = keyValuePairs;
+                            return NO_ERROR;
+                        }
+    virtual String8     getParameters(const String8& keys) { return String8(); }
+    virtual status_t    getRenderPosition(uint32_t *dspFrames) { return INVALID_OPERATION; }
+
+    String8             mKeyValuePairs;
+};
+
+// the same output with an extension that takes the parsed list
+class FakeExtendedStreamOut : public FakeStreamOut, public AudioStreamOutExtension {
+public:
+                        FakeExtendedStreamOut() : AudioStreamOutExtension(this), mRouting(0) {}
+    virtual status_t    setParameterList(const AudioParameterList& params) {
+                            return params.getInt(AudioParameterList::KEY_ROUTING, &mRouting);
+                        }
+
+    int                 mRouting;
+};
+
+TEST(AudioHardwareExtensionTest, QueryFindsOnlyExtendedObjects) {
+    FakeStreamOut plain;
+    EXPECT_EQ(nullptr, AudioStreamOutExtension::query(&plain));
+
+    FakeExtendedStreamOut *extended = new FakeExtendedStreamOut();
+    AudioStreamOut *out = extended;
+    EXPECT_EQ(static_cast<AudioStreamOutExtension *>(extended),
+              AudioStreamOutExtension::query(out));
+    delete extended;
+    EXPECT_EQ(nullptr, AudioStreamOutExtension::query(out));
+}
+
+TEST(AudioHardwareExtensionTest, ParameterListReachesExtension) {
+    AudioParameterList params;
+    ASSERT_EQ(NO_ERROR, params.parse("routing=2;screen_state=on"));
+
+    FakeExtendedStreamOut extended;
+    EXPECT_EQ(NO_ERROR, setParameterList(&extended, params));
+    EXPECT_EQ(2, extended.mRouting);
+    EXPECT_EQ(String8(), extended.mKeyValuePairs);
+}
+
+TEST(AudioHardwareExtensionTest, ParameterListIsSerializedWithoutExtension) {
+    AudioParameterList params;
+    ASSERT_EQ(NO_ERROR, params.parse("routing=2;screen_state=on"));
+
+    FakeStreamOut plain;
+    EXPECT_EQ(NO_ERROR, setParameterList(&plain, params));
+    AudioParameterList received;
+    ASSERT_EQ(NO_ERROR, received.parse(plain.mKeyValuePairs.string()));
+    int routing;
+    const char *screen;
+    ASSERT_EQ(NO_ERROR, received.getInt(AudioParameterList::KEY_ROUTING, &routing));
+    EXPECT_EQ(2, routing);
+    ASSERT_EQ(NO_ERROR, received.get(AudioParameterList::KEY_SCREEN_STATE, &screen));
+    EXPECT_STREQ("on", screen);
+}
+
+}  // namespace android_audio_legacy
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <time.h>
+#include <vector>
+
+#include "AudioHardwareStub.h"
+
+namespace android_audio_legacy {
+
+static AudioStubClock::Config virtualClock()
+{
+    AudioStubClock::Config config;
+    config.virtualTime = true;
+    return config;
+}
+
+// positions and timestamps follow the frames written, without sleeping
+TEST(AudioStubClockTest, VirtualOutputPosition) {
+    AudioHardwareStub hw;
+    hw.setClock(virtualClock());
+    status_t status;
+    AudioStreamOut *out = hw.openOutputStream(AUDIO_DEVICE_OUT_SPEAKER, 0, 0, 0, &status);
+    ASSERT_NE(nullptr, out);
+
+    std::vector<uint8_t> buffer(1024 * out->frameSize());
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < 44100; i++) {
+        ASSERT_EQ((ssize_t)buffer.size(), out->write(buffer.data(), buffer.size()));
+    }
+    // more than 17 minutes of audio
+    EXPECT_LT(systemTime(SYSTEM_TIME_MONOTONIC) - start, s2ns(60));
+
+    uint32_t dspFrames;
+    ASSERT_EQ(NO_ERROR, out->getRenderPosition(&dspFrames));
+    EXPECT_EQ(44100u * 1024, dspFrames);
+    uint64_t frames;
+    struct timespec timestamp;
+    ASSERT_EQ(NO_ERROR, out->getPresentationPosition(&frames, &timestamp));
+    EXPECT_EQ(44100u * 1024, frames);
+    EXPECT_EQ(1024, timestamp.tv_sec);
+    EXPECT_EQ(0, timestamp.tv_nsec);
+
+    // standby restarts the position
+    out->standby();
+    ASSERT_EQ(NO_ERROR, out->getRenderPosition(&dspFrames));
+    EXPECT_EQ(0u, dspFrames);
+    hw.closeOutputStream(out);
+}
+
+// the same seed gives the same jitter and underruns
+TEST(AudioStubClockTest, JitterIsRepeatable) {
+    AudioStubClock::Config config = virtualClock();
+    config.jitterUs = 2000;
+    config.underrunPeriod = 7;
+    config.underrunMs = 3;
+    config.seed = 1234;
+
+    AudioStubClock a, b, c;
+    a.configure(config);
+    b.configure(config);
+    config.seed = 4321;
+    c.configure(config);
+    bool differs = false;
+    for (int i = 0; i < 100; i++) {
+        a.advance(480, 48000);
+        b.advance(480, 48000);
+        c.advance(480, 48000);
+        ASSERT_EQ(a.time(), b.time()) << "transfer " << i;
+        differs |= a.time() != c.time();
+        // never earlier than the audio plus the stalls so far
+        EXPECT_GE(a.time(), ms2ns(10 * (i + 1) + 3 * ((i + 1) / 7)));
+    }
+    EXPECT_TRUE(differs);
+    EXPECT_EQ(14u, a.underruns());
+    EXPECT_EQ(14u * 3 * 48, a.framesLost());
+}
+
+TEST(AudioStubClockTest, InputReportsLostFramesOnce) {
+    AudioStubClock::Config config = virtualClock();
+    config.underrunPeriod = 10;
+    config.underrunMs = 5;
+    AudioHardwareStub hw;
+    hw.setClock(config);
+    int format = AUDIO_FORMAT_PCM_16_BIT;
+    uint32_t channels = AUDIO_CHANNEL_IN_MONO;
+    uint32_t rate = 8000;
+    status_t status;
+    AudioStreamIn *in = hw.openInputStream(AudioSystem::DEVICE_IN_BUILTIN_MIC, &format, &channels,
+                                           &rate, &status, (AudioSystem::audio_in_acoustics)0);
+    ASSERT_NE(nullptr, in);
+
+    std::vector<uint8_t> buffer(in->bufferSize());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ((ssize_t)buffer.size(), in->read(buffer.data(), buffer.size()));
+    }
+    EXPECT_EQ(10u * 40, in->getInputFramesLost());
+    EXPECT_EQ(0u, in->getInputFramesLost());
+
+    // standby restarts the clock: the transfers before it no longer count
+    for (int i = 0; i < 10; i++) {
+        in->read(buffer.data(), buffer.size());
+    }
+    in->standby();
+    EXPECT_EQ(0u, in->getInputFramesLost());
+    for (int i = 0; i < 9; i++) {
+        in->read(buffer.data(), buffer.size());
+    }
+    EXPECT_EQ(0u, in->getInputFramesLost());
+    in->read(buffer.data(), buffer.size());
+    EXPECT_EQ(40u, in->getInputFramesLost());
+    hw.closeInputStream(in);
+}
+
+// real time mode sleeps until the device deadline, without drifting
+TEST(AudioStubClockTest, RealTimePacing) {
+    AudioStubClock clock;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < 20; i++) {
+        clock.advance(441, 44100);
+    }
+    nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    EXPECT_GE(elapsed, ms2ns(190));
+    EXPECT_LT(elapsed, ms2ns(400));
+}
+
+}  // namespace android_audio_legacy
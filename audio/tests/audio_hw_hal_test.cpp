@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The legacy_audio_device shim in audio_hw_hal.cpp, over AudioHardwareStub
+// on its virtual clock.
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <hardware/hardware.h>
+#include <hardware/audio.h>
+#include <system/audio.h>
+
+extern "C" struct audio_module HAL_MODULE_INFO_SYM;
+
+class AudioHwHalTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        hw_device_t *device = NULL;
+        const hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+        ASSERT_EQ(0, module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device));
+        mDev = reinterpret_cast<audio_hw_device_t *>(device);
+        ASSERT_EQ(0, mDev->set_parameters(mDev, "stub_virtual_clock=1"));
+    }
+
+    virtual void TearDown() {
+        if (mDev != NULL) {
+            mDev->common.close(&mDev->common);
+        }
+    }
+
+    audio_stream_out_t *openOutput() {
+        struct audio_config config;
+        memset(&config, 0, sizeof(config));
+        audio_stream_out_t *out = NULL;
+        EXPECT_EQ(0, mDev->open_output_stream(mDev, 0, AUDIO_DEVICE_OUT_SPEAKER,
+                                              AUDIO_OUTPUT_FLAG_NONE, &config, &out, ""));
+        return out;
+    }
+
+    audio_hw_device_t *mDev = NULL;
+};
+
+TEST_F(AudioHwHalTest, OutputWritesAdvancePosition) {
+    audio_stream_out_t *out = openOutput();
+    ASSERT_NE(nullptr, out);
+    uint32_t rate = out->common.get_sample_rate(&out->common);
+    size_t frameSize = audio_bytes_per_sample(out->common.get_format(&out->common)) *
+            audio_channel_count_from_out_mask(out->common.get_channels(&out->common));
+    ASSERT_NE(0u, rate);
+    ASSERT_NE(0u, frameSize);
+
+    std::vector<uint8_t> buffer(rate / 10 * frameSize);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ((ssize_t)buffer.size(), out->write(out, buffer.data(), buffer.size()));
+    }
+    uint64_t frames;
+    struct timespec timestamp;
+    ASSERT_EQ(0, out->get_presentation_position(out, &frames, &timestamp));
+    EXPECT_EQ(rate, frames);
+    EXPECT_EQ(1, timestamp.tv_sec);
+    EXPECT_EQ(0, timestamp.tv_nsec);
+
+    ASSERT_EQ(0, out->common.standby(&out->common));
+    ASSERT_EQ(0, out->get_presentation_position(out, &frames, &timestamp));
+    EXPECT_EQ(0u, frames);
+    mDev->close_output_stream(mDev, out);
+}
+
+TEST_F(AudioHwHalTest, InputReadsFillBuffer) {
+    struct audio_config config;
+    memset(&config, 0, sizeof(config));
+    audio_stream_in_t *in = NULL;
+    ASSERT_EQ(0, mDev->open_input_stream(mDev, 0, AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &in,
+                                         AUDIO_INPUT_FLAG_NONE, "", AUDIO_SOURCE_MIC));
+    ASSERT_NE(nullptr, in);
+
+    size_t bytes = in->common.get_buffer_size(&in->common);
+    ASSERT_NE(0u, bytes);
+    std::vector<uint8_t> buffer(bytes, 0x55);
+    ASSERT_EQ((ssize_t)bytes, in->read(in, buffer.data(), bytes));
+    EXPECT_EQ(std::vector<uint8_t>(bytes, 0), buffer);
+    EXPECT_EQ(0u, in->get_input_frames_lost(in));
+    mDev->close_input_stream(mDev, in);
+}
+
+TEST_F(AudioHwHalTest, StreamParameters) {
+    audio_stream_out_t *out = openOutput();
+    ASSERT_NE(nullptr, out);
+    EXPECT_EQ(0, out->common.set_parameters(&out->common, "routing=2"));
+    EXPECT_EQ(0, out->common.set_parameters(&out->common, ""));
+    char *reply = out->common.get_parameters(&out->common, "routing");
+    ASSERT_NE(nullptr, reply);
+    free(reply);
+    mDev->close_output_stream(mDev, out);
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compressed offload outputs of AudioHardwareStub, through the shim in
+// audio_hw_hal.cpp.
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <hardware/hardware.h>
+#include <hardware/audio.h>
+#include <system/audio.h>
+
+#include "AudioHardwareStub.h"
+
+extern "C" struct audio_module HAL_MODULE_INFO_SYM;
+
+namespace android_audio_legacy {
+
+// MPEG-1 layer III, 128 kbit/s, 44.1 kHz, stereo: 417 bytes and 1152 frames
+static const uint8_t kMp3Header[] = { 0xff, 0xfb, 0x90, 0x00 };
+static const size_t kMp3FrameBytes = 417;
+static const uint64_t kMp3FrameSamples = 1152;
+
+static std::vector<uint8_t> mp3Frames(size_t count)
+{
+    std::vector<uint8_t> data(count * kMp3FrameBytes);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(&data[i * kMp3FrameBytes], kMp3Header, sizeof(kMp3Header));
+    }
+    return data;
+}
+
+struct CallbackEvents {
+    std::mutex lock;
+    std::condition_variable cond;
+    int drainReady = 0;
+
+    static int callback(stream_callback_event_t event, void *param, void *cookie) {
+        CallbackEvents *events = (CallbackEvents *)cookie;
+        std::lock_guard<std::mutex> guard(events->lock);
+        if (event == STREAM_CBK_EVENT_DRAIN_READY) {
+            events->drainReady++;
+            events->cond.notify_all();
+        }
+        return 0;
+    }
+
+    bool waitForDrain(int count) {
+        std::unique_lock<std::mutex> guard(lock);
+        return cond.wait_for(guard, std::chrono::seconds(5),
+                             [&]() { return drainReady >= count; });
+    }
+};
+
+TEST(AudioOffloadOutputsTest, ModuleOpensOffloadOutputs) {
+    AudioHardwareStub hw;
+    EXPECT_TRUE(hw.supportsOffload());
+
+    int format = AUDIO_FORMAT_MP3;
+    uint32_t channels = 0;
+    uint32_t rate = 44100;
+    status_t status;
+    AudioStreamOut *out = hw.openOutputStreamWithFlags(AudioSystem::DEVICE_OUT_SPEAKER,
+            AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD, &format, &channels, &rate, &status);
+    ASSERT_NE(nullptr, out);
+    EXPECT_EQ(NO_ERROR, status);
+    EXPECT_EQ((uint32_t)AUDIO_CHANNEL_OUT_STEREO, channels);
+    EXPECT_EQ(AUDIO_FORMAT_MP3, out->format());
+    EXPECT_NE(nullptr, AudioStreamOutExtension::query(out));
+    hw.closeOutputStream(out);
+
+    // PCM outputs are not offloaded
+    format = AUDIO_FORMAT_PCM_16_BIT;
+    out = hw.openOutputStreamWithFlags(AudioSystem::DEVICE_OUT_SPEAKER,
+            AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD, &format, &channels, &rate, &status);
+    EXPECT_EQ(nullptr, out);
+    EXPECT_EQ(BAD_VALUE, status);
+    out = hw.openOutputStreamWithFlags(AudioSystem::DEVICE_OUT_SPEAKER,
+            AUDIO_OUTPUT_FLAG_NONE, &format, &channels, &rate, &status);
+    ASSERT_NE(nullptr, out);
+    EXPECT_EQ(nullptr, AudioStreamOutExtension::query(out));
+    hw.closeOutputStream(out);
+}
+
+class AudioHwHalOffloadTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        hw_device_t *device = NULL;
+        const hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+        ASSERT_EQ(0, module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device));
+        mDev = reinterpret_cast<audio_hw_device_t *>(device);
+        ASSERT_EQ(0, mDev->set_parameters(mDev, "stub_virtual_clock=1"));
+    }
+
+    virtual void TearDown() {
+        if (mOut != NULL) {
+            mDev->close_output_stream(mDev, mOut);
+        }
+        if (mDev != NULL) {
+            mDev->common.close(&mDev->common);
+        }
+    }
+
+    int openOffload(audio_format_t format, uint32_t sampleRate) {
+        struct audio_config config;
+        memset(&config, 0, sizeof(config));
+        config.format = format;
+        config.sample_rate = sampleRate;
+        config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+        return mDev->open_output_stream(mDev, 1, AUDIO_DEVICE_OUT_SPEAKER,
+                (audio_output_flags_t)(AUDIO_OUTPUT_FLAG_DIRECT |
+                                       AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD),
+                &config, &mOut, "");
+    }
+
+    uint64_t presentedFrames() {
+        uint64_t frames = 0;
+        struct timespec timestamp;
+        EXPECT_EQ(0, mOut->get_presentation_position(mOut, &frames, &timestamp));
+        return frames;
+    }
+
+    audio_hw_device_t *mDev = NULL;
+    audio_stream_out_t *mOut = NULL;
+};
+
+TEST_F(AudioHwHalOffloadTest, OffloadOutputHasControls) {
+    ASSERT_EQ(0, openOffload(AUDIO_FORMAT_MP3, 44100));
+    EXPECT_NE(nullptr, mOut->set_callback);
+    EXPECT_NE(nullptr, mOut->pause);
+    EXPECT_NE(nullptr, mOut->resume);
+    EXPECT_NE(nullptr, mOut->drain);
+    EXPECT_NE(nullptr, mOut->flush);
+    EXPECT_EQ(AUDIO_FORMAT_MP3, mOut->common.get_format(&mOut->common));
+
+    // flush() is only valid while paused
+    EXPECT_NE(0, mOut->flush(mOut));
+    EXPECT_EQ(0, mOut->pause(mOut));
+    EXPECT_EQ(0, mOut->flush(mOut));
+    EXPECT_EQ(0, mOut->resume(mOut));
+}
+
+TEST_F(AudioHwHalOffloadTest, RejectsFormatsWithoutDecoder) {
+    EXPECT_NE(0, openOffload(AUDIO_FORMAT_PCM_16_BIT, 44100));
+    EXPECT_NE(0, openOffload(AUDIO_FORMAT_MP3, 0));
+    EXPECT_EQ(nullptr, mOut);
+}
+
+TEST_F(AudioHwHalOffloadTest, BlockingDrainPlaysWrittenFrames) {
+    ASSERT_EQ(0, openOffload(AUDIO_FORMAT_MP3, 44100));
+    std::vector<uint8_t> data = mp3Frames(10);
+    ASSERT_EQ((ssize_t)data.size(), mOut->write(mOut, data.data(), data.size()));
+    // without a callback, drain() returns once the track is played
+    ASSERT_EQ(0, mOut->drain(mOut, AUDIO_DRAIN_ALL));
+    EXPECT_EQ(10 * kMp3FrameSamples, presentedFrames());
+}
+
+TEST_F(AudioHwHalOffloadTest, CallbackSignalsDrainAndFlushResets) {
+    ASSERT_EQ(0, openOffload(AUDIO_FORMAT_MP3, 44100));
+    CallbackEvents events;
+    ASSERT_EQ(0, mOut->set_callback(mOut, CallbackEvents::callback, &events));
+
+    std::vector<uint8_t> data = mp3Frames(4);
+    ASSERT_EQ((ssize_t)data.size(), mOut->write(mOut, data.data(), data.size()));
+    ASSERT_EQ(0, mOut->drain(mOut, AUDIO_DRAIN_EARLY_NOTIFY));
+    ASSERT_TRUE(events.waitForDrain(1));
+    EXPECT_EQ(4 * kMp3FrameSamples, presentedFrames());
+
+    ASSERT_EQ(0, mOut->pause(mOut));
+    ASSERT_EQ(0, mOut->flush(mOut));
+    EXPECT_EQ(0u, presentedFrames());
+    ASSERT_EQ(0, mOut->resume(mOut));
+}
+
+}  // namespace android_audio_legacy
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <string>
+
+#include <hardware_legacy/AudioParameterList.h>
+
+namespace android_audio_legacy {
+    using android::BAD_VALUE;
+    using android::NAME_NOT_FOUND;
+    using android::NO_ERROR;
+
+static std::string toString(const AudioParameterList& params)
+{
+    String8 result;
+    params.toString(&result);
+    return std::string(result.string());
+}
+
+TEST(AudioParameterListTest, ParsesInternedAndOtherKeys) {
+    AudioParameterList params;
+    ASSERT_EQ(NO_ERROR, params.parse("routing=2;vendor_mode=night;sampling_rate=48000"));
+    ASSERT_EQ(3u, params.size());
+
+    EXPECT_EQ(AudioParameterList::KEY_ROUTING, params.idAt(0));
+    EXPECT_STREQ("routing", params.keyAt(0));
+    EXPECT_EQ(AudioParameterList::KEY_OTHER, params.idAt(1));
+    EXPECT_STREQ("vendor_mode", params.keyAt(1));
+    EXPECT_STREQ("night", params.valueAt(1));
+
+    int value = 0;
+    EXPECT_EQ(NO_ERROR, params.getInt(AudioParameterList::KEY_SAMPLING_RATE, &value));
+    EXPECT_EQ(48000, value);
+    EXPECT_EQ(NAME_NOT_FOUND, params.getInt(AudioParameterList::KEY_FORMAT, &value));
+    EXPECT_EQ(1, params.indexOf("vendor_mode"));
+    EXPECT_EQ(0, params.indexOf("routing"));
+    EXPECT_EQ(NAME_NOT_FOUND, params.indexOf("vendor"));
+    EXPECT_EQ(NAME_NOT_FOUND, params.indexOf(AudioParameterList::KEY_OTHER));
+}
+
+TEST(AudioParameterListTest, ParseEdgeCases) {
+    AudioParameterList params;
+    // empty pairs are skipped, a repeated key keeps its last value
+    ASSERT_EQ(NO_ERROR, params.parse(";;routing=1;;routing=4;"));
+    ASSERT_EQ(1u, params.size());
+    EXPECT_STREQ("4", params.valueAt(0));
+
+    // keys without values, as given to getParameters()
+    ASSERT_EQ(NO_ERROR, params.parse("routing;vendor_key"));
+    ASSERT_EQ(2u, params.size());
+    EXPECT_STREQ("", params.valueAt(0));
+    EXPECT_STREQ("vendor_key", params.keyAt(1));
+    EXPECT_STREQ("", params.valueAt(1));
+
+    // parse() replaces the previous contents
+    ASSERT_EQ(NO_ERROR, params.parse(""));
+    EXPECT_EQ(0u, params.size());
+}
+
+TEST(AudioParameterListTest, GetIntRejectsNonNumbers) {
+    AudioParameterList params;
+    ASSERT_EQ(NO_ERROR, params.parse("routing=0x10;format=pcm;channels=12abc"));
+    int value = 0;
+    EXPECT_EQ(NO_ERROR, params.getInt(AudioParameterList::KEY_ROUTING, &value));
+    EXPECT_EQ(16, value);
+    EXPECT_EQ(BAD_VALUE, params.getInt(AudioParameterList::KEY_FORMAT, &value));
+    EXPECT_EQ(BAD_VALUE, params.getInt(AudioParameterList::KEY_CHANNELS, &value));
+    EXPECT_EQ(16, value);
+}
+
+TEST(AudioParameterListTest, EditAndSerialize) {
+    AudioParameterList params;
+    ASSERT_EQ(NO_ERROR, params.parse("routing=2;vendor_mode=night"));
+    EXPECT_EQ(NO_ERROR, params.addInt(AudioParameterList::KEY_ROUTING, 8));
+    EXPECT_EQ(NO_ERROR, params.add("vendor_mode", "day"));
+    EXPECT_EQ(NO_ERROR, params.add("format", "1"));
+    EXPECT_EQ(AudioParameterList::KEY_FORMAT, params.idAt(2));
+    EXPECT_EQ(NO_ERROR, params.add(AudioParameterList::KEY_CLOSING, "true"));
+    EXPECT_EQ(BAD_VALUE, params.add(AudioParameterList::KEY_OTHER, "x"));
+    EXPECT_EQ(BAD_VALUE, params.add(AudioParameterList::NUM_KEYS, "x"));
+    EXPECT_EQ("routing=8;vendor_mode=day;format=1;closing=true", toString(params));
+
+    EXPECT_EQ(NO_ERROR, params.remove(AudioParameterList::KEY_FORMAT));
+    EXPECT_EQ(NAME_NOT_FOUND, params.remove(AudioParameterList::KEY_FORMAT));
+    EXPECT_EQ("routing=8;vendor_mode=day;closing=true", toString(params));
+
+    params.clear();
+    EXPECT_EQ("", toString(params));
+}
+
+// more pairs and text than the inline storage holds
+TEST(AudioParameterListTest, LongListsSpillToHeap) {
+    std::string keyValuePairs;
+    for (int i = 0; i < 40; i++) {
+        if (i != 0) {
+            keyValuePairs += ";";
+        }
+        keyValuePairs += "vendor_key_" + std::to_string(i) + "=value_" + std::to_string(i * 3);
+    }
+    AudioParameterList params;
+    ASSERT_EQ(NO_ERROR, params.parse(keyValuePairs.c_str()));
+    ASSERT_EQ(40u, params.size());
+    EXPECT_STREQ("value_117", params.valueAt(39));
+    EXPECT_EQ(keyValuePairs, toString(params));
+
+    // and keeps growing with edits
+    for (int i = 0; i < 40; i++) {
+        std::string key = "added_" + std::to_string(i);
+        ASSERT_EQ(NO_ERROR, params.add(key.c_str(), "a long value that does not fit inline"));
+    }
+    ASSERT_EQ(80u, params.size());
+    EXPECT_EQ(79, params.indexOf("added_39"));
+    EXPECT_STREQ("vendor_key_0", params.keyAt(0));
+    EXPECT_STREQ("value_0", params.valueAt(0));
+}
+
+}  // namespace android_audio_legacy
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Device to device patches of AudioHardwareStub, and mix patches routed by
+// the shim in audio_hw_hal.cpp.
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+#include <hardware/hardware.h>
+#include <hardware/audio.h>
+#include <system/audio.h>
+
+#include "AudioHardwareStub.h"
+
+extern "C" struct audio_module HAL_MODULE_INFO_SYM;
+
+namespace android_audio_legacy {
+
+static struct audio_port_config devicePort(uint32_t device)
+{
+    struct audio_port_config config;
+    memset(&config, 0, sizeof(config));
+    config.type = AUDIO_PORT_TYPE_DEVICE;
+    config.ext.device.type = (audio_devices_t)device;
+    return config;
+}
+
+static struct audio_port_config mixPort(audio_io_handle_t handle)
+{
+    struct audio_port_config config;
+    memset(&config, 0, sizeof(config));
+    config.type = AUDIO_PORT_TYPE_MIX;
+    config.ext.mix.handle = handle;
+    return config;
+}
+
+// frames moved by the first patch listed in the dump
+static unsigned long long patchFrames(AudioPatchList& patches)
+{
+    FILE *file = tmpfile();
+    patches.dump(fileno(file));
+    rewind(file);
+    char text[512] = {};
+    fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    const char *bytes = strstr(text, "bytes, ");
+    return bytes != NULL ? strtoull(bytes + strlen("bytes, "), NULL, 10) : 0;
+}
+
+class TestAudioHardware : public AudioHardwareStub {
+public:
+    AudioPatchList& patches() { return mPatches; }
+};
+
+TEST(AudioPatchListTest, DeviceToDevicePatchRuns) {
+    TestAudioHardware hw;
+    struct audio_port_config source = devicePort(AudioSystem::DEVICE_IN_BUILTIN_MIC);
+    struct audio_port_config sink = devicePort(AudioSystem::DEVICE_OUT_SPEAKER);
+    audio_patch_handle_t handle = AUDIO_PATCH_HANDLE_NONE;
+    ASSERT_EQ(NO_ERROR, hw.createAudioPatch(1, &source, 1, &sink, &handle));
+    EXPECT_NE(AUDIO_PATCH_HANDLE_NONE, handle);
+    EXPECT_EQ(1u, hw.patches().size());
+
+    // 8 kHz stub capture, 20 ms buffers
+    usleep(200000);
+    EXPECT_GE(patchFrames(hw.patches()), 800u);
+
+    // an update keeps the handle
+    audio_patch_handle_t updated = handle;
+    sink = devicePort(AudioSystem::DEVICE_OUT_WIRED_HEADPHONE);
+    ASSERT_EQ(NO_ERROR, hw.createAudioPatch(1, &source, 1, &sink, &updated));
+    EXPECT_EQ(handle, updated);
+    EXPECT_EQ(1u, hw.patches().size());
+
+    audio_patch_handle_t unknown = handle + 1;
+    EXPECT_EQ(BAD_VALUE, hw.createAudioPatch(1, &source, 1, &sink, &unknown));
+    EXPECT_EQ(NO_ERROR, hw.releaseAudioPatch(handle));
+    EXPECT_EQ(BAD_VALUE, hw.releaseAudioPatch(handle));
+    EXPECT_EQ(0u, hw.patches().size());
+}
+
+TEST(AudioPatchListTest, MixPatchesAreNotSupported) {
+    TestAudioHardware hw;
+    struct audio_port_config source = mixPort(1);
+    struct audio_port_config sink = devicePort(AudioSystem::DEVICE_OUT_SPEAKER);
+    audio_patch_handle_t handle = AUDIO_PATCH_HANDLE_NONE;
+    EXPECT_EQ(INVALID_OPERATION, hw.createAudioPatch(1, &source, 1, &sink, &handle));
+    EXPECT_EQ(AUDIO_PATCH_HANDLE_NONE, handle);
+}
+
+// the module is released with its patches still running
+TEST(AudioPatchListTest, DestructorReleasesPatches) {
+    TestAudioHardware *hw = new TestAudioHardware();
+    struct audio_port_config source = devicePort(AudioSystem::DEVICE_IN_BUILTIN_MIC);
+    struct audio_port_config sink = devicePort(AudioSystem::DEVICE_OUT_SPEAKER);
+    audio_patch_handle_t handle = AUDIO_PATCH_HANDLE_NONE;
+    ASSERT_EQ(NO_ERROR, hw->createAudioPatch(1, &source, 1, &sink, &handle));
+    delete hw;
+}
+
+class AudioHwHalPatchTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        hw_device_t *device = NULL;
+        const hw_module_t *module = &HAL_MODULE_INFO_SYM.common;
+        ASSERT_EQ(0, module->methods->open(module, AUDIO_HARDWARE_INTERFACE, &device));
+        mDev = reinterpret_cast<audio_hw_device_t *>(device);
+    }
+
+    virtual void TearDown() {
+        if (mDev != NULL) {
+            mDev->common.close(&mDev->common);
+        }
+    }
+
+    std::string getParameters(struct audio_stream *stream, const char *keys) {
+        char *value = stream->get_parameters(stream, keys);
+        std::string result(value);
+        free(value);
+        return result;
+    }
+
+    audio_hw_device_t *mDev = NULL;
+};
+
+TEST_F(AudioHwHalPatchTest, ReportsVersion3) {
+    EXPECT_EQ((uint32_t)AUDIO_DEVICE_API_VERSION_3_0, mDev->common.version);
+    EXPECT_NE(nullptr, mDev->create_audio_patch);
+    EXPECT_NE(nullptr, mDev->release_audio_patch);
+}
+
+TEST_F(AudioHwHalPatchTest, MixPatchesSetRouting) {
+    struct audio_config config;
+    memset(&config, 0, sizeof(config));
+    audio_stream_out_t *out = NULL;
+    ASSERT_EQ(0, mDev->open_output_stream(mDev, 7, AUDIO_DEVICE_OUT_SPEAKER,
+                                          AUDIO_OUTPUT_FLAG_NONE, &config, &out, ""));
+    memset(&config, 0, sizeof(config));
+    audio_stream_in_t *in = NULL;
+    ASSERT_EQ(0, mDev->open_input_stream(mDev, 9, AUDIO_DEVICE_IN_BUILTIN_MIC, &config, &in,
+                                         AUDIO_INPUT_FLAG_NONE, "", ::AUDIO_SOURCE_MIC));
+
+    // playback to two devices
+    struct audio_port_config mix = mixPort(7);
+    struct audio_port_config devices[2] = {
+        devicePort(AUDIO_DEVICE_OUT_SPEAKER), devicePort(AUDIO_DEVICE_OUT_WIRED_HEADPHONE)
+    };
+    audio_patch_handle_t playback = AUDIO_PATCH_HANDLE_NONE;
+    ASSERT_EQ(0, mDev->create_audio_patch(mDev, 1, &mix, 2, devices, &playback));
+    EXPECT_NE(AUDIO_PATCH_HANDLE_NONE, playback);
+    EXPECT_EQ("routing=" + std::to_string(AUDIO_DEVICE_OUT_SPEAKER |
+                                          AUDIO_DEVICE_OUT_WIRED_HEADPHONE),
+              getParameters(&out->common, "routing"));
+
+    // capture
+    struct audio_port_config mic = devicePort(AUDIO_DEVICE_IN_BUILTIN_MIC);
+    struct audio_port_config input = mixPort(9);
+    input.ext.mix.usecase.source = ::AUDIO_SOURCE_MIC;
+    audio_patch_handle_t capture = AUDIO_PATCH_HANDLE_NONE;
+    ASSERT_EQ(0, mDev->create_audio_patch(mDev, 1, &mic, 1, &input, &capture));
+    EXPECT_NE(playback, capture);
+    EXPECT_EQ("routing=" + std::to_string((int)AUDIO_DEVICE_IN_BUILTIN_MIC),
+              getParameters(&in->common, "routing"));
+
+    // a stream the device does not have
+    struct audio_port_config unknown = mixPort(8);
+    audio_patch_handle_t handle = AUDIO_PATCH_HANDLE_NONE;
+    EXPECT_NE(0, mDev->create_audio_patch(mDev, 1, &unknown, 1, devices, &handle));
+    EXPECT_EQ(AUDIO_PATCH_HANDLE_NONE, handle);
+
+    // releasing a mix patch unroutes the stream
+    EXPECT_EQ(0, mDev->release_audio_patch(mDev, playback));
+    EXPECT_EQ("routing=0", getParameters(&out->common, "routing"));
+    EXPECT_NE(0, mDev->release_audio_patch(mDev, playback));
+
+    mDev->close_input_stream(mDev, in);
+    // the stream is gone, the patch can still be released
+    EXPECT_EQ(0, mDev->release_audio_patch(mDev, capture));
+    mDev->close_output_stream(mDev, out);
+}
+
+TEST_F(AudioHwHalPatchTest, DevicePatchesReachTheModule) {
+    struct audio_port_config mic = devicePort(AUDIO_DEVICE_IN_BUILTIN_MIC);
+    struct audio_port_config speaker = devicePort(AUDIO_DEVICE_OUT_SPEAKER);
+    audio_patch_handle_t handle = AUDIO_PATCH_HANDLE_NONE;
+    ASSERT_EQ(0, mDev->create_audio_patch(mDev, 1, &mic, 1, &speaker, &handle));
+    EXPECT_NE(AUDIO_PATCH_HANDLE_NONE, handle);
+
+    audio_patch_handle_t updated = handle;
+    ASSERT_EQ(0, mDev->create_audio_patch(mDev, 1, &mic, 1, &speaker, &updated));
+    EXPECT_EQ(handle, updated);
+
+    EXPECT_EQ(0, mDev->release_audio_patch(mDev, handle));
+    EXPECT_NE(0, mDev->release_audio_patch(mDev, handle));
+
+    // left for close() to clean up
+    handle = AUDIO_PATCH_HANDLE_NONE;
+    ASSERT_EQ(0, mDev->create_audio_patch(mDev, 1, &mic, 1, &speaker, &handle));
+}
+
+}  // namespace android_audio_legacy
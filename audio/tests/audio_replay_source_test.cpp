@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <utils/Timers.h>
+
+#include "AudioReplaySource.h"
+
+namespace android_audio_legacy {
+
+static void put16(std::vector<uint8_t> *file, uint16_t v)
+{
+    file->push_back(v);
+    file->push_back(v >> 8);
+}
+
+static void put32(std::vector<uint8_t> *file, uint32_t v)
+{
+    put16(file, v);
+    put16(file, v >> 16);
+}
+
+// a WAV file holding samples; dataSize overrides the size of the data chunk
+static std::vector<uint8_t> waveFile(uint16_t tag, uint16_t channels, uint32_t rate,
+                                     uint16_t bits, const void *samples, size_t bytes,
+                                     uint32_t dataSize)
+{
+    std::vector<uint8_t> file;
+    const uint8_t *riff = (const uint8_t *)"RIFF";
+    file.insert(file.end(), riff, riff + 4);
+    put32(&file, 36 + bytes);
+    const uint8_t *chunks = (const uint8_t *)"WAVEfmt ";
+    file.insert(file.end(), chunks, chunks + 8);
+    put32(&file, 16);
+    put16(&file, tag);
+    put16(&file, channels);
+    put32(&file, rate);
+    put32(&file, rate * channels * bits / 8);
+    put16(&file, channels * bits / 8);
+    put16(&file, bits);
+    const uint8_t *data = (const uint8_t *)"data";
+    file.insert(file.end(), data, data + 4);
+    put32(&file, dataSize);
+    file.insert(file.end(), (const uint8_t *)samples, (const uint8_t *)samples + bytes);
+    return file;
+}
+
+static std::vector<uint8_t> waveFile(uint16_t tag, uint16_t channels, uint32_t rate,
+                                     uint16_t bits, const void *samples, size_t bytes)
+{
+    return waveFile(tag, channels, rate, bits, samples, bytes, bytes);
+}
+
+class AudioReplaySourceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::string dir = ::testing::TempDir() + "audio_replay_source_XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(&dir[0]));
+        mDir = dir;
+    }
+    void TearDown() override {
+        std::string command = "rm -rf " + mDir;
+        system(command.c_str());
+    }
+
+    std::string writeFile(const char *name, const std::vector<uint8_t>& data) {
+        std::string path = mDir + "/" + name;
+        FILE *f = fopen(path.c_str(), "wb");
+        if (f != NULL) {
+            fwrite(data.data(), 1, data.size(), f);
+            fclose(f);
+        }
+        return path;
+    }
+
+    std::string mDir;
+};
+
+TEST_F(AudioReplaySourceTest, Pcm16Stereo) {
+    const int16_t samples[] = { 1, -1, 2, -2, 3, -3, 4, -4 };
+    std::string path = writeFile("pcm16.wav",
+            waveFile(1, 2, 48000, 16, samples, sizeof(samples)));
+
+    AudioReplaySource source;
+    ASSERT_EQ(NO_ERROR, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                    AUDIO_CHANNEL_IN_STEREO, 48000));
+    int16_t out[12];
+    ASSERT_EQ(6, source.read(out, 6));
+    // looping by default
+    const int16_t expected[] = { 1, -1, 2, -2, 3, -3, 4, -4, 1, -1, 2, -2 };
+    EXPECT_EQ(0, memcmp(expected, out, sizeof(out)));
+}
+
+// 32 bit WAVE_FORMAT_PCM is Q31, full scale like any other PCM width
+TEST_F(AudioReplaySourceTest, Pcm32IsQ31) {
+    const int32_t samples[] = { 1 << 30, -(1 << 30), INT32_MAX, INT32_MIN, 0, 1 << 16 };
+    std::string path = writeFile("pcm32.wav",
+            waveFile(1, 1, 48000, 32, samples, sizeof(samples)));
+
+    AudioReplaySource source;
+    ASSERT_EQ(NO_ERROR, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                    AUDIO_CHANNEL_IN_MONO, 48000));
+    int16_t out[6];
+    ASSERT_EQ(6, source.read(out, 6));
+    EXPECT_EQ(16384, out[0]);
+    EXPECT_EQ(-16384, out[1]);
+    EXPECT_EQ(INT16_MAX, out[2]);
+    EXPECT_EQ(INT16_MIN, out[3]);
+    EXPECT_EQ(0, out[4]);
+    EXPECT_EQ(1, out[5]);
+}
+
+TEST_F(AudioReplaySourceTest, FloatToStereo) {
+    const float samples[] = { 0.5f, -0.25f };
+    std::string path = writeFile("float.wav",
+            waveFile(3, 1, 48000, 32, samples, sizeof(samples)));
+
+    AudioReplaySource source;
+    ASSERT_EQ(NO_ERROR, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                    AUDIO_CHANNEL_IN_STEREO, 48000));
+    int16_t out[4];
+    ASSERT_EQ(2, source.read(out, 2));
+    EXPECT_EQ(16384, out[0]);
+    EXPECT_EQ(16384, out[1]);
+    EXPECT_EQ(-8192, out[2]);
+    EXPECT_EQ(-8192, out[3]);
+}
+
+TEST_F(AudioReplaySourceTest, RejectsUnsupportedFiles) {
+    const uint8_t samples[16] = {};
+    AudioReplaySource source;
+    // 8 and 24 bit PCM, 64 bit float, A-law
+    std::string path = writeFile("pcm8.wav", waveFile(1, 1, 48000, 8, samples, 16));
+    EXPECT_EQ(BAD_VALUE, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                     AUDIO_CHANNEL_IN_MONO, 48000));
+    path = writeFile("pcm24.wav", waveFile(1, 1, 48000, 24, samples, 15));
+    EXPECT_EQ(BAD_VALUE, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                     AUDIO_CHANNEL_IN_MONO, 48000));
+    path = writeFile("double.wav", waveFile(3, 1, 48000, 64, samples, 16));
+    EXPECT_EQ(BAD_VALUE, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                     AUDIO_CHANNEL_IN_MONO, 48000));
+    path = writeFile("alaw.wav", waveFile(6, 1, 48000, 8, samples, 16));
+    EXPECT_EQ(BAD_VALUE, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                     AUDIO_CHANNEL_IN_MONO, 48000));
+    // more channels than the input masks carry
+    path = writeFile("quad.wav", waveFile(1, 4, 48000, 16, samples, 16));
+    EXPECT_EQ(BAD_VALUE, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                     AUDIO_CHANNEL_IN_MONO, 48000));
+    // no data chunk
+    std::vector<uint8_t> noData = waveFile(1, 1, 48000, 16, samples, 0);
+    noData.resize(noData.size() - 8);
+    path = writeFile("nodata.wav", noData);
+    EXPECT_EQ(BAD_VALUE, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                     AUDIO_CHANNEL_IN_MONO, 48000));
+    EXPECT_FALSE(source.isOpen());
+    EXPECT_EQ(NO_INIT, source.read(NULL, 1));
+}
+
+// a dump that was never finalized has a zero or oversized data chunk
+TEST_F(AudioReplaySourceTest, UnfinishedDataChunkEndsWithTheFile) {
+    const int16_t samples[] = { 10, 20, 30 };
+    AudioReplaySource source;
+    source.setLoop(false);
+    for (uint32_t dataSize : { 0u, 1000u }) {
+        std::string path = writeFile("unfinished.wav",
+                waveFile(1, 1, 48000, 16, samples, sizeof(samples), dataSize));
+        ASSERT_EQ(NO_ERROR, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                        AUDIO_CHANNEL_IN_MONO, 48000)) << dataSize;
+        int16_t out[5];
+        ASSERT_EQ(5, source.read(out, 5));
+        // followed by silence, the file does not loop
+        const int16_t expected[] = { 10, 20, 30, 0, 0 };
+        EXPECT_EQ(0, memcmp(expected, out, sizeof(out))) << dataSize;
+    }
+}
+
+// files without a RIFF header are raw PCM in the stream configuration
+TEST_F(AudioReplaySourceTest, RawFileAndSeek) {
+    std::vector<int16_t> samples(480);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = (int16_t)i;
+    }
+    std::vector<uint8_t> data((const uint8_t *)samples.data(),
+                              (const uint8_t *)(samples.data() + samples.size()));
+    std::string path = writeFile("raw.pcm", data);
+
+    AudioReplaySource source;
+    ASSERT_EQ(NO_ERROR, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                    AUDIO_CHANNEL_IN_MONO, 48000));
+    ASSERT_EQ(NO_ERROR, source.seek(5));
+    int16_t out[2];
+    ASSERT_EQ(2, source.read(out, 2));
+    EXPECT_EQ(240, out[0]);
+    EXPECT_EQ(241, out[1]);
+    EXPECT_EQ(BAD_VALUE, source.seek(10));
+}
+
+// reads return when their frames would have been captured
+TEST_F(AudioReplaySourceTest, ReadsArePaced) {
+    std::vector<int16_t> samples(480);
+    std::string path = writeFile("paced.wav",
+            waveFile(1, 1, 48000, 16, samples.data(), samples.size() * sizeof(int16_t)));
+
+    AudioReplaySource source;
+    ASSERT_EQ(NO_ERROR, source.open(path.c_str(), AUDIO_FORMAT_PCM_16_BIT,
+                                    AUDIO_CHANNEL_IN_MONO, 48000));
+    std::vector<int16_t> out(480);
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(480, source.read(out.data(), out.size()));
+    }
+    // 100 ms of audio
+    EXPECT_GE(systemTime(SYSTEM_TIME_MONOTONIC) - start, ms2ns(95));
+}
+
+}  // namespace android_audio_legacy
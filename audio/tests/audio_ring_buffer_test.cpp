@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "AudioRingBuffer.h"
+
+namespace android_audio_legacy {
+
+TEST(AudioRingBufferTest, InitRoundsUpToPowerOfTwo) {
+    AudioRingBuffer ring;
+    ASSERT_EQ(NO_ERROR, ring.init(100));
+    EXPECT_EQ(128u, ring.size());
+    EXPECT_EQ(0u, ring.availableToRead());
+    EXPECT_EQ(128u, ring.availableToWrite());
+
+    ASSERT_EQ(NO_ERROR, ring.init(64));
+    EXPECT_EQ(64u, ring.size());
+}
+
+TEST(AudioRingBufferTest, WriteStopsWhenFull) {
+    AudioRingBuffer ring;
+    ASSERT_EQ(NO_ERROR, ring.init(16));
+    uint8_t in[20];
+    for (size_t i = 0; i < sizeof(in); i++) {
+        in[i] = i;
+    }
+    EXPECT_EQ(16u, ring.write(in, sizeof(in)));
+    EXPECT_EQ(0u, ring.availableToWrite());
+    EXPECT_EQ(0u, ring.write(in, 1));
+
+    uint8_t out[20];
+    EXPECT_EQ(16u, ring.read(out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(in, out, 16));
+    EXPECT_EQ(0u, ring.read(out, 1));
+}
+
+TEST(AudioRingBufferTest, ReadAndWriteWrapAround) {
+    AudioRingBuffer ring;
+    ASSERT_EQ(NO_ERROR, ring.init(16));
+    uint8_t in[10];
+    uint8_t out[10];
+    // each transfer starts where the previous one ended, so that most wrap
+    for (int pass = 0; pass < 20; pass++) {
+        for (size_t i = 0; i < sizeof(in); i++) {
+            in[i] = pass * 16 + i;
+        }
+        ASSERT_EQ(sizeof(in), ring.write(in, sizeof(in)));
+        EXPECT_EQ(sizeof(in), ring.availableToRead());
+        EXPECT_EQ(ring.size() - sizeof(in), ring.availableToWrite());
+        ASSERT_EQ(sizeof(out), ring.read(out, sizeof(out)));
+        ASSERT_EQ(0, memcmp(in, out, sizeof(in))) << pass;
+    }
+}
+
+TEST(AudioRingBufferTest, SkipAndReset) {
+    AudioRingBuffer ring;
+    ASSERT_EQ(NO_ERROR, ring.init(16));
+    const uint8_t in[] = { 1, 2, 3, 4, 5, 6 };
+    ASSERT_EQ(sizeof(in), ring.write(in, sizeof(in)));
+    EXPECT_EQ(4u, ring.skip(4));
+    uint8_t out[4];
+    ASSERT_EQ(2u, ring.read(out, sizeof(out)));
+    EXPECT_EQ(5, out[0]);
+    EXPECT_EQ(6, out[1]);
+    EXPECT_EQ(0u, ring.skip(1));
+
+    ASSERT_EQ(sizeof(in), ring.write(in, sizeof(in)));
+    ring.reset();
+    EXPECT_EQ(0u, ring.availableToRead());
+    EXPECT_EQ(16u, ring.availableToWrite());
+}
+
+// one producer and one consumer thread, neither of them locking
+TEST(AudioRingBufferTest, ProducerAndConsumerThreads) {
+    AudioRingBuffer ring;
+    ASSERT_EQ(NO_ERROR, ring.init(256));
+    const size_t kTotal = 1 << 20;
+
+    std::thread producer([&]() {
+        uint8_t chunk[100];
+        size_t written = 0;
+        while (written < kTotal) {
+            size_t count = kTotal - written < sizeof(chunk) ? kTotal - written : sizeof(chunk);
+            for (size_t i = 0; i < count; i++) {
+                chunk[i] = (uint8_t)((written + i) * 7);
+            }
+            size_t done = ring.write(chunk, count);
+            written += done;
+            if (done == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<uint8_t> out(kTotal);
+    size_t read = 0;
+    while (read < kTotal) {
+        size_t done = ring.read(&out[read], 73);
+        read += done;
+        if (done == 0) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < kTotal; i++) {
+        if (out[i] != (uint8_t)(i * 7)) {
+            mismatches++;
+        }
+    }
+    EXPECT_EQ(0u, mismatches);
+}
+
+}  // namespace android_audio_legacy
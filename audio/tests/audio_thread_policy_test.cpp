@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <string>
+#include <thread>
+
+#include "AudioThreadPolicy.h"
+
+namespace android_audio_legacy {
+
+static status_t setParameters(AudioThreadPolicy *policy, const char *keyValuePairs)
+{
+    AudioParameterList params;
+    status_t status = params.parse(keyValuePairs);
+    return status != NO_ERROR ? status : policy->setParameters(params);
+}
+
+static String8 getParameter(AudioThreadPolicy *policy, const char *key)
+{
+    AudioParameter keys = AudioParameter(String8(key));
+    AudioParameter response;
+    policy->getParameters(keys, &response);
+    String8 value;
+    response.get(String8(key), value);
+    return value;
+}
+
+TEST(AudioThreadPolicyTest, SetParametersFromList) {
+    AudioThreadPolicy policy;
+    ASSERT_EQ(NO_ERROR, setParameters(&policy,
+            "routing=2;sched_capture_priority=2;sched_capture_policy=fifo;sched_dump_cpus=0-1"));
+    // the policy is applied before the priority whatever their order
+    EXPECT_EQ(String8("fifo"), getParameter(&policy, "sched_capture_policy"));
+    EXPECT_EQ(String8("2"), getParameter(&policy, "sched_capture_priority"));
+    EXPECT_EQ(String8("0-1"), getParameter(&policy, "sched_dump_cpus"));
+    EXPECT_EQ(String8("default"), getParameter(&policy, "sched_render_policy"));
+
+    EXPECT_EQ(BAD_VALUE, setParameters(&policy, "sched_dump_cpus=7-3"));
+    EXPECT_EQ(BAD_VALUE, setParameters(&policy, "sched_dump_policy=deadline"));
+    EXPECT_EQ(String8("0-1"), getParameter(&policy, "sched_dump_cpus"));
+}
+
+// keys without the sched_ prefix do not wake the threads up
+TEST(AudioThreadPolicyTest, OtherKeysKeepGeneration) {
+    AudioThreadPolicy policy;
+    uint32_t generation = 0;
+    ASSERT_EQ(NO_ERROR, setParameters(&policy, "sched_dump_cpus=all"));
+    policy.apply(AudioThreadPolicy::ROLE_DUMP, &generation);
+    uint32_t applied = generation;
+    EXPECT_NE(0u, applied);
+
+    ASSERT_EQ(NO_ERROR, setParameters(&policy, "routing=2;sched_unknown_policy=fifo"));
+    policy.apply(AudioThreadPolicy::ROLE_DUMP, &generation);
+    EXPECT_EQ(applied, generation);
+}
+
+TEST(AudioThreadPolicyTest, RtPriorityIsCapped) {
+    AudioThreadPolicy policy;
+    ASSERT_EQ(NO_ERROR, setParameters(&policy, "sched_render_policy=rr"));
+    EXPECT_EQ(String8("2"), getParameter(&policy, "sched_render_priority"));
+
+    char keyValuePair[64];
+    snprintf(keyValuePair, sizeof(keyValuePair), "sched_render_priority=%d",
+             AudioThreadPolicy::MAX_RT_PRIORITY);
+    EXPECT_EQ(NO_ERROR, setParameters(&policy, keyValuePair));
+    snprintf(keyValuePair, sizeof(keyValuePair), "sched_render_priority=%d",
+             AudioThreadPolicy::MAX_RT_PRIORITY + 1);
+    EXPECT_EQ(BAD_VALUE, setParameters(&policy, keyValuePair));
+    EXPECT_EQ(BAD_VALUE, setParameters(&policy, "sched_render_priority=99"));
+    EXPECT_EQ(BAD_VALUE, setParameters(&policy, "sched_render_priority=0"));
+
+    // nice values for SCHED_OTHER
+    ASSERT_EQ(NO_ERROR, setParameters(&policy,
+                                      "sched_render_policy=other;sched_render_priority=19"));
+    EXPECT_EQ(BAD_VALUE, setParameters(&policy, "sched_render_priority=20"));
+}
+
+TEST(AudioThreadPolicyTest, CgroupMustBeUnderKnownRoots) {
+    AudioThreadPolicy policy;
+    static const char *kAccepted[] = {
+        "/dev/cpuset",
+        "/dev/cpuset/audio-app",
+        "/dev/stune/top-app",
+        "/dev/stune/rt",
+    };
+    static const char *kRejected[] = {
+        "",
+        "dev/cpuset",
+        "/",
+        "/data/local/tmp",
+        "/dev/cpusets",
+        "/dev/cpuset/../../proc/self",
+        "/dev/stune/./top-app",
+        "/dev/cpuset//audio-app",
+        "/sys/fs/cgroup",
+    };
+    for (const char *path : kAccepted) {
+        std::string keyValuePair = std::string("sched_patch_cgroup=") + path;
+        EXPECT_EQ(NO_ERROR, setParameters(&policy, keyValuePair.c_str())) << path;
+        EXPECT_EQ(String8(path), getParameter(&policy, "sched_patch_cgroup"));
+    }
+    for (const char *path : kRejected) {
+        std::string keyValuePair = std::string("sched_patch_cgroup=") + path;
+        EXPECT_EQ(BAD_VALUE, setParameters(&policy, keyValuePair.c_str())) << path;
+    }
+    EXPECT_EQ(String8("/dev/stune/rt"), getParameter(&policy, "sched_patch_cgroup"));
+}
+
+// a thread picks up its role's configuration on its next apply()
+TEST(AudioThreadPolicyTest, ApplyConfiguresCallingThread) {
+    AudioThreadPolicy policy;
+    ASSERT_EQ(NO_ERROR, setParameters(&policy,
+            "sched_capture_policy=other;sched_capture_priority=5;sched_capture_cpus=0"));
+
+    int nice = 0;
+    bool onCpu0 = false;
+    std::thread thread([&]() {
+        uint32_t generation = 0;
+        policy.apply(AudioThreadPolicy::ROLE_CAPTURE, &generation);
+        nice = getpriority(PRIO_PROCESS, gettid());
+        cpu_set_t cpus;
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+            onCpu0 = CPU_COUNT(&cpus) == 1 && CPU_ISSET(0, &cpus);
+        }
+    });
+    thread.join();
+    EXPECT_EQ(5, nice);
+    EXPECT_TRUE(onCpu0);
+}
+
+}  // namespace android_audio_legacy
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "PolyphaseResampler.h"
+
+namespace android_audio_legacy {
+
+static std::vector<int16_t> sine(uint32_t rate, double frequency, size_t frames,
+                                 uint32_t channelCount)
+{
+    std::vector<int16_t> data(frames * channelCount);
+    for (size_t i = 0; i < frames; i++) {
+        for (uint32_t c = 0; c < channelCount; c++) {
+            data[i * channelCount + c] =
+                    (int16_t)lrint(16000 * sin(2 * M_PI * frequency * i / rate + c));
+        }
+    }
+    return data;
+}
+
+// resample all of in, chunk input frames at a time
+static std::vector<int16_t> resample(PolyphaseResampler *resampler, const std::vector<int16_t>& in,
+                                     uint32_t channelCount, size_t chunk)
+{
+    std::vector<int16_t> out;
+    std::vector<int16_t> buffer(resampler->outputFramesFor(chunk) * channelCount);
+    size_t frames = in.size() / channelCount;
+    size_t done = 0;
+    while (done < frames) {
+        size_t count = std::min(chunk, frames - done);
+        size_t queued = 0;
+        while (queued < count) {
+            queued += resampler->write(&in[(done + queued) * channelCount], count - queued);
+            size_t got;
+            while ((got = resampler->read(buffer.data(), buffer.size() / channelCount)) != 0) {
+                out.insert(out.end(), buffer.begin(), buffer.begin() + got * channelCount);
+            }
+        }
+        done += count;
+    }
+    return out;
+}
+
+TEST(PolyphaseResamplerTest, SupportedRates) {
+    EXPECT_TRUE(PolyphaseResampler::isSupported(8000, 44100));
+    EXPECT_TRUE(PolyphaseResampler::isSupported(44100, 48000));
+    EXPECT_TRUE(PolyphaseResampler::isSupported(48000, 8000));
+    PolyphaseResampler resampler;
+    EXPECT_NE(NO_ERROR, resampler.set(44100, 48000, PolyphaseResampler::MAX_CHANNELS + 1));
+}
+
+TEST(PolyphaseResamplerTest, OutputLength) {
+    static const uint32_t kRates[][2] = { { 8000, 44100 }, { 44100, 48000 }, { 48000, 8000 } };
+    for (const auto& rates : kRates) {
+        PolyphaseResampler resampler;
+        ASSERT_EQ(NO_ERROR, resampler.set(rates[0], rates[1], 1));
+        std::vector<int16_t> in = sine(rates[0], 440, rates[0], 1);
+        std::vector<int16_t> out = resample(&resampler, in, 1, 512);
+        // one second in, one second out, less what is still in the filter
+        EXPECT_LE(out.size(), rates[1]);
+        EXPECT_GE(out.size(), rates[1] - rates[1] / 100) << rates[0] << " -> " << rates[1];
+    }
+}
+
+// the filter state carries across calls: the chunking is invisible
+TEST(PolyphaseResamplerTest, ChunkSizeDoesNotMatter) {
+    std::vector<int16_t> in = sine(11025, 3000, 11025, 2);
+    PolyphaseResampler small, large;
+    ASSERT_EQ(NO_ERROR, small.set(11025, 48000, 2));
+    ASSERT_EQ(NO_ERROR, large.set(11025, 48000, 2));
+    std::vector<int16_t> a = resample(&small, in, 2, 7);
+    std::vector<int16_t> b = resample(&large, in, 2, 1000);
+    size_t frames = std::min(a.size(), b.size());
+    ASSERT_GT(frames, 40000u);
+    EXPECT_TRUE(std::equal(a.begin(), a.begin() + frames, b.begin()));
+}
+
+// a passband tone keeps its level and its frequency
+TEST(PolyphaseResamplerTest, SineKeepsLevelAndFrequency) {
+    static const double kFrequency = 1000;
+    PolyphaseResampler resampler;
+    ASSERT_EQ(NO_ERROR, resampler.set(44100, 48000, 1));
+    std::vector<int16_t> out = resample(&resampler, sine(44100, kFrequency, 44100, 1), 1, 512);
+
+    // skip the filter's start up
+    size_t start = 1000;
+    size_t frames = out.size() - start;
+    double power = 0;
+    size_t crossings = 0;
+    for (size_t i = start; i < out.size(); i++) {
+        power += (double)out[i] * out[i];
+        if (i > start && (out[i - 1] < 0) != (out[i] < 0)) {
+            crossings++;
+        }
+    }
+    double rms = sqrt(power / frames);
+    EXPECT_NEAR(16000 / sqrt(2), rms, 16000 / sqrt(2) * 0.06);
+    double expected = 2 * kFrequency * frames / 48000;
+    EXPECT_NEAR(expected, crossings, 2);
+}
+
+TEST(PolyphaseResamplerTest, InputFramesNeeded) {
+    PolyphaseResampler resampler;
+    ASSERT_EQ(NO_ERROR, resampler.set(8000, 44100, 1));
+    std::vector<int16_t> in(4096);
+    std::vector<int16_t> out(4096);
+    for (size_t i = 0; i < 200; i++) {
+        size_t want = 1 + (i * 37) % 500;
+        size_t got = resampler.read(out.data(), want);
+        if (got < want) {
+            size_t needed = resampler.inputFramesNeeded(want - got);
+            ASSERT_EQ(needed, resampler.write(in.data(), needed));
+            EXPECT_EQ(want - got, resampler.read(out.data(), want - got)) << "pass " << i;
+        }
+    }
+}
+
+TEST(PolyphaseResamplerTest, ResetClearsQueuedInput) {
+    PolyphaseResampler resampler;
+    ASSERT_EQ(NO_ERROR, resampler.set(8000, 48000, 1));
+    std::vector<int16_t> in = sine(8000, 440, 800, 1);
+    std::vector<int16_t> out(48000);
+    resampler.write(in.data(), in.size());
+    resampler.reset();
+    EXPECT_EQ(0u, resampler.read(out.data(), out.size()));
+}
+
+}  // namespace android_audio_legacy
@@ -51,6 +51,19 @@ public:
     /**This method dumps the state of the audio hardware */
     virtual status_t dumpState(int fd, const Vector<String16>& args);
 
+    /**
+     * The default implementations are unsupported: modules opt in to device
+     * to device patches with an AudioPatchList.
+     */
+    virtual int createAudioPatch(unsigned int num_sources,
+                               const struct audio_port_config *sources,
+                               unsigned int num_sinks,
+                               const struct audio_port_config *sinks,
+                               audio_patch_handle_t *handle);
+    virtual int releaseAudioPatch(audio_patch_handle_t handle);
+    virtual int getAudioPort(struct audio_port *port);
+    virtual int setAudioPortConfig(const struct audio_port_config *config);
+
 protected:
     /** returns true if the given mode maps to a telephony or VoIP call is in progress */
     virtual bool     isModeInCall(int mode)
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_HARDWARE_EXTENSION_H
+#define ANDROID_AUDIO_HARDWARE_EXTENSION_H
+
+#include <hardware_legacy/AudioHardwareInterface.h>
+#include <hardware_legacy/AudioParameterList.h>
+
+namespace android_audio_legacy {
+
+// ----------------------------------------------------------------------------
+
+/**
+ * Optional features of legacy devices and streams.
+ *
+ * The classes in AudioHardwareInterface.h keep the layout that existing
+ * implementations are built against, so features added to the legacy HAL
+ * live in these extension classes instead. An implementation opts in by also
+ * deriving from the extension of its interface, constructed with the object
+ * it extends. query() returns the extension of an object, or NULL if it has
+ * none; the HAL shim queries once when a device or stream is opened and uses
+ * the plain interface without an extension.
+ *
+ * An extension is registered from its constructor to its destructor: the
+ * object must not be used through query() while it is being destroyed.
+ */
+class AudioStreamOutExtension
+{
+public:
+    explicit            AudioStreamOutExtension(AudioStreamOut *out);
+    virtual             ~AudioStreamOutExtension();
+
+    static AudioStreamOutExtension* query(AudioStreamOut *out);
+
+    // same as setParameters() for parameters that are already parsed. The default
+    // implementation serializes them and calls setParameters().
+    virtual status_t    setParameterList(const AudioParameterList& params);
+
+    // attach or detach an effect that processes the frames written to the
+    // output. The default implementation accepts and ignores effects.
+    virtual status_t    addAudioEffect(effect_handle_t effect);
+    virtual status_t    removeAudioEffect(effect_handle_t effect);
+
+    // compressed offload outputs (AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) only.
+    // Once a callback is set, write() does not block and the stream signals
+    // STREAM_CBK_EVENT_WRITE_READY and STREAM_CBK_EVENT_DRAIN_READY. drain()
+    // ends the current track; flush() is only valid while paused. The default
+    // implementations are unsupported.
+    virtual status_t    setCallback(stream_callback_t callback, void *cookie);
+    virtual status_t    pause();
+    virtual status_t    resume();
+    virtual status_t    drain(audio_drain_type_t type);
+    virtual status_t    flush();
+
+private:
+                        AudioStreamOutExtension(const AudioStreamOutExtension&);
+    AudioStreamOutExtension& operator=(const AudioStreamOutExtension&);
+
+    AudioStreamOut      *mOut;
+};
+
+class AudioStreamInExtension
+{
+public:
+    explicit            AudioStreamInExtension(AudioStreamIn *in);
+    virtual             ~AudioStreamInExtension();
+
+    static AudioStreamInExtension* query(AudioStreamIn *in);
+
+    // same as setParameters() for parameters that are already parsed. The default
+    // implementation serializes them and calls setParameters().
+    virtual status_t    setParameterList(const AudioParameterList& params);
+
+private:
+                        AudioStreamInExtension(const AudioStreamInExtension&);
+    AudioStreamInExtension& operator=(const AudioStreamInExtension&);
+
+    AudioStreamIn       *mIn;
+};
+
+class AudioHardwareExtension
+{
+public:
+    explicit            AudioHardwareExtension(AudioHardwareInterface *hw);
+    virtual             ~AudioHardwareExtension();
+
+    static AudioHardwareExtension* query(AudioHardwareInterface *hw);
+
+    // same as setParameters() for parameters that are already parsed. The default
+    // implementation serializes them and calls setParameters().
+    virtual status_t    setParameterList(const AudioParameterList& params);
+
+    // true if createAudioPatch() and releaseAudioPatch() connect devices. The
+    // HAL shim then reports AUDIO_DEVICE_API_VERSION_3_0 and routes mix
+    // patches itself. The default implementation returns false.
+    virtual bool        supportsAudioPatches() const;
+
+    // true if openOutputStreamWithFlags() opens AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD
+    // outputs with an AudioStreamOutExtension implementing the offload calls.
+    // The HAL shim refuses offload outputs otherwise. The default
+    // implementation returns false.
+    virtual bool        supportsOffload() const;
+
+private:
+                        AudioHardwareExtension(const AudioHardwareExtension&);
+    AudioHardwareExtension& operator=(const AudioHardwareExtension&);
+
+    AudioHardwareInterface *mHardware;
+};
+
+/**
+ * hand parsed parameters to a device or stream that may not have an
+ * extension: setParameterList() of its extension, or setParameters() with
+ * the serialized list.
+ */
+status_t setParameterList(AudioStreamOut *out, const AudioParameterList& params);
+status_t setParameterList(AudioStreamIn *in, const AudioParameterList& params);
+status_t setParameterList(AudioHardwareInterface *hw, const AudioParameterList& params);
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_HARDWARE_EXTENSION_H
@@ -60,16 +60,19 @@ public:
     virtual uint32_t    channels() const = 0;
 
     /**
-     * return audio format in 8bit or 16bit PCM format -
+     * return audio format in 8bit, 16bit, 8.24 or float PCM format -
      * eg. AudioSystem:PCM_16_BIT
      */
     virtual int         format() const = 0;
 
     /**
-     * return the frame size (number of bytes per sample).
+     * return the frame size (number of bytes per sample), 1 for compressed
+     * formats, which have no fixed frame size.
      */
-    uint32_t    frameSize() const { return audio_channel_count_from_out_mask(channels())*
-                            ((format()==AUDIO_FORMAT_PCM_16_BIT)?sizeof(int16_t):sizeof(int8_t)); }
+    uint32_t    frameSize() const { return audio_is_linear_pcm((audio_format_t)format()) ?
+                            audio_channel_count_from_out_mask(channels())*
+                            audio_bytes_per_sample((audio_format_t)format()) :
+                            sizeof(int8_t); }
 
     /**
      * return the audio hardware driver latency in milli seconds.
@@ -142,16 +145,19 @@ public:
     virtual uint32_t    channels() const = 0;
 
     /**
-     * return audio format in 8bit or 16bit PCM format -
+     * return audio format in 8bit, 16bit, 8.24 or float PCM format -
      * eg. AudioSystem:PCM_16_BIT
      */
     virtual int         format() const = 0;
 
     /**
-     * return the frame size (number of bytes per sample).
+     * return the frame size (number of bytes per sample), 1 for compressed
+     * formats, which have no fixed frame size.
      */
-    uint32_t    frameSize() const { return audio_channel_count_from_in_mask(channels())*
-                            ((format()==AudioSystem::PCM_16_BIT)?sizeof(int16_t):sizeof(int8_t)); }
+    uint32_t    frameSize() const { return audio_is_linear_pcm((audio_format_t)format()) ?
+                            audio_channel_count_from_in_mask(channels())*
+                            audio_bytes_per_sample((audio_format_t)format()) :
+                            sizeof(int8_t); }
 
     /** set the input gain for the audio driver. This method is for
      *  for future use */
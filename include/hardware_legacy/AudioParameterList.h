@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_PARAMETER_LIST_H
+#define ANDROID_AUDIO_PARAMETER_LIST_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/Errors.h>
+#include <utils/String8.h>
+
+namespace android_audio_legacy {
+    using android::status_t;
+    using android::String8;
+
+// ----------------------------------------------------------------------------
+
+/**
+ * AudioParameterList holds the key value pairs of a "key1=value1;key2=value2"
+ * parameter string, parsed once.
+ *
+ * Keys the legacy HAL knows about are interned: they are looked up by id
+ * instead of by name. The string is copied and split in place into a small
+ * buffer inside the object, so a typical routing or format change is parsed,
+ * edited and handed down without allocating. Longer strings spill to the heap.
+ */
+class AudioParameterList {
+public:
+    enum {
+        KEY_OTHER = -1,             // not interned, use keyAt()
+        KEY_ROUTING = 0,
+        KEY_SAMPLING_RATE,
+        KEY_FORMAT,
+        KEY_CHANNELS,
+        KEY_FRAME_COUNT,
+        KEY_INPUT_SOURCE,
+        KEY_SCREEN_STATE,
+        KEY_BLUETOOTH_ENABLED,
+        KEY_A2DP_SUSPENDED,
+        KEY_A2DP_SINK_ADDRESS,
+        KEY_CLOSING,
+        NUM_KEYS
+    };
+
+                        AudioParameterList();
+                        ~AudioParameterList();
+
+    /** replace the contents with the pairs of keyValuePairs */
+    status_t            parse(const char *keyValuePairs);
+    void                clear();
+
+    size_t              size() const { return mCount; }
+    int                 idAt(size_t index) const { return mEntries[index].id; }
+    const char*         keyAt(size_t index) const;
+    const char*         valueAt(size_t index) const { return mStorage + mEntries[index].value; }
+
+    ssize_t             indexOf(int id) const;
+    ssize_t             indexOf(const char *key) const;
+
+    /** same semantics as AudioParameter: NAME_NOT_FOUND, or BAD_VALUE for getInt() */
+    status_t            get(int id, const char **value) const;
+    status_t            getInt(int id, int *value) const;
+
+    /** add the pair, or replace the value if the key is already present */
+    status_t            add(int id, const char *value);
+    status_t            add(const char *key, const char *value);
+    status_t            addInt(int id, int value);
+    status_t            remove(int id);
+
+    /** serialize back to "key1=value1;key2=value2" */
+    void                toString(String8 *result) const;
+
+    static const char*  keyName(int id);
+    static int          keyId(const char *key);
+
+private:
+                        AudioParameterList(const AudioParameterList&);
+    AudioParameterList& operator=(const AudioParameterList&);
+
+    enum {
+        INLINE_STORAGE = 192,
+        INLINE_ENTRIES = 8,
+    };
+
+    struct Entry {
+        int16_t         id;
+        uint16_t        key;        // offset of the name in mStorage, KEY_OTHER only
+        uint16_t        value;      // offset of the value in mStorage
+    };
+
+    ssize_t             store(const char *text, size_t length);
+    status_t            set(int id, const char *key, const char *value);
+    status_t            append(int id, size_t key, size_t value);
+
+    char                *mStorage;
+    size_t              mStorageSize;
+    size_t              mStorageUsed;
+    Entry               *mEntries;
+    size_t              mCapacity;
+    size_t              mCount;
+    char                mInlineStorage[INLINE_STORAGE];
+    Entry               mInlineEntries[INLINE_ENTRIES];
+};
+
+// ----------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_AUDIO_PARAMETER_LIST_H